@@ -18,6 +18,45 @@
  */
 #define APP_SENSORS_ENABLED 0
 
+/* DHT22 data line (open drain with external pull-up). */
+#define APP_DHT22_GPIO 5
+
+/* BLE advertised name and environmental notification period. */
+#define APP_BLE_DEVICE_NAME       "Terra"
+#define APP_BLE_NOTIFY_PERIOD_MS  10000
+
+/*
+ * Analog probes (humidity, light, UV) sampled by the continuous ADC.
+ * Values are ADC1 channel numbers (GPIO = channel + 1 on the ESP32-S3).
+ * Set APP_ADC_PROBE_COUNT to 0 when no analog probe is wired.
+ */
+#define APP_ADC_PROBE_CHANNELS { 5, 6 }
+#define APP_ADC_PROBE_COUNT    2
+#define APP_ADC_OVERSAMPLE     64
+#define APP_ADC_MEDIAN_WINDOW  5
+#define APP_ADC_IIR_SHIFT      3
+
+/*
+ * Sampling periods of the sensor scheduler jobs.  Periods are rounded
+ * up to the 250 ms scheduler tick; jobs with equal periods are served
+ * by the same wakeup.
+ */
+#define APP_SENSOR_PERIOD_DHT22_MS    60000
+#define APP_SENSOR_PERIOD_DS18B20_MS  60000
+#define APP_SENSOR_PERIOD_ADC_MS      5000
+#define APP_SENSOR_PERIOD_PUBLISH_MS  60000
+
+/*
+ * Report by exception (sensors/sensor_report.h): a reading is archived
+ * and published only when it moved by more than the deadband of its
+ * kind since the last report, or after the heartbeat without one.
+ */
+#define APP_REPORT_DEADBAND_TEMPERATURE  0.2f    // °C
+#define APP_REPORT_DEADBAND_HUMIDITY     1.0f    // %RH
+#define APP_REPORT_DEADBAND_VOLTAGE      20.0f   // mV
+#define APP_REPORT_MIN_INTERVAL_S        5
+#define APP_REPORT_HEARTBEAT_S           900
+
 /* Wi‑Fi credentials (overridden by provisioning at runtime). */
 #define DEFAULT_WIFI_SSID     ""
 #define DEFAULT_WIFI_PASSWORD ""
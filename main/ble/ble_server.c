@@ -1,14 +1,183 @@
 #include <stdio.h>
+#include <string.h>
 #include "ble_server.h"
+#include "ble_services.h"
+#include "app_config.h"
+#include "sdkconfig.h"
+#include "utils/logger.h"
+
+/*
+ * BLE peripheral built on the NimBLE host.
+ *
+ * Advertises the Environmental Sensing service and accepts
+ * connections from phones at the enclosure.  On connect the link is
+ * prepared for bulk transfer: the largest ATT MTU is requested, Data
+ * Length Extension is enabled (251-byte link-layer PDUs, so one
+ * notification travels in two or three packets instead of twenty-five)
+ * and the 2M PHY is preferred.  GATT traffic itself is handled in
+ * ble_services.c; this file forwards the GAP events it needs.
+ */
+
+#if CONFIG_BT_NIMBLE_ENABLED
+
+#include "esp_err.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "host/ble_hs.h"
+#include "host/util/util.h"
+#include "services/gap/ble_svc_gap.h"
+#include "services/gatt/ble_svc_gatt.h"
+
+#define BLE_PREFERRED_MTU   517
+#define BLE_DLE_TX_OCTETS   251
+#define BLE_DLE_TX_TIME_US  2120
+#define BLE_UUID_ESS        0x181A
+
+static uint8_t s_own_addr_type;
+static bool s_initialised = false;
+
+static int gap_event(struct ble_gap_event *event, void *arg);
+
+static void advertise(void)
+{
+    struct ble_hs_adv_fields fields;
+    memset(&fields, 0, sizeof(fields));
+    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+    fields.name = (const uint8_t *)APP_BLE_DEVICE_NAME;
+    fields.name_len = strlen(APP_BLE_DEVICE_NAME);
+    fields.name_is_complete = 1;
+    ble_uuid16_t ess = BLE_UUID16_INIT(BLE_UUID_ESS);
+    fields.uuids16 = &ess;
+    fields.num_uuids16 = 1;
+    fields.uuids16_is_complete = 1;
+    int rc = ble_gap_adv_set_fields(&fields);
+    if (rc != 0) {
+        log_error("ble", "Advertising data rejected (%d)", rc);
+        return;
+    }
+
+    struct ble_gap_adv_params params;
+    memset(&params, 0, sizeof(params));
+    params.conn_mode = BLE_GAP_CONN_MODE_UND;
+    params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    rc = ble_gap_adv_start(s_own_addr_type, NULL, BLE_HS_FOREVER, &params, gap_event, NULL);
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        log_error("ble", "Advertising failed to start (%d)", rc);
+    }
+}
+
+static void prepare_link(uint16_t conn)
+{
+    // Each call is a request; the peer may settle on smaller values
+    if (ble_gap_set_data_len(conn, BLE_DLE_TX_OCTETS, BLE_DLE_TX_TIME_US) != 0) {
+        log_warn("ble", "Data length extension not accepted");
+    }
+    ble_gap_set_prefered_le_phy(conn, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK,
+                                BLE_GAP_LE_PHY_CODED_ANY);
+    ble_gattc_exchange_mtu(conn, NULL, NULL);
+}
+
+static int gap_event(struct ble_gap_event *event, void *arg)
+{
+    (void)arg;
+    switch (event->type) {
+    case BLE_GAP_EVENT_CONNECT:
+        if (event->connect.status != 0) {
+            advertise();
+            break;
+        }
+        log_info("ble", "Connected (handle %d)", event->connect.conn_handle);
+        prepare_link(event->connect.conn_handle);
+        // Stay connectable for a second phone while slots remain
+        advertise();
+        break;
+    case BLE_GAP_EVENT_DISCONNECT:
+        log_info("ble", "Disconnected (reason 0x%x)", event->disconnect.reason);
+        ble_services_on_disconnect(event->disconnect.conn.conn_handle);
+        advertise();
+        break;
+    case BLE_GAP_EVENT_ADV_COMPLETE:
+        advertise();
+        break;
+    case BLE_GAP_EVENT_MTU:
+        // History pages are sized from the MTU when they are packed
+        log_info("ble", "MTU %d on handle %d", event->mtu.value, event->mtu.conn_handle);
+        break;
+    case BLE_GAP_EVENT_NOTIFY_TX:
+        if (!event->notify_tx.indication) {
+            ble_services_on_notify_tx(event->notify_tx.conn_handle, event->notify_tx.status);
+        }
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static void on_sync(void)
+{
+    if (ble_hs_util_ensure_addr(0) != 0 || ble_hs_id_infer_auto(0, &s_own_addr_type) != 0) {
+        log_error("ble", "No usable identity address");
+        return;
+    }
+    advertise();
+}
+
+static void on_reset(int reason)
+{
+    log_warn("ble", "Host reset (reason %d)", reason);
+}
+
+static void host_task(void *param)
+{
+    (void)param;
+    nimble_port_run();      // Returns only after nimble_port_stop()
+    nimble_port_freertos_deinit();
+}
 
 int ble_server_init(void)
 {
-    printf("[ble] server init stub called\n");
+    if (s_initialised) {
+        return 0;
+    }
+    if (nimble_port_init() != ESP_OK) {
+        log_error("ble", "NimBLE port init failed");
+        return -1;
+    }
+    ble_hs_cfg.sync_cb = on_sync;
+    ble_hs_cfg.reset_cb = on_reset;
+
+    ble_svc_gap_init();
+    ble_svc_gatt_init();
+    if (ble_services_init() != 0) {
+        return -1;
+    }
+    ble_svc_gap_device_name_set(APP_BLE_DEVICE_NAME);
+    ble_att_set_preferred_mtu(BLE_PREFERRED_MTU);
+    s_initialised = true;
     return 0;
 }
 
 int ble_server_start(void)
 {
-    printf("[ble] server start stub called\n");
+    if (!s_initialised) {
+        return -1;
+    }
+    nimble_port_freertos_init(host_task);
     return 0;
-}
\ No newline at end of file
+}
+
+#else /* !CONFIG_BT_NIMBLE_ENABLED */
+
+int ble_server_init(void)
+{
+    log_warn("ble", "Bluetooth (NimBLE) is disabled in sdkconfig");
+    return -1;
+}
+
+int ble_server_start(void)
+{
+    return -1;
+}
+
+#endif /* CONFIG_BT_NIMBLE_ENABLED */
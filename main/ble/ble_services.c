@@ -1,8 +1,386 @@
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "ble_services.h"
+#include "app_config.h"
+#include "sdkconfig.h"
+#include "utils/logger.h"
+
+/*
+ * GATT service implementation.
+ *
+ * Environmental Sensing values are read from the sensor manager's
+ * channel table when a client reads them, and pushed to subscribers by
+ * a sensor scheduler job every APP_BLE_NOTIFY_PERIOD_MS.
+ *
+ * A history request opens an iterator on the channel's archive and
+ * packs as many samples as the negotiated MTU allows into each
+ * notification (126 samples at MTU 517, against 3 in a default 23-byte
+ * MTU).  Pages are sent back to back until the host runs out of
+ * buffers, then a short callout retries, so the transfer runs at
+ * whatever rate the link drains.  One history stream runs at a time.
+ */
+
+#if CONFIG_BT_NIMBLE_ENABLED
+
+#include "host/ble_hs.h"
+#include "host/ble_uuid.h"
+#include "nimble/nimble_port.h"
+#include "sensors/sensor_manager.h"
+#include "sensors/sensor_scheduler.h"
+#include "storage/ts_archive.h"
+
+#define BLE_UUID_ESS            0x181A
+#define BLE_UUID_TEMPERATURE    0x2A6E
+#define BLE_UUID_HUMIDITY       0x2A6F
+
+#define HISTORY_HDR_LEN         7
+#define HISTORY_SAMPLE_LEN      4
+#define HISTORY_PAGE_MAX        (517 - 3)   // Largest ATT notification payload
+#define HISTORY_REQ_LEN         9
+#define HISTORY_RETRY_MS        5
+#define HISTORY_BURST           8           // Pages per pump before yielding
+#define HISTORY_ERR_BUSY        0x80        // Application ATT error
+#define HISTORY_ERR_CHANNEL     0x81
+
+// a3c87500-8ed3-4bdf-8a39-a01bebede295 (history service) and ...501
+static const ble_uuid128_t UUID_HISTORY_SVC =
+    BLE_UUID128_INIT(0x95, 0xe2, 0xed, 0xeb, 0x1b, 0xa0, 0x39, 0x8a,
+                     0xdf, 0x4b, 0xd3, 0x8e, 0x00, 0x75, 0xc8, 0xa3);
+static const ble_uuid128_t UUID_HISTORY_CHR =
+    BLE_UUID128_INIT(0x95, 0xe2, 0xed, 0xeb, 0x1b, 0xa0, 0x39, 0x8a,
+                     0xdf, 0x4b, 0xd3, 0x8e, 0x01, 0x75, 0xc8, 0xa3);
+
+typedef struct {
+    bool active;
+    uint16_t conn;
+    uint8_t seq;
+    uint8_t decimals;
+    float scale;
+    ts_iter_t it;
+    ts_sample_t pending;        // Read but did not fit the previous page
+    bool has_pending;
+    uint8_t page[HISTORY_PAGE_MAX];
+    uint16_t page_len;          // 0 = no page packed
+    bool page_is_last;
+    bool pumping;
+} history_stream_t;
+
+static uint16_t s_temp_handle;
+static uint16_t s_hum_handle;
+static uint16_t s_history_handle;
+static history_stream_t s_stream;
+static struct ble_npl_callout s_pump_callout;
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    put_le16(p, (uint16_t)v);
+    put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* First valid channel of a kind; false when none is valid. */
+static bool first_value(sensor_kind_t kind, float *out)
+{
+    sensor_value_t values[SENSOR_MAX_CHANNELS];
+    int n = sensors_get_current(values, SENSOR_MAX_CHANNELS);
+    for (int i = 0; i < n; i++) {
+        if (values[i].kind == kind && values[i].valid) {
+            *out = values[i].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int env_access(uint16_t conn_handle, uint16_t attr_handle,
+                      struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    (void)conn_handle;
+    (void)arg;
+    if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+    uint8_t buf[2];
+    float value = 0.0f;
+    if (attr_handle == s_temp_handle) {
+        // sint16, 0.01 °C; 0x8000 means "unknown"
+        int16_t t = first_value(SENSOR_KIND_TEMPERATURE, &value) ? (int16_t)lroundf(value * 100.0f)
+                                                                 : INT16_MIN;
+        put_le16(buf, (uint16_t)t);
+    } else {
+        // uint16, 0.01 %RH; 0xFFFF means "unknown"
+        uint16_t h = first_value(SENSOR_KIND_HUMIDITY, &value) ? (uint16_t)lroundf(value * 100.0f)
+                                                              : UINT16_MAX;
+        put_le16(buf, h);
+    }
+    return os_mbuf_append(ctxt->om, buf, sizeof(buf)) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+/* Fill the next page from the iterator.  A page with no sample ends the stream. */
+static void history_pack(history_stream_t *st)
+{
+    uint16_t mtu = ble_att_mtu(st->conn);
+    size_t cap = (mtu > 3) ? (size_t)mtu - 3 : 20;
+    if (cap > sizeof(st->page)) {
+        cap = sizeof(st->page);
+    }
+    size_t max_samples = (cap - HISTORY_HDR_LEN) / HISTORY_SAMPLE_LEN;
+    if (max_samples > UINT8_MAX) {
+        max_samples = UINT8_MAX;
+    }
+    size_t len = HISTORY_HDR_LEN;
+    uint32_t t_base = 0, prev = 0;
+    uint8_t count = 0;
+    while (count < max_samples) {
+        ts_sample_t s;
+        if (st->has_pending) {
+            s = st->pending;
+            st->has_pending = false;
+        } else if (ts_iter_next(&st->it, &s) != 1) {
+            break;
+        }
+        if (count == 0) {
+            t_base = prev = s.timestamp;
+        } else if (s.timestamp - prev > UINT16_MAX) {
+            // Gap too long for a u16 step: the sample opens the next page
+            st->pending = s;
+            st->has_pending = true;
+            break;
+        }
+        long q = lroundf(s.value * st->scale);
+        q = q < INT16_MIN ? INT16_MIN : (q > INT16_MAX ? INT16_MAX : q);
+        put_le16(st->page + len, (uint16_t)(s.timestamp - prev));
+        put_le16(st->page + len + 2, (uint16_t)(int16_t)q);
+        len += HISTORY_SAMPLE_LEN;
+        prev = s.timestamp;
+        count++;
+    }
+    st->page[0] = st->seq++;
+    st->page[1] = count;
+    st->page[2] = st->decimals;
+    put_le32(st->page + 3, t_base);
+    st->page_len = (uint16_t)len;
+    st->page_is_last = (count == 0);
+}
+
+static void history_stop(history_stream_t *st)
+{
+    if (st->active) {
+        ts_iter_end(&st->it);
+    }
+    st->active = false;
+    st->page_len = 0;
+    ble_npl_callout_stop(&s_pump_callout);
+}
+
+static void history_pump(history_stream_t *st)
+{
+    if (!st->active || st->pumping) {
+        return;
+    }
+    st->pumping = true;
+    for (int sent = 0; st->active && sent < HISTORY_BURST; sent++) {
+        if (st->page_len == 0) {
+            history_pack(st);
+        }
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(st->page, st->page_len);
+        int rc = om ? ble_gatts_notify_custom(st->conn, s_history_handle, om) : BLE_HS_ENOMEM;
+        if (rc == BLE_HS_ENOMEM || rc == BLE_HS_EBUSY) {
+            break;              // Keep the page; retry once buffers free up
+        }
+        if (rc != 0 || st->page_is_last) {
+            if (rc != 0) {
+                log_warn("ble", "History stream aborted (%d)", rc);
+            }
+            history_stop(st);
+            break;
+        }
+        st->page_len = 0;
+    }
+    st->pumping = false;
+    if (st->active) {
+        ble_npl_callout_reset(&s_pump_callout, ble_npl_time_ms_to_ticks32(HISTORY_RETRY_MS));
+    }
+}
+
+static void pump_callout(struct ble_npl_event *ev)
+{
+    (void)ev;
+    history_pump(&s_stream);
+}
+
+static int history_list_channels(struct os_mbuf *om)
+{
+    sensor_value_t values[SENSOR_MAX_CHANNELS];
+    int n = sensors_get_current(values, SENSOR_MAX_CHANNELS);
+    for (int i = 0; i < n; i++) {
+        if ((i > 0 && os_mbuf_append(om, ",", 1) != 0) ||
+            os_mbuf_append(om, values[i].name, strlen(values[i].name)) != 0) {
+            return BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+    }
+    return 0;
+}
+
+static int history_start(uint16_t conn, const uint8_t *req)
+{
+    if (s_stream.active) {
+        return HISTORY_ERR_BUSY;
+    }
+    sensor_value_t values[SENSOR_MAX_CHANNELS];
+    int n = sensors_get_current(values, SENSOR_MAX_CHANNELS);
+    ts_series_t *series = (req[0] < n) ? sensors_get_series(values[req[0]].name) : NULL;
+    uint32_t from = get_le32(req + 1);
+    uint32_t to = get_le32(req + 5);
+    if (!series) {
+        return HISTORY_ERR_CHANNEL;
+    }
+    history_stream_t *st = &s_stream;
+    memset(st, 0, sizeof(*st));
+    if (ts_iter_begin(series, from, to ? to : UINT32_MAX, &st->it) != 0) {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+    st->active = true;
+    st->conn = conn;
+    st->decimals = (values[req[0]].kind == SENSOR_KIND_VOLTAGE) ? 0 : 2;
+    st->scale = (st->decimals == 0) ? 1.0f : 100.0f;
+    log_info("ble", "History of %s requested", values[req[0]].name);
+    // Start from the host task once the write response is out
+    ble_npl_callout_reset(&s_pump_callout, 0);
+    return 0;
+}
+
+static int history_access(uint16_t conn_handle, uint16_t attr_handle,
+                          struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    (void)attr_handle;
+    (void)arg;
+    if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+        return history_list_channels(ctxt->om);
+    }
+    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+    uint8_t req[HISTORY_REQ_LEN];
+    uint16_t len = 0;
+    if (OS_MBUF_PKTLEN(ctxt->om) != HISTORY_REQ_LEN ||
+        ble_hs_mbuf_to_flat(ctxt->om, req, sizeof(req), &len) != 0) {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    return history_start(conn_handle, req);
+}
+
+static const struct ble_gatt_svc_def s_services[] = {
+    {
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = BLE_UUID16_DECLARE(BLE_UUID_ESS),
+        .characteristics = (struct ble_gatt_chr_def[]) {
+            {
+                .uuid = BLE_UUID16_DECLARE(BLE_UUID_TEMPERATURE),
+                .access_cb = env_access,
+                .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &s_temp_handle,
+            },
+            {
+                .uuid = BLE_UUID16_DECLARE(BLE_UUID_HUMIDITY),
+                .access_cb = env_access,
+                .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &s_hum_handle,
+            },
+            { 0 },
+        },
+    },
+    {
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = &UUID_HISTORY_SVC.u,
+        .characteristics = (struct ble_gatt_chr_def[]) {
+            {
+                .uuid = &UUID_HISTORY_CHR.u,
+                .access_cb = history_access,
+                .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &s_history_handle,
+            },
+            { 0 },
+        },
+    },
+    { 0 },
+};
+
+static int env_notify_job(void *ctx)
+{
+    (void)ctx;
+    // Sends to subscribed clients only, reading through env_access
+    ble_gatts_chr_updated(s_temp_handle);
+    ble_gatts_chr_updated(s_hum_handle);
+    return 0;
+}
 
 int ble_services_init(void)
 {
-    printf("[ble] services init stub called\n");
+    int rc = ble_gatts_count_cfg(s_services);
+    if (rc == 0) {
+        rc = ble_gatts_add_svcs(s_services);
+    }
+    if (rc != 0) {
+        log_error("ble", "GATT table rejected (%d)", rc);
+        return -1;
+    }
+    ble_npl_callout_init(&s_pump_callout, nimble_port_get_dflt_eventq(), pump_callout, NULL);
+    const sensor_job_cfg_t job = {
+        .name = "ble",
+        .period_ms = APP_BLE_NOTIFY_PERIOD_MS,
+        .collect = env_notify_job,
+    };
+    // The scheduler is otherwise started by sensors_start(), which does
+    // nothing when APP_SENSORS_ENABLED=0; starting it twice is harmless
+    if (sensor_sched_add(&job) < 0 || sensor_sched_start() != 0) {
+        log_warn("ble", "Environmental notifications not scheduled");
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+void ble_services_on_notify_tx(uint16_t conn_handle, int status)
+{
+    (void)status;
+    if (s_stream.active && s_stream.conn == conn_handle) {
+        history_pump(&s_stream);
+    }
+}
+
+void ble_services_on_disconnect(uint16_t conn_handle)
+{
+    if (s_stream.active && s_stream.conn == conn_handle) {
+        history_stop(&s_stream);
+    }
+}
+
+#else /* !CONFIG_BT_NIMBLE_ENABLED */
+
+int ble_services_init(void)
+{
+    return -1;
+}
+
+void ble_services_on_notify_tx(uint16_t conn_handle, int status)
+{
+    (void)conn_handle;
+    (void)status;
+}
+
+void ble_services_on_disconnect(uint16_t conn_handle)
+{
+    (void)conn_handle;
+}
+
+#endif /* CONFIG_BT_NIMBLE_ENABLED */
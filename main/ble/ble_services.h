@@ -1,6 +1,27 @@
 #ifndef BLE_SERVICES_H
 #define BLE_SERVICES_H
 
+#include <stdint.h>
+
+/*
+ * GATT services: Environmental Sensing (0x181A) with the temperature
+ * and humidity of the first channels of each kind, and a custom
+ * history service that streams a sensor archive range as packed
+ * notifications.
+ *
+ * History characteristic (read / write / notify):
+ *   read   comma separated channel names; the index is the position
+ *   write  u8 channel, u32 from, u32 to (little endian, 0 = unbounded)
+ *   notify one page per notification until a page with count 0:
+ *          u8 seq, u8 count, u8 decimals, u32 t_base,
+ *          count x { u16 dt, i16 value x 10^decimals }
+ *          dt is relative to the previous sample (first one: t_base)
+ */
+
 int ble_services_init(void);
 
-#endif /* BLE_SERVICES_H */
\ No newline at end of file
+/* GAP events forwarded by ble_server.c */
+void ble_services_on_notify_tx(uint16_t conn_handle, int status);
+void ble_services_on_disconnect(uint16_t conn_handle);
+
+#endif /* BLE_SERVICES_H */
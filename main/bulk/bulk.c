@@ -0,0 +1,756 @@
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "bulk.h"
+
+/*
+ * Bulk import and export.
+ *
+ * A dataset is a list of typed columns plus, for database tables, the
+ * table name the INSERT and SELECT are built from; both come from the
+ * table's definition in db_schema.h.  Import splits the
+ * body into records as it arrives: a CSV record ends at a newline
+ * outside quotes, an NDJSON record at any newline.  Records are
+ * buffered until batch rows (or CONFIG_APP_IMPORT_BATCH_BYTES) have
+ * arrived; the batch is then converted column by column, bound to the
+ * one prepared INSERT and stepped inside a single db_begin()/
+ * db_commit(), which is what makes a large import fast on flash, since
+ * each autocommitted row would pay for its own journal.  Buffering
+ * first keeps the network out of the transaction, which holds the
+ * shared connection.  A rejected row is reported with its line and
+ * does not stop the import or undo the batch; only a failed COMMIT
+ * loses the rows of its batch.
+ *
+ * Export walks a cursor and writes through a doc_out_t, one block at
+ * a time.  The CSV is the documents dialect (doc_output.h) and is read
+ * back by import, which detects the separator from the header and
+ * accepts decimal commas, so a spreadsheet round trip works.
+ */
+
+#include "sdkconfig.h"
+#include "database/db_manager.h"
+#include "database/db_schema.h"
+#include "sensors/sensor_manager.h"
+#include "storage/ts_archive.h"
+#include "utils/datetime.h"
+#include "utils/json_fields.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+#include "utils/uuid.h"
+
+#define BULK_RECORD_MAX   1024
+#define BULK_MAX_COLUMNS  16
+#define BULK_MAX_FIELDS   32        // CSV fields per record; extra ones are ignored
+#define BULK_NUMBER_LEN   32
+#define BULK_SQL_MAX      512
+
+typedef struct {
+    bool null;
+    const char *text;
+    int64_t i;
+    double d;
+    uint8_t key[UUID_BIN_LEN];
+} bulk_value_t;
+
+struct bulk_dataset {
+    const char *name;
+    const db_table_t *schema;   // Table name NULL: sensor archives
+};
+
+/* Header of a buffered record; the text and a NUL follow */
+typedef struct {
+    uint32_t line;
+    uint32_t len;
+} batch_record_t;
+
+struct bulk_import {
+    const bulk_dataset_t *ds;
+    bulk_format_t format;
+    bulk_report_t *report;
+    uint32_t batch;
+    uint32_t pending;           // Rows inserted since BEGIN
+    bool stopped;
+    char *batch_buf;            // Records waiting for the next transaction
+    size_t batch_used;
+    uint32_t batch_count;
+    db_stmt_t *stmt;
+    ts_series_t *series;        // Last archive appended to
+    // Record splitter
+    char sep;
+    bool have_header;
+    bool first;
+    bool in_quotes;
+    bool overflow;
+    uint32_t line;              // Line being read
+    uint32_t record_line;       // Line the buffered record started on
+    size_t len;
+    char record[BULK_RECORD_MAX];
+    int map[BULK_MAX_COLUMNS];  // CSV field of each column, -1 if absent
+    char numbers[BULK_MAX_COLUMNS][BULK_NUMBER_LEN];
+    json_field_t fields[BULK_MAX_COLUMNS];     // NDJSON: one RAW field per column
+};
+
+static const db_column_t READING_COLUMNS[] = {
+    { "channel",   DB_TYPE_TEXT, DB_COL_REQUIRED },
+    { "timestamp", DB_TYPE_DATE, DB_COL_REQUIRED },
+    { "value",     DB_TYPE_REAL, DB_COL_REQUIRED },
+};
+
+static const db_table_t READINGS = {
+    NULL, READING_COLUMNS, sizeof(READING_COLUMNS) / sizeof(READING_COLUMNS[0]),
+};
+
+// Database datasets carry every column of their table (db_schema.h)
+static const bulk_dataset_t DATASETS[] = {
+    { "animals", &DB_TABLE_ANIMALS },
+    { "breeding_cycles", &DB_TABLE_CYCLES },
+    { "readings", &READINGS },
+};
+
+#define COLUMN_COUNT(name, type, constraints, flags) + 1
+_Static_assert(0 DB_ANIMALS_COLUMNS(COLUMN_COUNT) <= BULK_MAX_COLUMNS, "columns");
+_Static_assert(0 DB_CYCLES_COLUMNS(COLUMN_COUNT) <= BULK_MAX_COLUMNS, "columns");
+_Static_assert(BULK_MAX_COLUMNS <= JSON_FIELDS_MAX, "columns");
+_Static_assert(CONFIG_APP_IMPORT_BATCH_BYTES >= BULK_RECORD_MAX + sizeof(batch_record_t),
+               "a record must fit an empty batch");
+
+const bulk_dataset_t *bulk_find_dataset(const char *name)
+{
+    for (size_t i = 0; name && i < sizeof(DATASETS) / sizeof(DATASETS[0]); i++) {
+        if (strcmp(DATASETS[i].name, name) == 0) {
+            return &DATASETS[i];
+        }
+    }
+    return NULL;
+}
+
+/* "INSERT INTO t (a,b) VALUES (?1,?2)" or "SELECT a,b FROM t ORDER BY rowid" */
+static int build_sql(char *sql, size_t size, const bulk_dataset_t *ds, bool insert)
+{
+    size_t n = (size_t)snprintf(sql, size, insert ? "INSERT INTO %s (" : "SELECT ", ds->schema->name);
+    for (int c = 0; c < ds->schema->count && n < size; c++) {
+        n += (size_t)snprintf(sql + n, size - n, "%s%s", c ? "," : "", ds->schema->columns[c].name);
+    }
+    if (insert) {
+        for (int c = 0; c < ds->schema->count && n < size; c++) {
+            n += (size_t)snprintf(sql + n, size - n, "%s?%d", c ? "," : ") VALUES (", c + 1);
+        }
+    }
+    if (n < size) {
+        n += (size_t)snprintf(sql + n, size - n, insert ? ")" : " FROM %s ORDER BY rowid",
+                              ds->schema->name);
+    }
+    return n < size ? 0 : -1;
+}
+
+/* ---- Import ---------------------------------------------------------- */
+
+static void stop(bulk_import_t *imp, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(imp->report->error, sizeof(imp->report->error), fmt, args);
+    va_end(args);
+    imp->stopped = true;
+    log_error("bulk", "Import of %s stopped at line %u: %s", imp->ds->name,
+              (unsigned)imp->record_line, imp->report->error);
+}
+
+static void row_error(bulk_import_t *imp, const char *fmt, ...)
+{
+    bulk_report_t *r = imp->report;
+    r->failed++;
+    if (r->error_count < BULK_MAX_ERRORS) {
+        bulk_row_error_t *e = &r->errors[r->error_count++];
+        e->line = imp->record_line;
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(e->message, sizeof(e->message), fmt, args);
+        va_end(args);
+    }
+}
+
+static void flush_series(bulk_import_t *imp)
+{
+    if (imp->series) {
+        ts_flush(imp->series);
+        imp->series = NULL;
+    }
+}
+
+static char *trim(char *s)
+{
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    size_t n = strlen(s);
+    while (n > 0 && isspace((unsigned char)s[n - 1])) {
+        s[--n] = '\0';
+    }
+    return s;
+}
+
+static bool parse_int(const char *s, int64_t *out)
+{
+    char *end;
+    long long v = strtoll(s, &end, 10);
+    *out = v;
+    return end != s && *end == '\0';
+}
+
+static bool parse_date(const char *s, int64_t *out)
+{
+    if (parse_int(s, out)) {
+        return *out >= 0;
+    }
+    int y, m, d;
+    char tail;
+    if (sscanf(s, "%4d-%2d-%2d%c", &y, &m, &d, &tail) != 3 &&
+        sscanf(s, "%2d/%2d/%4d%c", &d, &m, &y, &tail) != 3) {
+        return false;
+    }
+    if (y < 1900 || m < 1 || m > 12 || d < 1 || d > 31) {
+        return false;
+    }
+    // Local midnight, the day the documents will print
+    struct tm tm = { .tm_year = y - 1900, .tm_mon = m - 1, .tm_mday = d, .tm_isdst = -1 };
+    time_t t = mktime(&tm);
+    *out = t;
+    return t != (time_t)-1 && t >= 0;
+}
+
+static int convert(bulk_import_t *imp, const db_column_t *col, char *raw, bulk_value_t *v)
+{
+    memset(v, 0, sizeof(*v));
+    if (raw && col->type != DB_TYPE_TEXT) {
+        raw = trim(raw);
+    }
+    if (!raw || raw[0] == '\0') {
+        if (col->flags & DB_COL_NEW_ID) {
+            uuid_v7(v->key);
+        } else if (col->flags & DB_COL_NOW) {
+            v->i = datetime_now();
+        } else if (col->flags & DB_COL_REQUIRED) {
+            row_error(imp, "%s is required", col->name);
+            return -1;
+        } else {
+            v->null = true;
+        }
+        return 0;
+    }
+    switch (col->type) {
+    case DB_TYPE_TEXT:
+        // Undo the formula guard export puts on text
+        v->text = raw[0] == '\'' && raw[1] && strchr("=+-@", raw[1]) ? raw + 1 : raw;
+        return 0;
+    case DB_TYPE_INT:
+        if (parse_int(raw, &v->i)) {
+            return 0;
+        }
+        row_error(imp, "%s: not an integer", col->name);
+        return -1;
+    case DB_TYPE_REAL: {
+        char *comma = strchr(raw, ',');
+        if (comma) {
+            *comma = '.';       // Decimal comma from a French spreadsheet
+        }
+        char *end;
+        v->d = strtod(raw, &end);
+        if (end != raw && *end == '\0') {
+            return 0;
+        }
+        row_error(imp, "%s: not a number", col->name);
+        return -1;
+    }
+    case DB_TYPE_DATE:
+        if (parse_date(raw, &v->i)) {
+            return 0;
+        }
+        row_error(imp, "%s: not a date", col->name);
+        return -1;
+    case DB_TYPE_UUID:
+        // Keys from another system keep matching their references
+        if (uuid_parse(raw, v->key) != 0) {
+            uuid_from_name(raw, v->key);
+        }
+        return 0;
+    }
+    return -1;
+}
+
+static int insert_sql(bulk_import_t *imp, const bulk_value_t *values)
+{
+    const bulk_dataset_t *ds = imp->ds;
+    for (int c = 0; c < ds->schema->count; c++) {
+        const bulk_value_t *v = &values[c];
+        int rc;
+        if (v->null || ds->schema->columns[c].type == DB_TYPE_TEXT) {
+            rc = db_bind_text(imp->stmt, c + 1, v->null ? NULL : v->text);
+        } else if (ds->schema->columns[c].type == DB_TYPE_UUID) {
+            rc = db_bind_uuid(imp->stmt, c + 1, v->key);
+        } else if (ds->schema->columns[c].type == DB_TYPE_REAL) {
+            rc = db_bind_double(imp->stmt, c + 1, v->d);
+        } else {
+            rc = db_bind_int(imp->stmt, c + 1, v->i);
+        }
+        if (rc != 0) {
+            stop(imp, "Bind failed");
+            return -1;
+        }
+    }
+    if (db_step(imp->stmt) < 0) {
+        row_error(imp, "%s", db_errmsg());
+    } else {
+        imp->pending++;
+    }
+    return 0;
+}
+
+static int insert_reading(bulk_import_t *imp, const bulk_value_t *values)
+{
+    ts_series_t *series = sensors_get_series(values[0].text);
+    if (!series) {
+        row_error(imp, "Unknown channel %.40s", values[0].text);
+        return 0;
+    }
+    if (values[1].i > UINT32_MAX) {
+        row_error(imp, "timestamp: out of range");
+        return 0;
+    }
+    if (series != imp->series) {
+        flush_series(imp);
+        imp->series = series;
+    }
+    // The archive only grows forward, like the sampler writes it
+    if (ts_append(series, (uint32_t)values[1].i, (float)values[2].d) != 0) {
+        row_error(imp, "Older than the channel archive");
+        return 0;
+    }
+    imp->report->imported++;
+    return 0;
+}
+
+static int import_row(bulk_import_t *imp, char **raw)
+{
+    const bulk_dataset_t *ds = imp->ds;
+    bulk_value_t values[BULK_MAX_COLUMNS];
+    for (int c = 0; c < ds->schema->count; c++) {
+        if (convert(imp, &ds->schema->columns[c], raw[c], &values[c]) != 0) {
+            return 0;
+        }
+    }
+    return ds->schema->name ? insert_sql(imp, values) : insert_reading(imp, values);
+}
+
+/* Splits a CSV record in place; returns the number of fields, of
+ * which the first max are stored. */
+static int csv_split(char *p, char sep, char **fields, int max)
+{
+    int n = 0;
+    for (;;) {
+        char *start = p;
+        char *w = p;
+        if (*p == '"') {
+            for (p++; *p; ) {
+                if (*p == '"' && p[1] != '"') {
+                    p++;
+                    break;
+                }
+                p += *p == '"' ? 1 : 0;     // "" is one quote
+                *w++ = *p++;
+            }
+        }
+        while (*p && *p != sep) {
+            *w++ = *p++;
+        }
+        char end = *p;
+        *w = '\0';
+        if (n < max) {
+            fields[n] = start;
+        }
+        n++;
+        if (end == '\0') {
+            return n;
+        }
+        p++;
+    }
+}
+
+static int parse_header(bulk_import_t *imp, char *rec)
+{
+    const bulk_dataset_t *ds = imp->ds;
+    // The separator a spreadsheet used is the most frequent candidate
+    int counts[3] = { 0 };
+    const char candidates[3] = { ',', ';', '\t' };
+    for (const char *p = rec; *p; p++) {
+        for (int i = 0; i < 3; i++) {
+            counts[i] += *p == candidates[i];
+        }
+    }
+    int best = 0;
+    for (int i = 1; i < 3; i++) {
+        best = counts[i] > counts[best] ? i : best;
+    }
+    imp->sep = candidates[best];
+
+    char *fields[BULK_MAX_FIELDS];
+    int n = csv_split(rec, imp->sep, fields, BULK_MAX_FIELDS);
+    n = n < BULK_MAX_FIELDS ? n : BULK_MAX_FIELDS;
+    for (int c = 0; c < ds->schema->count; c++) {
+        imp->map[c] = -1;
+        for (int f = 0; f < n; f++) {
+            if (strcasecmp(trim(fields[f]), ds->schema->columns[c].name) == 0) {
+                imp->map[c] = f;
+                break;
+            }
+        }
+        if (imp->map[c] < 0 && (ds->schema->columns[c].flags & DB_COL_REQUIRED)) {
+            stop(imp, "Missing column %s", ds->schema->columns[c].name);
+            return -1;
+        }
+    }
+    imp->have_header = true;
+    return 0;
+}
+
+static int import_csv(bulk_import_t *imp, char *rec)
+{
+    char *fields[BULK_MAX_FIELDS];
+    char *raw[BULK_MAX_COLUMNS];
+    int n = csv_split(rec, imp->sep, fields, BULK_MAX_FIELDS);
+    for (int c = 0; c < imp->ds->schema->count; c++) {
+        raw[c] = imp->map[c] >= 0 && imp->map[c] < n ? fields[imp->map[c]] : NULL;
+    }
+    return import_row(imp, raw);
+}
+
+/* Parsed with json_fields, in place: an NDJSON row allocates nothing,
+ * however many rows the body holds. */
+static int import_ndjson(bulk_import_t *imp, char *rec, size_t len)
+{
+    const bulk_dataset_t *ds = imp->ds;
+    json_raw_t values[BULK_MAX_COLUMNS];
+    uint32_t present;
+    char err[BULK_ERROR_LEN];
+    if (json_fields_parse(rec, len, imp->fields, ds->schema->count, values, &present, err,
+                          sizeof(err)) != 0) {
+        row_error(imp, "%s", err);
+        return 0;
+    }
+    char *raw[BULK_MAX_COLUMNS];
+    for (int c = 0; c < ds->schema->count; c++) {
+        json_raw_t *v = &values[c];
+        raw[c] = NULL;
+        if (!(present & JSON_FIELD_BIT(c))) {
+            continue;
+        }
+        raw[c] = v->text;
+        if (v->string) {
+            continue;
+        }
+        v->text[v->len] = '\0';      // Parsing is over, the delimiter can go
+        if (v->text[0] == 't' || v->text[0] == 'f') {
+            raw[c] = v->text[0] == 't' ? "1" : "0";
+        } else if (v->text[0] != '{' && v->text[0] != '[' && strpbrk(v->text, ".eE")) {
+            double d = strtod(v->text, NULL);
+            snprintf(imp->numbers[c], BULK_NUMBER_LEN, d > -1e15 && d < 1e15 && d == (double)(int64_t)d ? "%.0f" : "%.17g", d);
+            raw[c] = imp->numbers[c];
+        }
+        // Objects and arrays (e.g. metadata_json) are kept as written
+    }
+    return import_row(imp, raw);
+}
+
+static int import_record(bulk_import_t *imp, char *rec, size_t len)
+{
+    return imp->format == BULK_FORMAT_CSV ? import_csv(imp, rec) : import_ndjson(imp, rec, len);
+}
+
+/* Imports the buffered records in one transaction.  Between BEGIN and
+ * COMMIT there is only parsing and SQLite, no network. */
+static int batch_run(bulk_import_t *imp)
+{
+    uint32_t count = imp->batch_count;
+    imp->batch_count = 0;
+    imp->batch_used = 0;
+    if (count == 0) {
+        return 0;
+    }
+    if (db_begin() != 0) {
+        imp->report->failed += count;
+        stop(imp, "Database unavailable");
+        return -1;
+    }
+    imp->pending = 0;
+    char *p = imp->batch_buf;
+    uint32_t done = 0;
+    while (done < count && !imp->stopped) {
+        batch_record_t hdr;
+        memcpy(&hdr, p, sizeof(hdr));
+        imp->record_line = hdr.line;
+        import_record(imp, p + sizeof(hdr), hdr.len);
+        p += sizeof(hdr) + hdr.len + 1;
+        done++;
+    }
+    uint32_t rows = imp->pending;
+    imp->pending = 0;
+    if (imp->stopped) {
+        db_rollback();
+        imp->report->failed += rows + (count - done);
+        return -1;
+    }
+    if (db_commit() != 0) {
+        imp->report->failed += rows;
+        stop(imp, "Commit failed, %u rows lost", (unsigned)rows);
+        return -1;
+    }
+    imp->report->imported += rows;
+    return 0;
+}
+
+static int batch_add(bulk_import_t *imp, const char *rec, size_t len)
+{
+    batch_record_t hdr = { imp->record_line, (uint32_t)len };
+    size_t need = sizeof(hdr) + len + 1;
+    if (imp->batch_used + need > CONFIG_APP_IMPORT_BATCH_BYTES && batch_run(imp) != 0) {
+        return -1;
+    }
+    char *p = imp->batch_buf + imp->batch_used;
+    memcpy(p, &hdr, sizeof(hdr));
+    memcpy(p + sizeof(hdr), rec, len + 1);
+    imp->batch_used += need;
+    imp->batch_count++;
+    return imp->batch_count >= imp->batch ? batch_run(imp) : 0;
+}
+
+static int end_record(bulk_import_t *imp)
+{
+    char *rec = imp->record;
+    size_t len = imp->len;
+    bool overflow = imp->overflow;
+    imp->len = 0;
+    imp->overflow = false;
+    imp->in_quotes = false;
+    if (len > 0 && rec[len - 1] == '\r') {
+        len--;
+    }
+    rec[len] = '\0';
+    if (imp->first && len >= 3 && memcmp(rec, DOC_CSV_BOM, 3) == 0) {
+        rec += 3;
+        len -= 3;
+    }
+    imp->first = false;
+    if (overflow) {
+        if (imp->format == BULK_FORMAT_CSV && !imp->have_header) {
+            stop(imp, "Header longer than %d bytes", BULK_RECORD_MAX - 1);
+            return -1;
+        }
+        row_error(imp, "Line longer than %d bytes", BULK_RECORD_MAX - 1);
+        return 0;
+    }
+    if (rec[strspn(rec, " \t")] == '\0') {
+        return 0;       // Blank line
+    }
+    if (imp->format == BULK_FORMAT_CSV && !imp->have_header) {
+        return parse_header(imp, rec);
+    }
+    // Archive appends need no transaction and are not buffered
+    return imp->ds->schema->name ? batch_add(imp, rec, len) : import_record(imp, rec, len);
+}
+
+bulk_import_t *bulk_import_begin(const bulk_dataset_t *ds, bulk_format_t format, uint32_t batch,
+                                 bulk_report_t *report)
+{
+    bulk_import_t *imp = calloc(1, sizeof(*imp));
+    if (!imp) {
+        return NULL;
+    }
+    memset(report, 0, sizeof(*report));
+    imp->ds = ds;
+    imp->format = format;
+    imp->report = report;
+    imp->batch = batch ? batch : 1;
+    imp->first = true;
+    imp->line = 1;
+    imp->record_line = 1;
+    for (int c = 0; c < ds->schema->count; c++) {
+        imp->fields[c] = (json_field_t){
+            ds->schema->columns[c].name, JSON_FIELD_RAW,
+            (uint16_t)(c * sizeof(json_raw_t)), sizeof(json_raw_t), 0, 0,
+        };
+    }
+    if (ds->schema->name) {
+        char sql[BULK_SQL_MAX];
+        imp->batch_buf = mem_alloc_large(CONFIG_APP_IMPORT_BATCH_BYTES);
+        if (!imp->batch_buf || build_sql(sql, sizeof(sql), ds, true) != 0 ||
+            !(imp->stmt = db_prepare(sql))) {
+            mem_free_large(imp->batch_buf);
+            free(imp);
+            return NULL;
+        }
+    }
+    return imp;
+}
+
+int bulk_import_feed(bulk_import_t *imp, const void *data, size_t len)
+{
+    const char *p = data;
+    for (size_t i = 0; i < len && !imp->stopped; i++) {
+        char c = p[i];
+        if (c == '"' && imp->format == BULK_FORMAT_CSV) {
+            imp->in_quotes = !imp->in_quotes;   // "" toggles twice
+        }
+        if (c == '\n' && !imp->in_quotes) {
+            end_record(imp);
+            imp->record_line = ++imp->line;
+            continue;
+        }
+        imp->line += c == '\n';
+        if (imp->len < BULK_RECORD_MAX - 1) {
+            imp->record[imp->len++] = c;
+        } else {
+            imp->overflow = true;
+        }
+    }
+    return imp->stopped ? -1 : 0;
+}
+
+int bulk_import_end(bulk_import_t *imp, bool abort)
+{
+    if (!abort && !imp->stopped && (imp->len > 0 || imp->overflow)) {
+        if (imp->in_quotes) {
+            row_error(imp, "Unterminated quoted field");
+        } else {
+            end_record(imp);
+        }
+    }
+    if (!abort && !imp->stopped && imp->format == BULK_FORMAT_CSV && !imp->have_header) {
+        stop(imp, "Empty body");
+    }
+    if (abort || imp->stopped) {
+        imp->report->failed += imp->batch_count;
+    } else {
+        batch_run(imp);
+    }
+    flush_series(imp);
+    db_finalize(imp->stmt);
+    mem_free_large(imp->batch_buf);
+    int rc = imp->stopped ? -1 : 0;
+    log_info("bulk", "Imported %u %s rows, %u rejected", (unsigned)imp->report->imported,
+             imp->ds->name, (unsigned)imp->report->failed);
+    free(imp);
+    return rc;
+}
+
+/* ---- Export ---------------------------------------------------------- */
+
+/* Numeric text as SQLite renders it; a column with a type affinity can
+ * still hold text, which must then be quoted. */
+static bool is_json_number(const char *s)
+{
+    if (s[strspn(s, "-+.0123456789eE")] != '\0') {
+        return false;
+    }
+    char *end;
+    strtod(s, &end);
+    return end != s && *end == '\0';
+}
+
+static void export_row(doc_out_t *out, const bulk_dataset_t *ds, bulk_format_t format,
+                       const char *const *cells)
+{
+    for (int c = 0; c < ds->schema->count; c++) {
+        const db_column_t *col = &ds->schema->columns[c];
+        if (format == BULK_FORMAT_CSV) {
+            if (c > 0) {
+                doc_out_puts(out, DOC_CSV_SEP);
+            }
+            doc_out_csv_field(out, cells[c] ? cells[c] : "", col->type == DB_TYPE_TEXT);
+            continue;
+        }
+        doc_out_printf(out, "%s\"%s\":", c ? "," : "{", col->name);
+        if (!cells[c]) {
+            doc_out_puts(out, "null");
+        } else if (col->type != DB_TYPE_TEXT && col->type != DB_TYPE_UUID && is_json_number(cells[c])) {
+            doc_out_puts(out, cells[c]);
+        } else {
+            doc_out_json_string(out, cells[c]);
+        }
+    }
+    doc_out_puts(out, format == BULK_FORMAT_CSV ? "\r\n" : "}\n");
+}
+
+static int export_sql(doc_out_t *out, const bulk_dataset_t *ds, bulk_format_t format)
+{
+    char sql[BULK_SQL_MAX];
+    db_stmt_t *st = build_sql(sql, sizeof(sql), ds, false) == 0 ? db_prepare(sql) : NULL;
+    if (!st) {
+        return -1;
+    }
+    const char *cells[BULK_MAX_COLUMNS];
+    char keys[BULK_MAX_COLUMNS][UUID_STR_LEN];
+    int rc;
+    while ((rc = db_step(st)) == 1 && !out->failed) {
+        for (int c = 0; c < ds->schema->count; c++) {
+            if (db_column_is_null(st, c)) {
+                cells[c] = NULL;
+            } else if (ds->schema->columns[c].type == DB_TYPE_UUID) {
+                cells[c] = db_column_uuid(st, c, keys[c]);
+            } else {
+                cells[c] = db_column_text(st, c);
+            }
+        }
+        export_row(out, ds, format, cells);
+    }
+    db_finalize(st);
+    return rc < 0 ? -1 : 0;
+}
+
+static int export_readings(doc_out_t *out, const bulk_dataset_t *ds, bulk_format_t format)
+{
+    sensor_value_t channels[SENSOR_MAX_CHANNELS];
+    int count = sensors_get_current(channels, SENSOR_MAX_CHANNELS);
+    for (int i = 0; i < count && !out->failed; i++) {
+        ts_series_t *series = sensors_get_series(channels[i].name);
+        ts_iter_t it;
+        if (!series || ts_iter_begin(series, 0, UINT32_MAX, &it) != 0) {
+            continue;
+        }
+        ts_sample_t sample;
+        char t[12];
+        char v[16];
+        const char *cells[3] = { channels[i].name, t, v };
+        int rc = 0;
+        while (!out->failed && (rc = ts_iter_next(&it, &sample)) == 1) {
+            snprintf(t, sizeof(t), "%u", (unsigned)sample.timestamp);
+            snprintf(v, sizeof(v), "%g", sample.value);
+            export_row(out, ds, format, cells);
+        }
+        ts_iter_end(&it);
+        if (rc < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int bulk_export(doc_out_t *out, const bulk_dataset_t *ds, bulk_format_t format)
+{
+    if (format == BULK_FORMAT_CSV) {
+        doc_out_puts(out, DOC_CSV_BOM);
+        for (int c = 0; c < ds->schema->count; c++) {
+            doc_out_printf(out, "%s%s", c ? DOC_CSV_SEP : "", ds->schema->columns[c].name);
+        }
+        doc_out_puts(out, "\r\n");
+    }
+    int rc = ds->schema->name ? export_sql(out, ds, format) : export_readings(out, ds, format);
+    if (doc_out_flush(out) != 0 || rc != 0) {
+        log_error("bulk", "Export of %s failed", ds->name);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef BULK_H
+#define BULK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "documents/doc_output.h"
+
+/*
+ * Bulk import and export of whole datasets: "animals" and
+ * "breeding_cycles" (database tables) and "readings" (the sensor
+ * archives, as channel/timestamp/value rows).  CSV carries a header
+ * row naming the columns; NDJSON is one object per line with the same
+ * names as keys.  Dates are Unix seconds on export and may also be
+ * YYYY-MM-DD or DD/MM/YYYY on import.  Keys are UUID text; a key that
+ * is not one, such as a spreadsheet's own numbering, is imported as a
+ * UUID named after it, so references between files still match.
+ */
+
+#define BULK_MAX_ERRORS  20     // Row errors kept in a report
+#define BULK_ERROR_LEN   64
+
+typedef enum {
+    BULK_FORMAT_CSV,
+    BULK_FORMAT_NDJSON,
+} bulk_format_t;
+
+typedef struct bulk_dataset bulk_dataset_t;
+typedef struct bulk_import bulk_import_t;
+
+typedef struct {
+    uint32_t line;              // 1-based line of the body
+    char message[BULK_ERROR_LEN];
+} bulk_row_error_t;
+
+typedef struct {
+    uint32_t imported;          // Rows committed
+    uint32_t failed;            // Rows rejected (or lost with their batch)
+    char error[BULK_ERROR_LEN]; // Why the import stopped, "" if it did not
+    int error_count;            // Rows in errors[], the first failures
+    bulk_row_error_t errors[BULK_MAX_ERRORS];
+} bulk_report_t;
+
+const bulk_dataset_t *bulk_find_dataset(const char *name);
+
+/* Rows are inserted through one prepared statement, batch rows per
+ * transaction.  report is filled as the import goes. */
+bulk_import_t *bulk_import_begin(const bulk_dataset_t *ds, bulk_format_t format, uint32_t batch,
+                                 bulk_report_t *report);
+/* Any split of the body will do.  -1 once the import has stopped. */
+int bulk_import_feed(bulk_import_t *imp, const void *data, size_t len);
+/* Imports the last line and runs the buffered batch, or with abort
+ * drops it.  Frees imp; returns -1 if the import stopped. */
+int bulk_import_end(bulk_import_t *imp, bool abort);
+
+/* Every row of the dataset, read from a cursor straight into out. */
+int bulk_export(doc_out_t *out, const bulk_dataset_t *ds, bulk_format_t format);
+
+#endif /* BULK_H */
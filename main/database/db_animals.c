@@ -1,29 +1,56 @@
 #include <stdio.h>
+#include <string.h>
 #include "db_animals.h"
 
 /*
  * Animal database accessors.
  *
  * These functions call into the generic db_manager to execute SQL
- * statements against the animals table.  For brevity the
- * statements are simplified and hard‑coded.  A real
- * implementation would accept parameters and use prepared
- * statements to prevent SQL injection.
+ * statements against the animals table.  Inserts and updates cover
+ * every column and are built, with the record they bind, from
+ * DB_ANIMALS_COLUMNS (db_schema.h), so they follow the schema as it
+ * grows.  The remaining queries are simplified placeholders.
  */
 
 #include "database/db_manager.h"
+#include "utils/datetime.h"
 #include "utils/logger.h"
+#include "utils/uuid.h"
 
-int db_animal_create(void)
+#define ANIMAL_SQL_MAX 512
+
+DB_ROW_BINDER(bind_animal, db_animal_t, DB_ANIMALS_COLUMNS)
+
+static int write_animal(const char *sql, const db_animal_t *a)
 {
-    const char *sql =
-        "INSERT INTO animals (id, species_name, common_name, date_acquisition, status, created_at, updated_at) "
-        "VALUES ('animal-1', 'Python regius', 'Ball python', strftime('%s','now'), 'ACTIVE', strftime('%s','now'), strftime('%s','now'));";
-    if (db_execute(sql) == 0) {
-        log_info("db/animals", "Inserted new animal record");
-        return 0;
+    db_stmt_t *st = db_prepare(sql);
+    int rc = st && bind_animal(st, a) == 0 ? db_step(st) : -1;
+    db_finalize(st);
+    return rc == 0 ? 0 : -1;
+}
+
+int db_animal_create(const db_animal_t *a)
+{
+    if (!a) {
+        return -1;
+    }
+    db_animal_t row = *a;
+    uint8_t id[UUID_BIN_LEN];
+    if (!row.id) {
+        uuid_v7(id);
+        row.id = id;
     }
-    return -1;
+    int64_t now = datetime_now();
+    row.created_at = row.created_at ? row.created_at : now;
+    row.updated_at = row.updated_at ? row.updated_at : now;
+    char sql[ANIMAL_SQL_MAX];
+    snprintf(sql, sizeof(sql), "INSERT INTO " DB_ANIMALS " (%s) VALUES (%s);",
+             DB_SQL_LIST(DB_ANIMALS_COLUMNS, DB_SQL_NAME), DB_SQL_LIST(DB_ANIMALS_COLUMNS, DB_SQL_PARAM));
+    if (write_animal(sql, &row) != 0) {
+        return -1;
+    }
+    log_info("db/animals", "Inserted new animal record");
+    return 0;
 }
 
 int db_animal_get(void)
@@ -32,15 +59,22 @@ int db_animal_get(void)
     return db_execute(sql);
 }
 
-int db_animal_update(void)
+int db_animal_update(const db_animal_t *a)
 {
-    const char *sql = "UPDATE animals SET status='SOLD', updated_at=strftime('%s','now') WHERE id='animal-1';";
-    return db_execute(sql);
+    if (!a || !a->id) {
+        return -1;
+    }
+    db_animal_t row = *a;
+    row.updated_at = datetime_now();
+    char sql[ANIMAL_SQL_MAX];
+    snprintf(sql, sizeof(sql), "UPDATE " DB_ANIMALS " SET %s WHERE " DB_ANIMALS_KEY " = ?1;",
+             DB_SQL_LIST(DB_ANIMALS_COLUMNS, DB_SQL_SET));
+    return write_animal(sql, &row);
 }
 
 int db_animal_delete(void)
 {
-    const char *sql = "DELETE FROM animals WHERE id='animal-1';";
+    const char *sql = "DELETE FROM animals WHERE id = (SELECT max(id) FROM animals);";
     return db_execute(sql);
 }
 
@@ -52,4 +86,53 @@ int db_animal_search(const char *query)
     char sql[256];
     snprintf(sql, sizeof(sql), "SELECT id, species_name FROM animals WHERE species_name LIKE '%%%s%%';", query);
     return db_execute(sql);
-}
\ No newline at end of file
+}
+
+int db_animal_add_photo(const char *animal_id, const char *blob_id, const char *content_type,
+                        uint32_t size)
+{
+    if (!animal_id || !blob_id || !content_type) {
+        return -1;
+    }
+    // Same key as uuid_key(): ids imported from before UUIDs still resolve
+    uint8_t key[UUID_BIN_LEN];
+    if (uuid_parse(animal_id, key) != 0) {
+        uuid_from_name(animal_id, key);
+    }
+    db_stmt_t *st = db_prepare(
+        "INSERT OR IGNORE INTO animal_photos (animal_id, blob_id, content_type, size, created_at) "
+        "VALUES (?1, ?2, ?3, ?4, strftime('%s','now'));");
+    int rc = st && db_bind_uuid(st, 1, key) == 0 && db_bind_text(st, 2, blob_id) == 0 &&
+             db_bind_text(st, 3, content_type) == 0 && db_bind_int(st, 4, size) == 0 ? db_step(st) : -1;
+    db_finalize(st);
+    return rc == 0 ? 0 : -1;
+}
+
+int db_animal_remove_photo(const char *animal_id, const char *blob_id)
+{
+    if (!blob_id) {
+        return -1;
+    }
+    db_stmt_t *st;
+    int rc = -1;
+    if (animal_id) {
+        uint8_t key[UUID_BIN_LEN];
+        if (uuid_parse(animal_id, key) != 0) {
+            uuid_from_name(animal_id, key);
+        }
+        st = db_prepare("DELETE FROM animal_photos WHERE blob_id = ?1 AND animal_id = ?2;");
+        rc = st && db_bind_text(st, 1, blob_id) == 0 && db_bind_uuid(st, 2, key) == 0 ? db_step(st) : -1;
+    } else {
+        st = db_prepare("DELETE FROM animal_photos WHERE blob_id = ?1;");
+        rc = st && db_bind_text(st, 1, blob_id) == 0 ? db_step(st) : -1;
+    }
+    db_finalize(st);
+    if (rc != 0) {
+        return -1;
+    }
+    st = db_prepare("SELECT count(*) FROM animal_photos WHERE blob_id = ?1;");
+    int remaining = st && db_bind_text(st, 1, blob_id) == 0 && db_step(st) == 1 ?
+                    (int)db_column_int(st, 0) : -1;
+    db_finalize(st);
+    return remaining;
+}
@@ -1,10 +1,25 @@
 #ifndef DB_ANIMALS_H
 #define DB_ANIMALS_H
 
-int db_animal_create(void);
+#include <stdint.h>
+#include "database/db_schema.h"
+
+/* One animals row, a field per column of DB_ANIMALS_COLUMNS. */
+typedef DB_ROW(DB_ANIMALS_COLUMNS) db_animal_t;
+
+/* Inserts a, with a fresh id when a->id is NULL and the current time
+ * for unset timestamps. */
+int db_animal_create(const db_animal_t *a);
 int db_animal_get(void);
-int db_animal_update(void);
+/* Rewrites every column of the row keyed a->id; updated_at is now. */
+int db_animal_update(const db_animal_t *a);
 int db_animal_delete(void);
 int db_animal_search(const char *query);
+/* Attaches a stored blob (photo, vet document) to an animal. */
+int db_animal_add_photo(const char *animal_id, const char *blob_id, const char *content_type,
+                        uint32_t size);
+/* Detaches blob_id from animal_id, or from every animal when animal_id
+ * is NULL.  Returns how many animals still reference it, -1 on error. */
+int db_animal_remove_photo(const char *animal_id, const char *blob_id);
 
 #endif /* DB_ANIMALS_H */
\ No newline at end of file
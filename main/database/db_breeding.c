@@ -2,26 +2,61 @@
 #include "db_breeding.h"
 
 /*
- * Breeding database accessors.  These functions execute simple
- * statements against the breeding_cycles table.  See db_manager.c
- * for the schema definition.  In a full implementation these
- * functions would accept parameters and return results via
- * structures or JSON.
+ * Breeding database accessors.  Inserts and updates of the
+ * breeding_cycles table cover every column and are built, with the
+ * record they bind, from DB_CYCLES_COLUMNS (db_schema.h).  The other
+ * functions are simplified placeholders.
  */
 
 #include "database/db_manager.h"
+#include "utils/datetime.h"
+#include "utils/uuid.h"
 
-int db_cycle_create(void)
+#define CYCLE_SQL_MAX 512
+
+DB_ROW_BINDER(bind_cycle, db_cycle_t, DB_CYCLES_COLUMNS)
+
+static int write_cycle(const char *sql, const db_cycle_t *c)
 {
-    const char *sql =
-        "INSERT INTO breeding_cycles (id, male_id, female_id, season, start_date, status, created_at) "
-        "VALUES ('cycle-1', 'animal-1', 'animal-2', strftime('%Y','now'), strftime('%s','now'), 'ACTIVE', strftime('%s','now'));";
-    return db_execute(sql);
+    db_stmt_t *st = db_prepare(sql);
+    int rc = st && bind_cycle(st, c) == 0 ? db_step(st) : -1;
+    db_finalize(st);
+    return rc == 0 ? 0 : -1;
+}
+
+int db_cycle_create(const db_cycle_t *c)
+{
+    if (!c) {
+        return -1;
+    }
+    db_cycle_t row = *c;
+    uint8_t id[UUID_BIN_LEN];
+    if (!row.id) {
+        uuid_v7(id);
+        row.id = id;
+    }
+    row.created_at = row.created_at ? row.created_at : datetime_now();
+    char sql[CYCLE_SQL_MAX];
+    snprintf(sql, sizeof(sql), "INSERT INTO " DB_CYCLES " (%s) VALUES (%s);",
+             DB_SQL_LIST(DB_CYCLES_COLUMNS, DB_SQL_NAME), DB_SQL_LIST(DB_CYCLES_COLUMNS, DB_SQL_PARAM));
+    return write_cycle(sql, &row);
+}
+
+int db_cycle_update(const db_cycle_t *c)
+{
+    if (!c || !c->id) {
+        return -1;
+    }
+    char sql[CYCLE_SQL_MAX];
+    snprintf(sql, sizeof(sql), "UPDATE " DB_CYCLES " SET %s WHERE " DB_CYCLES_KEY " = ?1;",
+             DB_SQL_LIST(DB_CYCLES_COLUMNS, DB_SQL_SET));
+    return write_cycle(sql, c);
 }
 
 int db_cycle_get(void)
 {
-    const char *sql = "SELECT id, male_id, female_id, status FROM breeding_cycles LIMIT 1;";
+    const char *sql = "SELECT uuid_text(id), uuid_text(male_id), uuid_text(female_id), status "
+                      "FROM breeding_cycles LIMIT 1;";
     return db_execute(sql);
 }
 
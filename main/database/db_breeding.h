@@ -1,7 +1,17 @@
 #ifndef DB_BREEDING_H
 #define DB_BREEDING_H
 
-int db_cycle_create(void);
+#include <stdint.h>
+#include "database/db_schema.h"
+
+/* One breeding_cycles row, a field per column of DB_CYCLES_COLUMNS. */
+typedef DB_ROW(DB_CYCLES_COLUMNS) db_cycle_t;
+
+/* Inserts c, with a fresh id when c->id is NULL and the current time
+ * when created_at is unset. */
+int db_cycle_create(const db_cycle_t *c);
+/* Rewrites every column of the row keyed c->id. */
+int db_cycle_update(const db_cycle_t *c);
 int db_cycle_get(void);
 int db_offspring_add(void);
 int db_genealogy_get(void);
@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "db_list.h"
+
+/*
+ * Keyset pagination over the animal and breeding tables.
+ *
+ * Each listable table has its columns from db_schema.h (fields= is
+ * checked against them, never pasted unchecked into SQL) and a few
+ * sort orders, each backed by an index on (key, id).  A page is
+ *
+ *     SELECT <fields>, key, id FROM t
+ *     WHERE (key, id) < (?1, ?2) ORDER BY key DESC, id DESC LIMIT n + 1
+ *
+ * (> and ASC for ascending orders); the extra row only says whether
+ * there is a next page.  The cursor is base64url of
+ *
+ *     [sort index | CURSOR_NO_KEY][key: 8 bytes big-endian or text][id]
+ *
+ * A text key too long for a cursor is left out, and the seek reads it
+ * back from the anchor row by its primary key instead.
+ */
+
+#include "db_manager.h"
+#include "db_schema.h"
+#include "mbedtls/base64.h"
+#include "utils/uuid.h"
+
+#define LIST_MAX_COLUMNS   32           // fields= is a bit set
+#define CURSOR_KEY_MAX     160          // Text key bytes carried in a cursor
+#define CURSOR_RAW_MAX     (1 + CURSOR_KEY_MAX + UUID_BIN_LEN)
+#define CURSOR_NO_KEY      0x80
+#define LIST_SQL_MAX       640
+
+typedef struct {
+    const char *name;
+    const char *key;            // NOT NULL column, indexed with id
+    db_type_t key_type;         // DB_TYPE_INT or DB_TYPE_TEXT
+    bool descending;
+} list_sort_t;
+
+struct db_list_table {
+    const db_table_t *schema;
+    const list_sort_t *sorts;   // The first is the default
+    int sort_count;
+};
+
+typedef struct {
+    const list_sort_t *sort;
+    uint8_t sort_index;
+    uint32_t fields;            // Bit per column
+    int limit;
+    bool after;
+    bool has_key;
+    int64_t key_int;
+    char key_text[CURSOR_KEY_MAX + 1];
+    uint8_t id[UUID_BIN_LEN];
+} list_params_t;
+
+static const list_sort_t ANIMAL_SORTS[] = {
+    { "updated", "updated_at",   DB_TYPE_INT,  true },
+    { "species", "species_name", DB_TYPE_TEXT, false },
+};
+
+static const list_sort_t CYCLE_SORTS[] = {
+    { "created", "created_at", DB_TYPE_INT, true },
+};
+
+#define COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+const db_list_table_t DB_LIST_ANIMALS = { &DB_TABLE_ANIMALS, ANIMAL_SORTS, COUNT(ANIMAL_SORTS) };
+const db_list_table_t DB_LIST_CYCLES = { &DB_TABLE_CYCLES, CYCLE_SORTS, COUNT(CYCLE_SORTS) };
+// Keyed by name rather than (key, id), so it has no page order
+const db_list_table_t DB_LIST_REGULATIONS = { &DB_TABLE_REGULATIONS, NULL, 0 };
+
+#define COLUMN_COUNT(name, type, constraints, flags) + 1
+_Static_assert(0 DB_ANIMALS_COLUMNS(COLUMN_COUNT) <= LIST_MAX_COLUMNS &&
+               0 DB_CYCLES_COLUMNS(COLUMN_COUNT) <= LIST_MAX_COLUMNS &&
+               0 DB_REGULATIONS_COLUMNS(COLUMN_COUNT) <= LIST_MAX_COLUMNS, "fields are a bit set");
+
+/* Columns fields= may name: a bit per column. */
+static uint32_t listed_columns(const db_table_t *t)
+{
+    uint32_t set = 0;
+    for (int c = 0; c < t->count; c++) {
+        if (!(t->columns[c].flags & DB_COL_UNLISTED)) {
+            set |= 1u << c;
+        }
+    }
+    return set;
+}
+
+static int cursor_encode(const uint8_t *raw, size_t len, char *out, size_t out_size)
+{
+    size_t out_len = 0;
+    if (mbedtls_base64_encode((unsigned char *)out, out_size, &out_len, raw, len) != 0) {
+        return -1;
+    }
+    // URL safe, no padding: the cursor goes back in a query string
+    for (size_t i = 0; i < out_len; i++) {
+        if (out[i] == '+') out[i] = '-';
+        else if (out[i] == '/') out[i] = '_';
+    }
+    while (out_len > 0 && out[out_len - 1] == '=') {
+        out[--out_len] = '\0';
+    }
+    return 0;
+}
+
+static int cursor_decode(const char *text, uint8_t *raw, size_t *len)
+{
+    char b64[DB_LIST_CURSOR_MAX + 3];
+    size_t n = strlen(text);
+    if (n >= DB_LIST_CURSOR_MAX) {
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        char c = text[i];
+        b64[i] = c == '-' ? '+' : c == '_' ? '/' : c;
+    }
+    while (n % 4) {
+        b64[n++] = '=';
+    }
+    return mbedtls_base64_decode(raw, CURSOR_RAW_MAX, len, (const unsigned char *)b64, n) == 0 ? 0 : -1;
+}
+
+static const char *parse_cursor(const char *text, list_params_t *p)
+{
+    uint8_t raw[CURSOR_RAW_MAX];
+    size_t len;
+    if (cursor_decode(text, raw, &len) != 0 || len < 1 + UUID_BIN_LEN) {
+        return "Invalid cursor";
+    }
+    if ((raw[0] & ~CURSOR_NO_KEY) != p->sort_index) {
+        return "Cursor is for another sort";
+    }
+    size_t key_len = len - 1 - UUID_BIN_LEN;
+    p->after = true;
+    p->has_key = !(raw[0] & CURSOR_NO_KEY);
+    memcpy(p->id, raw + len - UUID_BIN_LEN, UUID_BIN_LEN);
+    if (!p->has_key) {
+        return key_len == 0 ? NULL : "Invalid cursor";
+    }
+    if (p->sort->key_type == DB_TYPE_INT) {
+        if (key_len != 8) {
+            return "Invalid cursor";
+        }
+        uint64_t v = 0;
+        for (int i = 0; i < 8; i++) {
+            v = v << 8 | raw[1 + i];
+        }
+        p->key_int = (int64_t)v;
+        return NULL;
+    }
+    if (memchr(raw + 1, '\0', key_len)) {
+        return "Invalid cursor";
+    }
+    memcpy(p->key_text, raw + 1, key_len);
+    p->key_text[key_len] = '\0';
+    return NULL;
+}
+
+static const char *parse_fields(const db_table_t *t, const char *fields, uint32_t *set)
+{
+    const uint32_t listed = listed_columns(t);
+    *set = 0;
+    if (!fields || !fields[0]) {
+        *set = listed;
+        return NULL;
+    }
+    for (const char *s = fields; *s; ) {
+        size_t n = strcspn(s, ",");
+        int c = 0;
+        while (c < t->count && (!(listed & (1u << c)) || strlen(t->columns[c].name) != n ||
+                                strncmp(t->columns[c].name, s, n) != 0)) {
+            c++;
+        }
+        if (n > 0 && c == t->count) {
+            return "Unknown field";
+        }
+        if (n > 0) {
+            *set |= 1u << c;
+        }
+        s += n + (s[n] == ',');
+    }
+    return *set ? NULL : "No fields selected";
+}
+
+static const char *parse_query(const db_list_table_t *t, const db_list_query_t *q, list_params_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    if (t->sort_count == 0) {
+        return "Not a paginated table";
+    }
+    p->sort = &t->sorts[0];
+    if (q->sort && q->sort[0]) {
+        int i = 0;
+        while (i < t->sort_count && strcmp(t->sorts[i].name, q->sort) != 0) {
+            i++;
+        }
+        if (i == t->sort_count) {
+            return "Unknown sort";
+        }
+        p->sort = &t->sorts[i];
+        p->sort_index = (uint8_t)i;
+    }
+    p->limit = q->limit == 0 ? DB_LIST_DEFAULT_LIMIT : q->limit;
+    if (p->limit < 1 || p->limit > DB_LIST_MAX_LIMIT) {
+        return "limit must be between 1 and 200";
+    }
+    const char *err = parse_fields(t->schema, q->fields, &p->fields);
+    if (err || !q->after || !q->after[0]) {
+        return err;
+    }
+    return parse_cursor(q->after, p);
+}
+
+const char *db_list_check(const db_list_table_t *t, const db_list_query_t *q)
+{
+    list_params_t p;
+    return parse_query(t, q, &p);
+}
+
+static int build_sql(char *sql, size_t size, const db_list_table_t *t, const list_params_t *p)
+{
+    const list_sort_t *s = p->sort;
+    const db_table_t *schema = t->schema;
+    int len = snprintf(sql, size, "SELECT ");
+    for (int c = 0; c < schema->count; c++) {
+        if (p->fields & (1u << c)) {
+            len += snprintf(sql + len, size - len, "%s, ", schema->columns[c].name);
+        }
+    }
+    len += snprintf(sql + len, size - len, "%s, id FROM %s", s->key, schema->name);
+    if (p->after) {
+        len += snprintf(sql + len, size - len,
+                        " WHERE (%s, id) %c (coalesce(?1, (SELECT %s FROM %s WHERE id = ?2)), ?2)",
+                        s->key, s->descending ? '<' : '>', s->key, schema->name);
+    }
+    const char *dir = s->descending ? "DESC" : "ASC";
+    len += snprintf(sql + len, size - len, " ORDER BY %s %s, id %s LIMIT ?3;", s->key, dir, dir);
+    return len < (int)size ? 0 : -1;
+}
+
+static void write_row(doc_out_t *out, const db_table_t *t, uint32_t fields, db_stmt_t *stmt,
+                      int first)
+{
+    char uuid[UUID_STR_LEN];
+    int col = first;
+    doc_out_puts(out, "{");
+    for (int c = 0; c < t->count; c++) {
+        if (!(fields & (1u << c))) {
+            continue;
+        }
+        db_type_t type = t->columns[c].type;
+        doc_out_printf(out, col > first ? ",\"%s\":" : "\"%s\":", t->columns[c].name);
+        if (db_column_is_null(stmt, col)) {
+            doc_out_puts(out, "null");
+        } else if (type == DB_TYPE_INT || type == DB_TYPE_DATE) {
+            doc_out_printf(out, "%lld", (long long)db_column_int(stmt, col));
+        } else if (type == DB_TYPE_REAL) {
+            doc_out_puts(out, db_column_text(stmt, col));
+        } else if (type == DB_TYPE_UUID) {
+            doc_out_json_string(out, db_column_uuid(stmt, col, uuid));
+        } else {
+            doc_out_json_string(out, db_column_text(stmt, col));
+        }
+        col++;
+    }
+    doc_out_puts(out, "}");
+}
+
+/* Remembers the (key, id) of the row just written, for the cursor. */
+static void keep_position(list_params_t *p, db_stmt_t *stmt, int col)
+{
+    char uuid[UUID_STR_LEN];
+    p->has_key = true;
+    if (p->sort->key_type == DB_TYPE_INT) {
+        p->key_int = db_column_int(stmt, col);
+    } else {
+        const char *key = db_column_text(stmt, col);
+        p->has_key = strlen(key) <= CURSOR_KEY_MAX;
+        if (p->has_key) {
+            strcpy(p->key_text, key);
+        }
+    }
+    uuid_parse(db_column_uuid(stmt, col + 1, uuid), p->id);
+}
+
+static int write_cursor(doc_out_t *out, const list_params_t *p)
+{
+    uint8_t raw[CURSOR_RAW_MAX];
+    size_t len = 1;
+    raw[0] = p->sort_index | (p->has_key ? 0 : CURSOR_NO_KEY);
+    if (p->has_key && p->sort->key_type == DB_TYPE_INT) {
+        for (int i = 0; i < 8; i++) {
+            raw[len++] = (uint8_t)((uint64_t)p->key_int >> (56 - 8 * i));
+        }
+    } else if (p->has_key) {
+        size_t n = strlen(p->key_text);
+        memcpy(raw + len, p->key_text, n);
+        len += n;
+    }
+    memcpy(raw + len, p->id, UUID_BIN_LEN);
+    len += UUID_BIN_LEN;
+
+    char text[DB_LIST_CURSOR_MAX];
+    if (cursor_encode(raw, len, text, sizeof(text)) != 0) {
+        return -1;
+    }
+    return doc_out_printf(out, "\"%s\"", text);
+}
+
+int db_list_page(const db_list_table_t *t, const db_list_query_t *q, doc_out_t *out)
+{
+    list_params_t p;
+    if (parse_query(t, q, &p) != NULL) {
+        return -1;
+    }
+    char sql[LIST_SQL_MAX];
+    if (build_sql(sql, sizeof(sql), t, &p) != 0) {
+        return -1;
+    }
+    db_stmt_t *stmt = db_prepare(sql);
+    if (!stmt) {
+        return -1;
+    }
+    if (p.after) {
+        if (!p.has_key) {
+            db_bind_text(stmt, 1, NULL);
+        } else if (p.sort->key_type == DB_TYPE_INT) {
+            db_bind_int(stmt, 1, p.key_int);
+        } else {
+            db_bind_text(stmt, 1, p.key_text);
+        }
+        db_bind_uuid(stmt, 2, p.id);
+    }
+    db_bind_int(stmt, 3, p.limit + 1);
+
+    int key_col = __builtin_popcount(p.fields);
+    int rows = 0;
+    int rc;
+    doc_out_puts(out, "{\"items\":[");
+    while ((rc = db_step(stmt)) == 1 && rows < p.limit) {
+        if (rows++) {
+            doc_out_puts(out, ",");
+        }
+        write_row(out, t->schema, p.fields, stmt, 0);
+        keep_position(&p, stmt, key_col);
+    }
+    bool more = rc == 1;
+    db_finalize(stmt);
+    if (rc < 0) {
+        return -1;
+    }
+    doc_out_puts(out, "],\"next\":");
+    if (more) {
+        write_cursor(out, &p);
+    } else {
+        doc_out_puts(out, "null");
+    }
+    doc_out_puts(out, "}");
+    return doc_out_flush(out);
+}
+
+int db_list_columns(const db_list_table_t *t, char *sql, size_t size)
+{
+    const db_table_t *schema = t->schema;
+    int len = 0;
+    for (int c = 0; c < schema->count && len < (int)size; c++) {
+        len += snprintf(sql + len, size - len, len ? ", %s" : "%s", schema->columns[c].name);
+    }
+    return len < (int)size ? 0 : -1;
+}
+
+void db_list_write_row(doc_out_t *out, const db_list_table_t *t, db_stmt_t *stmt, int first)
+{
+    // Unlisted columns included: a replica needs the whole row
+    write_row(out, t->schema, (1u << t->schema->count) - 1, stmt, first);
+}
+
@@ -0,0 +1,50 @@
+#ifndef DB_LIST_H
+#define DB_LIST_H
+
+#include "database/db_manager.h"
+#include "documents/doc_output.h"
+
+/*
+ * Keyset-paginated listings of the animals and breeding cycles.
+ *
+ * A page starts right after the last row of the previous one in the
+ * chosen order, found by one index seek on (sort key, id) instead of
+ * stepping over OFFSET rows, so the hundredth page costs what the
+ * first does and rows written meanwhile neither repeat nor go missing.
+ * The position travels as an opaque cursor, the "next" of the previous
+ * page.  fields= narrows both the SELECT and the objects written.
+ */
+
+#define DB_LIST_DEFAULT_LIMIT  50
+#define DB_LIST_MAX_LIMIT      200
+#define DB_LIST_CURSOR_MAX     240      // Longest cursor text, NUL included
+
+typedef struct db_list_table db_list_table_t;
+
+extern const db_list_table_t DB_LIST_ANIMALS;   // sort=updated (default) or species
+extern const db_list_table_t DB_LIST_CYCLES;    // sort=created
+extern const db_list_table_t DB_LIST_REGULATIONS;   // Rows only, no page order
+
+typedef struct {
+    const char *sort;           // NULL or "": the table's default order
+    const char *fields;         // Comma-separated column names; NULL or "": all
+    const char *after;          // Cursor; NULL or "": first page
+    int limit;                  // 0: DB_LIST_DEFAULT_LIMIT
+} db_list_query_t;
+
+/* NULL when the query is usable, else what is wrong with it. */
+const char *db_list_check(const db_list_table_t *t, const db_list_query_t *q);
+
+/* Writes {"items":[...],"next":"<cursor>"|null} to out and flushes it. */
+int db_list_page(const db_list_table_t *t, const db_list_query_t *q, doc_out_t *out);
+
+/*
+ * For other row streams (delta sync): every column of t as a SELECT
+ * list, and one row read through it, from column first on, written as
+ * the JSON object a listing has plus its unlisted columns (free-form
+ * JSON such as metadata_json, as a string), so a replica is complete.
+ */
+int db_list_columns(const db_list_table_t *t, char *sql, size_t size);
+void db_list_write_row(doc_out_t *out, const db_list_table_t *t, db_stmt_t *stmt, int first);
+
+#endif /* DB_LIST_H */
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "sdkconfig.h"
 #include "db_manager.h"
@@ -14,12 +15,271 @@
  * same directory.  See the architecture document for the schema【808169448218282†L587-L669】.
  */
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "db_schema.h"
 #include "storage/file_manager.h"
 #include "utils/logger.h"
+#include "utils/uuid.h"
+
+#define DB_MAX_TRACKED_TABLES 16
+
+typedef struct {
+    char name[32];
+    uint32_t generation;
+} db_table_gen_t;
+
+// Written only from the SQLite update hook, which the library
+// serialises; an entry is filled before the count is raised.
+static db_table_gen_t s_table_gens[DB_MAX_TRACKED_TABLES];
+static volatile int s_table_gen_count = 0;
+static volatile uint32_t s_db_generation = 0;
 
 #if CONFIG_APP_USE_SQLITE3
 #include "sqlite3.h"
 static sqlite3 *s_db = NULL;
+// Recursive: a transaction holder runs db_execute()/db_step() itself
+static SemaphoreHandle_t s_lock = NULL;
+
+static void db_lock(void)
+{
+    xSemaphoreTakeRecursive(s_lock, portMAX_DELAY);
+}
+
+static void db_unlock(void)
+{
+    xSemaphoreGiveRecursive(s_lock);
+}
+
+static void db_update_hook(void *arg, int op, const char *db_name, const char *table,
+                           sqlite3_int64 rowid)
+{
+    (void)arg;
+    (void)op;
+    (void)db_name;
+    (void)rowid;
+    s_db_generation++;
+    for (int i = 0; i < s_table_gen_count; i++) {
+        if (strcmp(s_table_gens[i].name, table) == 0) {
+            s_table_gens[i].generation++;
+            return;
+        }
+    }
+    if (s_table_gen_count < DB_MAX_TRACKED_TABLES) {
+        db_table_gen_t *entry = &s_table_gens[s_table_gen_count];
+        snprintf(entry->name, sizeof(entry->name), "%s", table);
+        entry->generation = 1;
+        __sync_synchronize();
+        s_table_gen_count++;
+    }
+}
+
+// The update hook misses whole-table DELETEs and WITHOUT ROWID
+// tables.  When rows changed unseen, invalidate every table.
+static void note_unseen_changes(int changes_before, uint32_t hooked_before)
+{
+    uint32_t changes = (uint32_t)(sqlite3_total_changes(s_db) - changes_before);
+    if (changes > s_db_generation - hooked_before) {
+        s_db_generation++;
+        for (int i = 0; i < s_table_gen_count; i++) {
+            s_table_gens[i].generation++;
+        }
+    }
+}
+
+// Schema version 1 keys rows by 16-byte UUIDs (utils/uuid.h).
+// Version 2 adds the change log behind delta sync (db_sync.h) and
+// version 3 animals.date_exit, see EXIT_DATE_TRIGGERS.  The tables
+// themselves are defined in db_schema.h.
+#define DB_SCHEMA_VERSION "3"
+
+// One change_log row per synced row: its latest upsert ('U') or its
+// tombstone ('D').  A write replaces the row's entry with a new one at
+// a higher seq, so the log never holds more entries than rows plus
+// tombstones, and AUTOINCREMENT never hands out a seq twice, even once
+// the newest entries have been replaced or purged.
+#define CHANGE_LOG_DDL                                                      \
+    "CREATE TABLE IF NOT EXISTS change_log ("                               \
+    "seq INTEGER PRIMARY KEY AUTOINCREMENT,"                                \
+    "tbl TEXT NOT NULL,"                                                    \
+    "row_key NOT NULL,"                                                     \
+    "op TEXT NOT NULL CHECK (op IN ('U', 'D')),"                            \
+    "at INTEGER NOT NULL);"                                                 \
+    "CREATE INDEX IF NOT EXISTS idx_change_log_row ON change_log(tbl, row_key);" \
+    "CREATE TABLE IF NOT EXISTS sync_state ("                               \
+    "name TEXT PRIMARY KEY NOT NULL,"                                       \
+    "value INTEGER NOT NULL);"
+
+#define CHANGE_LOG_NOW "strftime('%s', 'now')"
+
+#define CHANGE_LOG_TRIGGERS(t, k)                                           \
+    "CREATE TRIGGER IF NOT EXISTS change_log_" t "_ins AFTER INSERT ON " t " BEGIN " \
+    "DELETE FROM change_log WHERE tbl = '" t "' AND row_key = NEW." k ";"   \
+    "INSERT INTO change_log (tbl, row_key, op, at) "                        \
+    "VALUES ('" t "', NEW." k ", 'U', " CHANGE_LOG_NOW ");"                 \
+    "END;"                                                                  \
+    "CREATE TRIGGER IF NOT EXISTS change_log_" t "_upd AFTER UPDATE ON " t " BEGIN " \
+    "DELETE FROM change_log WHERE tbl = '" t "' AND row_key IN (OLD." k ", NEW." k ");" \
+    "INSERT INTO change_log (tbl, row_key, op, at) "                        \
+    "SELECT '" t "', OLD." k ", 'D', " CHANGE_LOG_NOW " WHERE OLD." k " IS NOT NEW." k ";" \
+    "INSERT INTO change_log (tbl, row_key, op, at) "                        \
+    "VALUES ('" t "', NEW." k ", 'U', " CHANGE_LOG_NOW ");"                 \
+    "END;"                                                                  \
+    "CREATE TRIGGER IF NOT EXISTS change_log_" t "_del AFTER DELETE ON " t " BEGIN " \
+    "DELETE FROM change_log WHERE tbl = '" t "' AND row_key = OLD." k ";"   \
+    "INSERT INTO change_log (tbl, row_key, op, at) "                        \
+    "VALUES ('" t "', OLD." k ", 'D', " CHANGE_LOG_NOW ");"                 \
+    "END;"
+
+// Rows written before version 2 get an entry each, so a sync from 0
+// still returns everything.
+#define CHANGE_LOG_SEED(t, k)                                               \
+    "INSERT INTO change_log (tbl, row_key, op, at) "                        \
+    "SELECT '" t "', " k ", 'U', " CHANGE_LOG_NOW " FROM " t ";"
+
+// date_exit is stamped when an animal's status becomes an exit (the
+// statuses the registry prints a motive for) and cleared when it goes
+// back to anything else.  An exit date written together with the
+// status, by an import or a sync, is kept.  Rows inserted already
+// exited without one take their updated_at, the best date there is.
+#define EXIT_STATUSES "('SOLD', 'DECEASED', 'TRANSFERRED')"
+
+#define EXIT_DATE_TRIGGERS                                                  \
+    "CREATE TRIGGER IF NOT EXISTS animals_exit_ins AFTER INSERT ON animals " \
+    "WHEN NEW.status IN " EXIT_STATUSES " AND NEW.date_exit IS NULL BEGIN " \
+    "UPDATE animals SET date_exit = NEW.updated_at WHERE id = NEW.id;"      \
+    "END;"                                                                  \
+    "CREATE TRIGGER IF NOT EXISTS animals_exit_upd AFTER UPDATE OF status ON animals " \
+    "WHEN NEW.status IS NOT OLD.status BEGIN "                              \
+    "UPDATE animals SET date_exit = CASE WHEN NEW.status IN " EXIT_STATUSES \
+    " THEN COALESCE(NEW.date_exit, " CHANGE_LOG_NOW ") END WHERE id = NEW.id;" \
+    "END;"
+
+// uuid_key(x): the 16-byte key for x.  Keys pass through, UUID text is
+// decoded and anything else (ids from before UUIDs) is named into one.
+static void sql_uuid_key(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    (void)argc;
+    sqlite3_value *v = argv[0];
+    int type = sqlite3_value_type(v);
+    if (type == SQLITE_NULL || (type == SQLITE_BLOB && sqlite3_value_bytes(v) == UUID_BIN_LEN)) {
+        sqlite3_result_value(ctx, v);
+        return;
+    }
+    const char *text = (const char *)sqlite3_value_text(v);
+    uint8_t id[UUID_BIN_LEN];
+    if (!text || uuid_parse(text, id) != 0) {
+        uuid_from_name(text ? text : "", id);
+    }
+    sqlite3_result_blob(ctx, id, UUID_BIN_LEN, SQLITE_TRANSIENT);
+}
+
+// uuid_text(x): text form of a key; other values pass through.
+static void sql_uuid_text(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    (void)argc;
+    sqlite3_value *v = argv[0];
+    const void *blob = sqlite3_value_type(v) == SQLITE_BLOB ? sqlite3_value_blob(v) : NULL;
+    if (!blob || sqlite3_value_bytes(v) != UUID_BIN_LEN) {
+        sqlite3_result_value(ctx, v);
+        return;
+    }
+    char text[UUID_STR_LEN];
+    uuid_format(blob, text);
+    sqlite3_result_text(ctx, text, UUID_STR_LEN - 1, SQLITE_TRANSIENT);
+}
+
+// uuid_new(): a fresh UUIDv7 key.
+static void sql_uuid_new(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    (void)argc;
+    (void)argv;
+    uint8_t id[UUID_BIN_LEN];
+    uuid_v7(id);
+    sqlite3_result_blob(ctx, id, UUID_BIN_LEN, SQLITE_TRANSIENT);
+}
+
+static void register_uuid_functions(void)
+{
+    int flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC;
+    sqlite3_create_function(s_db, "uuid_key", 1, flags, NULL, sql_uuid_key, NULL, NULL);
+    sqlite3_create_function(s_db, "uuid_text", 1, flags, NULL, sql_uuid_text, NULL, NULL);
+    sqlite3_create_function(s_db, "uuid_new", 0, SQLITE_UTF8, NULL, sql_uuid_new, NULL, NULL);
+}
+
+static int schema_version(void)
+{
+    sqlite3_stmt *st;
+    int version = 0;
+    if (sqlite3_prepare_v2(s_db, "PRAGMA user_version;", -1, &st, NULL) == SQLITE_OK) {
+        if (sqlite3_step(st) == SQLITE_ROW) {
+            version = sqlite3_column_int(st, 0);
+        }
+        sqlite3_finalize(st);
+    }
+    return version;
+}
+
+static bool table_exists(const char *name)
+{
+    sqlite3_stmt *st;
+    bool exists = false;
+    if (sqlite3_prepare_v2(s_db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?1;",
+                           -1, &st, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(st, 1, name, -1, SQLITE_STATIC);
+        exists = sqlite3_step(st) == SQLITE_ROW;
+        sqlite3_finalize(st);
+    }
+    return exists;
+}
+
+// Version 0 stored ids as TEXT.  Each table is copied into a version 1
+// twin with every key and reference run through uuid_key(), which maps
+// a given old id to the same key wherever it appears, then swapped in.
+static int migrate_text_ids(void)
+{
+    static const struct {
+        const char *table;
+        const char *sql;
+    } STEPS[] = {
+        { "animals",
+          DB_TABLE_DDL("animals_v1", DB_ANIMALS_COLUMNS, DB_ANIMALS_KEY)
+          "INSERT INTO animals_v1 SELECT uuid_key(id), species_name, common_name, sex, date_birth, "
+          "date_acquisition, status, provenance_type, provenance_vendor, metadata_json, created_at, "
+          "updated_at, NULL FROM animals;"
+          "DROP TABLE animals; ALTER TABLE animals_v1 RENAME TO animals;" },
+        { "breeding_cycles",
+          DB_TABLE_DDL("breeding_cycles_v1", DB_CYCLES_COLUMNS, DB_CYCLES_KEY)
+          "INSERT INTO breeding_cycles_v1 SELECT uuid_key(id), uuid_key(male_id), uuid_key(female_id), "
+          "season, start_date, end_date, status, clutch_date, clutch_eggs_total, clutch_eggs_viable, "
+          "incubation_temp_avg, notes, created_at FROM breeding_cycles;"
+          "DROP TABLE breeding_cycles; ALTER TABLE breeding_cycles_v1 RENAME TO breeding_cycles;" },
+        { "animal_photos",
+          DB_TABLE_DDL("animal_photos_v1", DB_PHOTOS_COLUMNS, DB_PHOTOS_KEY)
+          "INSERT INTO animal_photos_v1 SELECT uuid_key(animal_id), blob_id, content_type, size, "
+          "created_at FROM animal_photos;"
+          "DROP TABLE animal_photos; ALTER TABLE animal_photos_v1 RENAME TO animal_photos;" },
+    };
+    // Foreign keys cannot be switched inside a transaction
+    sqlite3_exec(s_db, "PRAGMA foreign_keys = OFF; BEGIN;", NULL, NULL, NULL);
+    int rc = SQLITE_OK;
+    int migrated = 0;
+    for (size_t i = 0; rc == SQLITE_OK && i < sizeof(STEPS) / sizeof(STEPS[0]); i++) {
+        if (table_exists(STEPS[i].table)) {
+            rc = sqlite3_exec(s_db, STEPS[i].sql, NULL, NULL, NULL);
+            migrated++;
+        }
+    }
+    if (rc != SQLITE_OK) {
+        log_error("db", "Migration to UUID keys failed: %s", sqlite3_errmsg(s_db));
+    }
+    sqlite3_exec(s_db, rc == SQLITE_OK ? "COMMIT;" : "ROLLBACK;", NULL, NULL, NULL);
+    sqlite3_exec(s_db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+    if (rc == SQLITE_OK && migrated > 0) {
+        log_info("db", "Migrated %d table(s) to UUID keys", migrated);
+    }
+    return rc == SQLITE_OK ? 0 : -1;
+}
 #endif
 
 int db_init(void)
@@ -31,6 +291,9 @@ int db_init(void)
     if (s_db) {
         return 0;
     }
+    if (!s_lock && !(s_lock = xSemaphoreCreateRecursiveMutex())) {
+        return -1;
+    }
     // Open or create the database file in SPIFFS/LittleFS
     const char *db_path = "/spiffs/reptiles.db";
     int rc = sqlite3_open(db_path, &s_db);
@@ -40,26 +303,60 @@ int db_init(void)
     }
     // Enable foreign keys
     sqlite3_exec(s_db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+    sqlite3_update_hook(s_db, db_update_hook, NULL);
+    register_uuid_functions();
+    int version = schema_version();
+    if (version < 1 && migrate_text_ids() != 0) {
+        return -1;
+    }
+    // Tables created before version 3 lack date_exit; ADD COLUMN appends
+    // it, which is where db_schema.h lists it
+    if (version >= 1 && version < 3 &&
+        sqlite3_exec(s_db, "ALTER TABLE animals ADD COLUMN date_exit INTEGER;", NULL, NULL, NULL) != SQLITE_OK) {
+        log_error("db", "Failed to add animals.date_exit: %s", sqlite3_errmsg(s_db));
+        return -1;
+    }
     // Create tables if they do not exist (simplified schema)
     const char *sql =
-        "CREATE TABLE IF NOT EXISTS animals ("
-        "id TEXT PRIMARY KEY,"
-        "species_name TEXT NOT NULL,"
-        "common_name TEXT,"
-        "sex TEXT,"
-        "date_birth INTEGER,"
-        "date_acquisition INTEGER NOT NULL,"
-        "status TEXT,"
-        "provenance_type TEXT,"
-        "provenance_vendor TEXT,"
-        "metadata_json TEXT,"
-        "created_at INTEGER NOT NULL,"
-        "updated_at INTEGER NOT NULL);";
+        DB_TABLE_DDL(DB_ANIMALS, DB_ANIMALS_COLUMNS, DB_ANIMALS_KEY)
+        DB_TABLE_DDL(DB_CYCLES, DB_CYCLES_COLUMNS, DB_CYCLES_KEY)
+        "CREATE INDEX IF NOT EXISTS idx_breeding_season ON breeding_cycles(season DESC);"
+        // Keyset pagination seeks on (sort key, id), see db_list.c
+        "CREATE INDEX IF NOT EXISTS idx_animals_updated ON animals(updated_at, id);"
+        "CREATE INDEX IF NOT EXISTS idx_animals_species ON animals(species_name, id);"
+        "CREATE INDEX IF NOT EXISTS idx_breeding_created ON breeding_cycles(created_at, id);"
+        DB_TABLE_DDL(DB_PHOTOS, DB_PHOTOS_COLUMNS, DB_PHOTOS_KEY)
+        DB_TABLE_DDL(DB_REGULATIONS, DB_REGULATIONS_COLUMNS, DB_REGULATIONS_KEY)
+        CHANGE_LOG_DDL
+        CHANGE_LOG_TRIGGERS(DB_REGULATIONS, DB_REGULATIONS_KEY)
+        CHANGE_LOG_TRIGGERS(DB_ANIMALS, DB_ANIMALS_KEY)
+        CHANGE_LOG_TRIGGERS(DB_CYCLES, DB_CYCLES_KEY)
+        EXIT_DATE_TRIGGERS;
     rc = sqlite3_exec(s_db, sql, NULL, NULL, NULL);
     if (rc != SQLITE_OK) {
         log_error("db", "Failed to create tables: %s", sqlite3_errmsg(s_db));
         return -1;
     }
+    if (version < 2) {
+        rc = sqlite3_exec(s_db,
+                          "BEGIN;"
+                          CHANGE_LOG_SEED(DB_REGULATIONS, DB_REGULATIONS_KEY)
+                          CHANGE_LOG_SEED(DB_ANIMALS, DB_ANIMALS_KEY)
+                          CHANGE_LOG_SEED(DB_CYCLES, DB_CYCLES_KEY)
+                          "COMMIT;", NULL, NULL, NULL);
+        if (rc != SQLITE_OK) {
+            log_error("db", "Failed to seed the change log: %s", sqlite3_errmsg(s_db));
+            sqlite3_exec(s_db, "ROLLBACK;", NULL, NULL, NULL);
+            return -1;
+        }
+    }
+    if (version < 3) {
+        // No exit was dated before: the last change is the nearest guess
+        sqlite3_exec(s_db,
+                     "UPDATE animals SET date_exit = updated_at "
+                     "WHERE status IN " EXIT_STATUSES " AND date_exit IS NULL;", NULL, NULL, NULL);
+    }
+    sqlite3_exec(s_db, "PRAGMA user_version = " DB_SCHEMA_VERSION ";", NULL, NULL, NULL);
     log_info("db", "Database initialised at %s", db_path);
     return 0;
 #endif
@@ -76,7 +373,12 @@ int db_execute(const char *sql)
         return -1;
     }
     char *errmsg = NULL;
+    db_lock();
+    int changes_before = sqlite3_total_changes(s_db);
+    uint32_t hooked_before = s_db_generation;
     int rc = sqlite3_exec(s_db, sql, NULL, NULL, &errmsg);
+    note_unseen_changes(changes_before, hooked_before);
+    db_unlock();
     if (rc != SQLITE_OK) {
         log_error("db", "SQL error: %s", errmsg);
         sqlite3_free(errmsg);
@@ -86,6 +388,235 @@ int db_execute(const char *sql)
 #endif
 }
 
+int db_begin(void)
+{
+#if !CONFIG_APP_USE_SQLITE3
+    return -1;
+#else
+    if (!s_db) {
+        return -1;
+    }
+    db_lock();
+    if (db_execute("BEGIN;") != 0) {
+        db_unlock();
+        return -1;
+    }
+    return 0;
+#endif
+}
+
+int db_commit(void)
+{
+#if !CONFIG_APP_USE_SQLITE3
+    return -1;
+#else
+    int rc = db_execute("COMMIT;");
+    if (rc != 0) {
+        db_execute("ROLLBACK;");
+    }
+    db_unlock();
+    return rc;
+#endif
+}
+
+void db_rollback(void)
+{
+#if CONFIG_APP_USE_SQLITE3
+    db_execute("ROLLBACK;");
+    db_unlock();
+#endif
+}
+
+#if CONFIG_APP_USE_SQLITE3
+struct db_stmt {
+    sqlite3_stmt *stmt;
+    bool writes;            // Not read-only: may change table generations
+};
+#endif
+
+db_stmt_t *db_prepare(const char *sql)
+{
+#if !CONFIG_APP_USE_SQLITE3
+    (void)sql;
+    return NULL;
+#else
+    if (!s_db || !sql) {
+        return NULL;
+    }
+    db_stmt_t *st = calloc(1, sizeof(*st));
+    if (!st) {
+        return NULL;
+    }
+    if (sqlite3_prepare_v2(s_db, sql, -1, &st->stmt, NULL) != SQLITE_OK) {
+        log_error("db", "Prepare failed: %s", sqlite3_errmsg(s_db));
+        free(st);
+        return NULL;
+    }
+    st->writes = !sqlite3_stmt_readonly(st->stmt);
+    return st;
+#endif
+}
+
+int db_bind_text(db_stmt_t *stmt, int index, const char *value)
+{
+#if CONFIG_APP_USE_SQLITE3
+    int rc = value ? sqlite3_bind_text(stmt->stmt, index, value, -1, SQLITE_TRANSIENT)
+                   : sqlite3_bind_null(stmt->stmt, index);
+    return rc == SQLITE_OK ? 0 : -1;
+#else
+    (void)stmt;
+    (void)index;
+    (void)value;
+    return -1;
+#endif
+}
+
+int db_bind_int(db_stmt_t *stmt, int index, int64_t value)
+{
+#if CONFIG_APP_USE_SQLITE3
+    return sqlite3_bind_int64(stmt->stmt, index, value) == SQLITE_OK ? 0 : -1;
+#else
+    (void)stmt;
+    (void)index;
+    (void)value;
+    return -1;
+#endif
+}
+
+int db_bind_double(db_stmt_t *stmt, int index, double value)
+{
+#if CONFIG_APP_USE_SQLITE3
+    return sqlite3_bind_double(stmt->stmt, index, value) == SQLITE_OK ? 0 : -1;
+#else
+    (void)stmt;
+    (void)index;
+    (void)value;
+    return -1;
+#endif
+}
+
+int db_step(db_stmt_t *stmt)
+{
+#if CONFIG_APP_USE_SQLITE3
+    db_lock();
+    int changes_before = stmt->writes ? sqlite3_total_changes(s_db) : 0;
+    uint32_t hooked_before = s_db_generation;
+    int rc = sqlite3_step(stmt->stmt);
+    if (stmt->writes) {
+        note_unseen_changes(changes_before, hooked_before);
+    }
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+        log_error("db", "Step failed: %s", sqlite3_errmsg(s_db));
+    }
+    if (rc != SQLITE_ROW) {
+        // Rewind so the statement can be run again with new bindings
+        sqlite3_reset(stmt->stmt);
+    }
+    db_unlock();
+    return rc == SQLITE_ROW ? 1 : rc == SQLITE_DONE ? 0 : -1;
+#else
+    (void)stmt;
+    return -1;
+#endif
+}
+
+int db_bind_uuid(db_stmt_t *stmt, int index, const uint8_t *uuid)
+{
+#if CONFIG_APP_USE_SQLITE3
+    int rc = uuid ? sqlite3_bind_blob(stmt->stmt, index, uuid, UUID_BIN_LEN, SQLITE_TRANSIENT)
+                  : sqlite3_bind_null(stmt->stmt, index);
+    return rc == SQLITE_OK ? 0 : -1;
+#else
+    (void)stmt;
+    (void)index;
+    (void)uuid;
+    return -1;
+#endif
+}
+
+const char *db_column_text(db_stmt_t *stmt, int col)
+{
+#if CONFIG_APP_USE_SQLITE3
+    const unsigned char *text = sqlite3_column_text(stmt->stmt, col);
+    return text ? (const char *)text : "";
+#else
+    (void)stmt;
+    (void)col;
+    return "";
+#endif
+}
+
+int64_t db_column_int(db_stmt_t *stmt, int col)
+{
+#if CONFIG_APP_USE_SQLITE3
+    return sqlite3_column_int64(stmt->stmt, col);
+#else
+    (void)stmt;
+    (void)col;
+    return 0;
+#endif
+}
+
+const char *db_column_uuid(db_stmt_t *stmt, int col, char *out)
+{
+    out[0] = '\0';
+#if CONFIG_APP_USE_SQLITE3
+    const void *blob = sqlite3_column_blob(stmt->stmt, col);
+    if (blob && sqlite3_column_bytes(stmt->stmt, col) == UUID_BIN_LEN) {
+        uuid_format(blob, out);
+    }
+#else
+    (void)stmt;
+    (void)col;
+#endif
+    return out;
+}
+
+bool db_column_is_null(db_stmt_t *stmt, int col)
+{
+#if CONFIG_APP_USE_SQLITE3
+    return sqlite3_column_type(stmt->stmt, col) == SQLITE_NULL;
+#else
+    (void)stmt;
+    (void)col;
+    return true;
+#endif
+}
+
+void db_finalize(db_stmt_t *stmt)
+{
+    if (stmt) {
+#if CONFIG_APP_USE_SQLITE3
+        sqlite3_finalize(stmt->stmt);
+#endif
+        free(stmt);
+    }
+}
+
+const char *db_errmsg(void)
+{
+#if CONFIG_APP_USE_SQLITE3
+    return s_db ? sqlite3_errmsg(s_db) : "Database not open";
+#else
+    return "SQLite disabled";
+#endif
+}
+
+uint32_t db_table_generation(const char *table)
+{
+    for (int i = 0; table && i < s_table_gen_count; i++) {
+        if (strcmp(s_table_gens[i].name, table) == 0) {
+            return s_table_gens[i].generation;
+        }
+    }
+    return 0;
+}
+
+uint32_t db_generation(void)
+{
+    return s_db_generation;
+}
+
 int db_backup(void)
 {
 #if !CONFIG_APP_USE_SQLITE3
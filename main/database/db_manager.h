@@ -8,8 +8,64 @@
  * for success and non‑zero for failure.
  */
 
+#include <stdbool.h>
+#include <stdint.h>
+
 int db_init(void);
 int db_execute(const char *sql);
 int db_backup(void);
 
+/*
+ * Transactions.  Every task shares one connection, so a statement
+ * another task ran while a transaction is open would become part of
+ * it.  db_begin() takes the connection lock and keeps it until
+ * db_commit() or db_rollback(); db_execute() and db_step() take it for
+ * their own duration, so other tasks wait for the transaction to end
+ * instead of joining it.  Do no network or other slow I/O in between.
+ * db_commit() rolls back and returns -1 when the COMMIT fails.
+ */
+int db_begin(void);
+int db_commit(void);
+void db_rollback(void);
+
+/*
+ * Write generations.  db_table_generation() changes whenever a row of
+ * the table is inserted, updated or deleted; db_generation() whenever
+ * anything in the database changes.  Both restart at 0 on boot, so
+ * callers building cache validators must mix in a boot identifier.
+ */
+uint32_t db_table_generation(const char *table);
+uint32_t db_generation(void);
+
+/*
+ * Prepared statements and cursors.  Parameters are bound, never
+ * pasted into the SQL, and rows are read one at a time with
+ * db_step(), so a result set of any size is walked in constant
+ * memory.  Column text stays valid until the next db_step() or
+ * db_finalize().  Indexes: bind parameters from 1, columns from 0.
+ *
+ * Row ids and references to them are 16-byte BLOBs.  SQL can convert
+ * with uuid_text(key), uuid_key(text) and make new ones with
+ * uuid_new().
+ */
+typedef struct db_stmt db_stmt_t;
+
+db_stmt_t *db_prepare(const char *sql);
+int db_bind_text(db_stmt_t *stmt, int index, const char *value);   // NULL binds NULL
+int db_bind_int(db_stmt_t *stmt, int index, int64_t value);
+int db_bind_double(db_stmt_t *stmt, int index, double value);
+/* Keys are 16-byte UUIDs (utils/uuid.h); NULL binds NULL. */
+int db_bind_uuid(db_stmt_t *stmt, int index, const uint8_t *uuid);
+/* 1 when a row is ready, 0 when done, -1 on error. */
+int db_step(db_stmt_t *stmt);
+/* NULL columns read as "" and 0. */
+const char *db_column_text(db_stmt_t *stmt, int col);
+int64_t db_column_int(db_stmt_t *stmt, int col);
+bool db_column_is_null(db_stmt_t *stmt, int col);
+/* Text form of a key column into out (UUID_STR_LEN bytes); "" if NULL. */
+const char *db_column_uuid(db_stmt_t *stmt, int col, char *out);
+void db_finalize(db_stmt_t *stmt);
+/* Message of the last failed statement, e.g. a constraint violation. */
+const char *db_errmsg(void);
+
 #endif /* DB_MANAGER_H */
\ No newline at end of file
@@ -1,22 +1,91 @@
 #include <stdio.h>
+#include <string.h>
 #include "db_regulations.h"
 
 /*
  * Regulation database accessors.
  *
- * These functions perform simplified operations on the
- * species_regulations table.  In a complete system the regulation
- * logic would be more complex and would enforce legal
- * requirements.  Here we simply run a SELECT or return dummy
- * results.
+ * The curated CITES/EU/France list is compiled into its own flash
+ * partition and looked up in place (species/species_index.c), so a
+ * status check does not touch SQLite for the species it knows.  The
+ * species_regulations table only holds what was added or corrected on
+ * the device, and wins over the list for the same name.
+ *
+ * Compliance checks and alerts are still placeholders.
  */
 
 #include "database/db_manager.h"
+#include "species/species_index.h"
 
-int db_species_get_regulation(void)
+static const char *keep(char **pos, char *end, const char *s)
 {
-    const char *sql = "SELECT scientific_name, cites_appendix, eu_annex FROM species_regulations LIMIT 1;";
-    return db_execute(sql);
+    size_t n = strlen(s);
+    if (*pos >= end) {
+        return "";
+    }
+    if (n >= (size_t)(end - *pos)) {
+        n = end - *pos - 1;
+    }
+    char *start = *pos;
+    memcpy(start, s, n);
+    start[n] = '\0';
+    *pos += n + 1;
+    return start;
+}
+
+static int get_local(const char *scientific_name, species_regulation_t *out, char *buf,
+                     size_t buf_size)
+{
+    db_stmt_t *st = db_prepare(
+        "SELECT scientific_name, common_names, family, category, cites_appendix, eu_annex, "
+        "france_column, domestic, dangerous, invasive, last_updated "
+        "FROM species_regulations WHERE scientific_name = ?1 COLLATE NOCASE;");
+    int rc = st && db_bind_text(st, 1, scientific_name) == 0 ? db_step(st) : -1;
+    if (rc == 1) {
+        char *pos = buf, *end = buf + buf_size;
+        const char **text[] = {
+            &out->scientific_name, &out->common_names, &out->family, &out->category,
+            &out->cites_appendix, &out->eu_annex, &out->france_column,
+        };
+        for (int i = 0; i < 7; i++) {
+            *text[i] = keep(&pos, end, db_column_text(st, i));
+        }
+        out->domestic = db_column_int(st, 7) != 0;
+        out->dangerous = db_column_int(st, 8) != 0;
+        out->invasive = db_column_int(st, 9) != 0;
+        out->last_updated = db_column_int(st, 10);
+        out->local = true;
+    }
+    db_finalize(st);
+    return rc;
+}
+
+int db_species_get_regulation(const char *scientific_name, species_regulation_t *out,
+                              char *buf, size_t buf_size)
+{
+    if (!scientific_name || !out) {
+        return -1;
+    }
+    if (get_local(scientific_name, out, buf, buf_size) == 1) {
+        return 0;
+    }
+    const species_record_t *r = species_index_find(scientific_name);
+    if (!r) {
+        return -1;
+    }
+    out->scientific_name = species_index_str(r->scientific_name);
+    out->common_names = species_index_str(r->common_names);
+    out->family = species_index_str(r->family);
+    out->category = species_index_str(r->category);
+    out->cites_appendix = species_index_str(r->cites_appendix);
+    out->eu_annex = species_index_str(r->eu_annex);
+    out->france_column = species_index_str(r->france_column);
+    out->domestic = r->flags & SPECIES_DOMESTIC;
+    out->dangerous = r->flags & SPECIES_DANGEROUS;
+    out->invasive = r->flags & SPECIES_INVASIVE;
+    out->last_updated = r->last_updated;
+    out->local = false;
+    return 0;
 }
 
 int db_compliance_check(void)
@@ -30,4 +99,4 @@ int db_alerts_get_active(void)
 {
     // Alerts retrieval not implemented; return success
     return 0;
-}
\ No newline at end of file
+}
@@ -1,8 +1,32 @@
 #ifndef DB_REGULATIONS_H
 #define DB_REGULATIONS_H
 
-int db_species_get_regulation(void);
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    const char *scientific_name;
+    const char *common_names;
+    const char *family;
+    const char *category;
+    const char *cites_appendix;
+    const char *eu_annex;
+    const char *france_column;
+    bool domestic;
+    bool dangerous;
+    bool invasive;
+    int64_t last_updated;
+    bool local;                 // From species_regulations, not the flash list
+} species_regulation_t;
+
+/* Regulation status of a species: the device's own species_regulations
+ * row if there is one, else the flash list (species/species_index.h).
+ * Strings of a local row are copied into buf, flash ones point into the
+ * mapped list.  Returns -1 when the species is in neither. */
+int db_species_get_regulation(const char *scientific_name, species_regulation_t *out,
+                              char *buf, size_t buf_size);
 int db_compliance_check(void);
 int db_alerts_get_active(void);
 
-#endif /* DB_REGULATIONS_H */
\ No newline at end of file
+#endif /* DB_REGULATIONS_H */
@@ -0,0 +1,20 @@
+#include "db_schema.h"
+
+/*
+ * Column descriptors, expanded from the table definitions in
+ * db_schema.h.  The CREATE TABLE statements come from the same lists
+ * in db_manager.c.
+ */
+
+#define DB_COLUMN(name, type, constraints, flags) { #name, DB_TYPE_##type, flags },
+#define COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static const db_column_t ANIMAL_COLUMNS[] = { DB_ANIMALS_COLUMNS(DB_COLUMN) };
+static const db_column_t CYCLE_COLUMNS[] = { DB_CYCLES_COLUMNS(DB_COLUMN) };
+static const db_column_t REGULATION_COLUMNS[] = { DB_REGULATIONS_COLUMNS(DB_COLUMN) };
+
+const db_table_t DB_TABLE_ANIMALS = { DB_ANIMALS, ANIMAL_COLUMNS, COUNT(ANIMAL_COLUMNS) };
+const db_table_t DB_TABLE_CYCLES = { DB_CYCLES, CYCLE_COLUMNS, COUNT(CYCLE_COLUMNS) };
+const db_table_t DB_TABLE_REGULATIONS = {
+    DB_REGULATIONS, REGULATION_COLUMNS, COUNT(REGULATION_COLUMNS),
+};
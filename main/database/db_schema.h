@@ -0,0 +1,162 @@
+#ifndef DB_SCHEMA_H
+#define DB_SCHEMA_H
+
+#include <stdint.h>
+
+/*
+ * Table definitions.
+ *
+ * Each table's columns are listed once, as an X-macro
+ *
+ *     X(name, type, constraints, flags)
+ *
+ * from which db_manager.c builds the CREATE TABLE at compile time,
+ * db_animals.c and db_breeding.c their INSERT and UPDATE statements,
+ * records and binders, and db_schema.c the column descriptors that
+ * listings, delta sync and bulk import/export work from.  Adding a column here adds it
+ * everywhere; a column some layer must not see is flagged instead of
+ * left out of that layer's own list.
+ */
+
+typedef enum {
+    DB_TYPE_TEXT,
+    DB_TYPE_INT,
+    DB_TYPE_REAL,
+    DB_TYPE_DATE,               // Unix seconds
+    DB_TYPE_UUID,               // 16-byte key, or reference to one
+} db_type_t;
+
+#define DB_COL_REQUIRED  0x01   // Import: must be given
+#define DB_COL_NEW_ID    0x02   // Import: empty is a fresh key
+#define DB_COL_NOW       0x04   // Import: empty is the current time
+#define DB_COL_UNLISTED  0x08   // Not in listings; sync has it (free-form JSON)
+
+#define DB_SQL_TYPE_TEXT "TEXT"
+#define DB_SQL_TYPE_INT  "INTEGER"
+#define DB_SQL_TYPE_REAL "REAL"
+#define DB_SQL_TYPE_DATE "INTEGER"
+#define DB_SQL_TYPE_UUID "BLOB"
+
+#define DB_UUID_CHECK(c) "CHECK (typeof(" #c ") = 'blob' AND length(" #c ") = 16)"
+
+#define DB_ANIMALS      "animals"
+#define DB_ANIMALS_KEY  "id"
+#define DB_ANIMALS_COLUMNS(X)                                               \
+    X(id,                UUID, "NOT NULL " DB_UUID_CHECK(id), DB_COL_NEW_ID) \
+    X(species_name,      TEXT, "NOT NULL", DB_COL_REQUIRED)                 \
+    X(common_name,       TEXT, "", 0)                                       \
+    X(sex,               TEXT, "", 0)                                       \
+    X(date_birth,        DATE, "", 0)                                       \
+    X(date_acquisition,  DATE, "NOT NULL", DB_COL_REQUIRED)                 \
+    X(status,            TEXT, "", 0)                                       \
+    X(provenance_type,   TEXT, "", 0)                                       \
+    X(provenance_vendor, TEXT, "", 0)                                       \
+    X(metadata_json,     TEXT, "", DB_COL_UNLISTED)                         \
+    X(created_at,        DATE, "NOT NULL", DB_COL_NOW)                      \
+    X(updated_at,        DATE, "NOT NULL", DB_COL_NOW)                      \
+    X(date_exit,         DATE, "", 0)
+
+#define DB_CYCLES       "breeding_cycles"
+#define DB_CYCLES_KEY   "id"
+#define DB_CYCLES_COLUMNS(X)                                                \
+    X(id,                  UUID, "NOT NULL " DB_UUID_CHECK(id), DB_COL_NEW_ID) \
+    X(male_id,             UUID, "REFERENCES animals(id)", 0)               \
+    X(female_id,           UUID, "REFERENCES animals(id)", 0)               \
+    X(season,              INT,  "", 0)                                     \
+    X(start_date,          DATE, "", 0)                                     \
+    X(end_date,            DATE, "", 0)                                     \
+    X(status,              TEXT, "", 0)                                     \
+    X(clutch_date,         DATE, "", 0)                                     \
+    X(clutch_eggs_total,   INT,  "", 0)                                     \
+    X(clutch_eggs_viable,  INT,  "", 0)                                     \
+    X(incubation_temp_avg, REAL, "", 0)                                     \
+    X(notes,               TEXT, "", 0)                                     \
+    X(created_at,          DATE, "NOT NULL", DB_COL_NOW)
+
+// Photos and documents live in the blob store (storage/blob_store.h)
+#define DB_PHOTOS       "animal_photos"
+#define DB_PHOTOS_KEY   "animal_id, blob_id"
+#define DB_PHOTOS_COLUMNS(X)                                                \
+    X(animal_id,    UUID, "NOT NULL REFERENCES animals(id) ON DELETE CASCADE", 0) \
+    X(blob_id,      TEXT, "NOT NULL", 0)                                    \
+    X(content_type, TEXT, "", 0)                                            \
+    X(size,         INT,  "NOT NULL", 0)                                    \
+    X(created_at,   DATE, "NOT NULL", 0)
+
+#define DB_REGULATIONS      "species_regulations"
+#define DB_REGULATIONS_KEY  "scientific_name"
+#define DB_REGULATIONS_COLUMNS(X)                                           \
+    X(scientific_name, TEXT, "NOT NULL", DB_COL_REQUIRED)                   \
+    X(common_names,    TEXT, "", 0)                                         \
+    X(family,          TEXT, "", 0)                                         \
+    X(domestic,        INT,  "NOT NULL DEFAULT 0", 0)                       \
+    X(category,        TEXT, "", 0)                                         \
+    X(cites_appendix,  TEXT, "", 0)                                         \
+    X(eu_annex,        TEXT, "", 0)                                         \
+    X(france_column,   TEXT, "", 0)                                         \
+    X(dangerous,       INT,  "DEFAULT 0", 0)                                \
+    X(invasive,        INT,  "DEFAULT 0", 0)                                \
+    X(last_updated,    DATE, "", 0)
+
+/* "CREATE TABLE IF NOT EXISTS t (a TEXT NOT NULL, ..., PRIMARY KEY (k));"
+ * as one string literal; the key goes last so no column ends the list. */
+#define DB_DDL_COLUMN(name, type, constraints, flags) \
+    #name " " DB_SQL_TYPE_##type " " constraints ", "
+#define DB_TABLE_DDL(t, COLUMNS, key) \
+    "CREATE TABLE IF NOT EXISTS " t " (" COLUMNS(DB_DDL_COLUMN) "PRIMARY KEY (" key "));"
+
+typedef struct {
+    const char *name;
+    db_type_t type;
+    uint8_t flags;
+} db_column_t;
+
+/*
+ * Row statements and records from the same lists.  DB_SQL_LIST() gives
+ * every column in X order, "a, b", "?, ?" or "a = ?, b = ?" (each item
+ * is emitted with a leading ", " that it skips), so parameter N of an
+ * INSERT or an UPDATE's SET is column N - 1 and the key, which comes
+ * first, is ?1.  DB_ROW() declares a record of the same columns and
+ * DB_ROW_BINDER() a function binding one in that order: NULL strings
+ * and UUIDs and a DATE of 0 bind NULL, INT and REAL always bind.
+ */
+#define DB_SQL_NAME(name, type, constraints, flags)   ", " #name
+#define DB_SQL_PARAM(name, type, constraints, flags)  ", ?"
+#define DB_SQL_SET(name, type, constraints, flags)    ", " #name " = ?"
+#define DB_SQL_LIST(COLUMNS, ITEM) (COLUMNS(ITEM) + 2)
+
+#define DB_C_TYPE_TEXT const char *
+#define DB_C_TYPE_INT  int64_t
+#define DB_C_TYPE_REAL double
+#define DB_C_TYPE_DATE int64_t
+#define DB_C_TYPE_UUID const uint8_t *
+
+#define DB_ROW_FIELD(name, type, constraints, flags) DB_C_TYPE_##type name;
+#define DB_ROW(COLUMNS) struct { COLUMNS(DB_ROW_FIELD) }
+
+#define DB_BIND_TEXT(stmt, i, v) db_bind_text(stmt, i, v)
+#define DB_BIND_INT(stmt, i, v)  db_bind_int(stmt, i, v)
+#define DB_BIND_REAL(stmt, i, v) db_bind_double(stmt, i, v)
+#define DB_BIND_DATE(stmt, i, v) ((v) ? db_bind_int(stmt, i, v) : db_bind_text(stmt, i, NULL))
+#define DB_BIND_UUID(stmt, i, v) db_bind_uuid(stmt, i, v)
+#define DB_BIND_FIELD(name, type, constraints, flags) \
+    && DB_BIND_##type(stmt, ++i, row->name) == 0
+#define DB_ROW_BINDER(fn, row_t, COLUMNS)                                   \
+    static int fn(db_stmt_t *stmt, const row_t *row)                        \
+    {                                                                       \
+        int i = 0;                                                          \
+        return 1 COLUMNS(DB_BIND_FIELD) ? 0 : -1;                           \
+    }
+
+/* Tables with a single-column key, which comes first. */
+typedef struct {
+    const char *name;
+    const db_column_t *columns;
+    int count;
+} db_table_t;
+
+extern const db_table_t DB_TABLE_ANIMALS;
+extern const db_table_t DB_TABLE_CYCLES;
+extern const db_table_t DB_TABLE_REGULATIONS;
+
+#endif /* DB_SCHEMA_H */
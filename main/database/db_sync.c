@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "db_sync.h"
+
+/*
+ * Change log reader.
+ *
+ * The log itself is kept by triggers (see db_manager.c): each synced
+ * row has exactly one entry, its latest upsert or its tombstone, moved
+ * to a new seq on every write.  A sync therefore reads only entries
+ * above the client's seq, each row at most once however often it was
+ * edited, and joins the upserts to the live tables for their current
+ * content.
+ *
+ * The high-water mark is read first and bounds every query, so writes
+ * landing during the sync are left for the next one rather than
+ * half-reported.  It comes from sqlite_sequence, not max(seq), so it
+ * never goes backwards when the newest entry is replaced or purged.
+ * The queries walk the seq range; the unary + keeps SQLite off the
+ * (tbl, row_key) index, which would visit every row of the table.
+ */
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "db_list.h"
+#include "db_manager.h"
+#include "db_schema.h"
+#include "utils/logger.h"
+#include "utils/uuid.h"
+
+#define SYNC_SQL_MAX          512
+#define SYNC_COMPACT_EVERY_US (24LL * 3600 * 1000000)
+
+typedef struct {
+    const db_list_table_t *list;
+    const char *table;
+    const char *key;
+    bool uuid_key;
+} sync_table_t;
+
+// Referenced tables first, so a client can apply upserts in order
+static const sync_table_t SYNC_TABLES[] = {
+    { &DB_LIST_REGULATIONS, DB_REGULATIONS, DB_REGULATIONS_KEY, false },
+    { &DB_LIST_ANIMALS,     DB_ANIMALS,     DB_ANIMALS_KEY,     true },
+    { &DB_LIST_CYCLES,      DB_CYCLES,      DB_CYCLES_KEY,      true },
+};
+
+static int64_t s_compacted_at = -1;
+
+static int64_t query_int(const char *sql, int64_t fallback)
+{
+    db_stmt_t *stmt = db_prepare(sql);
+    int64_t value = fallback;
+    if (stmt && db_step(stmt) == 1) {
+        value = db_column_int(stmt, 0);
+    }
+    db_finalize(stmt);
+    return value;
+}
+
+int db_sync_compact(void)
+{
+    char sql[SYNC_SQL_MAX];
+    snprintf(sql, sizeof(sql),
+             "INSERT OR REPLACE INTO sync_state (name, value) "
+             "SELECT 'tombstone_floor', m FROM (SELECT max(seq) AS m FROM change_log "
+             "WHERE op = 'D' AND at < strftime('%%s', 'now') - %d) "
+             "WHERE m > coalesce((SELECT value FROM sync_state WHERE name = 'tombstone_floor'), 0);"
+             "DELETE FROM change_log WHERE op = 'D' AND at < strftime('%%s', 'now') - %d;",
+             CONFIG_APP_SYNC_TOMBSTONE_DAYS * 86400, CONFIG_APP_SYNC_TOMBSTONE_DAYS * 86400);
+    if (db_begin() != 0) {
+        return -1;
+    }
+    if (db_execute(sql) != 0) {
+        log_error("sync", "Change log compaction failed: %s", db_errmsg());
+        db_rollback();
+        return -1;
+    }
+    return db_commit();
+}
+
+static int write_upserts(doc_out_t *out, const sync_table_t *t, int64_t since, int64_t high)
+{
+    char sql[SYNC_SQL_MAX];
+    int len = snprintf(sql, sizeof(sql), "SELECT ");
+    if (db_list_columns(t->list, sql + len, sizeof(sql) - len) != 0) {
+        return -1;
+    }
+    len = (int)strlen(sql);
+    snprintf(sql + len, sizeof(sql) - len,
+             " FROM change_log c JOIN %s r ON r.%s = c.row_key "
+             "WHERE c.seq > ?1 AND c.seq <= ?2 AND +c.tbl = '%s' AND c.op = 'U' ORDER BY c.seq;",
+             t->table, t->key, t->table);
+    db_stmt_t *stmt = db_prepare(sql);
+    if (!stmt) {
+        return -1;
+    }
+    db_bind_int(stmt, 1, since);
+    db_bind_int(stmt, 2, high);
+    int rc;
+    int rows = 0;
+    while ((rc = db_step(stmt)) == 1) {
+        if (rows++) {
+            doc_out_puts(out, ",");
+        }
+        db_list_write_row(out, t->list, stmt, 0);
+    }
+    db_finalize(stmt);
+    return rc;
+}
+
+static int write_deletes(doc_out_t *out, const sync_table_t *t, int64_t since, int64_t high)
+{
+    db_stmt_t *stmt = db_prepare("SELECT row_key FROM change_log "
+                                 "WHERE seq > ?1 AND seq <= ?2 AND +tbl = ?3 AND op = 'D' ORDER BY seq;");
+    if (!stmt) {
+        return -1;
+    }
+    db_bind_int(stmt, 1, since);
+    db_bind_int(stmt, 2, high);
+    db_bind_text(stmt, 3, t->table);
+    char uuid[UUID_STR_LEN];
+    int rc;
+    int rows = 0;
+    while ((rc = db_step(stmt)) == 1) {
+        if (rows++) {
+            doc_out_puts(out, ",");
+        }
+        doc_out_json_string(out, t->uuid_key ? db_column_uuid(stmt, 0, uuid) : db_column_text(stmt, 0));
+    }
+    db_finalize(stmt);
+    return rc;
+}
+
+static void compact_if_due(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (s_compacted_at < 0 || now - s_compacted_at > SYNC_COMPACT_EVERY_US) {
+        s_compacted_at = now;
+        db_sync_compact();
+    }
+}
+
+static int64_t high_water(void)
+{
+    return query_int("SELECT seq FROM sqlite_sequence WHERE name = 'change_log';", 0);
+}
+
+bool db_sync_covers(int64_t since)
+{
+    compact_if_due();
+    int64_t floor = query_int("SELECT value FROM sync_state WHERE name = 'tombstone_floor';", 0);
+    return since == 0 || (since > 0 && since <= high_water() && since >= floor);
+}
+
+int db_sync_write(doc_out_t *out, int64_t since)
+{
+    if (!db_sync_covers(since)) {
+        return DB_SYNC_RESET;
+    }
+    int64_t high = high_water();
+
+    doc_out_printf(out, "{\"since\":%lld,\"seq\":%lld,\"tables\":{", (long long)since, (long long)high);
+    for (size_t i = 0; i < sizeof(SYNC_TABLES) / sizeof(SYNC_TABLES[0]); i++) {
+        const sync_table_t *t = &SYNC_TABLES[i];
+        doc_out_printf(out, "%s\"%s\":{\"upserts\":[", i ? "," : "", t->table);
+        if (write_upserts(out, t, since, high) < 0) {
+            return -1;
+        }
+        doc_out_puts(out, "],\"deletes\":[");
+        if (write_deletes(out, t, since, high) < 0) {
+            return -1;
+        }
+        doc_out_puts(out, "]}");
+    }
+    doc_out_puts(out, "}}");
+    return doc_out_flush(out);
+}
+
+static const sync_table_t *find_table(const char *name)
+{
+    for (size_t i = 0; i < sizeof(SYNC_TABLES) / sizeof(SYNC_TABLES[0]); i++) {
+        if (strcmp(SYNC_TABLES[i].table, name) == 0) {
+            return &SYNC_TABLES[i];
+        }
+    }
+    return NULL;
+}
+
+/* The live row behind an upsert entry: 1 when written, 0 when it has
+ * gone since (its tombstone follows further on), -1 on error. */
+static int write_upsert_line(doc_out_t *out, const sync_table_t *t, db_stmt_t **stmt,
+                             db_stmt_t *log, int64_t seq)
+{
+    if (!*stmt) {
+        char sql[SYNC_SQL_MAX];
+        int len = snprintf(sql, sizeof(sql), "SELECT ");
+        if (db_list_columns(t->list, sql + len, sizeof(sql) - len) != 0) {
+            return -1;
+        }
+        len = (int)strlen(sql);
+        snprintf(sql + len, sizeof(sql) - len, " FROM %s WHERE %s = ?1;", t->table, t->key);
+        if (!(*stmt = db_prepare(sql))) {
+            return -1;
+        }
+    }
+    if (t->uuid_key) {
+        char text[UUID_STR_LEN];
+        uint8_t key[UUID_BIN_LEN];
+        uuid_parse(db_column_uuid(log, 2, text), key);
+        db_bind_uuid(*stmt, 1, key);
+    } else {
+        db_bind_text(*stmt, 1, db_column_text(log, 2));
+    }
+    int rc = db_step(*stmt);
+    if (rc == 1) {
+        doc_out_printf(out, "{\"seq\":%lld,\"table\":\"%s\",\"op\":\"upsert\",\"row\":",
+                       (long long)seq, t->table);
+        db_list_write_row(out, t->list, *stmt, 0);
+        doc_out_puts(out, "}\n");
+        rc = db_step(*stmt) < 0 ? -1 : 1;   // Done: rewinds for the next key
+    }
+    return rc;
+}
+
+int db_sync_write_changes(doc_out_t *out, int64_t after, int max, int64_t *last)
+{
+    db_stmt_t *log = db_prepare("SELECT seq, tbl, row_key, op FROM change_log "
+                                "WHERE seq > ?1 ORDER BY seq LIMIT ?2;");
+    if (!log) {
+        return -1;
+    }
+    db_bind_int(log, 1, after);
+    db_bind_int(log, 2, max);
+    db_stmt_t *rows[sizeof(SYNC_TABLES) / sizeof(SYNC_TABLES[0])] = { 0 };
+    char uuid[UUID_STR_LEN];
+    int written = 0;
+    int rc;
+    *last = after;
+    while ((rc = db_step(log)) == 1) {
+        int64_t seq = db_column_int(log, 0);
+        const sync_table_t *t = find_table(db_column_text(log, 1));
+        if (!t) {
+            *last = seq;
+            continue;
+        }
+        if (db_column_text(log, 3)[0] == 'D') {
+            doc_out_printf(out, "{\"seq\":%lld,\"table\":\"%s\",\"op\":\"delete\",\"key\":",
+                           (long long)seq, t->table);
+            doc_out_json_string(out, t->uuid_key ? db_column_uuid(log, 2, uuid) : db_column_text(log, 2));
+            doc_out_puts(out, "}\n");
+            written++;
+        } else {
+            int found = write_upsert_line(out, t, &rows[t - SYNC_TABLES], log, seq);
+            if (found < 0) {
+                rc = -1;
+                break;
+            }
+            written += found;
+        }
+        *last = seq;
+    }
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+        db_finalize(rows[i]);
+    }
+    db_finalize(log);
+    return rc < 0 ? -1 : written;
+}
@@ -0,0 +1,48 @@
+#ifndef DB_SYNC_H
+#define DB_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "documents/doc_output.h"
+
+/*
+ * Delta sync for offline clients.
+ *
+ * Triggers record every insert, update and delete on
+ * species_regulations, animals and breeding_cycles in a change log,
+ * under a sequence number that only grows.  A client keeps the "seq"
+ * of its last sync and asks for what happened after it: the current
+ * rows that changed, and the keys of those deleted.  since=0 is a full
+ * copy.
+ *
+ * Tombstones are purged after CONFIG_APP_SYNC_TOMBSTONE_DAYS.  A client
+ * that last synced before the newest purged one can no longer be told
+ * what was deleted, and must drop its copy and sync again from 0.
+ */
+
+#define DB_SYNC_RESET 1         // since is too old (or from another database)
+
+/*
+ * Writes {"since":S,"seq":M,"tables":{"<table>":{"upserts":[...],
+ * "deletes":[...]},...}} covering the changes in (since, M], and flushes
+ * out.  Returns DB_SYNC_RESET, having written nothing, when the client
+ * must start again from 0.
+ */
+int db_sync_write(doc_out_t *out, int64_t since);
+
+/* False when since is below the purged tombstones or past the end of
+ * the log: the changes after it can no longer be told. */
+bool db_sync_covers(int64_t since);
+
+/*
+ * Replication form: the next changes after seq, at most max, in seq
+ * order, one NDJSON line each: {"seq":N,"table":T,"op":"upsert",
+ * "row":{...}} or {"seq":N,"table":T,"op":"delete","key":K}.  *last is
+ * the seq to continue from.  Returns the lines written or -1.
+ */
+int db_sync_write_changes(doc_out_t *out, int64_t after, int max, int64_t *last);
+
+/* Purges expired tombstones.  db_sync_write() runs it at most daily. */
+int db_sync_compact(void);
+
+#endif /* DB_SYNC_H */
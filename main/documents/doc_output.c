@@ -0,0 +1,111 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "doc_output.h"
+
+/*
+ * Document output buffer.  Writes larger than the free space flush
+ * the buffer first and then go to the sink directly, so a PDF page
+ * stream is not copied twice.
+ */
+
+void doc_out_init(doc_out_t *o, doc_sink_fn sink, void *ctx)
+{
+    o->sink = sink;
+    o->ctx = ctx;
+    o->offset = 0;
+    o->len = 0;
+    o->failed = false;
+}
+
+int doc_out_flush(doc_out_t *o)
+{
+    if (!o->failed && o->len > 0 && o->sink(o->ctx, o->buf, o->len) != 0) {
+        o->failed = true;
+    }
+    o->len = 0;
+    return o->failed ? -1 : 0;
+}
+
+int doc_out_write(doc_out_t *o, const void *data, size_t len)
+{
+    if (o->failed) {
+        return -1;
+    }
+    o->offset += (uint32_t)len;
+    if (len <= DOC_OUT_BUF - o->len) {
+        memcpy(o->buf + o->len, data, len);
+        o->len += len;
+        return 0;
+    }
+    if (doc_out_flush(o) != 0) {
+        return -1;
+    }
+    if (len < DOC_OUT_BUF) {
+        memcpy(o->buf, data, len);
+        o->len = len;
+        return 0;
+    }
+    if (o->sink(o->ctx, data, len) != 0) {
+        o->failed = true;
+        return -1;
+    }
+    return 0;
+}
+
+int doc_out_puts(doc_out_t *o, const char *s)
+{
+    return doc_out_write(o, s, strlen(s));
+}
+
+int doc_out_printf(doc_out_t *o, const char *fmt, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n < 0 || n >= (int)sizeof(line)) {
+        o->failed = true;       // Callers format short, fixed pieces only
+        return -1;
+    }
+    return doc_out_write(o, line, (size_t)n);
+}
+
+int doc_out_csv_field(doc_out_t *o, const char *s, bool neutralise)
+{
+    bool quote = strpbrk(s, DOC_CSV_SEP "\"\r\n") != NULL;
+    bool formula = neutralise && (s[0] == '=' || s[0] == '+' || s[0] == '-' || s[0] == '@');
+    if (!quote && !formula) {
+        return doc_out_puts(o, s);
+    }
+    doc_out_puts(o, formula ? "\"'" : "\"");
+    for (const char *q; (q = strchr(s, '"')) != NULL; s = q + 1) {
+        doc_out_write(o, s, (size_t)(q - s + 1));
+        doc_out_puts(o, "\"");
+    }
+    doc_out_puts(o, s);
+    return doc_out_puts(o, "\"");
+}
+
+int doc_out_json_string(doc_out_t *o, const char *s)
+{
+    doc_out_puts(o, "\"");
+    for (const char *run = s; ; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c != '\0' && c != '"' && c != '\\' && c >= 0x20) {
+            continue;
+        }
+        doc_out_write(o, run, (size_t)(s - run));
+        if (c == '\0') {
+            break;
+        }
+        if (c == '"' || c == '\\') {
+            doc_out_printf(o, "\\%c", c);
+        } else {
+            doc_out_printf(o, "\\u%04x", c);
+        }
+        run = s + 1;
+    }
+    return doc_out_puts(o, "\"");
+}
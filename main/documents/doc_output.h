@@ -0,0 +1,52 @@
+#ifndef DOC_OUTPUT_H
+#define DOC_OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Byte sink for generated documents.
+ *
+ * Renderers write small pieces (a CSV field, a PDF object header);
+ * they are gathered in DOC_OUT_BUF bytes and handed to the sink in
+ * larger blocks, e.g. one HTTP chunk or one flash write each.  The
+ * running offset is what PDF cross-reference tables are built from.
+ * After the first sink error every call fails and nothing more is
+ * written.
+ */
+
+#define DOC_OUT_BUF 1024
+
+/* CSV dialect of documents and exports: UTF-8 behind a BOM, which
+ * spreadsheets need to read it as such, ';' separators as a French
+ * locale expects, and CRLF row ends. */
+#define DOC_CSV_BOM "\xEF\xBB\xBF"
+#define DOC_CSV_SEP ";"
+
+typedef int (*doc_sink_fn)(void *ctx, const void *data, size_t len);
+
+typedef struct {
+    doc_sink_fn sink;
+    void *ctx;
+    uint32_t offset;            // Bytes written so far, buffered included
+    size_t len;
+    bool failed;
+    char buf[DOC_OUT_BUF];
+} doc_out_t;
+
+void doc_out_init(doc_out_t *o, doc_sink_fn sink, void *ctx);
+int doc_out_write(doc_out_t *o, const void *data, size_t len);
+int doc_out_puts(doc_out_t *o, const char *s);
+int doc_out_printf(doc_out_t *o, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+/* One CSV field, quoted when needed.  With neutralise, a leading
+ * = + - @ gets a ' so a spreadsheet never evaluates user text as a
+ * formula; numeric columns must not ask for it. */
+int doc_out_csv_field(doc_out_t *o, const char *s, bool neutralise);
+/* A JSON string literal: quotes, backslashes and control characters
+ * escaped, UTF-8 passed through. */
+int doc_out_json_string(doc_out_t *o, const char *s);
+/* Passes buffered bytes on; returns -1 if any write failed. */
+int doc_out_flush(doc_out_t *o);
+
+#endif /* DOC_OUTPUT_H */
@@ -0,0 +1,499 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "documents.h"
+
+/*
+ * Registry and transfer certificate renderers.
+ *
+ * Both formats are driven by the same layout tables: a table template
+ * gives the PDF column titles and widths and the CSV header, so the
+ * two outputs cannot drift apart.  PDF tables repeat their header on
+ * every page and cut long values to the column; CSV is UTF-8 with a
+ * BOM and ';' separators, which is what French spreadsheet software
+ * opens without an import dialog.
+ *
+ * Dates are printed in local time, and the registry year is bounded
+ * in local time too, so a late-evening acquisition on 31 December
+ * lands in the right year.
+ */
+
+#include "pdf_writer.h"
+#include "database/db_manager.h"
+#include "utils/logger.h"
+
+#define DOC_MARGIN          28
+#define DOC_ROW_HEIGHT      12
+#define DOC_HEADER_HEIGHT   16
+#define DOC_FONT_SIZE       7
+#define DOC_CELL_PAD        2
+#define DOC_MAX_COLUMNS     10
+
+typedef struct {
+    const char *title;
+    int width;              // PDF points
+} doc_column_t;
+
+typedef struct {
+    const char *title;
+    const doc_column_t *columns;
+    int count;
+} doc_table_t;
+
+/* Landscape A4 leaves 786 points between the margins */
+static const doc_column_t REGISTRY_COLUMNS[] = {
+    { "N°", 28 },
+    { "Date d'entrée", 58 },
+    { "Espèce", 110 },
+    { "Nom commun", 90 },
+    { "Sexe", 30 },
+    { "Identification", 140 },
+    { "Naissance", 58 },
+    { "Provenance", 110 },
+    { "Date de sortie", 58 },
+    { "Motif de sortie", 104 },
+};
+
+static const doc_column_t CYCLE_COLUMNS[] = {
+    { "Date de ponte", 70 },
+    { "Espèce", 150 },
+    { "Mâle", 138 },
+    { "Femelle", 138 },
+    { "Œufs", 50 },
+    { "Viables", 50 },
+    { "Statut", 70 },
+    { "Observations", 120 },
+};
+
+static const doc_table_t REGISTRY_TABLE = {
+    "Animaux détenus", REGISTRY_COLUMNS, sizeof(REGISTRY_COLUMNS) / sizeof(REGISTRY_COLUMNS[0]),
+};
+static const doc_table_t CYCLE_TABLE = {
+    "Reproductions", CYCLE_COLUMNS, sizeof(CYCLE_COLUMNS) / sizeof(CYCLE_COLUMNS[0]),
+};
+
+static const char REGISTRY_SQL[] =
+    "SELECT uuid_text(id), species_name, common_name, sex, date_birth, date_acquisition, "
+    "provenance_type, provenance_vendor, status, date_exit FROM animals "
+    "WHERE date_acquisition < ?2 AND (date_exit IS NULL OR date_exit >= ?1) "
+    "ORDER BY date_acquisition, id;";
+
+static const char CYCLE_SQL[] =
+    "SELECT c.clutch_date, COALESCE(f.species_name, m.species_name), uuid_text(c.male_id), "
+    "uuid_text(c.female_id), c.clutch_eggs_total, c.clutch_eggs_viable, c.status, c.notes "
+    "FROM breeding_cycles c "
+    "LEFT JOIN animals f ON f.id = c.female_id LEFT JOIN animals m ON m.id = c.male_id "
+    "WHERE c.season = ?1 ORDER BY c.clutch_date, c.id;";
+
+static const char CESSION_SQL[] =
+    "SELECT species_name, common_name, sex, date_birth, date_acquisition, provenance_type, "
+    "provenance_vendor FROM animals WHERE id = uuid_key(?1);";
+
+typedef struct {
+    doc_format_t format;
+    doc_out_t *out;
+    pdf_doc_t *pdf;
+    char heading[96];
+    char subheading[96];
+    const doc_table_t *table;
+    int tables;             // Tables started so far
+    int width;              // PDF page size
+    int height;
+    int y;                  // Baseline of the next PDF line
+} table_writer_t;
+
+static void format_date(char *buf, size_t len, int64_t when)
+{
+    buf[0] = '\0';
+    time_t t = (time_t)when;
+    struct tm tm;
+    if (when > 0 && localtime_r(&t, &tm)) {
+        snprintf(buf, len, "%02d/%02d/%04d", tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
+    }
+}
+
+static int64_t year_start(int year)
+{
+    struct tm tm = { .tm_year = year - 1900, .tm_mday = 1, .tm_isdst = -1 };
+    return (int64_t)mktime(&tm);
+}
+
+static const char *provenance_label(const char *type)
+{
+    if (strcmp(type, "ACHAT") == 0) {
+        return "Achat";
+    }
+    if (strcmp(type, "REPRODUCTION") == 0) {
+        return "Né à l'élevage";
+    }
+    if (strcmp(type, "DON") == 0) {
+        return "Don";
+    }
+    if (strcmp(type, "SAUVETAGE") == 0) {
+        return "Sauvetage";
+    }
+    return type;
+}
+
+static const char *exit_label(const char *status)
+{
+    if (strcmp(status, "SOLD") == 0) {
+        return "Cession";
+    }
+    if (strcmp(status, "DECEASED") == 0) {
+        return "Décès";
+    }
+    if (strcmp(status, "TRANSFERRED") == 0) {
+        return "Transfert";
+    }
+    return NULL;
+}
+
+static const char *sex_label(const char *sex)
+{
+    return strcmp(sex, "M") == 0 ? "M" : strcmp(sex, "F") == 0 ? "F" : "?";
+}
+
+static void csv_row(doc_out_t *out, const char *const *cells, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            doc_out_puts(out, DOC_CSV_SEP);
+        }
+        doc_out_csv_field(out, cells[i], true);
+    }
+    doc_out_puts(out, "\r\n");
+}
+
+static int writer_begin(table_writer_t *tw, doc_out_t *out, doc_format_t format, const char *title,
+                        bool landscape)
+{
+    memset(tw, 0, sizeof(*tw));
+    tw->format = format;
+    tw->out = out;
+    if (format == DOC_FORMAT_CSV) {
+        return doc_out_puts(out, DOC_CSV_BOM);
+    }
+    tw->width = landscape ? PDF_A4_HEIGHT : PDF_A4_WIDTH;
+    tw->height = landscape ? PDF_A4_WIDTH : PDF_A4_HEIGHT;
+    tw->pdf = pdf_begin(out, tw->width, tw->height, title);
+    return tw->pdf ? 0 : -1;
+}
+
+static int writer_end(table_writer_t *tw, int rc)
+{
+    if (tw->pdf) {
+        if (rc != 0) {
+            pdf_abort(tw->pdf);
+            return -1;
+        }
+        return pdf_end(tw->pdf);
+    }
+    return rc != 0 || doc_out_flush(tw->out) != 0 ? -1 : 0;
+}
+
+static int page_start(table_writer_t *tw)
+{
+    if (pdf_page_begin(tw->pdf) != 0) {
+        return -1;
+    }
+    int top = tw->height - DOC_MARGIN;
+    pdf_text(tw->pdf, PDF_FONT_BOLD, 12, DOC_MARGIN, top - 12, 0, tw->heading);
+    pdf_text(tw->pdf, PDF_FONT_REGULAR, 8, DOC_MARGIN, top - 24, 0, tw->subheading);
+    char page[16];
+    snprintf(page, sizeof(page), "Page %d", pdf_page_count(tw->pdf));
+    pdf_text(tw->pdf, PDF_FONT_REGULAR, DOC_FONT_SIZE, tw->width - DOC_MARGIN - 30,
+             DOC_MARGIN / 2, 0, page);
+    tw->y = top - 44;
+    return 0;
+}
+
+static void table_header(table_writer_t *tw)
+{
+    const doc_table_t *t = tw->table;
+    int x = DOC_MARGIN;
+    int width = 0;
+    for (int i = 0; i < t->count; i++) {
+        width += t->columns[i].width;
+    }
+    pdf_band(tw->pdf, x, tw->y - 5, width, DOC_HEADER_HEIGHT);
+    for (int i = 0; i < t->count; i++) {
+        pdf_text(tw->pdf, PDF_FONT_BOLD, DOC_FONT_SIZE, x + DOC_CELL_PAD, tw->y,
+                 t->columns[i].width - 2 * DOC_CELL_PAD, t->columns[i].title);
+        x += t->columns[i].width;
+    }
+    tw->y -= DOC_HEADER_HEIGHT;
+}
+
+static int table_begin(table_writer_t *tw, const doc_table_t *table)
+{
+    tw->table = table;
+    if (tw->format == DOC_FORMAT_CSV) {
+        const char *titles[DOC_MAX_COLUMNS];
+        for (int i = 0; i < table->count; i++) {
+            titles[i] = table->columns[i].title;
+        }
+        if (tw->tables++ > 0) {
+            doc_out_puts(tw->out, "\r\n");      // Blank line between sections
+        }
+        csv_row(tw->out, &table->title, 1);
+        csv_row(tw->out, titles, table->count);
+        return tw->out->failed ? -1 : 0;
+    }
+    // Section title, header and one row must fit, otherwise new page
+    int needed = 14 + DOC_HEADER_HEIGHT + DOC_ROW_HEIGHT;
+    if (pdf_page_count(tw->pdf) == 0 || tw->y - needed < DOC_MARGIN) {
+        if (page_start(tw) != 0) {
+            return -1;
+        }
+    }
+    pdf_text(tw->pdf, PDF_FONT_BOLD, 9, DOC_MARGIN, tw->y, 0, table->title);
+    tw->y -= 14;
+    table_header(tw);
+    return 0;
+}
+
+static int table_row(table_writer_t *tw, const char *const *cells)
+{
+    const doc_table_t *t = tw->table;
+    if (tw->format == DOC_FORMAT_CSV) {
+        csv_row(tw->out, cells, t->count);
+        return tw->out->failed ? -1 : 0;
+    }
+    if (tw->y - DOC_ROW_HEIGHT < DOC_MARGIN) {
+        if (page_start(tw) != 0) {
+            return -1;
+        }
+        table_header(tw);
+    }
+    int x = DOC_MARGIN;
+    for (int i = 0; i < t->count; i++) {
+        pdf_text(tw->pdf, PDF_FONT_REGULAR, DOC_FONT_SIZE, x + DOC_CELL_PAD, tw->y,
+                 t->columns[i].width - 2 * DOC_CELL_PAD, cells[i]);
+        x += t->columns[i].width;
+    }
+    tw->y -= DOC_ROW_HEIGHT;
+    return tw->out->failed ? -1 : 0;
+}
+
+static int registry_animals(table_writer_t *tw, int64_t from, int64_t to)
+{
+    db_stmt_t *st = db_prepare(REGISTRY_SQL);
+    if (!st || db_bind_int(st, 1, from) != 0 || db_bind_int(st, 2, to) != 0 ||
+        table_begin(tw, &REGISTRY_TABLE) != 0) {
+        db_finalize(st);
+        return -1;
+    }
+    int rc;
+    unsigned number = 0;
+    while ((rc = db_step(st)) == 1) {
+        char num[12], entered[12], born[12], left[12], provenance[96];
+        snprintf(num, sizeof(num), "%u", ++number);
+        format_date(entered, sizeof(entered), db_column_int(st, 5));
+        format_date(born, sizeof(born), db_column_int(st, 4));
+        const char *vendor = db_column_text(st, 7);
+        snprintf(provenance, sizeof(provenance), "%s%s%s", provenance_label(db_column_text(st, 6)),
+                 vendor[0] ? " - " : "", vendor);
+        // An exit after the year closes is not part of this year's book
+        const char *motive = exit_label(db_column_text(st, 8));
+        int64_t exit_date = db_column_int(st, 9);
+        if (!motive || exit_date >= to) {
+            motive = "";
+            exit_date = 0;
+        }
+        format_date(left, sizeof(left), exit_date);
+        const char *cells[] = {
+            num, entered, db_column_text(st, 1), db_column_text(st, 2),
+            sex_label(db_column_text(st, 3)), db_column_text(st, 0), born, provenance, left, motive,
+        };
+        if (table_row(tw, cells) != 0) {
+            rc = -1;
+            break;
+        }
+    }
+    db_finalize(st);
+    return rc;
+}
+
+static int registry_cycles(table_writer_t *tw, int year)
+{
+    db_stmt_t *st = db_prepare(CYCLE_SQL);
+    if (!st || db_bind_int(st, 1, year) != 0 || table_begin(tw, &CYCLE_TABLE) != 0) {
+        db_finalize(st);
+        return -1;
+    }
+    int rc;
+    while ((rc = db_step(st)) == 1) {
+        char laid[12], eggs[12] = "", viable[12] = "";
+        format_date(laid, sizeof(laid), db_column_int(st, 0));
+        if (!db_column_is_null(st, 4)) {
+            snprintf(eggs, sizeof(eggs), "%d", (int)db_column_int(st, 4));
+        }
+        if (!db_column_is_null(st, 5)) {
+            snprintf(viable, sizeof(viable), "%d", (int)db_column_int(st, 5));
+        }
+        const char *cells[] = {
+            laid, db_column_text(st, 1), db_column_text(st, 2), db_column_text(st, 3),
+            eggs, viable, db_column_text(st, 6), db_column_text(st, 7),
+        };
+        if (table_row(tw, cells) != 0) {
+            rc = -1;
+            break;
+        }
+    }
+    db_finalize(st);
+    return rc;
+}
+
+int doc_render_registry(doc_out_t *out, doc_format_t format, int year)
+{
+    char title[64];
+    snprintf(title, sizeof(title), "Registre d'entrées et de sorties %d", year);
+    table_writer_t tw;
+    if (writer_begin(&tw, out, format, title, true) != 0) {
+        return -1;
+    }
+    char today[12];
+    format_date(today, sizeof(today), time(NULL));
+    snprintf(tw.heading, sizeof(tw.heading), "%s", title);
+    snprintf(tw.subheading, sizeof(tw.subheading),
+             "Animaux d'espèces non domestiques - arrêté du 8 octobre 2018 - édité le %s", today);
+
+    int rc = registry_animals(&tw, year_start(year), year_start(year + 1));
+    if (rc == 0) {
+        rc = registry_cycles(&tw, year);
+    }
+    if (rc != 0) {
+        log_error("documents", "Registry %d failed", year);
+    }
+    return writer_end(&tw, rc);
+}
+
+/* Certificate fields, in the order they are laid out */
+enum {
+    F_SELLER_NAME,
+    F_SELLER_ADDRESS,
+    F_SELLER_PERMIT,
+    F_BUYER_NAME,
+    F_BUYER_ADDRESS,
+    F_BUYER_PERMIT,
+    F_SPECIES,
+    F_COMMON_NAME,
+    F_SEX,
+    F_BIRTH,
+    F_IDENT,
+    F_PROVENANCE,
+    F_DATE,
+    F_PRICE,
+    F_COUNT
+};
+
+static const struct {
+    const char *section;    // Starts a new block when set
+    const char *label;
+} CESSION_LAYOUT[F_COUNT] = {
+    [F_SELLER_NAME] = { "Cédant", "Nom" },
+    [F_SELLER_ADDRESS] = { NULL, "Adresse" },
+    [F_SELLER_PERMIT] = { NULL, "Certificat de capacité / autorisation" },
+    [F_BUYER_NAME] = { "Acquéreur", "Nom" },
+    [F_BUYER_ADDRESS] = { NULL, "Adresse" },
+    [F_BUYER_PERMIT] = { NULL, "Certificat de capacité / autorisation" },
+    [F_SPECIES] = { "Animal", "Espèce" },
+    [F_COMMON_NAME] = { NULL, "Nom commun" },
+    [F_SEX] = { NULL, "Sexe" },
+    [F_BIRTH] = { NULL, "Date de naissance" },
+    [F_IDENT] = { NULL, "Identification" },
+    [F_PROVENANCE] = { NULL, "Provenance" },
+    [F_DATE] = { "Cession", "Date" },
+    [F_PRICE] = { NULL, "Prix" },
+};
+
+static const char *or_blank(const char *s)
+{
+    return s ? s : "";
+}
+
+static void cession_pdf(table_writer_t *tw, const char *const *values)
+{
+    pdf_doc_t *pdf = tw->pdf;
+    int y = tw->y;
+    int label_x = DOC_MARGIN + 10;
+    int value_x = DOC_MARGIN + 190;
+    int value_width = PDF_A4_WIDTH - DOC_MARGIN - value_x;
+    for (int f = 0; f < F_COUNT; f++) {
+        if (CESSION_LAYOUT[f].section) {
+            y -= 12;
+            pdf_text(pdf, PDF_FONT_BOLD, 11, DOC_MARGIN, y, 0, CESSION_LAYOUT[f].section);
+            pdf_line(pdf, DOC_MARGIN, y - 4, PDF_A4_WIDTH - DOC_MARGIN, y - 4);
+            y -= 20;
+        }
+        pdf_text(pdf, PDF_FONT_REGULAR, 9, label_x, y, value_x - label_x - 8, CESSION_LAYOUT[f].label);
+        pdf_text(pdf, PDF_FONT_REGULAR, 10, value_x, y, value_width, values[f]);
+        y -= 16;
+    }
+    y -= 24;
+    char done[48];
+    snprintf(done, sizeof(done), "Fait le %s, en deux exemplaires.", values[F_DATE]);
+    pdf_text(pdf, PDF_FONT_REGULAR, 10, DOC_MARGIN, y, 0, done);
+    y -= 28;
+    int half = PDF_A4_WIDTH / 2;
+    pdf_text(pdf, PDF_FONT_BOLD, 9, DOC_MARGIN, y, 0, "Signature du cédant");
+    pdf_text(pdf, PDF_FONT_BOLD, 9, half, y, 0, "Signature de l'acquéreur");
+    pdf_line(pdf, DOC_MARGIN, y - 60, half - 20, y - 60);
+    pdf_line(pdf, half, y - 60, PDF_A4_WIDTH - DOC_MARGIN, y - 60);
+}
+
+int doc_render_cession(doc_out_t *out, doc_format_t format, const doc_cession_t *c)
+{
+    db_stmt_t *st = db_prepare(CESSION_SQL);
+    if (!st || db_bind_text(st, 1, c->animal_id) != 0 || db_step(st) != 1) {
+        db_finalize(st);
+        return -1;      // Nothing written yet
+    }
+    char born[12], date[12], provenance[96];
+    format_date(born, sizeof(born), db_column_int(st, 3));
+    format_date(date, sizeof(date), c->date > 0 ? c->date : time(NULL));
+    const char *vendor = db_column_text(st, 6);
+    snprintf(provenance, sizeof(provenance), "%s%s%s", provenance_label(db_column_text(st, 5)),
+             vendor[0] ? " - " : "", vendor);
+    const char *price = or_blank(c->price);
+    const char *values[F_COUNT] = {
+        [F_SELLER_NAME] = or_blank(c->seller_name),
+        [F_SELLER_ADDRESS] = or_blank(c->seller_address),
+        [F_SELLER_PERMIT] = or_blank(c->seller_permit),
+        [F_BUYER_NAME] = or_blank(c->buyer_name),
+        [F_BUYER_ADDRESS] = or_blank(c->buyer_address),
+        [F_BUYER_PERMIT] = or_blank(c->buyer_permit),
+        [F_SPECIES] = db_column_text(st, 0),
+        [F_COMMON_NAME] = db_column_text(st, 1),
+        [F_SEX] = sex_label(db_column_text(st, 2)),
+        [F_BIRTH] = born,
+        [F_IDENT] = c->animal_id,
+        [F_PROVENANCE] = provenance,
+        [F_DATE] = date,
+        [F_PRICE] = price[0] ? price : "À titre gratuit",
+    };
+
+    table_writer_t tw;
+    int rc = writer_begin(&tw, out, format, "Attestation de cession", false);
+    if (rc == 0 && format == DOC_FORMAT_CSV) {
+        const char *header[] = { "Rubrique", "Champ", "Valeur" };
+        csv_row(out, header, 3);
+        const char *section = "";
+        for (int f = 0; f < F_COUNT; f++) {
+            section = CESSION_LAYOUT[f].section ? CESSION_LAYOUT[f].section : section;
+            const char *row[] = { section, CESSION_LAYOUT[f].label, values[f] };
+            csv_row(out, row, 3);
+        }
+    } else if (rc == 0) {
+        snprintf(tw.heading, sizeof(tw.heading), "Attestation de cession");
+        snprintf(tw.subheading, sizeof(tw.subheading), "Animal d'espèce non domestique");
+        rc = page_start(&tw);
+        if (rc == 0) {
+            cession_pdf(&tw, values);
+        }
+    }
+    db_finalize(st);
+    return writer_end(&tw, rc);
+}
@@ -0,0 +1,41 @@
+#ifndef DOCUMENTS_H
+#define DOCUMENTS_H
+
+#include <stdint.h>
+#include "doc_output.h"
+
+/*
+ * Regulatory documents.
+ *
+ * Each renderer walks a database cursor and writes rows to the output
+ * as they are read, so memory use does not grow with the collection.
+ * Layouts (column titles and widths, page furniture) are constant
+ * tables in flash.
+ */
+
+typedef enum {
+    DOC_FORMAT_PDF,
+    DOC_FORMAT_CSV
+} doc_format_t;
+
+/* Parties and terms of a transfer; NULL or "" fields print blank. */
+typedef struct {
+    const char *animal_id;
+    const char *seller_name;
+    const char *seller_address;
+    const char *seller_permit;      // Certificat de capacité / autorisation
+    const char *buyer_name;
+    const char *buyer_address;
+    const char *buyer_permit;
+    int64_t date;                   // Unix seconds, 0 for today
+    const char *price;              // Free text, "" for a gift
+} doc_cession_t;
+
+/* "Livre d'entrées et de sorties" for one calendar year: every animal
+ * held during the year, then the year's breeding cycles. */
+int doc_render_registry(doc_out_t *out, doc_format_t format, int year);
+
+/* "Attestation de cession" for one animal; -1 if it does not exist. */
+int doc_render_cession(doc_out_t *out, doc_format_t format, const doc_cession_t *cession);
+
+#endif /* DOCUMENTS_H */
@@ -0,0 +1,320 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pdf_writer.h"
+
+/*
+ * PDF writer implementation.
+ *
+ * Fixed objects: 1 catalog, 2 page tree (written last, when the page
+ * count is known), 3 and 4 the fonts, 5 the document info.  Page k
+ * uses objects 6 + 3k (page), 7 + 3k (content stream) and 8 + 3k (the
+ * stream length, written after the stream as an indirect object), so
+ * a page is never held in memory to measure it and the page tree can
+ * list its kids from the count alone.
+ */
+
+#define PDF_FIXED_OBJECTS  5
+#define PDF_OBJ_CATALOG    1
+#define PDF_OBJ_PAGES      2
+#define PDF_OBJ_INFO       5
+#define PDF_MAX_OBJECTS    (PDF_FIXED_OBJECTS + 1 + 3 * PDF_MAX_PAGES)
+#define PDF_TEXT_MAX       160
+#define PDF_ELLIPSIS       0x85
+
+struct pdf_doc {
+    doc_out_t *out;
+    int width;
+    int height;
+    int pages;
+    bool in_page;
+    bool failed;
+    uint32_t stream_start;
+    uint32_t offsets[PDF_MAX_OBJECTS];
+};
+
+/* Helvetica and Helvetica-Bold advance widths (1/1000 em), codes 32..126 */
+static const uint16_t HELVETICA_WIDTHS[2][95] = {
+    {
+        278, 278, 355, 556, 556, 889, 667, 191, 333, 333, 389, 584, 278, 333, 278, 278,
+        556, 556, 556, 556, 556, 556, 556, 556, 556, 556, 278, 278, 584, 584, 584, 556,
+        1015, 667, 667, 722, 722, 667, 611, 778, 722, 278, 500, 667, 556, 833, 722, 778,
+        667, 778, 722, 667, 611, 722, 667, 944, 667, 667, 611, 278, 278, 278, 469, 556,
+        333, 556, 556, 500, 556, 556, 278, 556, 556, 222, 222, 500, 222, 833, 556, 556,
+        556, 556, 333, 500, 278, 556, 500, 722, 500, 500, 500, 334, 260, 334, 584,
+    },
+    {
+        278, 333, 474, 556, 556, 889, 722, 238, 333, 333, 389, 584, 278, 333, 278, 278,
+        556, 556, 556, 556, 556, 556, 556, 556, 556, 556, 333, 333, 584, 584, 584, 611,
+        975, 722, 722, 722, 722, 667, 611, 778, 722, 278, 556, 722, 611, 833, 722, 778,
+        667, 778, 722, 667, 611, 722, 667, 944, 667, 667, 611, 333, 278, 333, 584, 556,
+        333, 556, 611, 556, 611, 556, 333, 611, 611, 278, 278, 556, 278, 889, 611, 611,
+        611, 611, 389, 556, 333, 611, 556, 778, 556, 556, 500, 389, 280, 389, 584,
+    },
+};
+
+/* Latin-1 letters 0xC0..0xFF measured as their base letter */
+static const char LATIN1_BASE[] = "AAAAAA?CEEEEIIIIDNOOOOO?OUUUUYPsaaaaaa?ceeeeiiiidnooooo?ouuuuypy";
+
+/* Unicode code points of WinAnsi 0x80..0x9F (0 = unassigned) */
+static const uint16_t WINANSI_HIGH[32] = {
+    0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+    0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178,
+};
+
+static int char_width(pdf_font_t font, uint8_t c)
+{
+    if (c >= 0xC0 && LATIN1_BASE[c - 0xC0] != '?') {
+        c = (uint8_t)LATIN1_BASE[c - 0xC0];
+    }
+    if (c >= 32 && c <= 126) {
+        return HELVETICA_WIDTHS[font == PDF_FONT_BOLD][c - 32];
+    }
+    switch (c) {
+    case PDF_ELLIPSIS:
+    case 0x97:      // Em dash
+    case 0xC6:
+    case 0x8C:
+        return 1000;
+    case 0x91:
+    case 0x92:
+        return 278;
+    case 0xB0:
+        return 400;
+    default:
+        return 556;
+    }
+}
+
+static uint8_t to_winansi(uint32_t cp)
+{
+    if (cp < 0x20) {
+        return ' ';
+    }
+    if (cp < 0x7F || (cp >= 0xA0 && cp <= 0xFF)) {
+        return (uint8_t)cp;
+    }
+    for (int i = 0; i < 32; i++) {
+        if (WINANSI_HIGH[i] == cp) {
+            return (uint8_t)(0x80 + i);
+        }
+    }
+    return '?';
+}
+
+/* UTF-8 to WinAnsi; returns the number of bytes stored. */
+static size_t encode(const char *utf8, uint8_t *out, size_t max)
+{
+    const uint8_t *p = (const uint8_t *)utf8;
+    size_t n = 0;
+    while (*p && n < max) {
+        uint32_t cp = *p++;
+        int extra = cp >= 0xF0 ? 3 : cp >= 0xE0 ? 2 : cp >= 0xC0 ? 1 : 0;
+        if (cp >= 0x80 && extra == 0) {
+            cp = '?';       // Stray continuation byte
+        } else if (extra > 0) {
+            cp &= 0x3F >> extra;
+            for (; extra > 0 && (*p & 0xC0) == 0x80; extra--) {
+                cp = (cp << 6) | (*p++ & 0x3F);
+            }
+            if (extra > 0) {
+                cp = '?';   // Truncated sequence
+            }
+        }
+        out[n++] = to_winansi(cp);
+    }
+    return n;
+}
+
+static int encoded_width(pdf_font_t font, const uint8_t *s, size_t n)
+{
+    int units = 0;
+    for (size_t i = 0; i < n; i++) {
+        units += char_width(font, s[i]);
+    }
+    return units;
+}
+
+int pdf_text_width(pdf_font_t font, int size, const char *utf8)
+{
+    uint8_t buf[PDF_TEXT_MAX];
+    size_t n = encode(utf8, buf, sizeof(buf));
+    return encoded_width(font, buf, n) * size / 1000;
+}
+
+static void put(pdf_doc_t *pdf, const char *s)
+{
+    if (doc_out_puts(pdf->out, s) != 0) {
+        pdf->failed = true;
+    }
+}
+
+/* PDF literal string: parentheses and backslashes escaped. */
+static void put_string(pdf_doc_t *pdf, const uint8_t *s, size_t n)
+{
+    char buf[2 * PDF_TEXT_MAX + 2];
+    size_t len = 0;
+    buf[len++] = '(';
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] == '(' || s[i] == ')' || s[i] == '\\') {
+            buf[len++] = '\\';
+        }
+        buf[len++] = (char)s[i];
+    }
+    buf[len++] = ')';
+    if (doc_out_write(pdf->out, buf, len) != 0) {
+        pdf->failed = true;
+    }
+}
+
+static void begin_object(pdf_doc_t *pdf, int obj)
+{
+    pdf->offsets[obj] = pdf->out->offset;
+    if (doc_out_printf(pdf->out, "%d 0 obj\n", obj) != 0) {
+        pdf->failed = true;
+    }
+}
+
+pdf_doc_t *pdf_begin(doc_out_t *out, int width, int height, const char *title)
+{
+    pdf_doc_t *pdf = calloc(1, sizeof(*pdf));
+    if (!pdf) {
+        return NULL;
+    }
+    pdf->out = out;
+    pdf->width = width;
+    pdf->height = height;
+    // The comment line of high bytes marks the file as binary
+    put(pdf, "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+
+    begin_object(pdf, PDF_OBJ_CATALOG);
+    put(pdf, "<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+    begin_object(pdf, 3);
+    put(pdf, "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica /Encoding /WinAnsiEncoding >>\nendobj\n");
+    begin_object(pdf, 4);
+    put(pdf, "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica-Bold /Encoding /WinAnsiEncoding >>\nendobj\n");
+
+    begin_object(pdf, PDF_OBJ_INFO);
+    uint8_t buf[PDF_TEXT_MAX];
+    put(pdf, "<< /Producer (Reptile Manager) /Title ");
+    put_string(pdf, buf, encode(title ? title : "", buf, sizeof(buf)));
+    time_t now = time(NULL);
+    struct tm tm;
+    if (gmtime_r(&now, &tm) && tm.tm_year >= 120) {
+        doc_out_printf(out, " /CreationDate (D:%04d%02d%02d%02d%02d%02dZ)", tm.tm_year + 1900,
+                       tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    }
+    put(pdf, " >>\nendobj\n");
+    return pdf;
+}
+
+int pdf_page_begin(pdf_doc_t *pdf)
+{
+    if (pdf->in_page && pdf_page_end(pdf) != 0) {
+        return -1;
+    }
+    if (pdf->pages == PDF_MAX_PAGES) {
+        pdf->failed = true;
+        return -1;
+    }
+    int obj = PDF_FIXED_OBJECTS + 1 + 3 * pdf->pages;
+    begin_object(pdf, obj);
+    doc_out_printf(pdf->out, "<< /Type /Page /Parent 2 0 R /Contents %d 0 R >>\nendobj\n", obj + 1);
+    begin_object(pdf, obj + 1);
+    doc_out_printf(pdf->out, "<< /Length %d 0 R >>\nstream\n", obj + 2);
+    pdf->stream_start = pdf->out->offset;
+    put(pdf, "0.5 w\n");
+    pdf->in_page = true;
+    return pdf->failed ? -1 : 0;
+}
+
+void pdf_text(pdf_doc_t *pdf, pdf_font_t font, int size, int x, int y, int max_width,
+              const char *utf8)
+{
+    uint8_t buf[PDF_TEXT_MAX];
+    size_t n = encode(utf8 ? utf8 : "", buf, sizeof(buf) - 1);
+    if (n == 0) {
+        return;
+    }
+    int limit = max_width * 1000 / size;
+    if (max_width > 0 && encoded_width(font, buf, n) > limit) {
+        limit -= char_width(font, PDF_ELLIPSIS);
+        int units = 0;
+        size_t fit = 0;
+        while (fit < n && units + char_width(font, buf[fit]) <= limit) {
+            units += char_width(font, buf[fit++]);
+        }
+        buf[fit] = PDF_ELLIPSIS;
+        n = fit + 1;
+    }
+    doc_out_printf(pdf->out, "BT /F%d %d Tf %d %d Td ", (int)font, size, x, y);
+    put_string(pdf, buf, n);
+    put(pdf, " Tj ET\n");
+}
+
+void pdf_line(pdf_doc_t *pdf, int x1, int y1, int x2, int y2)
+{
+    doc_out_printf(pdf->out, "%d %d m %d %d l S\n", x1, y1, x2, y2);
+}
+
+void pdf_band(pdf_doc_t *pdf, int x, int y, int width, int height)
+{
+    doc_out_printf(pdf->out, "0.9 g %d %d %d %d re f 0 g\n", x, y, width, height);
+}
+
+int pdf_page_end(pdf_doc_t *pdf)
+{
+    if (!pdf->in_page) {
+        return 0;
+    }
+    uint32_t length = pdf->out->offset - pdf->stream_start;
+    put(pdf, "endstream\nendobj\n");
+    begin_object(pdf, PDF_FIXED_OBJECTS + 3 + 3 * pdf->pages);
+    doc_out_printf(pdf->out, "%u\nendobj\n", (unsigned)length);
+    pdf->pages++;
+    pdf->in_page = false;
+    return pdf->failed ? -1 : 0;
+}
+
+int pdf_page_count(const pdf_doc_t *pdf)
+{
+    return pdf->pages + (pdf->in_page ? 1 : 0);
+}
+
+int pdf_end(pdf_doc_t *pdf)
+{
+    pdf_page_end(pdf);
+    if (pdf->pages == 0) {
+        pdf_page_begin(pdf);    // A PDF needs at least one page
+        pdf_page_end(pdf);
+    }
+    doc_out_t *out = pdf->out;
+    begin_object(pdf, PDF_OBJ_PAGES);
+    doc_out_printf(out, "<< /Type /Pages /Count %d /MediaBox [0 0 %d %d]\n", pdf->pages,
+                   pdf->width, pdf->height);
+    put(pdf, "/Resources << /Font << /F1 3 0 R /F2 4 0 R >> >>\n/Kids [");
+    for (int k = 0; k < pdf->pages; k++) {
+        doc_out_printf(out, "%d 0 R ", PDF_FIXED_OBJECTS + 1 + 3 * k);
+    }
+    put(pdf, "] >>\nendobj\n");
+
+    int objects = PDF_FIXED_OBJECTS + 1 + 3 * pdf->pages;
+    uint32_t xref = out->offset;
+    doc_out_printf(out, "xref\n0 %d\n0000000000 65535 f \n", objects);
+    for (int i = 1; i < objects; i++) {
+        doc_out_printf(out, "%010u 00000 n \n", (unsigned)pdf->offsets[i]);
+    }
+    doc_out_printf(out, "trailer\n<< /Size %d /Root 1 0 R /Info 5 0 R >>\nstartxref\n%u\n%%%%EOF\n",
+                   objects, (unsigned)xref);
+    int rc = pdf->failed || doc_out_flush(out) != 0 ? -1 : 0;
+    free(pdf);
+    return rc;
+}
+
+void pdf_abort(pdf_doc_t *pdf)
+{
+    free(pdf);
+}
@@ -0,0 +1,51 @@
+#ifndef PDF_WRITER_H
+#define PDF_WRITER_H
+
+#include <stdbool.h>
+#include "doc_output.h"
+
+/*
+ * Streaming PDF 1.4 writer.
+ *
+ * Pages are written to the output as they are drawn; only the byte
+ * offset of each object is kept for the cross-reference table, about
+ * 12 bytes per page.  Text uses the standard Helvetica fonts, which
+ * every reader has, so nothing is embedded; their metrics are compiled
+ * in to fit text to table cells.  Input text is UTF-8 and is converted
+ * to WinAnsi (Latin-1 plus the usual typographic marks); characters
+ * outside it print as '?'.
+ *
+ * Coordinates are in points from the bottom-left corner.
+ */
+
+#define PDF_A4_WIDTH    595
+#define PDF_A4_HEIGHT   842
+#define PDF_MAX_PAGES   250
+
+typedef enum {
+    PDF_FONT_REGULAR = 1,
+    PDF_FONT_BOLD = 2
+} pdf_font_t;
+
+typedef struct pdf_doc pdf_doc_t;
+
+pdf_doc_t *pdf_begin(doc_out_t *out, int width, int height, const char *title);
+int pdf_page_begin(pdf_doc_t *pdf);
+/* Draws text with its baseline at y; when max_width > 0 the text is
+ * cut to fit and ends with an ellipsis. */
+void pdf_text(pdf_doc_t *pdf, pdf_font_t font, int size, int x, int y, int max_width,
+              const char *utf8);
+void pdf_line(pdf_doc_t *pdf, int x1, int y1, int x2, int y2);
+/* Light grey band, e.g. behind a table header. */
+void pdf_band(pdf_doc_t *pdf, int x, int y, int width, int height);
+int pdf_page_end(pdf_doc_t *pdf);
+int pdf_page_count(const pdf_doc_t *pdf);
+/* Writes the page tree, cross-reference table and trailer, then frees
+ * the document.  Returns -1 if anything failed on the way. */
+int pdf_end(pdf_doc_t *pdf);
+void pdf_abort(pdf_doc_t *pdf);
+
+/* Width in points of utf8 set in font at size. */
+int pdf_text_width(pdf_font_t font, int size, const char *utf8);
+
+#endif /* PDF_WRITER_H */
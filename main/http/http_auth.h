@@ -0,0 +1,14 @@
+#ifndef HTTP_AUTH_H
+#define HTTP_AUTH_H
+
+#include <stdbool.h>
+#include "esp_http_server.h"
+
+/*
+ * Bearer-token check shared by the endpoints that change firmware or
+ * stored files.  True when the request carries
+ * "Authorization: Bearer <token>" and the token verifies.
+ */
+bool http_authorized(httpd_req_t *req);
+
+#endif
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "http_cache.h"
+#include "esp_random.h"
+
+/*
+ * Conditional GET implementation.
+ *
+ * ETags are "<scope hash>-<boot id>-<version>" in hex; the boot id is
+ * drawn once per boot and replaced by 0 for versions that survive a
+ * reboot.  If-None-Match takes precedence over If-Modified-Since as in
+ * RFC 9110; the list form and "*" are accepted, W/ prefixes are
+ * ignored (weak comparison).
+ */
+
+#define HTTP_HDR_MAX 160
+
+static uint32_t s_boot_id = 0;
+
+static uint32_t fnv1a(const char *s)
+{
+    uint32_t h = 2166136261u;
+    while (s && *s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static const char *const DAYS[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char *const MONTHS[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                      "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+/* Days since 1970-01-01 of a proleptic Gregorian date. */
+static int64_t days_from_civil(int y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+/* Parse an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT"); 0 on error. */
+static uint32_t parse_http_date(const char *s)
+{
+    char mon[4];
+    int day, year, hh, mm, ss;
+    if (sscanf(s, "%*3s, %d %3s %d %d:%d:%d GMT", &day, mon, &year, &hh, &mm, &ss) != 6) {
+        return 0;
+    }
+    for (unsigned m = 0; m < 12; m++) {
+        if (strcmp(mon, MONTHS[m]) == 0) {
+            int64_t t = days_from_civil(year, m + 1, (unsigned)day) * 86400 + hh * 3600 + mm * 60 + ss;
+            return (t > 0 && t <= UINT32_MAX) ? (uint32_t)t : 0;
+        }
+    }
+    return 0;
+}
+
+static void format_http_date(uint32_t t, char *out, size_t len)
+{
+    time_t tt = (time_t)t;
+    struct tm tm;
+    gmtime_r(&tt, &tm);
+    snprintf(out, len, "%s, %02d %s %04d %02d:%02d:%02d GMT", DAYS[tm.tm_wday], tm.tm_mday,
+             MONTHS[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+void http_cache_validator(http_validator_t *v, const char *scope, uint64_t version,
+                          bool per_boot, uint32_t last_modified)
+{
+    if (s_boot_id == 0) {
+        s_boot_id = esp_random() | 1;
+    }
+    snprintf(v->etag, sizeof(v->etag), "\"%08x-%08x-%llx\"", (unsigned)fnv1a(scope),
+             per_boot ? (unsigned)s_boot_id : 0u, (unsigned long long)version);
+    v->last_modified[0] = '\0';
+    if (last_modified) {
+        format_http_date(last_modified, v->last_modified, sizeof(v->last_modified));
+    }
+}
+
+void http_cache_vary_encoding(httpd_req_t *req, http_validator_t *v, bool gzip)
+{
+    size_t len = strlen(v->etag);
+    if (gzip && len + 3 < sizeof(v->etag)) {
+        memcpy(v->etag + len - 1, "-gz\"", 5);
+    }
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+}
+
+static bool etag_listed(const char *header, const char *etag)
+{
+    size_t len = strlen(etag);
+    const char *p = header;
+    while (*p) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        if (*p == '*') {
+            return true;
+        }
+        if (p[0] == 'W' && p[1] == '/') {
+            p += 2;
+        }
+        if (strncmp(p, etag, len) == 0 && (p[len] == '\0' || p[len] == ',' || p[len] == ' ')) {
+            return true;
+        }
+        while (*p && *p != ',') {
+            p++;
+        }
+    }
+    return false;
+}
+
+bool http_cache_not_modified(httpd_req_t *req, const http_validator_t *v)
+{
+    char header[HTTP_HDR_MAX];
+    bool match = false;
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", header, sizeof(header)) == ESP_OK) {
+        match = etag_listed(header, v->etag);
+    } else if (v->last_modified[0] &&
+               httpd_req_get_hdr_value_str(req, "If-Modified-Since", header,
+                                           sizeof(header)) == ESP_OK) {
+        uint32_t since = parse_http_date(header);
+        match = since != 0 && parse_http_date(v->last_modified) <= since;
+    }
+
+    httpd_resp_set_hdr(req, "ETag", v->etag);
+    if (v->last_modified[0]) {
+        httpd_resp_set_hdr(req, "Last-Modified", v->last_modified);
+    }
+    if (!match) {
+        return false;
+    }
+    httpd_resp_set_status(req, "304 Not Modified");
+    httpd_resp_send(req, NULL, 0);
+    return true;
+}
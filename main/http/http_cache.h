@@ -0,0 +1,49 @@
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+
+/*
+ * Conditional GET helpers.
+ *
+ * Handlers derive a validator from a cheap version number (a table or
+ * NVS generation, a sensor update counter, the firmware hash) before
+ * doing any real work, then call http_cache_not_modified().  When the
+ * client's If-None-Match / If-Modified-Since matches, a bodiless 304 is
+ * sent and the handler returns; otherwise ETag and Last-Modified are
+ * set on the response that follows.
+ *
+ * The headers point into the validator, so it must stay alive until
+ * the response is sent (keep it on the handler's stack).
+ */
+
+typedef struct {
+    char etag[44];              // Quoted strong ETag
+    char last_modified[32];     // HTTP-date, empty when unknown
+} http_validator_t;
+
+/*
+ * scope names the resource family ("config", "sensors", a table
+ * name...).  Versions that restart at boot (RAM counters) set
+ * per_boot so a reboot never reuses an old tag.  last_modified is Unix
+ * seconds, 0 when unknown.
+ */
+void http_cache_validator(http_validator_t *v, const char *scope, uint64_t version,
+                          bool per_boot, uint32_t last_modified);
+
+/* For bodies served either gzipped or not: tags the ETag with the
+ * encoding ("...-gz") and sets Vary: Accept-Encoding, so the two
+ * representations never share a strong tag and a 304 says what the
+ * cached copy depends on.  Call before http_cache_not_modified(). */
+void http_cache_vary_encoding(httpd_req_t *req, http_validator_t *v, bool gzip);
+
+/* Returns true after sending 304; the handler must then return ESP_OK. */
+bool http_cache_not_modified(httpd_req_t *req, const http_validator_t *v);
+
+/* Cache-Control values */
+#define HTTP_CACHE_REVALIDATE  "no-cache"
+#define HTTP_CACHE_IMMUTABLE   "public, max-age=31536000, immutable"
+
+#endif /* HTTP_CACHE_H */
@@ -0,0 +1,146 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "http_compress.h"
+
+/*
+ * Compressed responses.
+ *
+ * Encoders are counted with an atomic slot counter; a response that
+ * finds no slot free falls back to identity, which every client
+ * accepts.  gz_stream hands its output to httpd_resp_send_chunk in
+ * GZ_OUT_SIZE pieces, so a compressed response never holds more than
+ * one encoder and one output buffer whatever its length.
+ */
+
+#include "sdkconfig.h"
+
+#define ACCEPT_ENCODING_MAX 128
+
+static atomic_uint s_streams;
+
+bool http_accepts_gzip(httpd_req_t *req)
+{
+#if CONFIG_APP_HTTP_GZIP
+    char header[ACCEPT_ENCODING_MAX];
+    if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    const char *p = header;
+    while (*p) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        const char *name = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ') {
+            p++;
+        }
+        size_t len = (size_t)(p - name);
+        bool gzip = (len == 4 && strncasecmp(name, "gzip", 4) == 0) ||
+                    (len == 6 && strncasecmp(name, "x-gzip", 6) == 0) ||
+                    (len == 1 && name[0] == '*');
+        double q = 1.0;
+        while (*p && *p != ',') {
+            if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+                q = strtod(p + 2, NULL);
+            }
+            p++;
+        }
+        if (gzip) {
+            return q > 0.0;
+        }
+    }
+#else
+    (void)req;
+#endif
+    return false;
+}
+
+static int send_chunk(void *ctx, const uint8_t *data, size_t len)
+{
+    return httpd_resp_send_chunk(ctx, (const char *)data, (ssize_t)len) == ESP_OK ? 0 : -1;
+}
+
+static gz_stream_t *acquire_encoder(httpd_req_t *req)
+{
+    if (atomic_fetch_add(&s_streams, 1) >= CONFIG_APP_HTTP_GZIP_STREAMS) {
+        atomic_fetch_sub(&s_streams, 1);
+        return NULL;
+    }
+    gz_stream_t *gz = gz_open(send_chunk, req);
+    if (!gz) {
+        atomic_fetch_sub(&s_streams, 1);
+    }
+    return gz;
+}
+
+void http_stream_begin(http_stream_t *s, httpd_req_t *req)
+{
+    s->req = req;
+    s->gz = NULL;
+    s->err = ESP_OK;
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if (http_accepts_gzip(req)) {
+        s->gz = acquire_encoder(req);
+    }
+    if (s->gz) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+}
+
+esp_err_t http_stream_write(http_stream_t *s, const void *data, size_t len)
+{
+    if (s->err != ESP_OK || len == 0) {
+        return s->err;
+    }
+    if (s->gz) {
+        s->err = gz_write(s->gz, data, len) == 0 ? ESP_OK : ESP_FAIL;
+    } else {
+        s->err = httpd_resp_send_chunk(s->req, data, (ssize_t)len);
+    }
+    return s->err;
+}
+
+esp_err_t http_stream_end(http_stream_t *s)
+{
+    if (s->gz) {
+        if (gz_finish(s->gz) != 0 && s->err == ESP_OK) {
+            s->err = ESP_FAIL;
+        }
+        gz_close(s->gz);
+        s->gz = NULL;
+        atomic_fetch_sub(&s_streams, 1);
+    }
+    if (s->err == ESP_OK) {
+        s->err = httpd_resp_send_chunk(s->req, NULL, 0);
+    }
+    return s->err;
+}
+
+esp_err_t http_send_compressed(httpd_req_t *req, const char *body, size_t len)
+{
+    if (len < CONFIG_APP_HTTP_GZIP_MIN_SIZE) {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        return httpd_resp_send(req, body, (ssize_t)len);
+    }
+    http_stream_t s;
+    http_stream_begin(&s, req);
+    if (!s.gz) {
+        // A fixed Content-Length is cheaper than chunking for identity
+        return httpd_resp_send(req, body, (ssize_t)len);
+    }
+    http_stream_write(&s, body, len);
+    return http_stream_end(&s);
+}
+
+esp_err_t http_send_asset(httpd_req_t *req, const uint8_t *plain, size_t plain_len,
+                          const uint8_t *gz, size_t gz_len)
+{
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if (gz_len > 0 && http_accepts_gzip(req)) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        return httpd_resp_send(req, (const char *)gz, (ssize_t)gz_len);
+    }
+    return httpd_resp_send(req, (const char *)plain, (ssize_t)plain_len);
+}
@@ -0,0 +1,46 @@
+#ifndef HTTP_COMPRESS_H
+#define HTTP_COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+#include "utils/gzip_stream.h"
+
+/*
+ * Content-Encoding negotiation.
+ *
+ * Static assets are gzipped at build time and sent as stored when the
+ * client's Accept-Encoding allows it.  Dynamic bodies go through a
+ * chunked stream that gzips on the fly; at most
+ * CONFIG_APP_HTTP_GZIP_STREAMS encoders exist at once and further
+ * responses are sent uncompressed rather than waiting for memory.
+ * Every negotiable response carries Vary: Accept-Encoding.
+ *
+ * Set the content type (and any cache headers) before calling these.
+ */
+
+typedef struct {
+    httpd_req_t *req;
+    gz_stream_t *gz;        // NULL when sending identity
+    esp_err_t err;
+} http_stream_t;
+
+/* True when Accept-Encoding lists gzip (or *) without q=0. */
+bool http_accepts_gzip(httpd_req_t *req);
+
+/* Chunked body, compressed when the client accepts it and an encoder
+ * slot is free.  Always finish with http_stream_end(). */
+void http_stream_begin(http_stream_t *s, httpd_req_t *req);
+esp_err_t http_stream_write(http_stream_t *s, const void *data, size_t len);
+esp_err_t http_stream_end(http_stream_t *s);
+
+/* Whole body in memory; bodies below CONFIG_APP_HTTP_GZIP_MIN_SIZE are
+ * sent as they are. */
+esp_err_t http_send_compressed(httpd_req_t *req, const char *body, size_t len);
+
+/* Precompressed asset: gz as stored when accepted, plain otherwise. */
+esp_err_t http_send_asset(httpd_req_t *req, const uint8_t *plain, size_t plain_len,
+                          const uint8_t *gz, size_t gz_len);
+
+#endif /* HTTP_COMPRESS_H */
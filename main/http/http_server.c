@@ -1,3 +1,4 @@
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,7 +15,9 @@
  * httpd_ssl_start() instead of httpd_start().
  */
 
+#include "sdkconfig.h"
 #include "esp_http_server.h"
+#include "esp_app_desc.h"
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_timer.h"
@@ -23,7 +26,25 @@
 #include "freertos/task.h"
 #include "cJSON.h"
 #include "utils/logger.h"
+#include "utils/json_fields.h"
+#include "utils/mem_arena.h"
 #include "storage/nvs_manager.h"
+#include "sensors/sensor_manager.h"
+#include "routes/api_sensors.h"
+#include "http_workers.h"
+#include "http_cache.h"
+#include "http_compress.h"
+#include "static_files.h"
+#include "websocket.h"
+#include "routes/api_ota.h"
+#include "routes/api_files.h"
+#include "routes/api_animals.h"
+#include "routes/api_breeding.h"
+#include "routes/api_bulk.h"
+#include "routes/api_sync.h"
+#include "routes/api_documents.h"
+#include "routes/api_regulations.h"
+#include "replication/replicator.h"
 
 static const char *TAG_HTTP = "http";
 #define WIFI_CRED_MAX_BODY 256
@@ -31,153 +52,11 @@ static const char *TAG_HTTP = "http";
 #define CONFIG_VALUE_MAX 64
 #define CONFIG_PORT_MAX 6
 
-static const char *CONFIG_PAGE_HTML =
-    "<!doctype html>\n"
-    "<html lang=\"fr\">\n"
-    "<head>\n"
-    "  <meta charset=\"utf-8\" />\n"
-    "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1\" />\n"
-    "  <title>ESP32 Reptile Manager - Configuration</title>\n"
-    "  <style>\n"
-    "    body{font-family:system-ui,-apple-system,Segoe UI,Roboto,Ubuntu,\"Helvetica Neue\",Arial,sans-serif;margin:0;background:#0f172a;color:#e2e8f0}\n"
-    "    main{max-width:720px;margin:0 auto;padding:24px}\n"
-    "    h1{font-size:1.5rem;margin-bottom:0.5rem}\n"
-    "    h2{font-size:1.1rem;margin:24px 0 8px}\n"
-    "    .card{background:#111827;border:1px solid #1f2937;border-radius:12px;padding:16px;margin-bottom:16px}\n"
-    "    label{display:block;font-size:0.9rem;margin-top:10px}\n"
-    "    input{width:100%;padding:10px;border-radius:8px;border:1px solid #334155;background:#0b1220;color:#e2e8f0}\n"
-    "    button{margin-top:16px;padding:10px 16px;border-radius:8px;border:none;background:#38bdf8;color:#0f172a;font-weight:600;cursor:pointer}\n"
-    "    .hint{font-size:0.8rem;color:#94a3b8}\n"
-    "    .status{margin-top:12px;font-size:0.9rem}\n"
-    "  </style>\n"
-    "</head>\n"
-    "<body>\n"
-    "  <main>\n"
-    "    <h1>Configuration ESP32 Reptile Manager</h1>\n"
-    "    <p class=\"hint\">Remplissez uniquement les champs à modifier. Laissez vide pour conserver la valeur actuelle.</p>\n"
-    "    <form id=\"configForm\" class=\"card\">\n"
-    "      <h2>Wi-Fi</h2>\n"
-    "      <label>SSID\n"
-    "        <input id=\"wifi_ssid\" name=\"wifi_ssid\" type=\"text\" />\n"
-    "      </label>\n"
-    "      <label>Mot de passe\n"
-    "        <input id=\"wifi_password\" name=\"wifi_password\" type=\"password\" />\n"
-    "      </label>\n"
-    "      <label class=\"hint\"><input id=\"wifi_password_clear\" type=\"checkbox\" /> Envoyer un mot de passe vide (réseau ouvert)</label>\n"
-    "\n"
-    "      <h2>Serveur</h2>\n"
-    "      <label>Hôte\n"
-    "        <input id=\"server_host\" name=\"server_host\" type=\"text\" />\n"
-    "      </label>\n"
-    "      <label>Port\n"
-    "        <input id=\"server_port\" name=\"server_port\" type=\"number\" min=\"1\" max=\"65535\" />\n"
-    "      </label>\n"
-    "      <label>Identifiant\n"
-    "        <input id=\"server_user\" name=\"server_user\" type=\"text\" />\n"
-    "      </label>\n"
-    "      <label>Mot de passe\n"
-    "        <input id=\"server_password\" name=\"server_password\" type=\"password\" />\n"
-    "      </label>\n"
-    "      <label class=\"hint\"><input id=\"server_password_clear\" type=\"checkbox\" /> Envoyer un mot de passe vide</label>\n"
-    "\n"
-    "      <h2>Base de données</h2>\n"
-    "      <label>Hôte\n"
-    "        <input id=\"db_host\" name=\"db_host\" type=\"text\" />\n"
-    "      </label>\n"
-    "      <label>Port\n"
-    "        <input id=\"db_port\" name=\"db_port\" type=\"number\" min=\"1\" max=\"65535\" />\n"
-    "      </label>\n"
-    "      <label>Nom de base\n"
-    "        <input id=\"db_name\" name=\"db_name\" type=\"text\" />\n"
-    "      </label>\n"
-    "      <label>Utilisateur\n"
-    "        <input id=\"db_user\" name=\"db_user\" type=\"text\" />\n"
-    "      </label>\n"
-    "      <label>Mot de passe\n"
-    "        <input id=\"db_password\" name=\"db_password\" type=\"password\" />\n"
-    "      </label>\n"
-    "      <label class=\"hint\"><input id=\"db_password_clear\" type=\"checkbox\" /> Envoyer un mot de passe vide</label>\n"
-    "\n"
-    "      <button type=\"submit\">Enregistrer</button>\n"
-    "      <div id=\"status\" class=\"status\"></div>\n"
-    "    </form>\n"
-    "  </main>\n"
-    "  <script>\n"
-    "    const statusEl = document.getElementById('status');\n"
-    "    const getValue = (id) => document.getElementById(id).value.trim();\n"
-    "    const getChecked = (id) => document.getElementById(id).checked;\n"
-    "\n"
-    "    async function loadConfig() {\n"
-    "      try {\n"
-    "        const res = await fetch('/api/v1/config');\n"
-    "        if (!res.ok) throw new Error('Erreur chargement');\n"
-    "        const data = await res.json();\n"
-    "        document.getElementById('wifi_ssid').value = data.wifi?.ssid || '';\n"
-    "        document.getElementById('server_host').value = data.server?.host || '';\n"
-    "        document.getElementById('server_port').value = data.server?.port || '';\n"
-    "        document.getElementById('server_user').value = data.server?.user || '';\n"
-    "        document.getElementById('db_host').value = data.database?.host || '';\n"
-    "        document.getElementById('db_port').value = data.database?.port || '';\n"
-    "        document.getElementById('db_name').value = data.database?.name || '';\n"
-    "        document.getElementById('db_user').value = data.database?.user || '';\n"
-    "      } catch (err) {\n"
-    "        statusEl.textContent = 'Impossible de charger la configuration.';\n"
-    "      }\n"
-    "    }\n"
-    "\n"
-    "    document.getElementById('configForm').addEventListener('submit', async (event) => {\n"
-    "      event.preventDefault();\n"
-    "      statusEl.textContent = 'Enregistrement...';\n"
-    "      const payload = { wifi: {}, server: {}, database: {} };\n"
-    "\n"
-    "      const wifiSsid = getValue('wifi_ssid');\n"
-    "      const wifiPassword = document.getElementById('wifi_password').value;\n"
-    "      if (wifiSsid) payload.wifi.ssid = wifiSsid;\n"
-    "      if (wifiPassword) payload.wifi.password = wifiPassword;\n"
-    "      if (!wifiPassword && getChecked('wifi_password_clear')) payload.wifi.password = '';\n"
-    "\n"
-    "      const serverHost = getValue('server_host');\n"
-    "      const serverPort = getValue('server_port');\n"
-    "      const serverUser = getValue('server_user');\n"
-    "      const serverPassword = document.getElementById('server_password').value;\n"
-    "      if (serverHost) payload.server.host = serverHost;\n"
-    "      if (serverPort) payload.server.port = Number(serverPort);\n"
-    "      if (serverUser) payload.server.user = serverUser;\n"
-    "      if (serverPassword) payload.server.password = serverPassword;\n"
-    "      if (!serverPassword && getChecked('server_password_clear')) payload.server.password = '';\n"
-    "\n"
-    "      const dbHost = getValue('db_host');\n"
-    "      const dbPort = getValue('db_port');\n"
-    "      const dbName = getValue('db_name');\n"
-    "      const dbUser = getValue('db_user');\n"
-    "      const dbPassword = document.getElementById('db_password').value;\n"
-    "      if (dbHost) payload.database.host = dbHost;\n"
-    "      if (dbPort) payload.database.port = Number(dbPort);\n"
-    "      if (dbName) payload.database.name = dbName;\n"
-    "      if (dbUser) payload.database.user = dbUser;\n"
-    "      if (dbPassword) payload.database.password = dbPassword;\n"
-    "      if (!dbPassword && getChecked('db_password_clear')) payload.database.password = '';\n"
-    "\n"
-    "      try {\n"
-    "        const res = await fetch('/api/v1/config', {\n"
-    "          method: 'POST',\n"
-    "          headers: { 'Content-Type': 'application/json' },\n"
-    "          body: JSON.stringify(payload),\n"
-    "        });\n"
-    "        const data = await res.json();\n"
-    "        if (!res.ok) throw new Error(data?.error || 'Erreur');\n"
-    "        statusEl.textContent = data.action === 'reboot'\n"
-    "          ? 'Configuration enregistrée. Redémarrage en cours...'\n"
-    "          : 'Configuration enregistrée.';\n"
-    "      } catch (err) {\n"
-    "        statusEl.textContent = 'Échec enregistrement: ' + err.message;\n"
-    "      }\n"
-    "    });\n"
-    "\n"
-    "    loadConfig();\n"
-    "  </script>\n"
-    "</body>\n"
-    "</html>\n";
+// www/config.html, embedded as written and gzipped by the build
+extern const uint8_t config_html_start[] asm("_binary_config_html_start");
+extern const uint8_t config_html_end[] asm("_binary_config_html_end");
+extern const uint8_t config_html_gz_start[] asm("_binary_config_html_gz_start");
+extern const uint8_t config_html_gz_end[] asm("_binary_config_html_gz_end");
 
 typedef struct {
     char wifi_ssid[sizeof(((wifi_config_t *)0)->sta.ssid)];
@@ -197,92 +76,168 @@ static void nvs_get_str_or_empty(const char *key, char *value, size_t max_len)
     }
 }
 
-static bool set_nvs_str_if_valid(const char *key, const cJSON *item, size_t max_len,
-                                 bool allow_empty, bool *changed)
-{
-    if (!cJSON_IsString(item)) {
-        return true;
-    }
-    const char *value = item->valuestring ? item->valuestring : "";
-    size_t len = strlen(value);
-    if (len == 0 && !allow_empty) {
-        return true;
-    }
-    if (len > max_len) {
-        return false;
-    }
-    if (nvsman_set_str(key, value) != 0) {
-        return false;
-    }
-    if (changed) {
-        *changed = true;
-    }
-    return true;
-}
+/* Body of POST /api/v1/config; every member is optional. */
+typedef struct {
+    char wifi_ssid[sizeof(((wifi_config_t *)0)->sta.ssid)];
+    char wifi_pass[sizeof(((wifi_config_t *)0)->sta.password)];
+    char srv_host[CONFIG_VALUE_MAX];
+    int64_t srv_port;
+    char srv_user[CONFIG_VALUE_MAX];
+    char srv_pass[CONFIG_VALUE_MAX];
+    char db_host[CONFIG_VALUE_MAX];
+    int64_t db_port;
+    char db_name[CONFIG_VALUE_MAX];
+    char db_user[CONFIG_VALUE_MAX];
+    char db_pass[CONFIG_VALUE_MAX];
+} config_body_t;
+
+static const json_field_t CONFIG_FIELDS[] = {
+    JSON_STR("wifi.ssid", config_body_t, wifi_ssid),
+    JSON_STR("wifi.password", config_body_t, wifi_pass),
+    JSON_STR("server.host", config_body_t, srv_host),
+    JSON_INT("server.port", config_body_t, srv_port, 1, 65535),
+    JSON_STR("server.user", config_body_t, srv_user),
+    JSON_STR("server.password", config_body_t, srv_pass),
+    JSON_STR("database.host", config_body_t, db_host),
+    JSON_INT("database.port", config_body_t, db_port, 1, 65535),
+    JSON_STR("database.name", config_body_t, db_name),
+    JSON_STR("database.user", config_body_t, db_user),
+    JSON_STR("database.password", config_body_t, db_pass),
+};
+
+// NVS key of each CONFIG_FIELDS entry
+static const char *const CONFIG_KEYS[] = {
+    "wifi_ssid", "wifi_pass",
+    "srv_host", "srv_port", "srv_user", "srv_pass",
+    "db_host", "db_port", "db_name", "db_user", "db_pass",
+};
+_Static_assert(sizeof(CONFIG_KEYS) / sizeof(CONFIG_KEYS[0]) ==
+               sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]), "one NVS key per field");
+
+#define CONFIG_WIFI_FIELDS    (JSON_FIELD_BIT(0) | JSON_FIELD_BIT(1))
+// An empty string clears these; for the others it means "unchanged"
+#define CONFIG_SECRET_FIELDS  (JSON_FIELD_BIT(1) | JSON_FIELD_BIT(5) | JSON_FIELD_BIT(10))
 
-static bool set_nvs_port_if_valid(const char *key, const cJSON *item, bool *changed)
-{
-    if (!item) {
-        return true;
-    }
-    long port = -1;
-    if (cJSON_IsNumber(item)) {
-        port = (long)item->valuedouble;
-    } else if (cJSON_IsString(item)) {
-        const char *value = item->valuestring;
-        if (!value || value[0] == '\0') {
-            return true;
-        }
-        char *endptr = NULL;
-        port = strtol(value, &endptr, 10);
-        if (!endptr || *endptr != '\0') {
-            return false;
-        }
-    } else {
-        return true;
-    }
-    if (port < 1 || port > 65535) {
-        return false;
-    }
-    char port_str[CONFIG_PORT_MAX];
-    snprintf(port_str, sizeof(port_str), "%ld", port);
-    if (nvsman_set_str(key, port_str) != 0) {
-        return false;
-    }
-    if (changed) {
-        *changed = true;
-    }
-    return true;
-}
+typedef struct {
+    char ssid[sizeof(((wifi_config_t *)0)->sta.ssid)];
+    char password[sizeof(((wifi_config_t *)0)->sta.password)];
+} wifi_cred_body_t;
+
+static const json_field_t WIFI_CRED_FIELDS[] = {
+    JSON_STR("ssid", wifi_cred_body_t, ssid),
+    JSON_STR("password", wifi_cred_body_t, password),
+};
 
-// Handler for GET /api/v1/system/stats
 static esp_err_t stats_get_handler(httpd_req_t *req)
 {
-    // Build a JSON response with basic system stats
+    // Build a JSON response with basic system stats.  The handler opens
+    // its own scope so the health table and the DOM are released on
+    // return whoever calls it (nested in http_dispatch()'s otherwise).
+    mem_arena_scope_begin();
     cJSON *root = cJSON_CreateObject();
     cJSON_AddNumberToObject(root, "uptime", (double)esp_timer_get_time() / 1e6);
     cJSON_AddNumberToObject(root, "heap_free", (double)esp_get_free_heap_size());
+
+    mem_heap_stats_t heap;
+    mem_get_heap_stats(&heap);
+    cJSON *heap_obj = cJSON_AddObjectToObject(root, "heap");
+    cJSON_AddNumberToObject(heap_obj, "internal_free", (double)heap.internal_free);
+    cJSON_AddNumberToObject(heap_obj, "internal_largest_block", (double)heap.internal_largest);
+    cJSON_AddNumberToObject(heap_obj, "internal_min_free", (double)heap.internal_min_free);
+    cJSON_AddNumberToObject(heap_obj, "fragmentation_pct", heap.internal_frag_pct);
+    cJSON_AddNumberToObject(heap_obj, "psram_free", (double)heap.psram_free);
+    cJSON_AddNumberToObject(heap_obj, "psram_largest_block", (double)heap.psram_largest);
+
+    mem_arena_stats_t arena;
+    mem_get_arena_stats(&arena);
+    cJSON *arena_obj = cJSON_AddObjectToObject(root, "arena");
+    cJSON_AddNumberToObject(arena_obj, "capacity", (double)arena.capacity);
+    cJSON_AddNumberToObject(arena_obj, "peak", (double)arena.peak);
+    cJSON_AddNumberToObject(arena_obj, "overflows", arena.overflows);
+
+    http_workers_stats_t workers;
+    http_workers_get_stats(&workers);
+    cJSON *http_obj = cJSON_AddObjectToObject(root, "http_workers");
+    cJSON_AddNumberToObject(http_obj, "workers", workers.workers);
+    cJSON_AddNumberToObject(http_obj, "queued", workers.queued);
+    cJSON_AddNumberToObject(http_obj, "busy", workers.busy);
+    cJSON_AddNumberToObject(http_obj, "completed", workers.completed);
+    cJSON_AddNumberToObject(http_obj, "rejected", workers.rejected);
+
+    // Probe health; noise is the per-reading noise standard deviation
+    sensor_health_info_t *health = mem_arena_malloc(SENSOR_MAX_CHANNELS * sizeof(*health));
+    int health_count = health ? sensors_get_health(health, SENSOR_MAX_CHANNELS) : 0;
+    cJSON *sensors_arr = cJSON_AddArrayToObject(root, "sensors");
+    for (int i = 0; i < health_count; i++) {
+        const sensor_health_t *h = &health[i].health;
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", health[i].name);
+        cJSON_AddStringToObject(item, "state", sensor_health_name(h->state));
+        cJSON_AddNumberToObject(item, "mean", h->mean);
+        cJSON_AddNumberToObject(item, "stddev", sqrtf(h->var));
+        cJSON_AddNumberToObject(item, "noise", sqrtf(h->noise / 2.0f));
+        cJSON_AddNumberToObject(item, "samples", h->samples);
+        cJSON_AddNumberToObject(item, "rejected", h->rejected);
+        cJSON_AddNumberToObject(item, "failures", h->failures);
+        cJSON_AddNumberToObject(item, "crc_errors", h->crc_errors);
+        cJSON_AddItemToArray(sensors_arr, item);
+    }
+    mem_arena_free(health);     // Heap when the arena was unavailable
+
+#if CONFIG_APP_REPLICATION
+    replicator_status_t repl;
+    replicator_get_status(&repl);
+    cJSON *repl_obj = cJSON_AddObjectToObject(root, "replication");
+    cJSON_AddBoolToObject(repl_obj, "connected", repl.connected);
+    cJSON_AddNumberToObject(repl_obj, "acked_seq", (double)repl.acked_seq);
+    cJSON_AddNumberToObject(repl_obj, "batches_acked", repl.batches_acked);
+    cJSON_AddNumberToObject(repl_obj, "failures", repl.failures);
+#endif
+
     char *json_str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
-    if (!json_str) {
+    esp_err_t ret = ESP_OK;
+    if (json_str) {
+        httpd_resp_set_type(req, "application/json");
+        http_send_compressed(req, json_str, strlen(json_str));
+        cJSON_free(json_str);
+    } else {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON encode failed");
-        return ESP_FAIL;
+        ret = ESP_FAIL;
     }
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_str, HTTPD_RESP_USE_STRLEN);
-    free(json_str);
-    return ESP_OK;
+    mem_arena_scope_end();
+    return ret;
 }
 
 static esp_err_t config_page_get_handler(httpd_req_t *req)
 {
+    // The page only changes with the firmware image
+    uint64_t build = 0;
+    memcpy(&build, esp_app_get_description()->app_elf_sha256, sizeof(build));
+    http_validator_t validator;
+    http_cache_validator(&validator, "config_page", build, false, 0);
+    // Same choice http_send_asset() makes below
+    bool gzip = config_html_gz_end - config_html_gz_start > 0 && http_accepts_gzip(req);
+    http_cache_vary_encoding(req, &validator, gzip);
+    httpd_resp_set_hdr(req, "Cache-Control", HTTP_CACHE_REVALIDATE);
+    if (http_cache_not_modified(req, &validator)) {
+        return ESP_OK;
+    }
     httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, CONFIG_PAGE_HTML, HTTPD_RESP_USE_STRLEN);
+    http_send_asset(req, config_html_start, (size_t)(config_html_end - config_html_start),
+                    config_html_gz_start, (size_t)(config_html_gz_end - config_html_gz_start));
     return ESP_OK;
 }
 
 static esp_err_t config_get_handler(httpd_req_t *req)
 {
+    http_validator_t validator;
+    http_cache_validator(&validator, "config", nvsman_generation(), true, 0);
+    httpd_resp_set_hdr(req, "Cache-Control", HTTP_CACHE_REVALIDATE);
+    if (http_cache_not_modified(req, &validator)) {
+        return ESP_OK;
+    }
+
     config_snapshot_t config = { 0 };
     nvs_get_str_or_empty("wifi_ssid", config.wifi_ssid, sizeof(config.wifi_ssid));
     nvs_get_str_or_empty("srv_host", config.server_host, sizeof(config.server_host));
@@ -317,8 +272,8 @@ static esp_err_t config_get_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_str, HTTPD_RESP_USE_STRLEN);
-    free(json_str);
+    http_send_compressed(req, json_str, strlen(json_str));
+    cJSON_free(json_str);
     return ESP_OK;
 }
 
@@ -329,81 +284,52 @@ static esp_err_t config_post_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    char body[CONFIG_MAX_BODY + 1];
+    char body[CONFIG_MAX_BODY];
     int received = httpd_req_recv(req, body, req->content_len);
     if (received <= 0) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read body");
         return ESP_FAIL;
     }
-    body[received] = '\0';
 
-    cJSON *root = cJSON_ParseWithLength(body, received);
-    if (!root) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    // Everything is validated before anything is stored
+    config_body_t in;
+    uint32_t present;
+    char err[96];
+    const size_t count = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+    if (json_fields_parse(body, received, CONFIG_FIELDS, count, &in, &present,
+                          err, sizeof(err)) != 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
         return ESP_FAIL;
     }
 
     bool wifi_changed = false;
     bool config_changed = false;
-    const cJSON *wifi = cJSON_GetObjectItemCaseSensitive(root, "wifi");
-    if (cJSON_IsObject(wifi)) {
-        const cJSON *ssid = cJSON_GetObjectItemCaseSensitive(wifi, "ssid");
-        const cJSON *password = cJSON_GetObjectItemCaseSensitive(wifi, "password");
-        size_t max_ssid_len = sizeof(((wifi_config_t *)0)->sta.ssid) - 1;
-        size_t max_pass_len = sizeof(((wifi_config_t *)0)->sta.password) - 1;
-
-        if (!set_nvs_str_if_valid("wifi_ssid", ssid, max_ssid_len, false, &wifi_changed) ||
-            !set_nvs_str_if_valid("wifi_pass", password, max_pass_len, true, &wifi_changed)) {
-            cJSON_Delete(root);
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid Wi-Fi fields");
-            return ESP_FAIL;
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t bit = JSON_FIELD_BIT(i);
+        if (!(present & bit)) {
+            continue;
         }
-    }
-
-    const cJSON *server = cJSON_GetObjectItemCaseSensitive(root, "server");
-    if (cJSON_IsObject(server)) {
-        if (!set_nvs_str_if_valid("srv_host",
-                                  cJSON_GetObjectItemCaseSensitive(server, "host"),
-                                  CONFIG_VALUE_MAX - 1, false, &config_changed) ||
-            !set_nvs_port_if_valid("srv_port",
-                                   cJSON_GetObjectItemCaseSensitive(server, "port"),
-                                   &config_changed) ||
-            !set_nvs_str_if_valid("srv_user",
-                                  cJSON_GetObjectItemCaseSensitive(server, "user"),
-                                  CONFIG_VALUE_MAX - 1, false, &config_changed) ||
-            !set_nvs_str_if_valid("srv_pass",
-                                  cJSON_GetObjectItemCaseSensitive(server, "password"),
-                                  CONFIG_VALUE_MAX - 1, true, &config_changed)) {
-            cJSON_Delete(root);
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid server fields");
-            return ESP_FAIL;
+        const char *value = (const char *)&in + CONFIG_FIELDS[i].offset;
+        char port[CONFIG_PORT_MAX];
+        if (CONFIG_FIELDS[i].type == JSON_FIELD_INT) {
+            int64_t number;
+            memcpy(&number, value, sizeof(number));
+            snprintf(port, sizeof(port), "%d", (int)number);
+            value = port;
+        } else if (value[0] == '\0' && !(CONFIG_SECRET_FIELDS & bit)) {
+            continue;
         }
-    }
-
-    const cJSON *database = cJSON_GetObjectItemCaseSensitive(root, "database");
-    if (cJSON_IsObject(database)) {
-        if (!set_nvs_str_if_valid("db_host",
-                                  cJSON_GetObjectItemCaseSensitive(database, "host"),
-                                  CONFIG_VALUE_MAX - 1, false, &config_changed) ||
-            !set_nvs_port_if_valid("db_port",
-                                   cJSON_GetObjectItemCaseSensitive(database, "port"),
-                                   &config_changed) ||
-            !set_nvs_str_if_valid("db_name",
-                                  cJSON_GetObjectItemCaseSensitive(database, "name"),
-                                  CONFIG_VALUE_MAX - 1, false, &config_changed) ||
-            !set_nvs_str_if_valid("db_user",
-                                  cJSON_GetObjectItemCaseSensitive(database, "user"),
-                                  CONFIG_VALUE_MAX - 1, false, &config_changed) ||
-            !set_nvs_str_if_valid("db_pass",
-                                  cJSON_GetObjectItemCaseSensitive(database, "password"),
-                                  CONFIG_VALUE_MAX - 1, true, &config_changed)) {
-            cJSON_Delete(root);
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid database fields");
+        if (nvsman_set_str(CONFIG_KEYS[i], value) != 0) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to store configuration");
             return ESP_FAIL;
         }
+        if (CONFIG_WIFI_FIELDS & bit) {
+            wifi_changed = true;
+        } else {
+            config_changed = true;
+        }
     }
 
-    cJSON_Delete(root);
     httpd_resp_set_type(req, "application/json");
     if (wifi_changed) {
         httpd_resp_sendstr(req, "{\"status\":\"ok\",\"action\":\"reboot\"}");
@@ -425,46 +351,32 @@ static esp_err_t wifi_credentials_post_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    char body[WIFI_CRED_MAX_BODY + 1];
+    char body[WIFI_CRED_MAX_BODY];
     int received = httpd_req_recv(req, body, req->content_len);
     if (received <= 0) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read body");
         return ESP_FAIL;
     }
-    body[received] = '\0';
 
-    cJSON *root = cJSON_ParseWithLength(body, received);
-    if (!root) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    wifi_cred_body_t in;
+    uint32_t present;
+    char err[96];
+    if (json_fields_parse(body, received, WIFI_CRED_FIELDS, 2, &in, &present,
+                          err, sizeof(err)) != 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
         return ESP_FAIL;
     }
-
-    const cJSON *ssid = cJSON_GetObjectItemCaseSensitive(root, "ssid");
-    const cJSON *password = cJSON_GetObjectItemCaseSensitive(root, "password");
-    if (!cJSON_IsString(ssid) || ssid->valuestring[0] == '\0' ||
-        !cJSON_IsString(password)) {
-        cJSON_Delete(root);
+    if (present != (JSON_FIELD_BIT(0) | JSON_FIELD_BIT(1)) || in.ssid[0] == '\0') {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing ssid/password");
         return ESP_FAIL;
     }
 
-    size_t max_ssid_len = sizeof(((wifi_config_t *)0)->sta.ssid) - 1;
-    size_t max_pass_len = sizeof(((wifi_config_t *)0)->sta.password) - 1;
-    if (strlen(ssid->valuestring) > max_ssid_len ||
-        strlen(password->valuestring) > max_pass_len) {
-        cJSON_Delete(root);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "SSID/password too long");
-        return ESP_FAIL;
-    }
-
-    if (nvsman_set_str("wifi_ssid", ssid->valuestring) != 0 ||
-        nvsman_set_str("wifi_pass", password->valuestring) != 0) {
-        cJSON_Delete(root);
+    if (nvsman_set_str("wifi_ssid", in.ssid) != 0 ||
+        nvsman_set_str("wifi_pass", in.password) != 0) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to store credentials");
         return ESP_FAIL;
     }
 
-    cJSON_Delete(root);
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, "{\"status\":\"ok\",\"action\":\"reboot\"}");
 
@@ -473,55 +385,105 @@ static esp_err_t wifi_credentials_post_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+#define HTTP_ROUTE_SLOW  0x01     // Run on the worker pool (flash, DB, sleeps)
+#define HTTP_ROUTE_WS    0x02     // WebSocket endpoint
+
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    uint8_t flags;
+} http_route_t;
+
+static const http_route_t s_routes[] = {
+    { "/api/v1/system/stats",     HTTP_GET,  stats_get_handler,             0 },
+    { "/",                        HTTP_GET,  config_page_get_handler,       0 },
+    { "/api/v1/config",           HTTP_GET,  config_get_handler,            0 },
+    { "/api/v1/config",           HTTP_POST, config_post_handler,           HTTP_ROUTE_SLOW },
+    { "/api/v1/wifi/credentials", HTTP_POST, wifi_credentials_post_handler, HTTP_ROUTE_SLOW },
+    { "/api/v1/sensors",          HTTP_GET,  api_sensors_get_current,       0 },
+    { "/api/v1/sensors/history",  HTTP_GET,  api_sensors_get_history,       HTTP_ROUTE_SLOW },
+    { "/api/v1/ota/update",       HTTP_POST, api_ota_upload,                HTTP_ROUTE_SLOW },
+    { "/api/v1/files",            HTTP_POST, api_files_upload,              HTTP_ROUTE_SLOW },
+    { "/api/v1/files/*",          HTTP_GET,  api_files_download,            HTTP_ROUTE_SLOW },
+    { "/api/v1/files/*",          HTTP_DELETE, api_files_delete,            HTTP_ROUTE_SLOW },
+    { "/api/v1/documents/generate/registry",    HTTP_POST, api_documents_registry,    HTTP_ROUTE_SLOW },
+    { "/api/v1/documents/generate/certificate", HTTP_POST, api_documents_certificate, HTTP_ROUTE_SLOW },
+    { "/api/v1/documents/*",      HTTP_GET,  api_documents_download,        HTTP_ROUTE_SLOW },
+    { "/api/v1/animals",          HTTP_GET,  api_animals_get_all,           HTTP_ROUTE_SLOW },
+    { "/api/v1/breeding/cycles",  HTTP_GET,  api_breeding_get_cycles,       HTTP_ROUTE_SLOW },
+    { "/api/v1/sync",             HTTP_GET,  api_sync_get,                  HTTP_ROUTE_SLOW },
+    { "/api/v1/regulations/species", HTTP_GET, api_regulations_get_species, HTTP_ROUTE_SLOW },
+    { "/api/v1/species/suggest",  HTTP_GET,  api_regulations_suggest_species, 0 },
+    { "/api/v1/import",           HTTP_POST, api_bulk_import,               HTTP_ROUTE_SLOW },
+    { "/api/v1/export",           HTTP_GET,  api_bulk_export,               HTTP_ROUTE_SLOW },
+    { "/api/v1/ws",               HTTP_GET,  ws_handler,                    HTTP_ROUTE_WS },
+    { STATIC_FILES_PREFIX,        HTTP_GET,  static_files_get,              HTTP_ROUTE_SLOW },
+    { STATIC_FILES_PREFIX "/*",   HTTP_GET,  static_files_get,              HTTP_ROUTE_SLOW },
+};
+
+/* Worker entry point for slow routes; the worker opens the arena scope. */
+static esp_err_t http_run_slow(httpd_req_t *req)
+{
+    const http_route_t *route = req->user_ctx;
+    return route->handler(req);
+}
+
+/*
+ * Every route runs inside a request arena scope: cJSON and scratch
+ * buffers allocated by the handler are bump-allocated and dropped
+ * in one step when the handler returns.  Slow routes are handed to
+ * the worker pool instead and the server task returns at once.
+ */
+static esp_err_t http_dispatch(httpd_req_t *req)
+{
+    const http_route_t *route = req->user_ctx;
+    if (route->flags & HTTP_ROUTE_SLOW) {
+        return http_workers_submit(req, http_run_slow);
+    }
+    mem_arena_scope_begin();
+    esp_err_t ret = route->handler(req);
+    mem_arena_scope_end();
+    return ret;
+}
+
+// httpd keeps 3 sockets of its own (listener and control) next to the
+// client sockets; the outgoing clients need theirs too
+_Static_assert(CONFIG_APP_HTTP_MAX_OPEN_SOCKETS + 3 + CONFIG_APP_NET_CLIENT_SOCKETS <=
+               CONFIG_LWIP_MAX_SOCKETS, "raise LWIP_MAX_SOCKETS or lower APP_HTTP_MAX_OPEN_SOCKETS");
+
 int http_server_start(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_uri_handlers = sizeof(s_routes) / sizeof(s_routes[0]);
+    config.max_open_sockets = CONFIG_APP_HTTP_MAX_OPEN_SOCKETS;
+    config.uri_match_fn = httpd_uri_match_wildcard;
+#if CONFIG_APP_HTTP_LRU_PURGE
+    config.lru_purge_enable = true;
+#endif
+    static_files_init();
+    if (http_workers_start() != 0) {
+        ESP_LOGW(TAG_HTTP, "Worker pool unavailable, slow routes run inline");
+    }
     httpd_handle_t server = NULL;
     esp_err_t err = httpd_start(&server, &config);
     if (err != ESP_OK) {
         ESP_LOGE(TAG_HTTP, "Failed to start HTTP server: %s", esp_err_to_name(err));
         return -1;
     }
-    // Register the /api/v1/system/stats endpoint
-    httpd_uri_t stats_uri = {
-        .uri = "/api/v1/system/stats",
-        .method = HTTP_GET,
-        .handler = stats_get_handler,
-        .user_ctx = NULL
-    };
-    httpd_register_uri_handler(server, &stats_uri);
-
-    httpd_uri_t config_page_uri = {
-        .uri = "/",
-        .method = HTTP_GET,
-        .handler = config_page_get_handler,
-        .user_ctx = NULL
-    };
-    httpd_register_uri_handler(server, &config_page_uri);
-
-    httpd_uri_t config_get_uri = {
-        .uri = "/api/v1/config",
-        .method = HTTP_GET,
-        .handler = config_get_handler,
-        .user_ctx = NULL
-    };
-    httpd_register_uri_handler(server, &config_get_uri);
-
-    httpd_uri_t config_post_uri = {
-        .uri = "/api/v1/config",
-        .method = HTTP_POST,
-        .handler = config_post_handler,
-        .user_ctx = NULL
-    };
-    httpd_register_uri_handler(server, &config_post_uri);
-
-    httpd_uri_t wifi_creds_uri = {
-        .uri = "/api/v1/wifi/credentials",
-        .method = HTTP_POST,
-        .handler = wifi_credentials_post_handler,
-        .user_ctx = NULL
-    };
-    httpd_register_uri_handler(server, &wifi_creds_uri);
+    for (size_t i = 0; i < sizeof(s_routes) / sizeof(s_routes[0]); i++) {
+        httpd_uri_t uri = {
+            .uri = s_routes[i].uri,
+            .method = s_routes[i].method,
+            .handler = http_dispatch,
+            .user_ctx = (void *)&s_routes[i],
+#if CONFIG_HTTPD_WS_SUPPORT
+            .is_websocket = (s_routes[i].flags & HTTP_ROUTE_WS) != 0,
+#endif
+        };
+        httpd_register_uri_handler(server, &uri);
+    }
+    ws_init(server);
     ESP_LOGI(TAG_HTTP, "HTTP server started on port %d", config.server_port);
     return 0;
 }
@@ -0,0 +1,114 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include "http_workers.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+
+/*
+ * HTTP worker pool implementation.
+ *
+ * The server task detaches the request with
+ * httpd_req_async_handler_begin() and posts the copy to a bounded
+ * queue without waiting.  Each worker takes a job, runs the handler
+ * inside its own request arena scope and releases the socket with
+ * httpd_req_async_handler_complete().  A detached request keeps its
+ * socket open until then, so max_open_sockets has to leave room for
+ * workers + queue depth plus the fast clients.
+ */
+
+#define HTTP_WORKER_PRIO     5
+#define HTTP_RETRY_AFTER_S   "2"
+
+typedef struct {
+    httpd_req_t *req;
+    http_work_fn fn;
+} http_job_t;
+
+static QueueHandle_t s_queue = NULL;
+static atomic_uint s_busy;
+static atomic_uint s_completed;
+static atomic_uint s_rejected;
+
+static void worker_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        http_job_t job;
+        if (xQueueReceive(s_queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        atomic_fetch_add(&s_busy, 1);
+        mem_arena_scope_begin();
+        job.fn(job.req);
+        mem_arena_scope_end();
+        httpd_req_async_handler_complete(job.req);
+        atomic_fetch_sub(&s_busy, 1);
+        atomic_fetch_add(&s_completed, 1);
+    }
+}
+
+int http_workers_start(void)
+{
+    if (s_queue) {
+        return 0;
+    }
+    s_queue = xQueueCreate(CONFIG_APP_HTTP_QUEUE_DEPTH, sizeof(http_job_t));
+    if (!s_queue) {
+        return -1;
+    }
+    for (int i = 0; i < CONFIG_APP_HTTP_WORKERS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "http_work%d", i);
+        if (xTaskCreate(worker_task, name, CONFIG_APP_HTTP_WORKER_STACK, NULL,
+                        HTTP_WORKER_PRIO, NULL) != pdPASS) {
+            log_error("http", "Failed to create %s", name);
+            return -1;
+        }
+    }
+    log_info("http", "%d HTTP workers, queue depth %d", CONFIG_APP_HTTP_WORKERS,
+             CONFIG_APP_HTTP_QUEUE_DEPTH);
+    return 0;
+}
+
+esp_err_t http_workers_submit(httpd_req_t *req, http_work_fn fn)
+{
+    if (!s_queue) {
+        // Run inline, with the arena scope the worker would have opened
+        mem_arena_scope_begin();
+        esp_err_t err = fn(req);
+        mem_arena_scope_end();
+        return err;
+    }
+    httpd_req_t *copy = NULL;
+    if (httpd_req_async_handler_begin(req, &copy) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    http_job_t job = { .req = copy, .fn = fn };
+    if (xQueueSend(s_queue, &job, 0) != pdTRUE) {
+        httpd_req_async_handler_complete(copy);
+        atomic_fetch_add(&s_rejected, 1);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", HTTP_RETRY_AFTER_S);
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"error\":\"busy\"}");
+    }
+    return ESP_OK;
+}
+
+void http_workers_get_stats(http_workers_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    out->workers = CONFIG_APP_HTTP_WORKERS;
+    out->queue_depth = CONFIG_APP_HTTP_QUEUE_DEPTH;
+    out->queued = s_queue ? (uint32_t)uxQueueMessagesWaiting(s_queue) : 0;
+    out->busy = atomic_load(&s_busy);
+    out->completed = atomic_load(&s_completed);
+    out->rejected = atomic_load(&s_rejected);
+}
@@ -0,0 +1,36 @@
+#ifndef HTTP_WORKERS_H
+#define HTTP_WORKERS_H
+
+#include <stdint.h>
+#include "esp_http_server.h"
+
+/*
+ * Worker pool for slow HTTP handlers.
+ *
+ * esp_http_server runs every handler on its one server task.  Routes
+ * that touch flash, the database or sleep are handed to a small pool
+ * of worker tasks instead (httpd_req_async_handler_begin), so the
+ * server task keeps accepting and serving fast routes meanwhile.  At
+ * most CONFIG_APP_HTTP_WORKERS requests run at once and
+ * CONFIG_APP_HTTP_QUEUE_DEPTH wait; beyond that the request is
+ * answered 503 with Retry-After.
+ */
+
+typedef esp_err_t (*http_work_fn)(httpd_req_t *req);
+
+typedef struct {
+    uint32_t workers;
+    uint32_t queue_depth;
+    uint32_t queued;        // Waiting for a worker now
+    uint32_t busy;          // Running now
+    uint32_t completed;
+    uint32_t rejected;      // Answered 503
+} http_workers_stats_t;
+
+int http_workers_start(void);
+/* Run fn(req) on a worker.  Falls back to running inline when the
+ * pool is not started. */
+esp_err_t http_workers_submit(httpd_req_t *req, http_work_fn fn);
+void http_workers_get_stats(http_workers_stats_t *out);
+
+#endif /* HTTP_WORKERS_H */
@@ -0,0 +1,205 @@
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include "multipart.h"
+
+/*
+ * multipart/form-data parser (RFC 7578 / RFC 2046).
+ *
+ * Part bodies are scanned for "\r\n--boundary" one byte at a time.
+ * A boundary cannot contain CR, so a failed partial match never hides
+ * the start of another one: the matched bytes are plain data, taken
+ * from delim[] rather than kept from earlier input, and scanning
+ * resumes at the byte that broke the match.  Runs of data between
+ * candidate matches are passed on as slices of the caller's buffer.
+ *
+ * The body is parsed as if preceded by CRLF so the first delimiter,
+ * which has none, matches like the others.
+ */
+
+enum {
+    MP_PREAMBLE,
+    MP_AFTER_DELIM,     // "--" (last part) or CRLF (headers follow)
+    MP_HEADERS,
+    MP_BODY,
+    MP_DONE,
+    MP_ERROR
+};
+
+int multipart_init(multipart_parser_t *p, const char *content_type,
+                   const multipart_callbacks_t *cb, void *ctx)
+{
+    memset(p, 0, sizeof(*p));
+    if (!content_type || strncasecmp(content_type, "multipart/form-data", 19) != 0) {
+        return -1;
+    }
+    const char *b = content_type;
+    while (*b && strncasecmp(b, "boundary=", 9) != 0) {
+        b++;
+    }
+    if (!*b) {
+        return -1;
+    }
+    b += 9;
+    bool quoted = *b == '"';
+    b += quoted;
+    size_t n = strcspn(b, quoted ? "\"" : "; \t");
+    if (n == 0 || n > MULTIPART_BOUNDARY_MAX) {
+        return -1;
+    }
+    memcpy(p->delim, "\r\n--", 4);
+    memcpy(p->delim + 4, b, n);
+    p->delim_len = n + 4;
+    p->cb = cb;
+    p->ctx = ctx;
+    p->state = MP_PREAMBLE;
+    p->match = 2;
+    return 0;
+}
+
+/* Copies a Content-Disposition parameter (name, filename) into out. */
+static void disposition_param(const char *headers, const char *key, char *out, size_t len)
+{
+    out[0] = '\0';
+    const char *line = headers;
+    while (line && strncasecmp(line, "Content-Disposition:", 20) != 0) {
+        line = strstr(line, "\r\n");
+        line = line ? line + 2 : NULL;
+    }
+    if (!line) {
+        return;
+    }
+    const char *end = strstr(line, "\r\n");
+    size_t klen = strlen(key);
+    for (const char *p = strchr(line, ';'); p && p < end; p = strchr(p + 1, ';')) {
+        const char *t = p + 1;
+        while (*t == ' ' || *t == '\t') {
+            t++;
+        }
+        if (strncasecmp(t, key, klen) != 0 || t[klen] != '=') {
+            continue;
+        }
+        t += klen + 1;
+        bool quoted = *t == '"';
+        t += quoted;
+        size_t n = 0;
+        while (t + n < end && (quoted ? t[n] != '"' : t[n] != ';' && t[n] != ' ') && n + 1 < len) {
+            n++;
+        }
+        memcpy(out, t, n);
+        out[n] = '\0';
+        return;
+    }
+}
+
+static bool emit(multipart_parser_t *p, const void *data, size_t len)
+{
+    if (p->state == MP_BODY && len > 0 && p->cb->on_data &&
+        p->cb->on_data(p->ctx, data, len) != 0) {
+        p->state = MP_ERROR;
+        return false;
+    }
+    return true;
+}
+
+/* Body or preamble bytes from data[i]; returns where parsing stopped. */
+static size_t scan_body(multipart_parser_t *p, const uint8_t *data, size_t i, size_t len)
+{
+    size_t run = i;
+    for (; i < len; i++) {
+        uint8_t c = data[i];
+        if (c == (uint8_t)p->delim[p->match]) {
+            if (p->match == 0 && i > run && !emit(p, data + run, i - run)) {
+                return len;
+            }
+            if (++p->match < p->delim_len) {
+                continue;
+            }
+            p->match = 0;
+            if (p->state == MP_BODY && p->cb->on_part_end && p->cb->on_part_end(p->ctx) != 0) {
+                p->state = MP_ERROR;
+                return len;
+            }
+            p->state = MP_AFTER_DELIM;
+            p->pending = 0;
+            return i + 1;
+        }
+        if (p->match > 0) {
+            if (!emit(p, p->delim, p->match)) {
+                return len;
+            }
+            p->match = c == (uint8_t)p->delim[0];
+            run = p->match ? i + 1 : i;
+        }
+    }
+    if (p->match == 0 && i > run) {
+        emit(p, data + run, i - run);
+    }
+    return len;
+}
+
+int multipart_feed(multipart_parser_t *p, const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && p->state != MP_ERROR) {
+        switch (p->state) {
+        case MP_PREAMBLE:
+        case MP_BODY:
+            i = scan_body(p, data, i, len);
+            break;
+        case MP_AFTER_DELIM: {
+            char c = (char)data[i++];
+            if (p->pending == 0 && (c == ' ' || c == '\t')) {
+                break;      // Transport padding
+            }
+            p->after[p->pending++] = c;
+            if (p->pending < 2) {
+                break;
+            }
+            if (p->after[0] == '-' && p->after[1] == '-') {
+                p->state = MP_DONE;
+            } else if (p->after[0] == '\r' && p->after[1] == '\n') {
+                p->state = MP_HEADERS;
+                p->header_len = 0;
+            } else {
+                p->state = MP_ERROR;
+            }
+            break;
+        }
+        case MP_HEADERS: {
+            if (p->header_len + 1 >= sizeof(p->header)) {
+                p->state = MP_ERROR;
+                break;
+            }
+            p->header[p->header_len++] = (char)data[i++];
+            p->header[p->header_len] = '\0';
+            size_t n = p->header_len;
+            bool end = (n == 2 && memcmp(p->header, "\r\n", 2) == 0) ||
+                       (n >= 4 && memcmp(p->header + n - 4, "\r\n\r\n", 4) == 0);
+            if (!end) {
+                break;
+            }
+            char name[MULTIPART_NAME_MAX];
+            char filename[MULTIPART_NAME_MAX * 2];
+            disposition_param(p->header, "name", name, sizeof(name));
+            disposition_param(p->header, "filename", filename, sizeof(filename));
+            p->state = MP_BODY;
+            p->match = 0;
+            if (p->cb->on_part && p->cb->on_part(p->ctx, name, filename) != 0) {
+                p->state = MP_ERROR;
+            }
+            break;
+        }
+        case MP_DONE:
+            return 0;       // Epilogue is ignored
+        default:
+            break;
+        }
+    }
+    return p->state == MP_ERROR ? -1 : 0;
+}
+
+int multipart_finish(const multipart_parser_t *p)
+{
+    return p->state == MP_DONE ? 0 : -1;
+}
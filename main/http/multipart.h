@@ -0,0 +1,49 @@
+#ifndef MULTIPART_H
+#define MULTIPART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Streaming multipart/form-data parser.
+ *
+ * The body is fed in whatever pieces httpd_req_recv() returns; part
+ * data is handed to the callbacks as it is found and never collected,
+ * so a part of any size costs the fixed size of the parser.  Any
+ * callback may return non-zero to stop parsing.
+ */
+
+#define MULTIPART_BOUNDARY_MAX  70      // RFC 2046
+#define MULTIPART_HEADER_MAX    256     // Header block of one part
+#define MULTIPART_NAME_MAX      32
+
+typedef struct {
+    int (*on_part)(void *ctx, const char *name, const char *filename);
+    int (*on_data)(void *ctx, const uint8_t *data, size_t len);
+    int (*on_part_end)(void *ctx);
+} multipart_callbacks_t;
+
+typedef struct {
+    const multipart_callbacks_t *cb;
+    void *ctx;
+    char delim[MULTIPART_BOUNDARY_MAX + 5];     // "\r\n--" boundary
+    size_t delim_len;
+    size_t match;                               // Delimiter bytes matched so far
+    char header[MULTIPART_HEADER_MAX];
+    size_t header_len;
+    uint8_t state;
+    uint8_t pending;                            // Bytes seen after a delimiter
+    char after[2];
+} multipart_parser_t;
+
+/* Takes the request Content-Type; -1 when it is not multipart. */
+int multipart_init(multipart_parser_t *p, const char *content_type,
+                   const multipart_callbacks_t *cb, void *ctx);
+
+/* -1 on malformed input or when a callback stopped the parser. */
+int multipart_feed(multipart_parser_t *p, const uint8_t *data, size_t len);
+
+/* -1 unless the closing delimiter has been seen. */
+int multipart_finish(const multipart_parser_t *p);
+
+#endif /* MULTIPART_H */
@@ -1,10 +1,10 @@
 #include <stdio.h>
 #include "api_animals.h"
+#include "api_list.h"
 
-int api_animals_get_all(void)
+esp_err_t api_animals_get_all(httpd_req_t *req)
 {
-    printf("[api/animals] GET all stub called\n");
-    return 0;
+    return api_list_send(req, &DB_LIST_ANIMALS, "animals");
 }
 
 int api_animals_create(void)
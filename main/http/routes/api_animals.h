@@ -9,7 +9,11 @@
  * serialise responses to JSON.
  */
 
-int api_animals_get_all(void);
+#include "esp_http_server.h"
+
+/* GET /api/v1/animals?limit=&sort=updated|species&fields=&after=:
+ * one page of animals, see database/db_list.h. */
+esp_err_t api_animals_get_all(httpd_req_t *req);
 int api_animals_create(void);
 int api_animals_get(const char *id);
 int api_animals_update(const char *id);
@@ -1,10 +1,10 @@
 #include <stdio.h>
 #include "api_breeding.h"
+#include "api_list.h"
 
-int api_breeding_get_cycles(void)
+esp_err_t api_breeding_get_cycles(httpd_req_t *req)
 {
-    printf("[api/breeding] GET cycles stub called\n");
-    return 0;
+    return api_list_send(req, &DB_LIST_CYCLES, "breeding_cycles");
 }
 
 int api_breeding_create_cycle(void)
@@ -1,7 +1,11 @@
 #ifndef API_BREEDING_H
 #define API_BREEDING_H
 
-int api_breeding_get_cycles(void);
+#include "esp_http_server.h"
+
+/* GET /api/v1/breeding/cycles?limit=&sort=created&fields=&after=:
+ * one page of cycles, newest first, see database/db_list.h. */
+esp_err_t api_breeding_get_cycles(httpd_req_t *req);
 int api_breeding_create_cycle(void);
 int api_breeding_get_cycle(const char *id);
 int api_breeding_record_mating(const char *id);
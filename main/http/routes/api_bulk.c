@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "api_bulk.h"
+
+/*
+ * Bulk import/export endpoints.
+ *
+ * Import reads the body in BULK_RECV_CHUNK pieces and hands each one
+ * to the bulk importer, which splits it into rows and inserts them in
+ * batched transactions; nothing is buffered beyond one chunk and one
+ * batch, whatever the size of the file.  The reply counts committed and
+ * rejected rows and lists the first rejected ones with their line, so
+ * a spreadsheet can be fixed and only the failed rows sent again.
+ * Both directions need the bearer token: an export is the whole
+ * collection and an import writes to it.
+ *
+ * Export streams the dataset as chunked (and, when accepted, gzipped)
+ * output straight from a database cursor.  As with documents, a
+ * failure after the first chunk aborts the connection instead of
+ * ending the body, so a truncated export never looks complete.
+ */
+
+#include "cJSON.h"
+#include "sdkconfig.h"
+#include "http_auth.h"
+#include "http_compress.h"
+#include "bulk/bulk.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+
+#define BULK_RECV_CHUNK    4096
+#define BULK_RECV_RETRIES  3
+#define BULK_QUERY_MAX     96
+#define BULK_BATCH_MAX     5000
+#define BULK_NAME_MAX      24
+
+typedef struct {
+    httpd_req_t *req;
+    http_stream_t stream;
+    bool started;
+} export_target_t;
+
+/* dataset=<name> into name; format=, else a Content-Type naming ndjson */
+static const bulk_dataset_t *query_dataset(const char *query, char name[BULK_NAME_MAX],
+                                           bulk_format_t *format, const char *content_type)
+{
+    char value[16];
+    if (httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+        *format = strcmp(value, "ndjson") == 0 ? BULK_FORMAT_NDJSON : BULK_FORMAT_CSV;
+    } else {
+        *format = content_type && strstr(content_type, "ndjson") ? BULK_FORMAT_NDJSON : BULK_FORMAT_CSV;
+    }
+    if (httpd_query_key_value(query, "dataset", name, BULK_NAME_MAX) != ESP_OK) {
+        return NULL;
+    }
+    return bulk_find_dataset(name);
+}
+
+static esp_err_t send_report(httpd_req_t *req, const char *dataset, const bulk_report_t *r,
+                             const char *status)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "dataset", dataset);
+    cJSON_AddNumberToObject(root, "imported", r->imported);
+    cJSON_AddNumberToObject(root, "failed", r->failed);
+    if (r->error[0]) {
+        cJSON_AddStringToObject(root, "error", r->error);
+    }
+    cJSON *errors = cJSON_AddArrayToObject(root, "errors");
+    for (int i = 0; i < r->error_count; i++) {
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "line", r->errors[i].line);
+        cJSON_AddStringToObject(item, "message", r->errors[i].message);
+        cJSON_AddItemToArray(errors, item);
+    }
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON encode failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+    cJSON_free(json_str);
+    return ESP_OK;
+}
+
+esp_err_t api_bulk_import(httpd_req_t *req)
+{
+    if (!http_authorized(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Bearer token required");
+        return ESP_FAIL;
+    }
+    char query[BULK_QUERY_MAX] = { 0 };
+    char content_type[64] = { 0 };
+    char name[BULK_NAME_MAX];
+    char value[16];
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type));
+    bulk_format_t format;
+    const bulk_dataset_t *ds = query_dataset(query, name, &format, content_type);
+    if (!ds) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown dataset");
+        return ESP_FAIL;
+    }
+    if (req->content_len == 0) {
+        httpd_resp_send_err(req, HTTPD_411_LENGTH_REQUIRED, "Empty import");
+        return ESP_FAIL;
+    }
+    if (req->content_len > CONFIG_APP_UPLOAD_MAX_SIZE) {
+        httpd_resp_set_status(req, "413 Payload Too Large");
+        httpd_resp_sendstr(req, "Import too large");
+        return ESP_FAIL;
+    }
+    uint32_t batch = CONFIG_APP_IMPORT_BATCH_ROWS;
+    if (httpd_query_key_value(query, "batch", value, sizeof(value)) == ESP_OK) {
+        batch = (uint32_t)strtoul(value, NULL, 10);
+        batch = batch < 1 ? 1 : batch > BULK_BATCH_MAX ? BULK_BATCH_MAX : batch;
+    }
+
+    bulk_report_t *report = mem_arena_malloc(sizeof(*report));
+    char *buf = mem_arena_malloc(BULK_RECV_CHUNK);
+    if (!report || !buf) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    bulk_import_t *imp = bulk_import_begin(ds, format, batch, report);
+    if (!imp) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Database unavailable");
+        return ESP_FAIL;
+    }
+
+    bool recv_failed = false;
+    size_t received = 0;
+    int retries = 0;
+    while (received < req->content_len) {
+        size_t want = req->content_len - received;
+        int n = httpd_req_recv(req, buf, want < BULK_RECV_CHUNK ? want : BULK_RECV_CHUNK);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++retries <= BULK_RECV_RETRIES) {
+            continue;
+        }
+        if (n <= 0) {
+            recv_failed = true;
+            break;
+        }
+        retries = 0;
+        received += (size_t)n;
+        if (bulk_import_feed(imp, buf, (size_t)n) != 0) {
+            break;
+        }
+    }
+    // Batches already committed stay; the report says how many
+    int rc = bulk_import_end(imp, recv_failed);
+    if (recv_failed) {
+        snprintf(report->error, sizeof(report->error), "Receive failed after %u bytes",
+                 (unsigned)received);
+        return send_report(req, name, report, "400 Bad Request");
+    }
+    return send_report(req, name, report, rc == 0 ? "200 OK" : "422 Unprocessable Entity");
+}
+
+static int http_sink(void *ctx, const void *data, size_t len)
+{
+    export_target_t *t = ctx;
+    if (!t->started) {
+        http_stream_begin(&t->stream, t->req);
+        t->started = true;
+    }
+    return http_stream_write(&t->stream, data, len) == ESP_OK ? 0 : -1;
+}
+
+esp_err_t api_bulk_export(httpd_req_t *req)
+{
+    if (!http_authorized(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Bearer token required");
+        return ESP_FAIL;
+    }
+    char query[BULK_QUERY_MAX] = { 0 };
+    char name[BULK_NAME_MAX];
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    bulk_format_t format;
+    const bulk_dataset_t *ds = query_dataset(query, name, &format, NULL);
+    if (!ds) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown dataset");
+        return ESP_FAIL;
+    }
+    doc_out_t *out = mem_arena_malloc(sizeof(*out));
+    if (!out) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    char disposition[64];
+    snprintf(disposition, sizeof(disposition), "attachment; filename=\"%s.%s\"", name,
+             format == BULK_FORMAT_CSV ? "csv" : "ndjson");
+    httpd_resp_set_type(req, format == BULK_FORMAT_CSV ? "text/csv; charset=utf-8" : "application/x-ndjson");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+    export_target_t t = { .req = req };
+    doc_out_init(out, http_sink, &t);
+    log_info("bulk", "Export %s as %s", name, format == BULK_FORMAT_CSV ? "CSV" : "NDJSON");
+    int rc = bulk_export(out, ds, format);
+    if (!t.started) {
+        if (rc == 0) {
+            return httpd_resp_send(req, NULL, 0);      // Empty NDJSON dataset
+        }
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Database unavailable");
+        return ESP_FAIL;
+    }
+    if (rc != 0) {
+        t.stream.err = ESP_FAIL;    // Drop the connection, no final chunk
+    }
+    esp_err_t err = http_stream_end(&t.stream);
+    return rc == 0 ? err : ESP_FAIL;
+}
@@ -0,0 +1,13 @@
+#ifndef API_BULK_H
+#define API_BULK_H
+
+#include "esp_http_server.h"
+
+/* POST /api/v1/import?dataset=animals|breeding_cycles|readings
+ * [&format=csv|ndjson][&batch=N]: body is the CSV or NDJSON; replies
+ * with the counts and the first row errors. */
+esp_err_t api_bulk_import(httpd_req_t *req);
+/* GET /api/v1/export?dataset=...[&format=csv|ndjson] */
+esp_err_t api_bulk_export(httpd_req_t *req);
+
+#endif /* API_BULK_H */
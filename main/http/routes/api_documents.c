@@ -1,14 +1,236 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "api_documents.h"
 
-int api_documents_generate(void)
+/*
+ * Document generation endpoints.
+ *
+ * Documents are rendered straight into the response as chunked
+ * (and, when accepted, gzipped) output, one DOC_OUT_BUF block at a
+ * time, so the size of the collection never shows up in RAM.  With
+ * store=1 the same bytes go to the blob store instead and the reply
+ * names the stored document, which can then be fetched later, with
+ * ranges, from /api/v1/documents/<id>; storing needs the bearer
+ * token, as uploads do.
+ *
+ * The status line is only committed by the first block of output, so
+ * failures that happen before it (unknown animal, database down) still
+ * get a proper error response.  A failure after that aborts the
+ * connection rather than ending the chunked body, so a client never
+ * takes a truncated document for a complete one.
+ */
+
+#include "http_auth.h"
+#include "http_compress.h"
+#include "api_files.h"
+#include "documents/documents.h"
+#include "storage/blob_store.h"
+#include "utils/json_fields.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+
+#define DOC_URI_PREFIX  "/api/v1/documents/"
+#define DOC_BODY_MAX    2048
+#define DOC_QUERY_MAX   96
+#define DOC_NAME_MAX    128     // Longest name, permit or price in a request
+#define DOC_ADDRESS_MAX 256
+
+typedef int (*render_fn)(doc_out_t *out, doc_format_t format, const void *arg);
+
+typedef struct {
+    httpd_req_t *req;
+    http_stream_t stream;
+    bool started;
+    blob_writer_t *blob;
+} doc_target_t;
+
+static int http_sink(void *ctx, const void *data, size_t len)
+{
+    doc_target_t *t = ctx;
+    if (!t->started) {
+        http_stream_begin(&t->stream, t->req);
+        t->started = true;
+    }
+    return http_stream_write(&t->stream, data, len) == ESP_OK ? 0 : -1;
+}
+
+static int blob_sink(void *ctx, const void *data, size_t len)
+{
+    doc_target_t *t = ctx;
+    return blob_write(t->blob, data, len);
+}
+
+static int render_registry(doc_out_t *out, doc_format_t format, const void *arg)
+{
+    return doc_render_registry(out, format, *(const int *)arg);
+}
+
+static int render_cession(doc_out_t *out, doc_format_t format, const void *arg)
 {
-    printf("[api/documents] POST generate stub called\n");
-    return 0;
+    return doc_render_cession(out, format, arg);
 }
 
-int api_documents_download(const char *id)
+static esp_err_t store_document(httpd_req_t *req, doc_out_t *out, doc_target_t *t, doc_format_t format,
+                                render_fn render, const void *arg, httpd_err_code_t fail_code,
+                                const char *fail_msg)
 {
-    printf("[api/documents] GET download id=%s stub called\n", id);
-    return 0;
-}
\ No newline at end of file
+    t->blob = blob_begin();
+    if (!t->blob) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Storage unavailable");
+        return ESP_FAIL;
+    }
+    doc_out_init(out, blob_sink, t);
+    if (render(out, format, arg) != 0) {
+        blob_abort(t->blob);
+        httpd_resp_send_err(req, out->offset == 0 ? fail_code : HTTPD_500_INTERNAL_SERVER_ERROR,
+                            out->offset == 0 ? fail_msg : "Storage full");
+        return ESP_FAIL;
+    }
+    char id[BLOB_ID_LEN + 1];
+    uint32_t size;
+    if (blob_commit(t->blob, id, NULL, &size) != 0) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Storage full");
+        return ESP_FAIL;
+    }
+    char body[128];
+    snprintf(body, sizeof(body), "{\"id\":\"%s\",\"size\":%u,\"url\":\"" DOC_URI_PREFIX "%s\"}", id,
+             (unsigned)size, id);
+    httpd_resp_set_status(req, "201 Created");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, body);
+}
+
+static esp_err_t generate(httpd_req_t *req, doc_format_t format, bool store, const char *name,
+                          render_fn render, const void *arg, httpd_err_code_t fail_code,
+                          const char *fail_msg)
+{
+    // Storing writes to flash: same rule as uploads
+    if (store && !http_authorized(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Bearer token required");
+        return ESP_FAIL;
+    }
+    doc_out_t *out = mem_arena_malloc(sizeof(*out));
+    if (!out) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    doc_target_t t = { .req = req };
+    if (store) {
+        return store_document(req, out, &t, format, render, arg, fail_code, fail_msg);
+    }
+
+    char disposition[80];
+    snprintf(disposition, sizeof(disposition), "attachment; filename=\"%s.%s\"", name,
+             format == DOC_FORMAT_PDF ? "pdf" : "csv");
+    httpd_resp_set_type(req, format == DOC_FORMAT_PDF ? "application/pdf" : "text/csv; charset=utf-8");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+    doc_out_init(out, http_sink, &t);
+    int rc = render(out, format, arg);
+    if (!t.started) {
+        httpd_resp_send_err(req, fail_code, fail_msg);
+        return ESP_FAIL;
+    }
+    if (rc != 0) {
+        t.stream.err = ESP_FAIL;    // Drop the connection, no final chunk
+    }
+    esp_err_t err = http_stream_end(&t.stream);
+    return rc == 0 ? err : ESP_FAIL;
+}
+
+static doc_format_t parse_format(const char *value)
+{
+    return value && strcmp(value, "csv") == 0 ? DOC_FORMAT_CSV : DOC_FORMAT_PDF;
+}
+
+esp_err_t api_documents_registry(httpd_req_t *req)
+{
+    char query[DOC_QUERY_MAX] = { 0 };
+    char value[16];
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    int year = tm.tm_year + 1900;
+    if (httpd_query_key_value(query, "year", value, sizeof(value)) == ESP_OK) {
+        year = atoi(value);
+    }
+    if (year < 2000 || year > 2100) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid year");
+        return ESP_FAIL;
+    }
+    bool have_format = httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK;
+    doc_format_t format = parse_format(have_format ? value : NULL);
+    bool store = httpd_query_key_value(query, "store", value, sizeof(value)) == ESP_OK &&
+                 strcmp(value, "1") == 0;
+
+    char name[32];
+    snprintf(name, sizeof(name), "registre-%d", year);
+    log_info("documents", "Registry %d as %s", year, format == DOC_FORMAT_PDF ? "PDF" : "CSV");
+    return generate(req, format, store, name, render_registry, &year,
+                    HTTPD_500_INTERNAL_SERVER_ERROR, "Database unavailable");
+}
+
+typedef struct {
+    doc_cession_t cession;
+    const char *format;
+    bool store;
+} cession_body_t;
+
+static const json_field_t CESSION_FIELDS[] = {
+    JSON_STR_REF("animal_id", cession_body_t, cession.animal_id, 36),
+    JSON_STR_REF("seller.name", cession_body_t, cession.seller_name, DOC_NAME_MAX),
+    JSON_STR_REF("seller.address", cession_body_t, cession.seller_address, DOC_ADDRESS_MAX),
+    JSON_STR_REF("seller.permit", cession_body_t, cession.seller_permit, DOC_NAME_MAX),
+    JSON_STR_REF("buyer.name", cession_body_t, cession.buyer_name, DOC_NAME_MAX),
+    JSON_STR_REF("buyer.address", cession_body_t, cession.buyer_address, DOC_ADDRESS_MAX),
+    JSON_STR_REF("buyer.permit", cession_body_t, cession.buyer_permit, DOC_NAME_MAX),
+    JSON_INT("date", cession_body_t, cession.date, 0, 4102444800LL),   // Up to 2100
+    JSON_STR_REF("price", cession_body_t, cession.price, DOC_NAME_MAX),
+    JSON_STR_REF("format", cession_body_t, format, 8),
+    JSON_BOOL("store", cession_body_t, store),
+};
+
+esp_err_t api_documents_certificate(httpd_req_t *req)
+{
+    if (req->content_len <= 0 || req->content_len > DOC_BODY_MAX) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid content length");
+        return ESP_FAIL;
+    }
+    char *body = mem_arena_malloc(req->content_len + 1);
+    if (!body) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int n = httpd_req_recv(req, body + received, req->content_len - received);
+        if (n <= 0) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read body");
+            return ESP_FAIL;
+        }
+        received += (size_t)n;
+    }
+    cession_body_t in = { 0 };
+    uint32_t present;
+    char err[96];
+    if (json_fields_parse(body, received, CESSION_FIELDS,
+                          sizeof(CESSION_FIELDS) / sizeof(CESSION_FIELDS[0]), &in, &present,
+                          err, sizeof(err)) != 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
+        return ESP_FAIL;
+    }
+    if (!in.cession.animal_id || !in.cession.buyer_name) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "animal_id and buyer.name are required");
+        return ESP_FAIL;
+    }
+    return generate(req, parse_format(in.format), in.store, "attestation-cession", render_cession,
+                    &in.cession, HTTPD_404_NOT_FOUND, "Unknown animal");
+}
+
+esp_err_t api_documents_download(httpd_req_t *req)
+{
+    return api_files_send_blob(req, req->uri + strlen(DOC_URI_PREFIX));
+}
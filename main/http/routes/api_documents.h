@@ -1,7 +1,15 @@
 #ifndef API_DOCUMENTS_H
 #define API_DOCUMENTS_H
 
-int api_documents_generate(void);
-int api_documents_download(const char *id);
+#include "esp_http_server.h"
 
-#endif /* API_DOCUMENTS_H */
\ No newline at end of file
+/* POST /api/v1/documents/generate/registry?year=&format=pdf|csv[&store=1] */
+esp_err_t api_documents_registry(httpd_req_t *req);
+/* POST /api/v1/documents/generate/certificate: JSON body with
+ * animal_id, seller{name,address,permit}, buyer{...}, date, price,
+ * format and store */
+esp_err_t api_documents_certificate(httpd_req_t *req);
+/* GET /api/v1/documents/<id>: a document generated with store=1 */
+esp_err_t api_documents_download(httpd_req_t *req);
+
+#endif /* API_DOCUMENTS_H */
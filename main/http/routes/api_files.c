@@ -0,0 +1,331 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "api_files.h"
+
+/*
+ * Photo and document upload/download.
+ *
+ * Uploads are multipart/form-data read in FILES_RECV_CHUNK pieces and
+ * fed through the streaming parser: every file part goes straight into
+ * a blob writer, so a 5 MB vet PDF needs the receive buffer and parser
+ * state, not 5 MB of contiguous heap.  The content type is sniffed
+ * from the first bytes rather than trusted from the client, and again
+ * on download, so nothing but the blob itself has to be stored.
+ *
+ * Blobs never change once written, which makes downloads immutable
+ * cache entries keyed by their id; byte ranges are honoured so large
+ * files can be resumed or previewed.
+ *
+ * Uploads and deletes need a Bearer token, downloads do not (ids are
+ * unguessable digests).  A blob is only unlinked once no animal_photos
+ * row points at it: identical content uploaded twice shares one id.
+ */
+
+#include "cJSON.h"
+#include "sdkconfig.h"
+#include "multipart.h"
+#include "http_auth.h"
+#include "http_cache.h"
+#include "static_files.h"
+#include "database/db_animals.h"
+#include "storage/blob_store.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+
+#define FILES_URI_PREFIX   "/api/v1/files/"
+#define FILES_RECV_CHUNK   4096
+#define FILES_RECV_RETRIES 3
+#define FILES_MAX_PARTS    8
+#define FILES_NAME_MAX     64
+#define FILES_SNIFF_LEN    12
+#define FILES_TYPE_MAX     128
+#define FILES_QUERY_MAX    128
+
+typedef struct {
+    char id[BLOB_ID_LEN + 1];
+    char sha256[65];
+    uint32_t size;
+    const char *type;
+    char name[FILES_NAME_MAX];
+} stored_file_t;
+
+typedef struct {
+    blob_writer_t *blob;        // File part being received
+    uint8_t head[FILES_SNIFF_LEN];
+    size_t head_len;
+    char name[FILES_NAME_MAX];
+    bool in_animal;
+    char animal_id[65];
+    size_t animal_len;
+    stored_file_t files[FILES_MAX_PARTS];
+    int count;
+} upload_t;
+
+static const char *sniff_type(const uint8_t *p, size_t n)
+{
+    if (n >= 3 && p[0] == 0xFF && p[1] == 0xD8 && p[2] == 0xFF) {
+        return "image/jpeg";
+    }
+    if (n >= 8 && memcmp(p, "\x89PNG\r\n\x1a\n", 8) == 0) {
+        return "image/png";
+    }
+    if (n >= 12 && memcmp(p, "RIFF", 4) == 0 && memcmp(p + 8, "WEBP", 4) == 0) {
+        return "image/webp";
+    }
+    if (n >= 12 && memcmp(p + 4, "ftyp", 4) == 0 &&
+        (memcmp(p + 8, "heic", 4) == 0 || memcmp(p + 8, "mif1", 4) == 0)) {
+        return "image/heic";
+    }
+    if (n >= 4 && memcmp(p, "GIF8", 4) == 0) {
+        return "image/gif";
+    }
+    if (n >= 5 && memcmp(p, "%PDF-", 5) == 0) {
+        return "application/pdf";
+    }
+    if (n >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0) {
+        return "text/csv; charset=utf-8";      // Generated documents
+    }
+    return "application/octet-stream";
+}
+
+static int on_part(void *ctx, const char *name, const char *filename)
+{
+    upload_t *u = ctx;
+    if (filename[0] == '\0') {
+        u->in_animal = strcmp(name, "animal_id") == 0;
+        return 0;       // Other plain fields are ignored
+    }
+    if (u->count == FILES_MAX_PARTS) {
+        log_warn("files", "More than %d files in one upload", FILES_MAX_PARTS);
+        return -1;
+    }
+    u->blob = blob_begin();
+    u->head_len = 0;
+    snprintf(u->name, sizeof(u->name), "%s", filename);
+    return u->blob ? 0 : -1;
+}
+
+static int on_data(void *ctx, const uint8_t *data, size_t len)
+{
+    upload_t *u = ctx;
+    if (u->blob) {
+        size_t take = FILES_SNIFF_LEN - u->head_len;
+        take = take < len ? take : len;
+        memcpy(u->head + u->head_len, data, take);
+        u->head_len += take;
+        return blob_write(u->blob, data, len);
+    }
+    if (u->in_animal) {
+        size_t room = sizeof(u->animal_id) - 1 - u->animal_len;
+        if (len > room) {
+            return -1;
+        }
+        memcpy(u->animal_id + u->animal_len, data, len);
+        u->animal_len += len;
+    }
+    return 0;
+}
+
+static int on_part_end(void *ctx)
+{
+    upload_t *u = ctx;
+    u->in_animal = false;
+    if (!u->blob) {
+        return 0;
+    }
+    stored_file_t *f = &u->files[u->count];
+    uint8_t digest[32];
+    int rc = blob_commit(u->blob, f->id, digest, &f->size);
+    u->blob = NULL;
+    if (rc != 0) {
+        return -1;
+    }
+    for (int i = 0; i < 32; i++) {
+        snprintf(f->sha256 + 2 * i, 3, "%02x", digest[i]);
+    }
+    f->type = sniff_type(u->head, u->head_len);
+    memcpy(f->name, u->name, sizeof(f->name));
+    u->count++;
+    return 0;
+}
+
+static const multipart_callbacks_t MULTIPART_CB = {
+    .on_part = on_part,
+    .on_data = on_data,
+    .on_part_end = on_part_end,
+};
+
+static esp_err_t send_result(httpd_req_t *req, const upload_t *u)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *files = cJSON_AddArrayToObject(root, "files");
+    for (int i = 0; i < u->count; i++) {
+        const stored_file_t *f = &u->files[i];
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "id", f->id);
+        cJSON_AddStringToObject(item, "sha256", f->sha256);
+        cJSON_AddNumberToObject(item, "size", f->size);
+        cJSON_AddStringToObject(item, "type", f->type);
+        cJSON_AddStringToObject(item, "name", f->name);
+        cJSON_AddItemToArray(files, item);
+    }
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON encode failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_status(req, "201 Created");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+    cJSON_free(json_str);
+    return ESP_OK;
+}
+
+esp_err_t api_files_upload(httpd_req_t *req)
+{
+    if (!http_authorized(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Bearer token required");
+        return ESP_FAIL;
+    }
+    if (req->content_len == 0) {
+        httpd_resp_send_err(req, HTTPD_411_LENGTH_REQUIRED, "Empty upload");
+        return ESP_FAIL;
+    }
+    if (req->content_len > CONFIG_APP_UPLOAD_MAX_SIZE) {
+        httpd_resp_set_status(req, "413 Payload Too Large");
+        httpd_resp_sendstr(req, "Upload too large");
+        return ESP_FAIL;
+    }
+    char content_type[FILES_TYPE_MAX] = { 0 };
+    httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type));
+
+    upload_t *u = mem_arena_malloc(sizeof(*u));
+    multipart_parser_t *parser = mem_arena_malloc(sizeof(*parser));
+    uint8_t *buf = mem_arena_malloc(FILES_RECV_CHUNK);
+    if (!u || !parser || !buf) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    memset(u, 0, sizeof(*u));
+    if (multipart_init(parser, content_type, &MULTIPART_CB, u) != 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "multipart/form-data expected");
+        return ESP_FAIL;
+    }
+
+    const char *error = NULL;
+    size_t received = 0;
+    int retries = 0;
+    while (received < req->content_len && !error) {
+        size_t want = req->content_len - received;
+        int n = httpd_req_recv(req, (char *)buf, want < FILES_RECV_CHUNK ? want : FILES_RECV_CHUNK);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++retries <= FILES_RECV_RETRIES) {
+            continue;
+        }
+        if (n <= 0) {
+            error = "Receive failed";
+            break;
+        }
+        retries = 0;
+        received += (size_t)n;
+        if (multipart_feed(parser, buf, (size_t)n) != 0) {
+            error = u->blob ? "Storage full or write error" : "Malformed upload";
+        }
+    }
+    if (!error && multipart_finish(parser) != 0) {
+        error = "Malformed upload";
+    }
+    if (!error && u->count == 0) {
+        error = "No file part";
+    }
+    if (error) {
+        // Blobs already committed stay: identical content may be in use
+        blob_abort(u->blob);
+        log_error("files", "Upload failed after %u bytes: %s", (unsigned)received, error);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        return ESP_FAIL;
+    }
+
+    if (u->animal_len > 0) {
+        u->animal_id[u->animal_len] = '\0';
+        for (int i = 0; i < u->count; i++) {
+            const stored_file_t *f = &u->files[i];
+            if (db_animal_add_photo(u->animal_id, f->id, f->type, f->size) != 0) {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Cannot attach files to this animal");
+                return ESP_FAIL;
+            }
+        }
+    }
+    log_info("files", "Stored %d file(s), %u bytes received", u->count, (unsigned)received);
+    return send_result(req, u);
+}
+
+esp_err_t api_files_download(httpd_req_t *req)
+{
+    return api_files_send_blob(req, req->uri + strlen(FILES_URI_PREFIX));
+}
+
+esp_err_t api_files_delete(httpd_req_t *req)
+{
+    if (!http_authorized(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Bearer token required");
+        return ESP_FAIL;
+    }
+    const char *id = req->uri + strlen(FILES_URI_PREFIX);
+    char blob_id[BLOB_ID_LEN + 1];
+    uint32_t size;
+    if (strcspn(id, "?#") != BLOB_ID_LEN || blob_stat(id, &size) != 0) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such file");
+        return ESP_FAIL;
+    }
+    memcpy(blob_id, id, BLOB_ID_LEN);
+    blob_id[BLOB_ID_LEN] = '\0';
+
+    char query[FILES_QUERY_MAX] = { 0 };
+    char animal_id[65];
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    bool one_animal = httpd_query_key_value(query, "animal_id", animal_id, sizeof(animal_id)) == ESP_OK;
+
+    int remaining = db_animal_remove_photo(one_animal ? animal_id : NULL, blob_id);
+    if (remaining < 0) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Database error");
+        return ESP_FAIL;
+    }
+    if (remaining == 0 && blob_remove(blob_id) != 0) {
+        log_warn("files", "Cannot remove blob %s", blob_id);
+    } else if (remaining == 0) {
+        log_info("files", "Removed blob %s (%u bytes)", blob_id, (unsigned)size);
+    }
+    httpd_resp_set_status(req, "204 No Content");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+esp_err_t api_files_send_blob(httpd_req_t *req, const char *id)
+{
+    char path[sizeof(BLOB_ROOT) + BLOB_ID_LEN + 2];
+    uint32_t size;
+    if (strcspn(id, "?#") < BLOB_ID_LEN || blob_path(id, path, sizeof(path)) != 0 ||
+        blob_stat(id, &size) != 0) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such file");
+        return ESP_FAIL;
+    }
+
+    http_validator_t validator = { .last_modified = "" };
+    snprintf(validator.etag, sizeof(validator.etag), "\"%.*s\"", BLOB_ID_LEN, id);
+    httpd_resp_set_hdr(req, "Cache-Control", HTTP_CACHE_IMMUTABLE);
+    if (http_cache_not_modified(req, &validator)) {
+        return ESP_OK;
+    }
+
+    uint8_t head[FILES_SNIFF_LEN];
+    ssize_t n = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        n = read(fd, head, sizeof(head));
+        close(fd);
+    }
+    httpd_resp_set_type(req, sniff_type(head, n > 0 ? (size_t)n : 0));
+    return static_files_send(req, path, size, validator.etag);
+}
@@ -0,0 +1,18 @@
+#ifndef API_FILES_H
+#define API_FILES_H
+
+#include "esp_http_server.h"
+
+/* POST /api/v1/files: multipart upload of one or more files, stored in
+ * the blob store; an "animal_id" field attaches them to that animal. */
+esp_err_t api_files_upload(httpd_req_t *req);
+/* GET /api/v1/files/<id>: download with Range support */
+esp_err_t api_files_download(httpd_req_t *req);
+/* DELETE /api/v1/files/<id>[?animal_id=..]: detaches the file from that
+ * animal (from all without the parameter) and removes the blob once
+ * nothing references it. */
+esp_err_t api_files_delete(httpd_req_t *req);
+/* Sends blob id (the rest of the URI may follow it) as the response. */
+esp_err_t api_files_send_blob(httpd_req_t *req, const char *id);
+
+#endif /* API_FILES_H */
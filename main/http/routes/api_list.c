@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "api_list.h"
+
+/*
+ * Paginated collection responses.
+ *
+ * The query is checked before anything is sent, so a bad cursor or an
+ * unknown field gets a plain 400.  The page is then written from the
+ * database cursor into chunked (and, when accepted, gzipped) output;
+ * the ETag follows the table's write generation, so a client polling
+ * the first page gets 304s until something changes.
+ */
+
+#include "http_cache.h"
+#include "http_compress.h"
+#include "database/db_manager.h"
+#include "utils/mem_arena.h"
+
+#define LIST_QUERY_MAX   512
+#define LIST_FIELDS_MAX  224
+
+typedef struct {
+    httpd_req_t *req;
+    http_stream_t stream;
+    bool started;
+} list_target_t;
+
+static int http_sink(void *ctx, const void *data, size_t len)
+{
+    list_target_t *t = ctx;
+    if (!t->started) {
+        http_stream_begin(&t->stream, t->req);
+        t->started = true;
+    }
+    return http_stream_write(&t->stream, data, len) == ESP_OK ? 0 : -1;
+}
+
+/* Clients may send the field list's commas percent-encoded. */
+static void decode_commas(char *s)
+{
+    char *w = s;
+    for (const char *r = s; *r; ) {
+        if (r[0] == '%' && r[1] == '2' && (r[2] == 'C' || r[2] == 'c')) {
+            *w++ = ',';
+            r += 3;
+        } else {
+            *w++ = *r++;
+        }
+    }
+    *w = '\0';
+}
+
+esp_err_t api_list_send(httpd_req_t *req, const db_list_table_t *list, const char *table)
+{
+    char *query = mem_arena_malloc(LIST_QUERY_MAX);
+    char *fields = mem_arena_malloc(LIST_FIELDS_MAX);
+    char *after = mem_arena_malloc(DB_LIST_CURSOR_MAX);
+    doc_out_t *out = mem_arena_malloc(sizeof(*out));
+    if (!query || !fields || !after || !out) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    query[0] = fields[0] = after[0] = '\0';
+    if (httpd_req_get_url_query_len(req) >= LIST_QUERY_MAX) {
+        httpd_resp_send_err(req, HTTPD_414_URI_TOO_LONG, "Query too long");
+        return ESP_FAIL;
+    }
+    httpd_req_get_url_query_str(req, query, LIST_QUERY_MAX);
+
+    char sort[16] = "";
+    char value[12];
+    db_list_query_t q = { .sort = sort, .fields = fields, .after = after };
+    httpd_query_key_value(query, "sort", sort, sizeof(sort));
+    httpd_query_key_value(query, "fields", fields, LIST_FIELDS_MAX);
+    httpd_query_key_value(query, "after", after, DB_LIST_CURSOR_MAX);
+    decode_commas(fields);
+    if (httpd_query_key_value(query, "limit", value, sizeof(value)) == ESP_OK) {
+        char *end;
+        long limit = strtol(value, &end, 10);
+        q.limit = *end || end == value || limit <= 0 || limit > DB_LIST_MAX_LIMIT ? -1 : (int)limit;
+    }
+    const char *err = db_list_check(list, &q);
+    if (err) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
+        return ESP_FAIL;
+    }
+
+    // The query string names the page; the table generation its content
+    http_validator_t validator;
+    http_cache_validator(&validator, query, db_table_generation(table), true, 0);
+    httpd_resp_set_hdr(req, "Cache-Control", HTTP_CACHE_REVALIDATE);
+    if (http_cache_not_modified(req, &validator)) {
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    list_target_t t = { .req = req };
+    doc_out_init(out, http_sink, &t);
+    int rc = db_list_page(list, &q, out);
+    if (!t.started) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Database unavailable");
+        return ESP_FAIL;
+    }
+    if (rc != 0) {
+        t.stream.err = ESP_FAIL;    // Drop the connection, no final chunk
+    }
+    esp_err_t send_err = http_stream_end(&t.stream);
+    return rc == 0 ? send_err : ESP_FAIL;
+}
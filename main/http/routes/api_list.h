@@ -0,0 +1,14 @@
+#ifndef API_LIST_H
+#define API_LIST_H
+
+#include "esp_http_server.h"
+#include "database/db_list.h"
+
+/*
+ * Shared GET handler body for the paginated collections:
+ * ?limit=N&sort=<order>&fields=a,b,c&after=<cursor>.  table names the
+ * database table whose write generation tags the response.
+ */
+esp_err_t api_list_send(httpd_req_t *req, const db_list_table_t *list, const char *table);
+
+#endif /* API_LIST_H */
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "api_ota.h"
+
+/*
+ * Firmware upload endpoint.
+ *
+ * The request body is received in OTA_RECV_CHUNK pieces and each piece
+ * goes straight through the multipart parser into the OTA session, so
+ * memory use is one receive buffer and the parser state whatever the
+ * image size, and the upload runs at link speed.  The expected SHA-256
+ * comes from a "sha256" form field (before or after the image) or an
+ * X-Firmware-SHA256 header; it is checked before the new slot is made
+ * bootable, together with the image's own validation.
+ *
+ * A "delta" part instead of "firmware" carries a patch from
+ * tools/make_delta.py; it is applied against the running image as it
+ * arrives (ota_delta.c) and the digest then names the rebuilt image.
+ *
+ * Progress is pushed to WebSocket clients as
+ * {"type":"ota","state":...,"received":n,"total":n}.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "http_auth.h"
+#include "multipart.h"
+#include "websocket.h"
+#include "ota/ota_delta.h"
+#include "ota/ota_manager.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+
+#define OTA_RECV_CHUNK      4096
+#define OTA_PROGRESS_STEP   (64 * 1024)
+#define OTA_RECV_RETRIES    3
+#define OTA_TYPE_MAX        128
+
+typedef struct {
+    ota_session_t *ota;
+    ota_delta_t *delta;     // Set instead of ota for a patch upload
+    bool in_image;
+    bool in_digest;
+    bool image_done;
+    char digest_hex[65];
+    size_t digest_len;
+    size_t total;           // Request body length
+    size_t received;
+    size_t next_report;
+} ota_upload_t;
+
+static void report(const ota_upload_t *u, const char *state)
+{
+    char msg[96];
+    snprintf(msg, sizeof(msg), "{\"type\":\"ota\",\"state\":\"%s\",\"received\":%u,\"total\":%u}",
+             state, (unsigned)u->received, (unsigned)u->total);
+    ws_broadcast(msg);
+}
+
+static int parse_digest(const char *hex, uint8_t out[32])
+{
+    if (strlen(hex) != 64) {
+        return -1;
+    }
+    for (int i = 0; i < 32; i++) {
+        unsigned byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1) {
+            return -1;
+        }
+        out[i] = (uint8_t)byte;
+    }
+    return 0;
+}
+
+static int image_data(ota_upload_t *u, const uint8_t *data, size_t len)
+{
+    return u->delta ? ota_delta_write(u->delta, data, len) : ota_session_write(u->ota, data, len);
+}
+
+static int on_part(void *ctx, const char *name, const char *filename)
+{
+    ota_upload_t *u = ctx;
+    if (strcmp(name, "sha256") == 0) {
+        u->in_digest = true;
+        return 0;
+    }
+    bool delta = strcmp(name, "delta") == 0;
+    if (!delta && strcmp(name, "firmware") != 0 && filename[0] == '\0') {
+        return 0;       // Unknown field, skipped
+    }
+    if (u->ota || u->delta || u->image_done) {
+        log_warn("ota", "Upload carries more than one image");
+        return -1;
+    }
+    if (delta) {
+        u->delta = ota_delta_begin();
+    } else {
+        u->ota = ota_session_begin(0);
+    }
+    u->in_image = u->ota || u->delta;
+    return u->in_image ? 0 : -1;
+}
+
+static int on_data(void *ctx, const uint8_t *data, size_t len)
+{
+    ota_upload_t *u = ctx;
+    if (u->in_image) {
+        return image_data(u, data, len);
+    }
+    if (u->in_digest) {
+        size_t room = sizeof(u->digest_hex) - 1 - u->digest_len;
+        size_t n = len < room ? len : room;
+        memcpy(u->digest_hex + u->digest_len, data, n);
+        u->digest_len += n;
+    }
+    return 0;
+}
+
+static int on_part_end(void *ctx)
+{
+    ota_upload_t *u = ctx;
+    u->image_done |= u->in_image;
+    u->in_image = false;
+    u->in_digest = false;
+    return 0;
+}
+
+static const multipart_callbacks_t MULTIPART_CB = {
+    .on_part = on_part,
+    .on_data = on_data,
+    .on_part_end = on_part_end,
+};
+
+esp_err_t api_ota_upload(httpd_req_t *req)
+{
+    if (!http_authorized(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Bearer token required");
+        return ESP_FAIL;
+    }
+    if (req->content_len == 0) {
+        httpd_resp_send_err(req, HTTPD_411_LENGTH_REQUIRED, "Empty upload");
+        return ESP_FAIL;
+    }
+    char content_type[OTA_TYPE_MAX] = { 0 };
+    httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type));
+
+    ota_upload_t *u = mem_arena_malloc(sizeof(*u));
+    multipart_parser_t *parser = mem_arena_malloc(sizeof(*parser));
+    uint8_t *buf = mem_arena_malloc(OTA_RECV_CHUNK);
+    if (!u || !parser || !buf) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    memset(u, 0, sizeof(*u));
+    u->total = req->content_len;
+    u->next_report = OTA_PROGRESS_STEP;
+    httpd_req_get_hdr_value_str(req, "X-Firmware-SHA256", u->digest_hex, sizeof(u->digest_hex));
+    u->digest_len = strlen(u->digest_hex);
+
+    bool multipart = multipart_init(parser, content_type, &MULTIPART_CB, u) == 0;
+    if (!multipart) {
+        // Raw body: the whole request is the image
+        u->ota = ota_session_begin(req->content_len);
+        u->in_image = true;
+        if (!u->ota) {
+            httpd_resp_set_status(req, "409 Conflict");
+            httpd_resp_sendstr(req, "Update not possible now");
+            return ESP_FAIL;
+        }
+    }
+    report(u, "started");
+
+    const char *error = NULL;
+    int retries = 0;
+    while (u->received < u->total && !error) {
+        size_t want = u->total - u->received;
+        int n = httpd_req_recv(req, (char *)buf, want < OTA_RECV_CHUNK ? want : OTA_RECV_CHUNK);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++retries <= OTA_RECV_RETRIES) {
+            continue;
+        }
+        if (n <= 0) {
+            error = "Receive failed";
+            break;
+        }
+        retries = 0;
+        u->received += (size_t)n;
+        int rc = multipart ? multipart_feed(parser, buf, (size_t)n) : image_data(u, buf, (size_t)n);
+        if (rc != 0) {
+            error = u->ota || u->delta || !multipart ? "Image rejected" : "Malformed upload";
+        }
+        if (u->received >= u->next_report) {
+            u->next_report += OTA_PROGRESS_STEP;
+            report(u, "writing");
+        }
+    }
+    if (!error && multipart && (multipart_finish(parser) != 0 || !u->image_done)) {
+        error = u->image_done ? "Malformed upload" : "No firmware part";
+    }
+
+    uint8_t digest[32];
+    bool have_digest = u->digest_len > 0;
+    if (!error && have_digest && parse_digest(u->digest_hex, digest) != 0) {
+        error = "Invalid sha256";
+    }
+    if (error) {
+        ota_session_abort(u->ota);
+        ota_delta_abort(u->delta);
+        log_error("ota", "Upload failed after %u bytes: %s", (unsigned)u->received, error);
+        report(u, "failed");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        return ESP_FAIL;
+    }
+    if (!have_digest) {
+        log_warn("ota", "No SHA-256 supplied, relying on the image checksum only");
+    }
+
+    report(u, "verifying");
+    int rc = u->delta ? ota_delta_finish(u->delta, have_digest ? digest : NULL)
+                      : ota_session_finish(u->ota, have_digest ? digest : NULL);
+    u->ota = NULL;
+    u->delta = NULL;
+    if (rc != 0) {
+        report(u, "failed");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Verification failed");
+        return ESP_FAIL;
+    }
+    report(u, "done");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\",\"action\":\"reboot\"}");
+    vTaskDelay(pdMS_TO_TICKS(500));
+    esp_restart();
+    return ESP_OK;
+}
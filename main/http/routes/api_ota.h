@@ -0,0 +1,10 @@
+#ifndef API_OTA_H
+#define API_OTA_H
+
+#include "esp_http_server.h"
+
+/* POST /api/v1/ota/update: multipart "firmware" or "delta" (+ "sha256")
+ * or a raw application/octet-stream image; Bearer token required. */
+esp_err_t api_ota_upload(httpd_req_t *req);
+
+#endif /* API_OTA_H */
@@ -1,12 +1,139 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "api_regulations.h"
 
-int api_regulations_get_species(const char *name)
+/*
+ * Regulation API.
+ *
+ * Species lookups are answered from the flash regulation list unless
+ * the device has its own entry for the name (database/db_regulations.h).
+ * Suggestions come from the in-memory prefix index, so the UI can ask
+ * on every keystroke (species/species_suggest.h).
+ * Animal status and alerts are still stubs.
+ */
+
+#include "cJSON.h"
+#include "http_compress.h"
+#include "database/db_regulations.h"
+#include "species/species_suggest.h"
+
+#define SPECIES_QUERY_MAX  160
+#define SPECIES_NAME_MAX   96
+#define SPECIES_LOCAL_BUF  512
+#define SUGGEST_DEFAULT    10
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/* Query values arrive form-encoded: "Python+regius", "Python%20regius". */
+static void url_decode(char *s)
+{
+    char *w = s;
+    for (const char *r = s; *r; ) {
+        int hi, lo;
+        if (r[0] == '%' && (hi = hex_digit(r[1])) >= 0 && (lo = hex_digit(r[2])) >= 0) {
+            *w++ = (char)(hi << 4 | lo);
+            r += 3;
+        } else {
+            *w++ = *r == '+' ? ' ' : *r;
+            r++;
+        }
+    }
+    *w = '\0';
+}
+
+esp_err_t api_regulations_get_species(httpd_req_t *req)
 {
-    printf("[api/regulations] GET species name=%s stub called\n", name);
+    char query[SPECIES_QUERY_MAX] = { 0 };
+    char name[SPECIES_NAME_MAX];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "name", name, sizeof(name)) != ESP_OK || !name[0]) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "name is required");
+        return ESP_FAIL;
+    }
+    url_decode(name);
+
+    species_regulation_t reg;
+    char local[SPECIES_LOCAL_BUF];
+    if (db_species_get_regulation(name, &reg, local, sizeof(local)) != 0) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown species");
+        return ESP_FAIL;
+    }
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "scientific_name", reg.scientific_name);
+    cJSON_AddStringToObject(root, "common_names", reg.common_names);
+    cJSON_AddStringToObject(root, "family", reg.family);
+    cJSON_AddStringToObject(root, "category", reg.category);
+    cJSON_AddStringToObject(root, "cites_appendix", reg.cites_appendix);
+    cJSON_AddStringToObject(root, "eu_annex", reg.eu_annex);
+    cJSON_AddStringToObject(root, "france_column", reg.france_column);
+    cJSON_AddBoolToObject(root, "domestic", reg.domestic);
+    cJSON_AddBoolToObject(root, "dangerous", reg.dangerous);
+    cJSON_AddBoolToObject(root, "invasive", reg.invasive);
+    cJSON_AddNumberToObject(root, "last_updated", (double)reg.last_updated);
+    cJSON_AddBoolToObject(root, "local", reg.local);
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON encode failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    http_send_compressed(req, json_str, strlen(json_str));
+    cJSON_free(json_str);
+    return ESP_OK;
+}
+
+static int add_suggestion(const char *scientific_name, const char *name, void *ctx)
+{
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddStringToObject(item, "scientific_name", scientific_name);
+    cJSON_AddStringToObject(item, "name", name);
+    cJSON_AddItemToArray(ctx, item);
     return 0;
 }
 
+esp_err_t api_regulations_suggest_species(httpd_req_t *req)
+{
+    char query[SPECIES_QUERY_MAX] = { 0 };
+    char prefix[SPECIES_NAME_MAX];
+    char value[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "q", prefix, sizeof(prefix)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "q is required");
+        return ESP_FAIL;
+    }
+    url_decode(prefix);
+    int limit = SUGGEST_DEFAULT;
+    if (httpd_query_key_value(query, "limit", value, sizeof(value)) == ESP_OK) {
+        limit = atoi(value);
+        if (limit < 1 || limit > SPECIES_SUGGEST_MAX) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid limit");
+            return ESP_FAIL;
+        }
+    }
+
+    cJSON *root = cJSON_CreateArray();
+    species_suggest(prefix, limit, add_suggestion, root);
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON encode failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+    cJSON_free(json_str);
+    return ESP_OK;
+}
+
 int api_regulations_get_animal_status(const char *id)
 {
     printf("[api/regulations] GET animal status id=%s stub called\n", id);
@@ -17,4 +144,4 @@ int api_regulations_get_alerts(void)
 {
     printf("[api/regulations] GET alerts stub called\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -1,8 +1,17 @@
 #ifndef API_REGULATIONS_H
 #define API_REGULATIONS_H
 
-int api_regulations_get_species(const char *name);
+#include "esp_http_server.h"
+
+/* GET /api/v1/regulations/species?name=<scientific name>: CITES, EU and
+ * French status of a species; "local" when it comes from the device's
+ * own species_regulations table rather than the flash list. */
+esp_err_t api_regulations_get_species(httpd_req_t *req);
+/* GET /api/v1/species/suggest?q=<prefix>&limit=<n>: up to n (10 by
+ * default) species whose scientific or common names have a word
+ * starting with q, ignoring case and accents. */
+esp_err_t api_regulations_suggest_species(httpd_req_t *req);
 int api_regulations_get_animal_status(const char *id);
 int api_regulations_get_alerts(void);
 
-#endif /* API_REGULATIONS_H */
\ No newline at end of file
+#endif /* API_REGULATIONS_H */
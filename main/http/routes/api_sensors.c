@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "api_sensors.h"
+
+/*
+ * Sensor API implementation.
+ *
+ * /api/v1/sensors returns the channel table kept by the sensor
+ * manager.  /api/v1/sensors/history streams a time range from a
+ * channel archive as chunked JSON: raw samples as [t, value] pairs, or
+ * with step=<seconds> one [t, min, max, mean, count] row per bucket.
+ * Nothing is buffered beyond one chunk, whatever the range, and the
+ * chunks are gzipped on the way out when the client accepts it.
+ *
+ * Both answer conditional requests: the current values are tagged with
+ * the sensor update counter, and a history range that ends in the past
+ * never changes (archives only grow forward), so it is served with an
+ * immutable Cache-Control.
+ */
+
+#include "cJSON.h"
+#include "http_cache.h"
+#include "http_compress.h"
+#include "sensors/sensor_manager.h"
+#include "storage/ts_archive.h"
+#include "utils/datetime.h"
+
+#define HISTORY_DEFAULT_RANGE_S  86400
+#define HISTORY_CHUNK_SIZE       512
+
+static const char *KIND_NAMES[] = { "temperature", "humidity", "voltage" };
+
+typedef struct {
+    http_stream_t out;
+    char buf[HISTORY_CHUNK_SIZE];
+    size_t len;
+    bool first;
+} history_writer_t;
+
+static void writer_flush(history_writer_t *w)
+{
+    http_stream_write(&w->out, w->buf, w->len);
+    w->len = 0;
+}
+
+static void writer_row(history_writer_t *w, const char *row)
+{
+    size_t n = strlen(row) + 1;
+    if (w->len + n > sizeof(w->buf)) {
+        writer_flush(w);
+    }
+    if (!w->first) {
+        w->buf[w->len++] = ',';
+    }
+    memcpy(w->buf + w->len, row, n - 1);
+    w->len += n - 1;
+    w->first = false;
+}
+
+static int bucket_row(const ts_bucket_t *b, void *ctx)
+{
+    history_writer_t *w = ctx;
+    char row[96];
+    snprintf(row, sizeof(row), "[%u,%.2f,%.2f,%.3f,%u]", (unsigned)b->t_start, b->min, b->max,
+             b->mean, (unsigned)b->count);
+    writer_row(w, row);
+    return w->out.err == ESP_OK ? 0 : 1;
+}
+
+static uint32_t query_u32(const char *query, const char *key, uint32_t def)
+{
+    char value[16];
+    if (httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) {
+        return def;
+    }
+    return (uint32_t)strtoul(value, NULL, 10);
+}
+
+esp_err_t api_sensors_get_current(httpd_req_t *req)
+{
+    http_validator_t validator;
+    http_cache_validator(&validator, "sensors", sensors_generation(), true, 0);
+    httpd_resp_set_hdr(req, "Cache-Control", HTTP_CACHE_REVALIDATE);
+    if (http_cache_not_modified(req, &validator)) {
+        return ESP_OK;
+    }
+
+    sensor_value_t values[SENSOR_MAX_CHANNELS];
+    int n = sensors_get_current(values, SENSOR_MAX_CHANNELS);
+
+    cJSON *root = cJSON_CreateArray();
+    for (int i = 0; i < n; i++) {
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", values[i].name);
+        cJSON_AddStringToObject(item, "kind", KIND_NAMES[values[i].kind]);
+        cJSON_AddNumberToObject(item, "value", values[i].value);
+        cJSON_AddNumberToObject(item, "timestamp", values[i].timestamp);
+        cJSON_AddBoolToObject(item, "valid", values[i].valid);
+        cJSON_AddStringToObject(item, "health", sensor_health_name(values[i].health));
+        cJSON_AddItemToArray(root, item);
+    }
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON encode failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    http_send_compressed(req, json_str, strlen(json_str));
+    cJSON_free(json_str);
+    return ESP_OK;
+}
+
+esp_err_t api_sensors_get_history(httpd_req_t *req)
+{
+    char query[128] = { 0 };
+    char channel[SENSOR_NAME_LEN];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "channel", channel, sizeof(channel)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "channel is required");
+        return ESP_FAIL;
+    }
+    ts_series_t *series = sensors_get_series(channel);
+    if (!series) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown channel");
+        return ESP_FAIL;
+    }
+    uint32_t now = datetime_now();
+    uint32_t to = query_u32(query, "to", now);
+    uint32_t from = query_u32(query, "from", to > HISTORY_DEFAULT_RANGE_S ? to - HISTORY_DEFAULT_RANGE_S : 0);
+    uint32_t step = query_u32(query, "step", 0);
+    if (from > to) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "from is after to");
+        return ESP_FAIL;
+    }
+
+    // An explicit "to" before the newest archived sample names a range
+    // no append can reach; it is immutable while all of it is still
+    // held.  Anything else revalidates against the series' appends.
+    http_validator_t validator;
+    char to_str[12];
+    uint32_t oldest = 0, newest = 0, version = 0;
+    bool spanned = ts_span(series, &oldest, &newest, &version) == 0;
+    bool fixed = spanned && httpd_query_key_value(query, "to", to_str, sizeof(to_str)) == ESP_OK &&
+                 to < newest && oldest != 0 && from >= oldest;
+    if (fixed) {
+        http_cache_validator(&validator, query, 0, false, 0);
+        httpd_resp_set_hdr(req, "Cache-Control", HTTP_CACHE_IMMUTABLE);
+    } else {
+        uint64_t tag = spanned ? ((uint64_t)oldest << 32) | version : sensors_generation();
+        http_cache_validator(&validator, query, tag, true, 0);
+        httpd_resp_set_hdr(req, "Cache-Control", HTTP_CACHE_REVALIDATE);
+    }
+    if (http_cache_not_modified(req, &validator)) {
+        return ESP_OK;
+    }
+
+    history_writer_t *w = calloc(1, sizeof(*w));
+    if (!w) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    w->first = true;
+    httpd_resp_set_type(req, "application/json");
+    http_stream_begin(&w->out, req);
+    int len = snprintf(w->buf, sizeof(w->buf),
+                       "{\"channel\":\"%s\",\"from\":%u,\"to\":%u,\"step\":%u,\"points\":[",
+                       channel, (unsigned)from, (unsigned)to, (unsigned)step);
+    w->len = (size_t)len;
+
+    if (step > 0) {
+        ts_rollup(series, from, to, step, bucket_row, w);
+    } else {
+        ts_iter_t it;
+        ts_sample_t sample;
+        if (ts_iter_begin(series, from, to, &it) == 0) {
+            while (w->out.err == ESP_OK && ts_iter_next(&it, &sample) == 1) {
+                char row[40];
+                snprintf(row, sizeof(row), "[%u,%.2f]", (unsigned)sample.timestamp, sample.value);
+                writer_row(w, row);
+            }
+            ts_iter_end(&it);
+        }
+    }
+    // Close the array; an archive read error leaves it short but valid
+    w->first = true;
+    writer_row(w, "]}");
+    writer_flush(w);
+    esp_err_t err = http_stream_end(&w->out);
+    free(w);
+    return err;
+}
@@ -0,0 +1,11 @@
+#ifndef API_SENSORS_H
+#define API_SENSORS_H
+
+#include "esp_http_server.h"
+
+/* GET /api/v1/sensors: latest value of every channel */
+esp_err_t api_sensors_get_current(httpd_req_t *req);
+/* GET /api/v1/sensors/history?channel=&from=&to=&step= */
+esp_err_t api_sensors_get_history(httpd_req_t *req);
+
+#endif /* API_SENSORS_H */
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "api_sync.h"
+
+/*
+ * Delta sync endpoint.
+ *
+ * A tablet that synced a minute ago gets a few hundred bytes: the
+ * rows written since, the keys deleted since and the new seq.  The
+ * reply is streamed from the change log like the listings, and tagged
+ * with the log's write generation, so polling with nothing new costs a
+ * 304.  Rows carry every column, metadata_json included, so it needs
+ * the bearer token.
+ */
+
+#include "http_auth.h"
+#include "http_cache.h"
+#include "http_compress.h"
+#include "database/db_manager.h"
+#include "database/db_sync.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+
+#define SYNC_QUERY_MAX 64
+
+typedef struct {
+    httpd_req_t *req;
+    http_stream_t stream;
+    bool started;
+} sync_target_t;
+
+static int http_sink(void *ctx, const void *data, size_t len)
+{
+    sync_target_t *t = ctx;
+    if (!t->started) {
+        http_stream_begin(&t->stream, t->req);
+        t->started = true;
+    }
+    return http_stream_write(&t->stream, data, len) == ESP_OK ? 0 : -1;
+}
+
+esp_err_t api_sync_get(httpd_req_t *req)
+{
+    if (!http_authorized(req)) {
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Bearer token required");
+        return ESP_FAIL;
+    }
+    char query[SYNC_QUERY_MAX] = { 0 };
+    char value[24];
+    int64_t since = 0;
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+        char *end;
+        since = strtoll(value, &end, 10);
+        if (*end || end == value || since < 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid since");
+            return ESP_FAIL;
+        }
+    }
+    doc_out_t *out = mem_arena_malloc(sizeof(*out));
+    if (!out) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    http_validator_t validator;
+    http_cache_validator(&validator, query, db_table_generation("change_log"), true, 0);
+    httpd_resp_set_hdr(req, "Cache-Control", HTTP_CACHE_REVALIDATE);
+    if (http_cache_not_modified(req, &validator)) {
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    sync_target_t t = { .req = req };
+    doc_out_init(out, http_sink, &t);
+    int rc = db_sync_write(out, since);
+    if (rc == DB_SYNC_RESET) {
+        log_info("sync", "Client at seq %lld must resync", (long long)since);
+        httpd_resp_set_status(req, "410 Gone");
+        return httpd_resp_sendstr(req, "{\"error\":\"Change log no longer reaches since; sync again from 0\"}");
+    }
+    if (!t.started) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Database unavailable");
+        return ESP_FAIL;
+    }
+    if (rc != 0) {
+        t.stream.err = ESP_FAIL;    // Drop the connection, no final chunk
+    }
+    esp_err_t err = http_stream_end(&t.stream);
+    return rc == 0 ? err : ESP_FAIL;
+}
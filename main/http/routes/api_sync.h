@@ -0,0 +1,11 @@
+#ifndef API_SYNC_H
+#define API_SYNC_H
+
+#include "esp_http_server.h"
+
+/* GET /api/v1/sync?since=<seq>: rows changed and deleted since seq,
+ * and the seq to ask from next time (database/db_sync.h).  410 when
+ * the client has to start again from since=0. */
+esp_err_t api_sync_get(httpd_req_t *req);
+
+#endif /* API_SYNC_H */
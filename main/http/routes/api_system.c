@@ -24,7 +24,7 @@ int api_system_get_stats(void)
     cJSON_Delete(root);
     if (json_str) {
         printf("%s\n", json_str);
-        free(json_str);
+        cJSON_free(json_str);
     }
     return 0;
 }
@@ -0,0 +1,302 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "static_files.h"
+
+/*
+ * Static file handler.
+ *
+ * Manifest lines are "<hash> <size> <gz size> <flags> <path>", with
+ * flags "i" for immutable (hashed file name) or "-".  The manifest
+ * text is kept in RAM and the table points into it.
+ *
+ * Files are streamed with read() into one 4 KB buffer (a flash sector)
+ * taken from the request arena and sent as HTTP chunks; nothing goes
+ * through stdio buffering and memory use does not depend on the file.
+ * The gzip variant is only chosen for full responses, so byte ranges
+ * always refer to the identity encoding.
+ */
+
+#include "http_cache.h"
+#include "http_compress.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+
+#define STATIC_HASH_LEN      16
+#define STATIC_PATH_MAX      96
+#define STATIC_CHUNK_SIZE    4096
+#define STATIC_MANIFEST_MAX  32768
+
+typedef struct {
+    const char *path;       // URL path below STATIC_FILES_PREFIX
+    char hash[STATIC_HASH_LEN + 1];
+    uint32_t size;
+    uint32_t gz_size;       // 0 when there is no .gz variant
+    bool immutable;
+} static_entry_t;
+
+static char *s_manifest = NULL;
+static static_entry_t *s_entries = NULL;
+static size_t s_count = 0;
+
+static const struct {
+    const char *ext;
+    const char *type;
+} CONTENT_TYPES[] = {
+    { "html", "text/html" },
+    { "js", "application/javascript" },
+    { "mjs", "application/javascript" },
+    { "css", "text/css" },
+    { "json", "application/json" },
+    { "webmanifest", "application/manifest+json" },
+    { "svg", "image/svg+xml" },
+    { "png", "image/png" },
+    { "ico", "image/x-icon" },
+    { "woff2", "font/woff2" },
+    { "txt", "text/plain" },
+};
+
+static int entry_cmp(const void *a, const void *b)
+{
+    return strcmp(((const static_entry_t *)a)->path, ((const static_entry_t *)b)->path);
+}
+
+int static_files_init(void)
+{
+    int fd = open(STATIC_FILES_ROOT "/manifest", O_RDONLY);
+    if (fd < 0) {
+        log_warn("static", "No web UI manifest in " STATIC_FILES_ROOT);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > STATIC_MANIFEST_MAX) {
+        close(fd);
+        log_error("static", "Web UI manifest has an invalid size");
+        return -1;
+    }
+    char *text = malloc((size_t)st.st_size + 1);
+    ssize_t got = text ? read(fd, text, (size_t)st.st_size) : -1;
+    close(fd);
+    if (got != st.st_size) {
+        free(text);
+        return -1;
+    }
+    text[got] = '\0';
+
+    size_t lines = 1;
+    for (const char *p = text; *p; p++) {
+        lines += *p == '\n';
+    }
+    static_entry_t *entries = calloc(lines, sizeof(*entries));
+    if (!entries) {
+        free(text);
+        return -1;
+    }
+    size_t count = 0;
+    char *save = NULL;
+    for (char *line = strtok_r(text, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        static_entry_t *e = &entries[count];
+        char flags[8];
+        unsigned size, gz_size;
+        int path_at = 0;
+        if (line[0] == '#' ||
+            sscanf(line, "%16s %u %u %7s %n", e->hash, &size, &gz_size, flags, &path_at) != 4 ||
+            path_at == 0 || line[path_at] != '/') {
+            continue;
+        }
+        e->path = line + path_at;
+        e->size = size;
+        e->gz_size = gz_size;
+        e->immutable = strchr(flags, 'i') != NULL;
+        count++;
+    }
+    qsort(entries, count, sizeof(*entries), entry_cmp);
+
+    free(s_entries);
+    free(s_manifest);
+    s_manifest = text;
+    s_entries = entries;
+    s_count = count;
+    log_info("static", "Web UI manifest: %u files", (unsigned)count);
+    return 0;
+}
+
+static const static_entry_t *lookup(const char *path)
+{
+    static_entry_t key = { .path = path };
+    return s_entries ? bsearch(&key, s_entries, s_count, sizeof(key), entry_cmp) : NULL;
+}
+
+static const char *content_type(const char *path)
+{
+    const char *base = strrchr(path, '/');
+    const char *ext = strrchr(base ? base : path, '.');
+    if (ext) {
+        for (size_t i = 0; i < sizeof(CONTENT_TYPES) / sizeof(CONTENT_TYPES[0]); i++) {
+            if (strcmp(ext + 1, CONTENT_TYPES[i].ext) == 0) {
+                return CONTENT_TYPES[i].type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+/*
+ * Single "bytes=" range.  Returns 1 with [*first, *last] set, 0 when
+ * the header should be ignored (multiple ranges, other units, garbage)
+ * and -1 when the range cannot be satisfied.
+ */
+static int parse_range(const char *header, uint32_t size, uint32_t *first, uint32_t *last)
+{
+    if (strncmp(header, "bytes=", 6) != 0 || strchr(header, ',')) {
+        return 0;
+    }
+    const char *p = header + 6;
+    char *end;
+    if (*p == '-') {
+        unsigned long suffix = strtoul(p + 1, &end, 10);
+        if (end == p + 1 || *end) {
+            return 0;
+        }
+        if (suffix == 0 || size == 0) {
+            return -1;
+        }
+        *first = suffix >= size ? 0 : size - (uint32_t)suffix;
+        *last = size - 1;
+        return 1;
+    }
+    unsigned long a = strtoul(p, &end, 10);
+    if (end == p || *end != '-') {
+        return 0;
+    }
+    p = end + 1;
+    unsigned long b = size ? size - 1 : 0;
+    if (*p) {
+        b = strtoul(p, &end, 10);
+        if (*end || b < a) {
+            return 0;
+        }
+    }
+    if (a >= size) {
+        return -1;
+    }
+    *first = (uint32_t)a;
+    *last = b >= size ? size - 1 : (uint32_t)b;
+    return 1;
+}
+
+static esp_err_t send_file(httpd_req_t *req, const char *file, uint32_t offset, uint32_t length)
+{
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "File missing");
+        return ESP_FAIL;
+    }
+    char *buf = mem_arena_malloc(STATIC_CHUNK_SIZE);
+    esp_err_t err = buf ? ESP_OK : ESP_ERR_NO_MEM;
+    if (err == ESP_OK && offset > 0 && lseek(fd, (off_t)offset, SEEK_SET) != (off_t)offset) {
+        err = ESP_FAIL;
+    }
+    while (err == ESP_OK && length > 0) {
+        size_t want = length < STATIC_CHUNK_SIZE ? length : STATIC_CHUNK_SIZE;
+        ssize_t n = read(fd, buf, want);
+        if (n <= 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        err = httpd_resp_send_chunk(req, buf, n);
+        length -= (uint32_t)n;
+    }
+    close(fd);
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    } else {
+        log_warn("static", "Transfer of %s aborted", file);
+    }
+    return err;
+}
+
+esp_err_t static_files_get(httpd_req_t *req)
+{
+    const char *rest = req->uri + strlen(STATIC_FILES_PREFIX);
+    size_t len = strcspn(rest, "?#");
+    if (len == 0) {
+        // Relative asset URLs in index.html need the trailing slash
+        httpd_resp_set_status(req, "301 Moved Permanently");
+        httpd_resp_set_hdr(req, "Location", STATIC_FILES_PREFIX "/");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    char path[STATIC_PATH_MAX];
+    if (len >= sizeof(path)) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+        return ESP_FAIL;
+    }
+    memcpy(path, rest, len);
+    path[len] = '\0';
+
+    const static_entry_t *e = lookup(strcmp(path, "/") == 0 ? "/index.html" : path);
+    const char *base = strrchr(path, '/');
+    if (!e && !strchr(base, '.')) {
+        e = lookup("/index.html");
+    }
+    if (!e) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+        return ESP_FAIL;
+    }
+
+    bool has_range = httpd_req_get_hdr_value_len(req, "Range") > 0;
+    bool gzip = e->gz_size > 0 && !has_range && http_accepts_gzip(req);
+
+    http_validator_t validator = { .last_modified = "" };
+    snprintf(validator.etag, sizeof(validator.etag), "\"%s%s\"", e->hash, gzip ? "-gz" : "");
+    httpd_resp_set_hdr(req, "Cache-Control", e->immutable ? HTTP_CACHE_IMMUTABLE : HTTP_CACHE_REVALIDATE);
+    if (e->gz_size > 0) {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+    if (http_cache_not_modified(req, &validator)) {
+        return ESP_OK;
+    }
+
+    char file[sizeof(STATIC_FILES_ROOT) + STATIC_HASH_LEN + 8];
+    snprintf(file, sizeof(file), STATIC_FILES_ROOT "/%s%s", e->hash, gzip ? ".gz" : "");
+    httpd_resp_set_type(req, content_type(e->path));
+    if (gzip) {
+        httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        return send_file(req, file, 0, e->gz_size);
+    }
+    return static_files_send(req, file, e->size, validator.etag);
+}
+
+esp_err_t static_files_send(httpd_req_t *req, const char *file, uint32_t size, const char *etag)
+{
+    httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+    char range[48] = { 0 };
+    bool has_range = httpd_req_get_hdr_value_str(req, "Range", range, sizeof(range)) == ESP_OK;
+    // If-Range: a stale validator means the client wants the whole file
+    char if_range[48];
+    if (has_range && httpd_req_get_hdr_value_str(req, "If-Range", if_range, sizeof(if_range)) == ESP_OK &&
+        strcmp(if_range, etag) != 0) {
+        has_range = false;
+    }
+    uint32_t first = 0, last = 0;
+    int ranged = has_range ? parse_range(range, size, &first, &last) : 0;
+    char content_range[48];
+    if (ranged < 0) {
+        snprintf(content_range, sizeof(content_range), "bytes */%u", (unsigned)size);
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+        return httpd_resp_send(req, NULL, 0);
+    }
+    if (ranged > 0) {
+        snprintf(content_range, sizeof(content_range), "bytes %u-%u/%u", (unsigned)first,
+                 (unsigned)last, (unsigned)size);
+        httpd_resp_set_status(req, "206 Partial Content");
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+        return send_file(req, file, first, last - first + 1);
+    }
+    return send_file(req, file, 0, size);
+}
@@ -0,0 +1,38 @@
+#ifndef STATIC_FILES_H
+#define STATIC_FILES_H
+
+#include "esp_http_server.h"
+
+/*
+ * Web UI served from SPIFFS.
+ *
+ * tools/build_ui.py stores each file of the built UI under
+ * /spiffs/www/<content hash> (plus <hash>.gz when compression pays)
+ * and writes /spiffs/www/manifest mapping URL paths to hashes.  The
+ * manifest is loaded once into a sorted table, so a request costs one
+ * binary search and one open(), never a directory scan.
+ *
+ * Files whose names already carry a content hash (app.3f9c21d0.js)
+ * are served with an immutable Cache-Control; the others (index.html)
+ * revalidate against the content-hash ETag.  Single byte ranges are
+ * honoured.  Paths without an extension fall back to index.html for
+ * client-side routing.
+ */
+
+#define STATIC_FILES_ROOT     "/spiffs/www"
+#define STATIC_FILES_PREFIX   "/ui"
+
+/* Load the manifest; returns -1 when none is installed. */
+int static_files_init(void);
+
+/* Handler for STATIC_FILES_PREFIX and everything below it. */
+esp_err_t static_files_get(httpd_req_t *req);
+
+/*
+ * Streams a file of the given size, honouring Range and If-Range
+ * against etag (the quoted ETag already set on the response).  The
+ * caller sets Content-Type and caching headers beforehand.
+ */
+esp_err_t static_files_send(httpd_req_t *req, const char *file, uint32_t size, const char *etag);
+
+#endif /* STATIC_FILES_H */
@@ -1,24 +1,161 @@
 #include <stdio.h>
-#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include "websocket.h"
 
-int ws_handle_connect(void)
+/*
+ * WebSocket implementation on esp_http_server.
+ *
+ * The handshake registers the socket in a small table; broadcasts are
+ * queued to the server task with httpd_queue_work(), which also runs
+ * every handler, so the table is only ever touched from that task and
+ * needs no lock.  Sockets closed by the peer or purged by the server
+ * are noticed (httpd_ws_get_fd_info) and dropped on the next send.
+ * Ping/pong and close frames are answered by the server itself.
+ */
+
+#include "sdkconfig.h"
+#include "utils/logger.h"
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+#include "utils/mem_arena.h"
+
+#define WS_MAX_FRAME 512
+
+static httpd_handle_t s_server = NULL;
+static int s_clients[WS_MAX_CLIENTS];
+
+int ws_init(httpd_handle_t server)
 {
-    printf("[ws] handle connect stub called\n");
+    s_server = server;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        s_clients[i] = -1;
+    }
     return 0;
 }
 
+static void client_add(int fd)
+{
+    int free_slot = -1;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (s_clients[i] == fd) {
+            return;
+        }
+        if (s_clients[i] < 0 ||
+            httpd_ws_get_fd_info(s_server, s_clients[i]) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            free_slot = i;
+        }
+    }
+    if (free_slot < 0) {
+        log_warn("ws", "Client table full, socket %d gets no broadcasts", fd);
+        return;
+    }
+    s_clients[free_slot] = fd;
+}
+
+esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        client_add(httpd_req_to_sockfd(req));
+        return ESP_OK;
+    }
+    httpd_ws_frame_t frame = { 0 };
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (frame.len > WS_MAX_FRAME) {
+        return ESP_FAIL;    // Closes the connection
+    }
+    char *buf = mem_arena_malloc(frame.len + 1);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    frame.payload = (uint8_t *)buf;
+    err = httpd_ws_recv_frame(req, &frame, frame.len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    buf[frame.len] = '\0';
+    if (frame.type == HTTPD_WS_TYPE_TEXT) {
+        ws_handle_frame(buf, frame.len);
+    }
+    return ESP_OK;
+}
+
+static void broadcast_work(void *arg)
+{
+    char *message = arg;
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)message,
+        .len = strlen(message),
+    };
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        int fd = s_clients[i];
+        if (fd < 0) {
+            continue;
+        }
+        if (httpd_ws_get_fd_info(s_server, fd) != HTTPD_WS_CLIENT_WEBSOCKET ||
+            httpd_ws_send_frame_async(s_server, fd, &frame) != ESP_OK) {
+            s_clients[i] = -1;
+        }
+    }
+    free(message);
+}
+
 int ws_broadcast(const char *message)
 {
-    (void)message;
-    printf("[ws] broadcast stub called\n");
+    if (!s_server || !message) {
+        return -1;
+    }
+    char *copy = strdup(message);
+    if (!copy) {
+        return -1;
+    }
+    if (httpd_queue_work(s_server, broadcast_work, copy) != ESP_OK) {
+        free(copy);
+        return -1;
+    }
     return 0;
 }
 
 int ws_handle_frame(const char *data, size_t len)
 {
+    // Clients only listen for now; what they send is ignored
     (void)data;
     (void)len;
-    printf("[ws] handle frame stub called\n");
     return 0;
-}
\ No newline at end of file
+}
+
+#else /* !CONFIG_HTTPD_WS_SUPPORT */
+
+int ws_init(httpd_handle_t server)
+{
+    (void)server;
+    log_warn("ws", "WebSocket support is disabled in sdkconfig");
+    return -1;
+}
+
+esp_err_t ws_handler(httpd_req_t *req)
+{
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "WebSocket support disabled");
+    return ESP_FAIL;
+}
+
+int ws_broadcast(const char *message)
+{
+    (void)message;
+    return -1;
+}
+
+int ws_handle_frame(const char *data, size_t len)
+{
+    (void)data;
+    (void)len;
+    return -1;
+}
+
+#endif /* CONFIG_HTTPD_WS_SUPPORT */
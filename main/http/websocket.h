@@ -1,14 +1,23 @@
 #ifndef WEBSOCKET_H
 #define WEBSOCKET_H
 
+#include <stddef.h>
+#include "esp_http_server.h"
+
 /*
- * WebSocket handler stubs.  The full implementation would manage
- * connections, broadcast sensor updates and handle bidirectional
- * communication.  The functions here are placeholders.
+ * WebSocket endpoint (/api/v1/ws) for server push.
+ *
+ * Clients connect and receive JSON text messages; long operations
+ * (OTA uploads) report progress here.  ws_broadcast() may be called
+ * from any task: the message is copied and sent from the HTTP server
+ * task.
  */
 
-int ws_handle_connect(void);
+#define WS_MAX_CLIENTS  4
+
+int ws_init(httpd_handle_t server);
+esp_err_t ws_handler(httpd_req_t *req);
 int ws_broadcast(const char *message);
 int ws_handle_frame(const char *data, size_t len);
 
-#endif /* WEBSOCKET_H */
\ No newline at end of file
+#endif /* WEBSOCKET_H */
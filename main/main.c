@@ -3,12 +3,19 @@
 #include "wifi/wifi_manager.h"
 #include "http/http_server.h"
 #include "database/db_manager.h"
+#include "species/species_index.h"
+#include "species/species_suggest.h"
 #include "sensors/sensor_manager.h"
 #include "mqtt/mqtt_client.h"
+#include "replication/replicator.h"
 #include "security/auth.h"
 #include "ota/ota_manager.h"
+#include "ota/rollback.h"
+#include "ble/ble_server.h"
 #include "storage/storage_manager.h"
 #include "storage/nvs_manager.h"
+#include "storage/blob_store.h"
+#include "utils/mem_arena.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -26,10 +33,15 @@ void app_main(void)
     printf("  Version: %s\n", APP_VERSION);
     printf("============================================\n\n");
 
+    // Route cJSON through the request arena allocator before any
+    // module creates a JSON document.
+    mem_init();
+
     // Initialise modules.  Each function currently returns 0 and
     // prints a message; replace with real implementations.
     // Initialise storage and NVS before any other operations
     storage_mount();
+    blob_store_init();
     nvs_init();
 
     // Initialise Wi‑Fi; if credentials are missing start AP for provisioning
@@ -38,35 +50,38 @@ void app_main(void)
         // Start AP mode for provisioning
         wifi_start_ap();
     }
-    // Initialise database
+    // Initialise database; the regulation list it overrides is in flash
     db_init();
+    species_index_init();
+    species_suggest_init();
     // Initialise sensors
 #if APP_SENSORS_ENABLED
     sensors_init();
 #else
     printf("Sensors disabled via APP_SENSORS_ENABLED=0\n");
 #endif
-    // Start MQTT client only when STA networking is available
+    // Start MQTT client and replication only when STA networking is available
     if (wifi_connected) {
         mqtt_client_init();
+        replicator_start();
     } else {
         printf("MQTT client disabled until Wi-Fi STA connection is available.\n");
     }
-    // Start HTTP server
-    http_server_start();
+    // Start HTTP server; it is also how the next update arrives, so an
+    // image that cannot serve it must not be kept
+    bool http_ok = (http_server_start() == 0);
     // Initialise OTA support
     ota_init();
+    // BLE: environmental readings and history download without Wi-Fi
+    if (ble_server_init() == 0) {
+        ble_server_start();
+    }
 
-    // Simple periodic sensor reading loop (non‑blocking tasks omitted)
+    // Periodic sampling runs in the sensor scheduler task; app_main
+    // returns once everything is started.
 #if APP_SENSORS_ENABLED
-    while (1) {
-        sensors_read();
-        vTaskDelay(pdMS_TO_TICKS(60000)); // 1 minute
-    }
+    sensors_start();
 #endif
-
-    // Unreachable; in practice the FreeRTOS scheduler runs tasks
-    // and the loop above yields to other tasks.
-    // storage_unmount();
-    // printf("Initialisation complete.\n");
+    ota_confirm_boot(http_ok);
+    printf("Initialisation complete.\n");
 }
@@ -12,6 +12,7 @@
 #define MQTT_TOPIC_SENSORS_HUMIDITY       "reptile/sensors/humidity"
 #define MQTT_TOPIC_ALERTS_TEMP_HIGH       "reptile/alerts/temperature_high"
 #define MQTT_TOPIC_ALERTS_TEMP_LOW        "reptile/alerts/temperature_low"
+#define MQTT_TOPIC_ALERTS_SENSOR          "reptile/alerts/sensor"
 #define MQTT_TOPIC_STATUS_ONLINE          "reptile/status/online"
 #define MQTT_TOPIC_STATUS_STATS           "reptile/status/stats"
 
@@ -0,0 +1,280 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ota_delta.h"
+
+/*
+ * Delta patch applier.
+ *
+ * Patch layout (see tools/make_delta.py): an 80-byte header
+ * ("TDP1", old size, new size, flags, old SHA-256, new SHA-256) and a
+ * raw DEFLATE stream with a 4 KB window holding bsdiff-style records
+ * {u32 diff_len, u32 extra_len, i32 seek, diff bytes, extra bytes}.
+ *
+ * The ROM inflater (tinfl) decompresses into a ring the size of the
+ * window; each piece it produces is consumed at once by the record
+ * state machine below, which adds diff bytes to the mapped old image
+ * and passes the result to the OTA session.  The base image is hashed
+ * before anything is written, so a patch made for another build is
+ * rejected up front instead of producing garbage.
+ */
+
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+#include "rom/miniz.h"
+#include "ota_manager.h"
+
+#define DELTA_MAGIC        "TDP1"
+#define DELTA_HEADER_SIZE  80
+#define DELTA_RECORD_SIZE  12
+#define DELTA_RING_SIZE    4096    // DEFLATE window used by make_delta.py
+#define DELTA_SCRATCH      512
+
+static const char *TAG_DELTA = "ota_delta";
+
+typedef enum {
+    DELTA_HEADER,
+    DELTA_RECORD,
+    DELTA_DIFF,
+    DELTA_EXTRA,
+    DELTA_FAILED
+} delta_state_t;
+
+struct ota_delta {
+    delta_state_t state;
+    uint8_t header[DELTA_HEADER_SIZE];
+    size_t header_len;
+    uint32_t old_size;
+    uint32_t new_size;
+    const uint8_t *old;                 // Running image, memory mapped
+    esp_partition_mmap_handle_t map;
+    bool mapped;
+    ota_session_t *ota;
+    tinfl_decompressor inflator;
+    bool inflated;                      // End of the DEFLATE stream seen
+    uint8_t ring[DELTA_RING_SIZE];
+    size_t ring_pos;
+    uint8_t record[DELTA_RECORD_SIZE];
+    size_t record_len;
+    uint32_t diff_left;
+    uint32_t extra_left;
+    int32_t seek;
+    uint32_t old_pos;
+    uint32_t produced;
+    uint8_t scratch[DELTA_SCRATCH];
+};
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+ota_delta_t *ota_delta_begin(void)
+{
+    ota_delta_t *d = calloc(1, sizeof(*d));
+    if (!d) {
+        return NULL;
+    }
+    tinfl_init(&d->inflator);
+    d->state = DELTA_HEADER;
+    return d;
+}
+
+/* Checks the header against the running image and opens the OTA slot. */
+static int start(ota_delta_t *d)
+{
+    const uint8_t *h = d->header;
+    if (memcmp(h, DELTA_MAGIC, 4) != 0 || le32(h + 12) != 0) {
+        ESP_LOGE(TAG_DELTA, "Not a delta patch");
+        return -1;
+    }
+    d->old_size = le32(h + 4);
+    d->new_size = le32(h + 8);
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    if (!running || d->old_size == 0 || d->old_size > running->size) {
+        ESP_LOGE(TAG_DELTA, "Patch base does not fit the running partition");
+        return -1;
+    }
+    const void *ptr;
+    if (esp_partition_mmap(running, 0, running->size, ESP_PARTITION_MMAP_DATA, &ptr, &d->map) != ESP_OK) {
+        ESP_LOGE(TAG_DELTA, "Cannot map the running image");
+        return -1;
+    }
+    d->old = ptr;
+    d->mapped = true;
+
+    uint8_t digest[32];
+    mbedtls_sha256(d->old, d->old_size, digest, 0);
+    if (memcmp(digest, h + 16, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG_DELTA, "Patch was made for a different firmware build");
+        return -1;
+    }
+    d->ota = ota_session_begin(d->new_size);
+    if (!d->ota) {
+        return -1;
+    }
+    ESP_LOGI(TAG_DELTA, "Applying patch: %u -> %u bytes", (unsigned)d->old_size,
+             (unsigned)d->new_size);
+    d->state = DELTA_RECORD;
+    return 0;
+}
+
+static int end_record(ota_delta_t *d)
+{
+    int64_t pos = (int64_t)d->old_pos + d->seek;
+    if (pos < 0 || pos > d->old_size) {
+        return -1;
+    }
+    d->old_pos = (uint32_t)pos;
+    d->state = DELTA_RECORD;
+    return 0;
+}
+
+static int next_state(ota_delta_t *d)
+{
+    if (d->diff_left > 0) {
+        d->state = DELTA_DIFF;
+        return 0;
+    }
+    if (d->extra_left > 0) {
+        d->state = DELTA_EXTRA;
+        return 0;
+    }
+    return end_record(d);
+}
+
+/* Consumes inflated record bytes. */
+static int apply(ota_delta_t *d, const uint8_t *p, size_t n)
+{
+    while (n > 0) {
+        size_t take;
+        switch (d->state) {
+        case DELTA_RECORD:
+            take = DELTA_RECORD_SIZE - d->record_len;
+            take = take < n ? take : n;
+            memcpy(d->record + d->record_len, p, take);
+            d->record_len += take;
+            if (d->record_len == DELTA_RECORD_SIZE) {
+                d->record_len = 0;
+                d->diff_left = le32(d->record);
+                d->extra_left = le32(d->record + 4);
+                d->seek = (int32_t)le32(d->record + 8);
+                uint64_t out = (uint64_t)d->produced + d->diff_left + d->extra_left;
+                if ((uint64_t)d->old_pos + d->diff_left > d->old_size || out > d->new_size ||
+                    next_state(d) != 0) {
+                    ESP_LOGE(TAG_DELTA, "Corrupt patch record");
+                    return -1;
+                }
+            }
+            break;
+        case DELTA_DIFF:
+            take = d->diff_left < n ? d->diff_left : n;
+            take = take < DELTA_SCRATCH ? take : DELTA_SCRATCH;
+            for (size_t k = 0; k < take; k++) {
+                d->scratch[k] = (uint8_t)(d->old[d->old_pos + k] + p[k]);
+            }
+            if (ota_session_write(d->ota, d->scratch, take) != 0) {
+                return -1;
+            }
+            d->old_pos += take;
+            d->diff_left -= take;
+            d->produced += take;
+            if (d->diff_left == 0 && next_state(d) != 0) {
+                return -1;
+            }
+            break;
+        case DELTA_EXTRA:
+            take = d->extra_left < n ? d->extra_left : n;
+            if (ota_session_write(d->ota, p, take) != 0) {
+                return -1;
+            }
+            d->extra_left -= take;
+            d->produced += take;
+            if (d->extra_left == 0 && end_record(d) != 0) {
+                return -1;
+            }
+            break;
+        default:
+            return -1;
+        }
+        p += take;
+        n -= take;
+    }
+    return 0;
+}
+
+int ota_delta_write(ota_delta_t *d, const void *data, size_t len)
+{
+    const uint8_t *in = data;
+    if (d->state == DELTA_HEADER) {
+        size_t take = DELTA_HEADER_SIZE - d->header_len;
+        take = take < len ? take : len;
+        memcpy(d->header + d->header_len, in, take);
+        d->header_len += take;
+        in += take;
+        len -= take;
+        if (d->header_len < DELTA_HEADER_SIZE) {
+            return 0;
+        }
+        if (start(d) != 0) {
+            d->state = DELTA_FAILED;
+            return -1;
+        }
+    }
+    if (d->state == DELTA_FAILED) {
+        return -1;
+    }
+
+    tinfl_status status = TINFL_STATUS_NEEDS_MORE_INPUT;
+    while (!d->inflated && (len > 0 || status == TINFL_STATUS_HAS_MORE_OUTPUT)) {
+        size_t in_size = len;
+        size_t out_size = DELTA_RING_SIZE - d->ring_pos;
+        status = tinfl_decompress(&d->inflator, in, &in_size, d->ring, d->ring + d->ring_pos,
+                                  &out_size, TINFL_FLAG_HAS_MORE_INPUT);
+        in += in_size;
+        len -= in_size;
+        if (status < TINFL_STATUS_DONE || (out_size > 0 && apply(d, d->ring + d->ring_pos, out_size) != 0)) {
+            ESP_LOGE(TAG_DELTA, "Patch rejected after %u output bytes", (unsigned)d->produced);
+            d->state = DELTA_FAILED;
+            return -1;
+        }
+        d->ring_pos = (d->ring_pos + out_size) & (DELTA_RING_SIZE - 1);
+        d->inflated = status == TINFL_STATUS_DONE;
+    }
+    return 0;
+}
+
+static void delta_free(ota_delta_t *d)
+{
+    if (d->mapped) {
+        esp_partition_munmap(d->map);
+    }
+    free(d);
+}
+
+int ota_delta_finish(ota_delta_t *d, const uint8_t expected_sha256[32])
+{
+    const uint8_t *new_sha = d->header + 48;
+    bool complete = d->state == DELTA_RECORD && d->inflated && d->record_len == 0 &&
+                    d->produced == d->new_size;
+    if (!complete || (expected_sha256 && memcmp(expected_sha256, new_sha, 32) != 0)) {
+        ESP_LOGE(TAG_DELTA, complete ? "Patch builds a different image than announced"
+                                     : "Patch ended early");
+        ota_delta_abort(d);
+        return -1;
+    }
+    // The session hashes what was written; it must be the announced image
+    int rc = ota_session_finish(d->ota, new_sha);
+    delta_free(d);
+    return rc;
+}
+
+void ota_delta_abort(ota_delta_t *d)
+{
+    if (d) {
+        ota_session_abort(d->ota);
+        delta_free(d);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef OTA_DELTA_H
+#define OTA_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Delta OTA: rebuild the new firmware from the running image and a
+ * patch made by tools/make_delta.py, while the patch streams in.
+ *
+ * The running partition is memory mapped and read in place, the patch
+ * is inflated through a 4 KB ring, and the output goes through an OTA
+ * session into the inactive slot, so RAM use is about 16 KB whatever
+ * the image size.  The patch names the SHA-256 of the image it applies
+ * to and of the image it produces; both are checked.
+ */
+
+typedef struct ota_delta ota_delta_t;
+
+ota_delta_t *ota_delta_begin(void);
+/* Feed patch bytes in any pieces; -1 stops the update. */
+int ota_delta_write(ota_delta_t *d, const void *data, size_t len);
+/* expected_sha256, when given, must match the image the patch builds.
+ * Selects the new image for the next boot.  Frees d. */
+int ota_delta_finish(ota_delta_t *d, const uint8_t expected_sha256[32]);
+void ota_delta_abort(ota_delta_t *d);
+
+#endif /* OTA_DELTA_H */
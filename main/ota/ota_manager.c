@@ -1,4 +1,8 @@
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "ota_manager.h"
 
 /*
@@ -11,15 +15,34 @@
  * will reboot automatically.  For simplicity signature
  * verification is assumed to be handled by the OTA API and the
  * server certificate is referenced via the certificates module.
+ *
+ * Pushed images (HTTP upload) go through an OTA session instead: the
+ * slot is opened with sequential writes, so flash is erased sector by
+ * sector just ahead of the data rather than all 3 MB up front, and a
+ * SHA-256 of the stream is kept so the caller's digest can be checked
+ * before the boot partition is switched.
  */
 
 #include "esp_https_ota.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "mbedtls/sha256.h"
 #include "security/certificates.h"
 
 static const char *TAG_OTA = "ota";
 
+struct ota_session {
+    const esp_partition_t *partition;
+    esp_ota_handle_t handle;
+    mbedtls_sha256_context sha;
+    size_t written;
+};
+
+// Claimed with a compare-exchange: uploads run on several HTTP workers
+static atomic_bool s_session_open = false;
+
 int ota_init(void)
 {
     // Nothing to initialise for OTA in this implementation
@@ -39,8 +62,15 @@ int ota_update_from_url(const char *url)
     esp_https_ota_config_t ota_config = {
         .http_config = &http_config
     };
+    // A download writes the same slot as an upload
+    bool idle = false;
+    if (!atomic_compare_exchange_strong(&s_session_open, &idle, true)) {
+        ESP_LOGW(TAG_OTA, "An update is already in progress");
+        return -1;
+    }
     ESP_LOGI(TAG_OTA, "Starting OTA from %s", url);
     esp_err_t ret = esp_https_ota(&ota_config);
+    atomic_store(&s_session_open, false);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG_OTA, "OTA update succeeded, rebooting...");
         esp_restart();
@@ -50,3 +80,98 @@ int ota_update_from_url(const char *url)
         return -1;
     }
 }
+
+ota_session_t *ota_session_begin(size_t image_size)
+{
+    bool idle = false;
+    if (!atomic_compare_exchange_strong(&s_session_open, &idle, true)) {
+        ESP_LOGW(TAG_OTA, "An update is already in progress");
+        return NULL;
+    }
+    const esp_partition_t *part = esp_ota_get_next_update_partition(NULL);
+    if (!part) {
+        ESP_LOGE(TAG_OTA, "No OTA slot available");
+        atomic_store(&s_session_open, false);
+        return NULL;
+    }
+    if (image_size > part->size) {
+        ESP_LOGE(TAG_OTA, "Image of %u bytes does not fit in %s", (unsigned)image_size, part->label);
+        atomic_store(&s_session_open, false);
+        return NULL;
+    }
+    ota_session_t *s = calloc(1, sizeof(*s));
+    if (!s) {
+        atomic_store(&s_session_open, false);
+        return NULL;
+    }
+    esp_err_t err = esp_ota_begin(part, OTA_WITH_SEQUENTIAL_WRITES, &s->handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_OTA, "esp_ota_begin failed: %s", esp_err_to_name(err));
+        free(s);
+        atomic_store(&s_session_open, false);
+        return NULL;
+    }
+    s->partition = part;
+    mbedtls_sha256_init(&s->sha);
+    mbedtls_sha256_starts(&s->sha, 0);
+    ESP_LOGI(TAG_OTA, "Receiving image into %s", part->label);
+    return s;
+}
+
+int ota_session_write(ota_session_t *s, const void *data, size_t len)
+{
+    esp_err_t err = esp_ota_write(s->handle, data, len);
+    if (err != ESP_OK) {
+        // The first write already fails on a wrong magic byte or chip id
+        ESP_LOGE(TAG_OTA, "Write at %u failed: %s", (unsigned)s->written, esp_err_to_name(err));
+        return -1;
+    }
+    mbedtls_sha256_update(&s->sha, data, len);
+    s->written += len;
+    return 0;
+}
+
+static void session_free(ota_session_t *s)
+{
+    mbedtls_sha256_free(&s->sha);
+    free(s);
+    atomic_store(&s_session_open, false);
+}
+
+int ota_session_finish(ota_session_t *s, const uint8_t expected_sha256[32])
+{
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&s->sha, digest);
+    if (expected_sha256 && memcmp(digest, expected_sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG_OTA, "SHA-256 mismatch, image discarded");
+        esp_ota_abort(s->handle);
+        session_free(s);
+        return -1;
+    }
+    // esp_ota_end checks the image structure and its appended hash
+    esp_err_t err = esp_ota_end(s->handle);
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(s->partition);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_OTA, "Image rejected: %s", esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG_OTA, "%u bytes verified, %s selected for next boot", (unsigned)s->written,
+                 s->partition->label);
+    }
+    session_free(s);
+    return err == ESP_OK ? 0 : -1;
+}
+
+void ota_session_abort(ota_session_t *s)
+{
+    if (s) {
+        esp_ota_abort(s->handle);
+        session_free(s);
+    }
+}
+
+size_t ota_session_written(const ota_session_t *s)
+{
+    return s->written;
+}
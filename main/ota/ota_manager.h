@@ -1,7 +1,27 @@
 #ifndef OTA_MANAGER_H
 #define OTA_MANAGER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 int ota_init(void);
 int ota_update_from_url(const char *url);
 
-#endif /* OTA_MANAGER_H */
\ No newline at end of file
+/*
+ * Streamed install into the inactive OTA slot.  Data is written as it
+ * arrives and hashed on the way; the running image and boot partition
+ * are untouched until ota_session_finish() has verified everything.
+ * One session at a time.
+ */
+typedef struct ota_session ota_session_t;
+
+/* image_size may be 0 when the length is not known in advance. */
+ota_session_t *ota_session_begin(size_t image_size);
+int ota_session_write(ota_session_t *s, const void *data, size_t len);
+/* Validates the image, compares its SHA-256 with expected (skipped
+ * when NULL) and selects it for the next boot.  Frees the session. */
+int ota_session_finish(ota_session_t *s, const uint8_t expected_sha256[32]);
+void ota_session_abort(ota_session_t *s);
+size_t ota_session_written(const ota_session_t *s);
+
+#endif /* OTA_MANAGER_H */
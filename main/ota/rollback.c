@@ -7,6 +7,13 @@
  * If the current running firmware is marked as pending verification
  * and diagnostics fail, this function can be called to roll back
  * to the previous partition.  It uses the ESP‑IDF OTA API.
+ *
+ * With CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE every image installed by
+ * OTA (full or delta) boots once in the pending-verify state; unless
+ * ota_confirm_boot() marks it valid, the next reset returns to the
+ * previous slot.  Delta patches are always built against the image
+ * that is running, so a rolled back device simply rejects a patch made
+ * for the build it left.
  */
 
 #include "esp_ota_ops.h"
@@ -21,4 +28,25 @@ int ota_rollback(void)
         return -1;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+int ota_confirm_boot(bool healthy)
+{
+    esp_ota_img_states_t state;
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    if (esp_ota_get_state_partition(running, &state) != ESP_OK ||
+        state != ESP_OTA_IMG_PENDING_VERIFY) {
+        return 0;
+    }
+    if (!healthy) {
+        ESP_LOGE("rollback", "New firmware failed its start-up checks");
+        return ota_rollback();
+    }
+    esp_err_t err = esp_ota_mark_app_valid_cancel_rollback();
+    if (err != ESP_OK) {
+        ESP_LOGE("rollback", "Failed to confirm image: %s", esp_err_to_name(err));
+        return -1;
+    }
+    ESP_LOGI("rollback", "New firmware confirmed on %s", running->label);
+    return 0;
+}
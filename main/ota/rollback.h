@@ -1,6 +1,13 @@
 #ifndef ROLLBACK_H
 #define ROLLBACK_H
 
+#include <stdbool.h>
+
 int ota_rollback(void);
 
-#endif /* ROLLBACK_H */
\ No newline at end of file
+/* Call once start-up is complete.  A newly installed image still
+ * pending verification is kept when healthy, rolled back otherwise;
+ * images already confirmed are left alone. */
+int ota_confirm_boot(bool healthy);
+
+#endif /* ROLLBACK_H */
@@ -0,0 +1,674 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "replicator.h"
+
+/*
+ * Replication worker.
+ *
+ * A session connects, then keeps up to CONFIG_APP_REPL_WINDOW batches
+ * in flight: it builds and sends batches until the window is full,
+ * reads the oldest response, and refills.  Pipelining like this keeps
+ * the link busy across the round trip instead of paying it per
+ * batch.  When nothing new is left and every batch is acknowledged,
+ * the session ends and the task sleeps CONFIG_APP_REPL_INTERVAL_S.
+ *
+ * A batch does not need to be kept once sent.  Its end position is
+ * recorded in the in-flight slot, and after a failure the next session
+ * rebuilds everything after the last acknowledged position from the
+ * change log and archives.  A position is the change log seq plus, per
+ * channel, the timestamp of the last reading sent.  Readings sharing a
+ * timestamp are never split between batches, so the timestamp alone
+ * says where to resume.
+ *
+ * The body is NDJSON gzipped as it is written (utils/gzip_stream.h),
+ * cut after about CONFIG_APP_REPL_BATCH_BYTES of JSON.  The acknowledged
+ * position is saved to NVS at most every few seconds and at the end of
+ * a session, so a reboot repeats seconds of data, not hours.
+ *
+ * With CONFIG_APP_REPL_TLS the connection goes through esp-tls and the
+ * server must present a certificate the bundle trusts.  Basic
+ * credentials are only ever sent over it; on a plain TCP build a
+ * configured server user disables replication instead.
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_APP_REPLICATION
+
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#if CONFIG_APP_REPL_TLS
+#include "esp_crt_bundle.h"
+#include "esp_tls.h"
+#endif
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#include "mbedtls/base64.h"
+#include "database/db_sync.h"
+#include "documents/doc_output.h"
+#include "sensors/sensor_manager.h"
+#include "storage/nvs_manager.h"
+#include "utils/gzip_stream.h"
+#include "utils/logger.h"
+
+#if CONFIG_APP_REPL_TLS
+#define REPL_TASK_STACK      9216       // The handshake runs on this stack
+#define REPL_DEFAULT_PORT    "443"
+#else
+#define REPL_TASK_STACK      6144
+#define REPL_DEFAULT_PORT    "80"
+#endif
+#define REPL_TASK_PRIO       3
+#define REPL_VALUE_MAX       64         // NVS config strings, as on the config page
+#define REPL_HEAD_MAX        640
+#define REPL_RX_MAX          256
+#define REPL_POS_TEXT_MAX    512
+#define REPL_CHANGES_STEP    32         // Change log rows per query
+#define REPL_IO_TIMEOUT_S    15
+#define REPL_BACKOFF_MIN_S   5
+#define REPL_BACKOFF_MAX_S   300
+#define REPL_SAVE_EVERY_US   (5LL * 1000000)
+#define REPL_BODY_LIMIT      (256 * 1024)
+#define REPL_POS_KEY         "repl_pos"
+
+typedef struct {
+    char name[SENSOR_NAME_LEN];
+    uint32_t ts;                // Last timestamp sent, 0 for none
+} repl_channel_t;
+
+typedef struct {
+    int64_t seq;
+    int channel_count;
+    repl_channel_t channels[SENSOR_MAX_CHANNELS];
+} repl_pos_t;
+
+typedef struct {
+    char host[REPL_VALUE_MAX];
+    char port[8];
+    char database[REPL_VALUE_MAX];
+    char auth[4 * REPL_VALUE_MAX];  // Base64 of user:password, "" for none
+    char device[13];
+} repl_target_t;
+
+typedef struct {
+    uint32_t id;
+    repl_pos_t end;
+} repl_slot_t;
+
+typedef struct {
+    repl_target_t target;
+    repl_pos_t acked;
+    int64_t saved_at;
+    bool dirty;
+    uint32_t next_id;
+#if CONFIG_APP_REPL_TLS
+    esp_tls_t *tls;
+#else
+    int fd;
+#endif
+    // Batch being built
+    gz_stream_t *gz;
+    uint8_t *body;
+    size_t body_len;
+    size_t body_cap;
+    uint32_t records;
+    doc_out_t out;
+    // Response head reader
+    char rx[REPL_RX_MAX];
+    size_t rx_len;
+    repl_slot_t slots[CONFIG_APP_REPL_WINDOW];
+} repl_t;
+
+static replicator_status_t s_status;
+
+/* ---- positions ---- */
+
+static repl_channel_t *find_channel(repl_pos_t *pos, const char *name)
+{
+    for (int i = 0; i < pos->channel_count; i++) {
+        if (strcmp(pos->channels[i].name, name) == 0) {
+            return &pos->channels[i];
+        }
+    }
+    if (pos->channel_count == SENSOR_MAX_CHANNELS) {
+        return NULL;
+    }
+    repl_channel_t *c = &pos->channels[pos->channel_count++];
+    snprintf(c->name, sizeof(c->name), "%s", name);
+    c->ts = 0;
+    return c;
+}
+
+/* "<seq>,<channel>=<ts>,..." */
+static void load_position(repl_pos_t *pos)
+{
+    char text[REPL_POS_TEXT_MAX] = "";
+    memset(pos, 0, sizeof(*pos));
+    if (nvsman_get_str(REPL_POS_KEY, text, sizeof(text)) != 0) {
+        return;
+    }
+    char *p = text;
+    pos->seq = strtoll(p, &p, 10);
+    while (*p == ',') {
+        char *name = p + 1;
+        char *eq = strchr(name, '=');
+        if (!eq) {
+            break;
+        }
+        *eq = '\0';
+        repl_channel_t *c = find_channel(pos, name);
+        uint32_t ts = (uint32_t)strtoul(eq + 1, &p, 10);
+        if (c) {
+            c->ts = ts;
+        }
+    }
+}
+
+static void save_position(repl_t *r, bool force)
+{
+    int64_t now = esp_timer_get_time();
+    if (!r->dirty || (!force && now - r->saved_at < REPL_SAVE_EVERY_US)) {
+        return;
+    }
+    char text[REPL_POS_TEXT_MAX];
+    int len = snprintf(text, sizeof(text), "%lld", (long long)r->acked.seq);
+    for (int i = 0; i < r->acked.channel_count && len < (int)sizeof(text); i++) {
+        len += snprintf(text + len, sizeof(text) - len, ",%s=%u", r->acked.channels[i].name,
+                        (unsigned)r->acked.channels[i].ts);
+    }
+    if (nvsman_set_str(REPL_POS_KEY, text) == 0) {
+        r->dirty = false;
+        r->saved_at = now;
+    }
+}
+
+/* ---- batches ---- */
+
+static int body_sink(void *ctx, const uint8_t *data, size_t len)
+{
+    repl_t *r = ctx;
+    if (r->body_len + len > r->body_cap) {
+        size_t cap = r->body_cap ? r->body_cap * 2 : CONFIG_APP_REPL_BATCH_BYTES / 2;
+        while (cap < r->body_len + len) {
+            cap *= 2;
+        }
+        uint8_t *body = cap <= REPL_BODY_LIMIT ? realloc(r->body, cap) : NULL;
+        if (!body) {
+            return -1;
+        }
+        r->body = body;
+        r->body_cap = cap;
+    }
+    memcpy(r->body + r->body_len, data, len);
+    r->body_len += len;
+    return 0;
+}
+
+static int gzip_sink(void *ctx, const void *data, size_t len)
+{
+    return gz_write(ctx, data, len) == 0 ? 0 : -1;
+}
+
+static bool batch_full(const repl_t *r)
+{
+    return r->out.offset >= CONFIG_APP_REPL_BATCH_BYTES;
+}
+
+static int add_changes(repl_t *r, repl_pos_t *pos)
+{
+#if CONFIG_APP_USE_SQLITE3
+    if (!db_sync_covers(pos->seq)) {
+        log_warn("repl", "Change log no longer reaches seq %lld, sending it all again",
+                 (long long)pos->seq);
+        pos->seq = 0;
+    }
+    while (!batch_full(r)) {
+        int64_t last;
+        int n = db_sync_write_changes(&r->out, pos->seq, REPL_CHANGES_STEP, &last);
+        if (n < 0) {
+            return -1;
+        }
+        r->records += (uint32_t)n;
+        if (last == pos->seq) {
+            break;
+        }
+        pos->seq = last;
+    }
+#else
+    (void)r;
+    (void)pos;
+#endif
+    return 0;
+}
+
+static int add_readings(repl_t *r, repl_pos_t *pos)
+{
+    sensor_value_t channels[SENSOR_MAX_CHANNELS];
+    int count = sensors_get_current(channels, SENSOR_MAX_CHANNELS);
+    for (int i = 0; i < count && !batch_full(r); i++) {
+        ts_series_t *series = sensors_get_series(channels[i].name);
+        repl_channel_t *c = series ? find_channel(pos, channels[i].name) : NULL;
+        ts_iter_t it;
+        if (!c || ts_iter_begin(series, c->ts + 1, UINT32_MAX, &it) != 0) {
+            continue;
+        }
+        ts_sample_t sample;
+        int rc;
+        while ((rc = ts_iter_next(&it, &sample)) == 1) {
+            if (batch_full(r) && sample.timestamp != c->ts) {
+                break;
+            }
+            doc_out_printf(&r->out, "{\"channel\":\"%s\",\"t\":%u,\"v\":%.2f}\n", c->name,
+                           (unsigned)sample.timestamp, sample.value);
+            c->ts = sample.timestamp;
+            r->records++;
+        }
+        ts_iter_end(&it);
+        if (rc < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Everything after from, up to the size limit, gzipped into r->body.
+ * Returns the records in it, 0 when there is nothing new, or -1. */
+static int build_batch(repl_t *r, const repl_pos_t *from, repl_pos_t *to)
+{
+    *to = *from;
+    r->body_len = 0;
+    r->records = 0;
+    r->gz = gz_open(body_sink, r);
+    if (!r->gz) {
+        return -1;
+    }
+    doc_out_init(&r->out, gzip_sink, r->gz);
+    int rc = add_changes(r, to);
+    if (rc == 0) {
+        rc = add_readings(r, to);
+    }
+    if (rc == 0 && (doc_out_flush(&r->out) != 0 || gz_finish(r->gz) != 0)) {
+        rc = -1;
+    }
+    gz_close(r->gz);
+    r->gz = NULL;
+    if (rc != 0) {
+        log_error("repl", "Failed to build a batch");
+        return -1;
+    }
+    return (int)r->records;
+}
+
+/* ---- connection ---- */
+
+static bool load_target(repl_target_t *t)
+{
+    char user[REPL_VALUE_MAX] = "";
+    char pass[REPL_VALUE_MAX] = "";
+    memset(t, 0, sizeof(*t));
+    // The server if one is set, else the database host itself
+    if (nvsman_get_str("srv_host", t->host, sizeof(t->host)) == 0 && t->host[0]) {
+        nvsman_get_str("srv_port", t->port, sizeof(t->port));
+    } else if (nvsman_get_str("db_host", t->host, sizeof(t->host)) == 0 && t->host[0]) {
+        nvsman_get_str("db_port", t->port, sizeof(t->port));
+    }
+    if (!t->host[0]) {
+        return false;
+    }
+    if (!t->port[0]) {
+        strcpy(t->port, REPL_DEFAULT_PORT);
+    }
+    nvsman_get_str("db_name", t->database, sizeof(t->database));
+    if (nvsman_get_str("srv_user", user, sizeof(user)) == 0 && user[0]) {
+#if !CONFIG_APP_REPL_TLS
+        // Basic credentials in clear text would go to anyone on the path
+        static bool s_warned;
+        if (!s_warned) {
+            log_error("repl", "A server user is set but CONFIG_APP_REPL_TLS is off; not replicating");
+            s_warned = true;
+        }
+        return false;
+#endif
+        char credentials[2 * REPL_VALUE_MAX];
+        size_t len = 0;
+        nvsman_get_str("srv_pass", pass, sizeof(pass));
+        snprintf(credentials, sizeof(credentials), "%s:%s", user, pass);
+        mbedtls_base64_encode((unsigned char *)t->auth, sizeof(t->auth), &len,
+                              (const unsigned char *)credentials, strlen(credentials));
+    }
+    uint8_t mac[6];
+    esp_wifi_get_mac(WIFI_IF_STA, mac);
+    snprintf(t->device, sizeof(t->device), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2],
+             mac[3], mac[4], mac[5]);
+    return true;
+}
+
+#if CONFIG_APP_REPL_TLS
+
+static int open_connection(repl_t *r)
+{
+    const repl_target_t *t = &r->target;
+    // timeout_ms also becomes the socket's send and receive timeout
+    esp_tls_cfg_t cfg = {
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .timeout_ms = REPL_IO_TIMEOUT_S * 1000,
+    };
+    r->tls = esp_tls_init();
+    if (!r->tls || esp_tls_conn_new_sync(t->host, strlen(t->host), atoi(t->port), &cfg, r->tls) != 1) {
+        esp_tls_conn_destroy(r->tls);
+        r->tls = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void close_connection(repl_t *r)
+{
+    esp_tls_conn_destroy(r->tls);
+    r->tls = NULL;
+}
+
+static int conn_send(repl_t *r, const void *data, size_t len)
+{
+    return (int)esp_tls_conn_write(r->tls, data, len);
+}
+
+static int conn_recv(repl_t *r, void *buf, size_t len)
+{
+    return (int)esp_tls_conn_read(r->tls, buf, len);
+}
+
+#else
+
+static int open_connection(repl_t *r)
+{
+    const repl_target_t *t = &r->target;
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(t->host, t->port, &hints, &res) != 0 || !res) {
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, 0);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd >= 0) {
+        struct timeval tv = { .tv_sec = REPL_IO_TIMEOUT_S };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+    r->fd = fd;
+    return fd >= 0 ? 0 : -1;
+}
+
+static void close_connection(repl_t *r)
+{
+    close(r->fd);
+    r->fd = -1;
+}
+
+static int conn_send(repl_t *r, const void *data, size_t len)
+{
+    return send(r->fd, data, len, 0);
+}
+
+static int conn_recv(repl_t *r, void *buf, size_t len)
+{
+    return recv(r->fd, buf, len, 0);
+}
+
+#endif /* CONFIG_APP_REPL_TLS */
+
+static int send_all(repl_t *r, const void *data, size_t len)
+{
+    const char *p = data;
+    while (len > 0) {
+        int n = conn_send(r, p, len);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int send_batch(repl_t *r, uint32_t id)
+{
+    const repl_target_t *t = &r->target;
+    char head[REPL_HEAD_MAX];
+    int len = snprintf(head, sizeof(head),
+                       "POST " CONFIG_APP_REPL_PATH " HTTP/1.1\r\n"
+                       "Host: %s:%s\r\n"
+                       "Content-Type: application/x-ndjson\r\n"
+                       "Content-Encoding: gzip\r\n"
+                       "Content-Length: %u\r\n"
+                       "X-Batch: %u\r\n"
+                       "X-Device: %s\r\n"
+                       "X-Database: %s\r\n"
+                       "%s%s%s"
+                       "\r\n",
+                       t->host, t->port, (unsigned)r->body_len, (unsigned)id, t->device, t->database,
+                       t->auth[0] ? "Authorization: Basic " : "", t->auth, t->auth[0] ? "\r\n" : "");
+    if (len >= (int)sizeof(head)) {
+        return -1;
+    }
+    return send_all(r, head, (size_t)len) == 0 && send_all(r, r->body, r->body_len) == 0 ? 0 : -1;
+}
+
+/* One line of a response head, without its CRLF. */
+static int recv_line(repl_t *r, char *line, size_t size)
+{
+    for (;;) {
+        char *nl = memchr(r->rx, '\n', r->rx_len);
+        if (nl) {
+            size_t used = (size_t)(nl - r->rx) + 1;
+            size_t n = used - 1;
+            if (n > 0 && r->rx[n - 1] == '\r') {
+                n--;
+            }
+            n = n < size - 1 ? n : size - 1;
+            memcpy(line, r->rx, n);
+            line[n] = '\0';
+            memmove(r->rx, r->rx + used, r->rx_len - used);
+            r->rx_len -= used;
+            return 0;
+        }
+        if (r->rx_len == sizeof(r->rx)) {
+            return -1;
+        }
+        int n = conn_recv(r, r->rx + r->rx_len, sizeof(r->rx) - r->rx_len);
+        if (n <= 0) {
+            return -1;
+        }
+        r->rx_len += (size_t)n;
+    }
+}
+
+static int skip_body(repl_t *r, size_t len)
+{
+    size_t buffered = len < r->rx_len ? len : r->rx_len;
+    memmove(r->rx, r->rx + buffered, r->rx_len - buffered);
+    r->rx_len -= buffered;
+    len -= buffered;
+    while (len > 0) {
+        int n = conn_recv(r, r->rx, len < sizeof(r->rx) ? len : sizeof(r->rx));
+        if (n <= 0) {
+            return -1;
+        }
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Reads the response to batch id: 0 when it acknowledges it. */
+static int recv_ack(repl_t *r, uint32_t id, bool *closing)
+{
+    char line[REPL_RX_MAX];
+    int status = 0;
+    if (recv_line(r, line, sizeof(line)) != 0 || sscanf(line, "HTTP/1.%*d %d", &status) != 1) {
+        log_warn("repl", "No response to batch %u", (unsigned)id);
+        return -1;
+    }
+    size_t content_len = 0;
+    long ack = -1;
+    for (;;) {
+        if (recv_line(r, line, sizeof(line)) != 0) {
+            return -1;
+        }
+        if (!line[0]) {
+            break;
+        }
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            content_len = strtoul(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "X-Ack:", 6) == 0) {
+            ack = strtol(line + 6, NULL, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close")) {
+            *closing = true;
+        }
+    }
+    if (skip_body(r, content_len) != 0) {
+        return -1;
+    }
+    if (status < 200 || status > 299) {
+        log_warn("repl", "Batch %u refused with HTTP %d", (unsigned)id, status);
+        return -1;
+    }
+    if (ack != (long)id) {
+        log_warn("repl", "Batch %u answered with X-Ack %ld", (unsigned)id, ack);
+        return -1;
+    }
+    return 0;
+}
+
+/* 0 once caught up, 1 when the server closed the connection early,
+ * -1 on failure.  Either way r->acked is where the next one resumes. */
+static int run_session(repl_t *r)
+{
+    if (open_connection(r) != 0) {
+        log_warn("repl", "Cannot connect to %s:%s", r->target.host, r->target.port);
+        return -1;
+    }
+    s_status.connected = true;
+    r->rx_len = 0;
+
+    repl_pos_t sent = r->acked;
+    int head = 0;
+    int in_flight = 0;
+    bool closing = false;
+    int rc = 0;
+    for (;;) {
+        while (in_flight < CONFIG_APP_REPL_WINDOW && !closing) {
+            repl_slot_t *slot = &r->slots[(head + in_flight) % CONFIG_APP_REPL_WINDOW];
+            int records = build_batch(r, &sent, &slot->end);
+            if (records <= 0) {
+                rc = records;
+                break;
+            }
+            slot->id = ++r->next_id;
+            if (send_batch(r, slot->id) != 0) {
+                log_warn("repl", "Send of batch %u failed", (unsigned)slot->id);
+                rc = -1;
+                break;
+            }
+            sent = slot->end;
+            in_flight++;
+        }
+        if (rc != 0 || in_flight == 0) {
+            break;
+        }
+        if (recv_ack(r, r->slots[head].id, &closing) != 0) {
+            rc = -1;
+            break;
+        }
+        r->acked = r->slots[head].end;
+        r->dirty = true;
+        head = (head + 1) % CONFIG_APP_REPL_WINDOW;
+        in_flight--;
+        s_status.batches_acked++;
+        s_status.acked_seq = r->acked.seq;
+        save_position(r, false);
+        if (closing) {
+            rc = 1;     // Anything still in flight is sent again
+            break;
+        }
+    }
+    close_connection(r);
+    s_status.connected = false;
+    save_position(r, true);
+    free(r->body);
+    r->body = NULL;
+    r->body_cap = 0;
+    return rc;
+}
+
+static void replicator_task(void *arg)
+{
+    repl_t *r = arg;
+    uint32_t backoff = REPL_BACKOFF_MIN_S;
+    load_position(&r->acked);
+    log_info("repl", "Resuming after seq %lld, %d channel(s)", (long long)r->acked.seq,
+             r->acked.channel_count);
+    for (;;) {
+        uint32_t wait = CONFIG_APP_REPL_INTERVAL_S;
+        if (load_target(&r->target)) {
+            int rc = run_session(r);
+            if (rc < 0) {
+                s_status.failures++;
+                wait = backoff;
+                backoff = backoff * 2 < REPL_BACKOFF_MAX_S ? backoff * 2 : REPL_BACKOFF_MAX_S;
+            } else {
+                backoff = REPL_BACKOFF_MIN_S;
+                wait = rc == 1 ? 0 : wait;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(wait * 1000) + 1);
+    }
+}
+
+int replicator_start(void)
+{
+    static repl_t *s_repl;
+    if (s_repl) {
+        return 0;
+    }
+    s_repl = calloc(1, sizeof(*s_repl));
+    if (!s_repl) {
+        return -1;
+    }
+#if !CONFIG_APP_REPL_TLS
+    s_repl->fd = -1;
+#endif
+    if (xTaskCreate(replicator_task, "replicator", REPL_TASK_STACK, s_repl, REPL_TASK_PRIO, NULL) != pdPASS) {
+        log_error("repl", "Failed to create the replication task");
+        free(s_repl);
+        s_repl = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void replicator_get_status(replicator_status_t *out)
+{
+    *out = s_status;
+}
+
+#else /* !CONFIG_APP_REPLICATION */
+
+int replicator_start(void)
+{
+    return 0;
+}
+
+void replicator_get_status(replicator_status_t *out)
+{
+    memset(out, 0, sizeof(*out));
+}
+
+#endif /* CONFIG_APP_REPLICATION */
@@ -0,0 +1,39 @@
+#ifndef REPLICATOR_H
+#define REPLICATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Upstream replication to the configured server.
+ *
+ * A background task sends everything recorded locally to the server
+ * set on the config page (srv_host:srv_port, or db_host:db_port when
+ * no server is set): record mutations from the change log in seq order
+ * (database/db_sync.h) and sensor readings from the archives in
+ * timestamp order.  They go as gzipped NDJSON batches, POSTed to
+ * CONFIG_APP_REPL_PATH and pipelined CONFIG_APP_REPL_WINDOW deep on one
+ * keep-alive connection, over TLS unless CONFIG_APP_REPL_TLS is off.
+ * Credentials (srv_user/srv_pass, as HTTP Basic) are only sent over
+ * TLS.
+ *
+ * The server acknowledges each batch with a 2xx response carrying
+ * "X-Ack: <X-Batch of the request>".  The position after the last
+ * acknowledged batch is saved in NVS.  A reconnect or reboot resumes
+ * from it, so delivery is at least once: the server should upsert
+ * mutations by (table, key) and readings by (channel, t).  Every
+ * request also carries X-Device (the STA MAC) and X-Database (db_name).
+ * tools/replication_server.py is a stand-in server for testing.
+ */
+
+typedef struct {
+    bool connected;             // A session is open
+    int64_t acked_seq;          // Change log seq acknowledged
+    uint32_t batches_acked;     // Since boot
+    uint32_t failures;          // Sessions ended by an error, since boot
+} replicator_status_t;
+
+int replicator_start(void);
+void replicator_get_status(replicator_status_t *out);
+
+#endif /* REPLICATOR_H */
@@ -1,59 +1,358 @@
 #include <stdio.h>
+#include <string.h>
 #include "adc_sensors.h"
-#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_attr.h"
 #include "esp_err.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "utils/logger.h"
 
 /*
  * ADC sensors implementation.
  *
- * This module configures the ADC1 peripheral for 12‑bit reads and
- * provides functions to read raw values and convert them to a
- * voltage.  Calibration support is omitted for brevity; refer to
- * the ESP‑IDF ADC calibration example for full calibration.
+ * ADC1 runs in continuous mode: every registered channel is part of
+ * one conversion pattern and results are written by DMA into frames
+ * of ADC_FRAME_BYTES.  The conversion-done ISR only wakes the ADC
+ * task, which drains the frames and runs the per-channel pipeline:
+ *
+ *   raw -> oversampling average -> median window -> IIR -> calibration
+ *
+ * Calibration uses curve fitting where the chip supports it (ESP32-S3)
+ * and line fitting otherwise, one scheme per attenuation.  Results are
+ * published through a sequence counter so readers on any task get a
+ * consistent copy without taking a lock.
  */
 
-static adc_oneshot_unit_handle_t s_adc_handle;
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_OUTPUT_TYPE           ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_GET_CHANNEL(p)        ((p)->type1.channel)
+#define ADC_GET_DATA(p)           ((p)->type1.data)
+#else
+#define ADC_OUTPUT_TYPE           ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_GET_CHANNEL(p)        ((p)->type2.channel)
+#define ADC_GET_DATA(p)           ((p)->type2.data)
+#endif
+
+#define ADC_TASK_STACK    3072
+#define ADC_TASK_PRIO     5
+#define ADC_ATTEN_COUNT   4
+#define ADC_CHANNEL_NONE  0xFF
+#define ADC_IIR_FRAC_BITS 8
+
+typedef struct {
+    adc_channel_cfg_t cfg;
+    // Decimation state
+    uint32_t acc;
+    uint16_t acc_count;
+    // Median window (ring of decimated values)
+    uint16_t window[ADC_MEDIAN_MAX];
+    uint8_t window_len;
+    uint8_t window_pos;
+    // IIR state in fixed point
+    int32_t iir;
+    bool iir_primed;
+    // Published value
+    volatile uint32_t seq;
+    adc_reading_t latest;
+} adc_slot_t;
+
+static const char *TAG_ADC = "adc";
+static const adc_atten_t s_atten_map[ADC_ATTEN_COUNT] = {
+    ADC_ATTEN_DB_0, ADC_ATTEN_DB_2_5, ADC_ATTEN_DB_6, ADC_ATTEN_DB_12
+};
+
+static adc_continuous_handle_t s_adc_handle;
+static adc_cali_handle_t s_cali[ADC_ATTEN_COUNT];
+static adc_slot_t s_slots[ADC_SENSORS_MAX_CHANNELS];
+static uint8_t s_slot_count;
+static uint8_t s_channel_to_slot[SOC_ADC_MAX_CHANNEL_NUM];
+static TaskHandle_t s_adc_task;
+static bool s_running;
+
+static bool IRAM_ATTR adc_conv_done_cb(adc_continuous_handle_t handle,
+                                       const adc_continuous_evt_data_t *edata,
+                                       void *user_data)
+{
+    (void)handle;
+    (void)edata;
+    (void)user_data;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_adc_task, &woken);
+    return woken == pdTRUE;
+}
+
+static uint16_t median_of(const uint16_t *values, uint8_t len)
+{
+    uint16_t sorted[ADC_MEDIAN_MAX];
+    memcpy(sorted, values, len * sizeof(values[0]));
+    for (uint8_t i = 1; i < len; i++) {
+        uint16_t v = sorted[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > v) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+    return sorted[len / 2];
+}
+
+static int raw_to_mv(adc_probe_atten_t atten, int raw)
+{
+    int mv = 0;
+    if (s_cali[atten] && adc_cali_raw_to_voltage(s_cali[atten], raw, &mv) == ESP_OK) {
+        return mv;
+    }
+    // Uncalibrated fallback: nominal full scale per attenuation
+    static const int full_scale_mv[ADC_ATTEN_COUNT] = { 950, 1250, 1750, 3100 };
+    return raw * full_scale_mv[atten] / 4095;
+}
+
+static void slot_publish(adc_slot_t *slot, int raw)
+{
+    int mv = raw_to_mv(slot->cfg.atten, raw);
+    // Odd sequence = update in progress; readers retry.  The fence keeps
+    // the payload stores after the odd count (a release on the count
+    // itself only orders what came before it); the closing release
+    // publishes them with the even one.
+    __atomic_add_fetch(&slot->seq, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->latest.raw = raw;
+    slot->latest.millivolts = mv;
+    slot->latest.samples++;
+    slot->latest.timestamp_us = esp_timer_get_time();
+    __atomic_add_fetch(&slot->seq, 1, __ATOMIC_RELEASE);
+}
+
+static void slot_push(adc_slot_t *slot, uint32_t raw)
+{
+    slot->acc += raw;
+    if (++slot->acc_count < slot->cfg.oversample) {
+        return;
+    }
+    uint16_t decimated = (uint16_t)(slot->acc / slot->acc_count);
+    slot->acc = 0;
+    slot->acc_count = 0;
+
+    uint16_t value = decimated;
+    if (slot->cfg.median_window > 1) {
+        slot->window[slot->window_pos] = decimated;
+        slot->window_pos = (slot->window_pos + 1) % slot->cfg.median_window;
+        if (slot->window_len < slot->cfg.median_window) {
+            slot->window_len++;
+        }
+        value = median_of(slot->window, slot->window_len);
+    }
+
+    if (slot->cfg.iir_shift > 0) {
+        int32_t x = (int32_t)value << ADC_IIR_FRAC_BITS;
+        if (!slot->iir_primed) {
+            slot->iir = x;
+            slot->iir_primed = true;
+        } else {
+            slot->iir += (x - slot->iir) >> slot->cfg.iir_shift;
+        }
+        value = (uint16_t)((slot->iir + (1 << (ADC_IIR_FRAC_BITS - 1))) >> ADC_IIR_FRAC_BITS);
+    }
+    slot_publish(slot, value);
+}
+
+static void adc_task(void *arg)
+{
+    (void)arg;
+    static uint8_t frame[ADC_FRAME_BYTES];
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (;;) {
+            uint32_t len = 0;
+            esp_err_t err = adc_continuous_read(s_adc_handle, frame, sizeof(frame), &len, 0);
+            if (err != ESP_OK) {
+                // ESP_ERR_TIMEOUT: pool drained until the next ISR
+                break;
+            }
+            for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+                const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&frame[i];
+                uint32_t ch = ADC_GET_CHANNEL(p);
+                if (ch >= SOC_ADC_MAX_CHANNEL_NUM || s_channel_to_slot[ch] == ADC_CHANNEL_NONE) {
+                    continue;
+                }
+                slot_push(&s_slots[s_channel_to_slot[ch]], ADC_GET_DATA(p));
+            }
+        }
+    }
+}
 
 int adc_init(void)
 {
-    adc_oneshot_unit_init_cfg_t init_config = {
-        .unit_id = ADC_UNIT_1,
-        .ulp_mode = ADC_ULP_MODE_DISABLE
+    if (s_adc_handle) {
+        return 0;
+    }
+    memset(s_channel_to_slot, ADC_CHANNEL_NONE, sizeof(s_channel_to_slot));
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = ADC_FRAME_BYTES * 4,
+        .conv_frame_size = ADC_FRAME_BYTES,
     };
-    esp_err_t err = adc_oneshot_new_unit(&init_config, &s_adc_handle);
-    return (err == ESP_OK) ? 0 : -1;
+    if (adc_continuous_new_handle(&handle_cfg, &s_adc_handle) != ESP_OK) {
+        log_error(TAG_ADC, "Failed to create continuous ADC handle");
+        return -1;
+    }
+    return adc_calibrate();
 }
 
-int adc_read_raw(int channel, int *value)
+int adc_add_channel(const adc_channel_cfg_t *cfg)
 {
-    if (!value) {
+    if (!cfg || s_running || s_slot_count >= ADC_SENSORS_MAX_CHANNELS) {
         return -1;
     }
-    if (!s_adc_handle) {
+    if (cfg->channel < 0 || cfg->channel >= SOC_ADC_MAX_CHANNEL_NUM ||
+        cfg->atten > ADC_PROBE_ATTEN_12DB || cfg->median_window > ADC_MEDIAN_MAX ||
+        cfg->iir_shift > 7 || s_channel_to_slot[cfg->channel] != ADC_CHANNEL_NONE) {
         return -1;
     }
-    adc_channel_t ch = (adc_channel_t)channel;
-    adc_oneshot_chan_cfg_t chan_cfg = {
-        .atten = ADC_ATTEN_DB_12,
-        .bitwidth = ADC_BITWIDTH_12
+    adc_slot_t *slot = &s_slots[s_slot_count];
+    memset(slot, 0, sizeof(*slot));
+    slot->cfg = *cfg;
+    if (slot->cfg.oversample == 0) {
+        slot->cfg.oversample = 1;
+    }
+    if (slot->cfg.median_window == 0) {
+        slot->cfg.median_window = 1;
+    }
+    s_channel_to_slot[cfg->channel] = s_slot_count++;
+    return 0;
+}
+
+int adc_start(void)
+{
+    if (!s_adc_handle || s_slot_count == 0) {
+        return -1;
+    }
+    if (s_running) {
+        return 0;
+    }
+    adc_digi_pattern_config_t pattern[ADC_SENSORS_MAX_CHANNELS] = { 0 };
+    for (uint8_t i = 0; i < s_slot_count; i++) {
+        pattern[i].unit = ADC_UNIT_1;
+        pattern[i].channel = s_slots[i].cfg.channel;
+        pattern[i].atten = s_atten_map[s_slots[i].cfg.atten];
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = s_slot_count,
+        .adc_pattern = pattern,
+        .sample_freq_hz = ADC_SAMPLE_FREQ_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_OUTPUT_TYPE,
     };
-    if (adc_oneshot_config_channel(s_adc_handle, ch, &chan_cfg) != ESP_OK) {
+    if (adc_continuous_config(s_adc_handle, &dig_cfg) != ESP_OK) {
+        log_error(TAG_ADC, "Failed to configure ADC pattern");
         return -1;
     }
-    if (adc_oneshot_read(s_adc_handle, ch, value) != ESP_OK) {
+    if (!s_adc_task &&
+        xTaskCreate(adc_task, "adc", ADC_TASK_STACK, NULL, ADC_TASK_PRIO, &s_adc_task) != pdPASS) {
         return -1;
     }
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = adc_conv_done_cb,
+    };
+    if (adc_continuous_register_event_callbacks(s_adc_handle, &cbs, NULL) != ESP_OK ||
+        adc_continuous_start(s_adc_handle) != ESP_OK) {
+        log_error(TAG_ADC, "Failed to start continuous ADC");
+        return -1;
+    }
+    s_running = true;
+    log_info(TAG_ADC, "Continuous ADC started: %d channel(s) at %d Hz",
+             s_slot_count, ADC_SAMPLE_FREQ_HZ);
+    return 0;
+}
+
+int adc_stop(void)
+{
+    if (!s_running) {
+        return 0;
+    }
+    if (adc_continuous_stop(s_adc_handle) != ESP_OK) {
+        return -1;
+    }
+    s_running = false;
+    return 0;
+}
+
+int adc_get_latest(int channel, adc_reading_t *out)
+{
+    if (!out || !s_adc_handle || channel < 0 || channel >= SOC_ADC_MAX_CHANNEL_NUM ||
+        s_channel_to_slot[channel] == ADC_CHANNEL_NONE) {
+        return -1;
+    }
+    const adc_slot_t *slot = &s_slots[s_channel_to_slot[channel]];
+    uint32_t before, after;
+    do {
+        // Acquire on the first count orders the copy after it; the fence,
+        // paired with slot_publish()'s, keeps it before the second count
+        before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        *out = slot->latest;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    } while (before != after || (before & 1));
+    return (out->samples > 0) ? 0 : -1;
+}
+
+int adc_read_raw(int channel, int *value)
+{
+    if (!value) {
+        return -1;
+    }
+    adc_reading_t reading;
+    if (adc_get_latest(channel, &reading) != 0) {
+        return -1;
+    }
+    *value = reading.raw;
     return 0;
 }
 
 int adc_calibrate(void)
 {
-    // Calibration is not implemented; return success
+    int created = 0;
+    for (int i = 0; i < ADC_ATTEN_COUNT; i++) {
+        if (s_cali[i]) {
+            created++;
+            continue;
+        }
+        esp_err_t err = ESP_ERR_NOT_SUPPORTED;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+        adc_cali_curve_fitting_config_t cali_cfg = {
+            .unit_id = ADC_UNIT_1,
+            .atten = s_atten_map[i],
+            .bitwidth = ADC_BITWIDTH_DEFAULT,
+        };
+        err = adc_cali_create_scheme_curve_fitting(&cali_cfg, &s_cali[i]);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+        adc_cali_line_fitting_config_t cali_cfg = {
+            .unit_id = ADC_UNIT_1,
+            .atten = s_atten_map[i],
+            .bitwidth = ADC_BITWIDTH_DEFAULT,
+        };
+        err = adc_cali_create_scheme_line_fitting(&cali_cfg, &s_cali[i]);
+#endif
+        if (err == ESP_OK) {
+            created++;
+        } else {
+            s_cali[i] = NULL;
+        }
+    }
+    if (created == 0) {
+        // No eFuse calibration data: keep going with nominal scaling
+        log_warn(TAG_ADC, "ADC calibration unavailable, using nominal scale");
+    }
     return 0;
 }
 
 float adc_to_voltage(int raw)
 {
-    // Convert raw reading to voltage (approximate), assuming 12‑bit and 3.3V
-    return (float)raw * 3.3f / 4095.0f;
+    return (float)raw_to_mv(ADC_PROBE_ATTEN_12DB, raw) / 1000.0f;
 }
@@ -1,9 +1,57 @@
 #ifndef ADC_SENSORS_H
 #define ADC_SENSORS_H
 
+#include <stdint.h>
+
+/*
+ * Continuous (DMA) ADC sampling for analog probes.
+ *
+ * Channels are registered with adc_add_channel() and sampled in a
+ * single ADC1 conversion pattern by the DMA engine.  A background
+ * task decimates each channel (oversampling average), applies a
+ * median and IIR filter, converts to millivolts with the chip's
+ * calibration scheme and stores the result in a latest-value table.
+ * Readers never block: adc_get_latest() copies the newest entry.
+ */
+
+#define ADC_SENSORS_MAX_CHANNELS 6
+#define ADC_SAMPLE_FREQ_HZ       2000   // Total rate shared by all channels
+#define ADC_FRAME_BYTES          256    // DMA conversion frame size
+#define ADC_MEDIAN_MAX           5
+
+typedef enum {
+    ADC_PROBE_ATTEN_0DB = 0,    // ~0–950 mV
+    ADC_PROBE_ATTEN_2_5DB,      // ~0–1250 mV
+    ADC_PROBE_ATTEN_6DB,        // ~0–1750 mV
+    ADC_PROBE_ATTEN_12DB,       // ~0–3100 mV
+} adc_probe_atten_t;
+
+typedef struct {
+    int channel;                // ADC1 channel number
+    adc_probe_atten_t atten;
+    uint16_t oversample;        // Raw samples averaged per output (>= 1)
+    uint8_t median_window;      // 1 (off), 3 or 5
+    uint8_t iir_shift;          // IIR weight 1/2^shift, 0 = off
+} adc_channel_cfg_t;
+
+typedef struct {
+    int raw;                    // Filtered raw code
+    int millivolts;             // Calibrated voltage
+    uint32_t samples;           // Outputs produced since start
+    int64_t timestamp_us;       // esp_timer time of last update
+} adc_reading_t;
+
 int adc_init(void);
+int adc_add_channel(const adc_channel_cfg_t *cfg);
+int adc_start(void);
+int adc_stop(void);
+int adc_get_latest(int channel, adc_reading_t *out);
+
+/* Compatibility helpers.  adc_read_raw() returns the latest filtered
+ * code of a registered channel; adc_to_voltage() converts a code
+ * measured at 12 dB attenuation. */
 int adc_read_raw(int channel, int *value);
 int adc_calibrate(void);
 float adc_to_voltage(int raw);
 
-#endif /* ADC_SENSORS_H */
\ No newline at end of file
+#endif /* ADC_SENSORS_H */
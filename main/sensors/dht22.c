@@ -1,21 +1,186 @@
 #include <stdio.h>
+#include <string.h>
 #include "dht22.h"
-#include "esp_random.h"
-#include "esp_system.h"
+#include "app_config.h"
+#include "driver/gpio.h"
+#include "driver/rmt_rx.h"
+#include "esp_attr.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "soc/soc_caps.h"
+#include "utils/logger.h"
 
 /*
- * Simple DHT22 driver.
+ * DHT22 driver using the RMT peripheral.
  *
- * For demonstration purposes this implementation returns pseudo‑random
- * temperature and humidity values.  A real implementation would
- * perform the DHT22 start signal handshake and bit‑bang the GPIO
- * lines to read the sensor data.  See the ESP‑IDF example
- * "dht" component for a production ready driver.
+ * A read pulls the open-drain line low for ~1.2 ms, arms the RMT
+ * receiver and releases the line.  The sensor's answer (80 µs low/high preamble followed by 40 bits encoded as
+ * 50 µs low + 26 µs or 70 µs high) is timestamped by the RMT hardware
+ * at 1 µs resolution; the receive ends when the line idles high.  The
+ * done-callback only hands the symbol count to the reading task, which
+ * decodes and checks the checksum outside interrupt context
+ * (dht22_frame.c).
  */
 
+#define DHT22_RMT_RESOLUTION_HZ  1000000   // 1 tick = 1 µs
+#define DHT22_START_LOW_US       1200
+#define DHT22_FILTER_NS          3000      // Ignore glitches shorter than 3 µs
+#define DHT22_IDLE_NS            200000    // Line high for 200 µs = frame done
+#define DHT22_RX_TIMEOUT_MS      20
+#define DHT22_SYMBOLS            SOC_RMT_MEM_WORDS_PER_CHANNEL
+
+typedef struct {
+    int gpio;
+    rmt_channel_handle_t channel;
+    QueueHandle_t done_queue;
+    rmt_symbol_word_t symbols[DHT22_SYMBOLS];
+    // Cached result and rate limiting
+    float temperature;
+    float humidity;
+    int64_t sample_us;          // Capture time of the cached sample, 0 = none
+    int64_t next_attempt_us;
+    uint32_t failures;
+} dht22_dev_t;
+
+static dht22_dev_t s_devs[DHT22_MAX_SENSORS];
+static int s_dev_count = 0;
+
+static bool IRAM_ATTR dht22_rx_done_cb(rmt_channel_handle_t channel,
+                                       const rmt_rx_done_event_data_t *edata,
+                                       void *user_data)
+{
+    (void)channel;
+    BaseType_t woken = pdFALSE;
+    size_t count = edata->num_symbols;
+    xQueueSendFromISR((QueueHandle_t)user_data, &count, &woken);
+    return woken == pdTRUE;
+}
+
+static int dht22_capture(dht22_dev_t *dev, float *temperature, float *humidity)
+{
+    const rmt_receive_config_t rx_cfg = {
+        .signal_range_min_ns = DHT22_FILTER_NS,
+        .signal_range_max_ns = DHT22_IDLE_NS,
+    };
+    size_t received = 0;
+    xQueueReset(dev->done_queue);
+
+    // Host start signal: hold the line low, then arm and release.  The
+    // 1.2 ms wait is shorter than a tick, so it busy-waits with
+    // interrupts left enabled.
+    gpio_set_level(dev->gpio, 0);
+    esp_rom_delay_us(DHT22_START_LOW_US);
+    if (rmt_receive(dev->channel, dev->symbols, sizeof(dev->symbols), &rx_cfg) != ESP_OK) {
+        gpio_set_level(dev->gpio, 1);
+        return -1;
+    }
+    gpio_set_level(dev->gpio, 1);
+
+    if (xQueueReceive(dev->done_queue, &received, pdMS_TO_TICKS(DHT22_RX_TIMEOUT_MS)) != pdTRUE) {
+        return -1;
+    }
+    uint16_t highs[DHT22_FRAME_BITS + 2];
+    dht22_pulses_t pulses;
+    dht22_pulses_init(&pulses, highs, sizeof(highs) / sizeof(highs[0]));
+    for (size_t i = 0; i < received; i++) {
+        dht22_pulses_add(&pulses, dev->symbols[i].level0, dev->symbols[i].duration0);
+        dht22_pulses_add(&pulses, dev->symbols[i].level1, dev->symbols[i].duration1);
+    }
+    return dht22_decode(highs, pulses.count, temperature, humidity);
+}
+
+int dht22_add(int gpio)
+{
+    if (s_dev_count >= DHT22_MAX_SENSORS || gpio < 0) {
+        return -1;
+    }
+    dht22_dev_t *dev = &s_devs[s_dev_count];
+    memset(dev, 0, sizeof(*dev));
+    dev->gpio = gpio;
+    dev->done_queue = xQueueCreate(1, sizeof(size_t));
+    if (!dev->done_queue) {
+        return -1;
+    }
+    rmt_rx_channel_config_t chan_cfg = {
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = DHT22_RMT_RESOLUTION_HZ,
+        .mem_block_symbols = DHT22_SYMBOLS,
+        .gpio_num = gpio,
+    };
+    if (rmt_new_rx_channel(&chan_cfg, &dev->channel) != ESP_OK) {
+        log_error("dht22", "No RMT RX channel for GPIO %d", gpio);
+        return -1;
+    }
+    rmt_rx_event_callbacks_t cbs = {
+        .on_recv_done = dht22_rx_done_cb,
+    };
+    if (rmt_rx_register_event_callbacks(dev->channel, &cbs, dev->done_queue) != ESP_OK ||
+        rmt_enable(dev->channel) != ESP_OK) {
+        return -1;
+    }
+    // The RMT input stays routed; drive the same pad as open drain
+    // (external 4.7–10 kΩ pull-up expected, internal pull-up as backup).
+    gpio_set_direction(gpio, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(gpio, GPIO_PULLUP_ONLY);
+    gpio_set_level(gpio, 1);
+    log_info("dht22", "DHT22[%d] on GPIO %d", s_dev_count, gpio);
+    return s_dev_count++;
+}
+
 int dht22_init(void)
 {
-    // Nothing to initialise for the simple random generator
+    if (s_dev_count > 0) {
+        return 0;
+    }
+    return (dht22_add(APP_DHT22_GPIO) >= 0) ? 0 : -1;
+}
+
+int dht22_count(void)
+{
+    return s_dev_count;
+}
+
+int dht22_read_sensor(int index, dht22_sample_t *out)
+{
+    if (index < 0 || index >= s_dev_count || !out) {
+        return -1;
+    }
+    dht22_dev_t *dev = &s_devs[index];
+    int64_t now = esp_timer_get_time();
+    bool fresh = dev->sample_us != 0 &&
+                 now - dev->sample_us < (int64_t)DHT22_MIN_INTERVAL_MS * 1000;
+
+    if (!fresh && now >= dev->next_attempt_us) {
+        float t = 0.0f, h = 0.0f;
+        if (dht22_capture(dev, &t, &h) == 0) {
+            dev->temperature = t;
+            dev->humidity = h;
+            dev->sample_us = now;
+            dev->failures = 0;
+            dev->next_attempt_us = now + (int64_t)DHT22_MIN_INTERVAL_MS * 1000;
+        } else {
+            dev->failures++;
+            uint32_t backoff = dht22_backoff_ms(dev->failures);
+            dev->next_attempt_us = now + (int64_t)backoff * 1000;
+            log_warn("dht22", "DHT22[%d] read failed (%u in a row), retry in %u ms",
+                     index, (unsigned)dev->failures, (unsigned)backoff);
+        }
+    }
+
+    if (dev->sample_us == 0) {
+        return -1;
+    }
+    uint32_t age_ms = (uint32_t)((now - dev->sample_us) / 1000);
+    if (age_ms > DHT22_MAX_CACHE_AGE_MS) {
+        return -1;
+    }
+    out->temperature = dev->temperature;
+    out->humidity = dev->humidity;
+    out->age_ms = age_ms;
+    out->failures = dev->failures;
     return 0;
 }
 
@@ -24,9 +189,11 @@ int dht22_read(float *temperature, float *humidity)
     if (!temperature || !humidity) {
         return -1;
     }
-    // Generate deterministic pseudo‑random values in a reasonable range
-    uint32_t r = esp_random();
-    *temperature = 20.0f + (float)(r % 1000) / 100.0f; // 20.0 – 29.9°C
-    *humidity    = 40.0f + (float)((r >> 10) % 1000) / 100.0f; // 40 – 49.9 %RH
+    dht22_sample_t sample;
+    if (dht22_read_sensor(0, &sample) != 0) {
+        return -1;
+    }
+    *temperature = sample.temperature;
+    *humidity = sample.humidity;
     return 0;
 }
@@ -1,7 +1,39 @@
 #ifndef DHT22_H
 #define DHT22_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include "dht22_frame.h"
+
+/*
+ * DHT22 / AM2302 driver.
+ *
+ * The 40-bit response is captured by an RMT receive channel (one per
+ * sensor GPIO), so no interrupts are masked while the sensor talks.
+ * Reads are rate limited to the sensor's 2 s minimum interval: calls
+ * made sooner return the cached sample.  After a failed read the next
+ * attempt is pushed back exponentially while the last good sample is
+ * served until it goes stale.
+ */
+
+#define DHT22_MAX_SENSORS        4      // RMT RX channels on the ESP32-S3
+#define DHT22_MAX_CACHE_AGE_MS   30000
+
+typedef struct {
+    float temperature;      // °C
+    float humidity;         // %RH
+    uint32_t age_ms;        // Time since the sample was captured
+    uint32_t failures;      // Consecutive failed reads
+} dht22_sample_t;
+
+/* Register the default sensor (APP_DHT22_GPIO) */
 int dht22_init(void);
+/* Register an additional sensor; returns its index or -1 */
+int dht22_add(int gpio);
+int dht22_count(void);
+int dht22_read_sensor(int index, dht22_sample_t *out);
+
+/* Read the first sensor */
 int dht22_read(float *temperature, float *humidity);
 
-#endif /* DHT22_H */
\ No newline at end of file
+#endif /* DHT22_H */
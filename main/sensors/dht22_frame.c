@@ -0,0 +1,82 @@
+#include <string.h>
+#include "dht22_frame.h"
+
+/*
+ * DHT22 frame decoding.
+ *
+ * The driver feeds the RMT symbols of one capture through
+ * dht22_pulses_add(); a trace recorded with a logic analyser goes
+ * through the same path in the host test.  A capture cut short by the
+ * receive timeout simply has fewer than 40 bits and fails to decode.
+ */
+
+void dht22_pulses_init(dht22_pulses_t *p, uint16_t *high_us, size_t max)
+{
+    p->high_us = high_us;
+    p->max = max;
+    p->count = 0;
+    p->seen_low = false;
+}
+
+void dht22_pulses_add(dht22_pulses_t *p, int level, uint16_t duration_us)
+{
+    // A zero duration marks the end of the RMT buffer
+    if (duration_us == 0 || p->max == 0) {
+        return;
+    }
+    if (level == 0) {
+        p->seen_low = true;
+        return;
+    }
+    if (!p->seen_low) {
+        return;
+    }
+    if (p->count == p->max) {
+        // Keep the most recent pulses: the data bits are last
+        memmove(p->high_us, p->high_us + 1, (p->max - 1) * sizeof(p->high_us[0]));
+        p->count--;
+    }
+    p->high_us[p->count++] = duration_us;
+    p->seen_low = false;
+}
+
+int dht22_decode(const uint16_t *high_us, size_t count, float *temperature, float *humidity)
+{
+    if (!high_us || !temperature || !humidity || count < DHT22_FRAME_BITS) {
+        return -1;
+    }
+    uint8_t data[5] = { 0 };
+    const uint16_t *bits = high_us + (count - DHT22_FRAME_BITS);
+    for (int i = 0; i < DHT22_FRAME_BITS; i++) {
+        data[i / 8] <<= 1;
+        if (bits[i] > DHT22_BIT_THRESHOLD_US) {
+            data[i / 8] |= 1;
+        }
+    }
+    uint8_t sum = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+    if (sum != data[4]) {
+        return -1;
+    }
+    uint16_t raw_h = ((uint16_t)data[0] << 8) | data[1];
+    uint16_t raw_t = ((uint16_t)data[2] << 8) | data[3];
+    float t = (float)(raw_t & 0x7FFF) / 10.0f;
+    if (raw_t & 0x8000) {
+        t = -t;
+    }
+    float h = (float)raw_h / 10.0f;
+    if (h > 100.0f || t < -40.0f || t > 80.0f) {
+        return -1;
+    }
+    *temperature = t;
+    *humidity = h;
+    return 0;
+}
+
+uint32_t dht22_backoff_ms(uint32_t failures)
+{
+    if (failures == 0) {
+        return DHT22_MIN_INTERVAL_MS;
+    }
+    uint32_t backoff = DHT22_MIN_INTERVAL_MS << (failures < 5 ? failures - 1 : 4);
+    return backoff > DHT22_MAX_BACKOFF_MS ? DHT22_MAX_BACKOFF_MS : backoff;
+}
@@ -0,0 +1,42 @@
+#ifndef DHT22_FRAME_H
+#define DHT22_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * DHT22 frame decoding, free of any driver dependency so that recorded
+ * traces can be decoded on the host (tests/host).
+ *
+ * The captured line levels are fed one (level, duration) pair at a
+ * time; the width of every high pulse that follows a low one is kept,
+ * the last max entries only.  The last 40 widths are the data bits.
+ */
+
+#define DHT22_FRAME_BITS         40
+#define DHT22_BIT_THRESHOLD_US   48        // 26 µs = 0, 70 µs = 1
+#define DHT22_MIN_INTERVAL_MS    2000      // Sensor minimum read interval
+#define DHT22_MAX_BACKOFF_MS     32000
+
+typedef struct {
+    uint16_t *high_us;
+    size_t max;
+    size_t count;
+    bool seen_low;
+} dht22_pulses_t;
+
+void dht22_pulses_init(dht22_pulses_t *p, uint16_t *high_us, size_t max);
+void dht22_pulses_add(dht22_pulses_t *p, int level, uint16_t duration_us);
+
+/*
+ * Decode one response from its high-pulse widths in microseconds, in
+ * capture order.  The last 40 entries are the data bits.  Returns 0
+ * and fills temperature/humidity when the checksum matches.
+ */
+int dht22_decode(const uint16_t *high_us, size_t count, float *temperature, float *humidity);
+
+/* Delay before the next attempt after failures failed reads in a row. */
+uint32_t dht22_backoff_ms(uint32_t failures);
+
+#endif /* DHT22_FRAME_H */
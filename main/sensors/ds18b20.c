@@ -37,30 +37,45 @@ esp_err_t ds18b20_scan_bus(uint8_t *addresses[], uint8_t *count)
     return ESP_OK;
 }
 
-esp_err_t ds18b20_read_temp(uint8_t *address, float *temp)
+esp_err_t ds18b20_start_conversion(const uint8_t *address)
 {
-    uint8_t scratchpad[9];
-
-    // 1. Convert T command
     onewire_reset();
-    onewire_select(address);
+    if (address) {
+        onewire_select(address);
+    } else {
+        onewire_write_byte(0xCC);  // SKIP_ROM: every sensor on the bus
+    }
     onewire_write_byte(0x44);  // CONVERT_T
-    vTaskDelay(pdMS_TO_TICKS(750));  // Wait conversion
+    return ESP_OK;
+}
+
+esp_err_t ds18b20_read_result(const uint8_t *address, float *temp)
+{
+    uint8_t scratchpad[9];
 
-    // 2. Read scratchpad
     onewire_reset();
     onewire_select(address);
     onewire_write_byte(0xBE);  // READ_SCRATCHPAD
     onewire_read_bytes(scratchpad, 9);
 
-    // 3. Vérifier CRC
+    // Vérifier CRC
     if (onewire_crc8(scratchpad, 8) != scratchpad[8]) {
         return ESP_ERR_INVALID_CRC;
     }
 
-    // 4. Convertir
+    // Convertir
     int16_t raw = (scratchpad[1] << 8) | scratchpad[0];
     *temp = (float)raw / 16.0f;
 
     return ESP_OK;
 }
+
+esp_err_t ds18b20_read_temp(uint8_t *address, float *temp)
+{
+    // 1. Convert T command
+    ds18b20_start_conversion(address);
+    vTaskDelay(pdMS_TO_TICKS(DS18B20_CONVERSION_MS));  // Wait conversion
+
+    // 2. Read scratchpad and check CRC
+    return ds18b20_read_result(address, temp);
+}
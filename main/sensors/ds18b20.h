@@ -36,8 +36,30 @@ esp_err_t ds18b20_init(void);
  */
 esp_err_t ds18b20_scan_bus(uint8_t *addresses[], uint8_t *count);
 
+/* Worst-case 12-bit conversion time. */
+#define DS18B20_CONVERSION_MS 750
+
+/**
+ * Start a temperature conversion without waiting for it.
+ *
+ * @param address 8‑byte OneWire address, or NULL to start every
+ *                sensor on the bus at once (SKIP_ROM)
+ * @return ESP_OK on success, or an error code
+ */
+esp_err_t ds18b20_start_conversion(const uint8_t *address);
+
+/**
+ * Read the result of a conversion started DS18B20_CONVERSION_MS ago.
+ *
+ * @param address 8‑byte OneWire address of the sensor
+ * @param temp Pointer to float where the temperature (°C) will be stored
+ * @return ESP_OK on success, ESP_ERR_INVALID_CRC on a corrupted read
+ */
+esp_err_t ds18b20_read_result(const uint8_t *address, float *temp);
+
 /**
- * Read the temperature from a DS18B20 sensor.
+ * Read the temperature from a DS18B20 sensor (blocking: starts a
+ * conversion and waits DS18B20_CONVERSION_MS).
  *
  * @param address 8‑byte OneWire address of the sensor
  * @param temp Pointer to float where the temperature (°C) will be stored
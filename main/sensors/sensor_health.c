@@ -0,0 +1,137 @@
+#include <math.h>
+#include <string.h>
+#include "sensor_health.h"
+
+/*
+ * Probe health tracking.
+ *
+ * Everything here is a handful of float operations per reading on
+ * state kept in the channel table: no history buffer is needed, since
+ * the EWMAs stand for the recent past and the stuck detector only
+ * remembers when the reading last changed.
+ */
+
+#define HEALTH_ALPHA        0.1f    // EWMA weight of a new reading (~10 readings)
+#define HEALTH_CONFIRM      3       // Readings agreeing on a jump to accept it
+#define HEALTH_WARMUP       8       // Readings before the noise estimate counts
+
+static const char *STATE_NAMES[] = { "ok", "noisy", "stuck", "failed" };
+
+void sensor_health_init(sensor_health_t *h, const sensor_health_policy_t *policy)
+{
+    memset(h, 0, sizeof(*h));
+    h->policy = *policy;
+}
+
+/* First reading, or a confirmed jump: a new level to track from.  The
+ * noise estimate is about the probe, not the level, and is kept. */
+static void seed(sensor_health_t *h, float value, uint32_t now)
+{
+    if (!h->seeded) {
+        h->seeded = true;
+        h->noise = 0.0f;
+        h->accepted = 0;
+    }
+    h->mean = value;
+    h->var = 0.0f;
+    h->last = value;
+    h->last_time = now;
+    h->changed_time = now;
+    h->jump_count = 0;
+    h->accepted++;
+}
+
+/* A run of failed or implausible readings puts the probe in FAILED. */
+static void fail_streak(sensor_health_t *h)
+{
+    if (h->fails_in_row < UINT8_MAX) {
+        h->fails_in_row++;
+    }
+    if (h->policy.fail_limit && h->fails_in_row >= h->policy.fail_limit) {
+        h->state = SENSOR_HEALTH_FAILED;
+    }
+}
+
+/* Rate check: 1 within the limit, 0 a jump held back until
+ * HEALTH_CONFIRM readings agree on it, 2 a confirmed jump. */
+static int check_step(sensor_health_t *h, float value, uint32_t now)
+{
+    const sensor_health_policy_t *p = &h->policy;
+    if (p->max_rate <= 0.0f ||
+        fabsf(value - h->last) <= p->max_step + p->max_rate * (float)(now - h->last_time)) {
+        h->jump_count = 0;
+        return 1;
+    }
+    if (h->jump_count > 0 &&
+        fabsf(value - h->jump) <= p->max_step + p->max_rate * (float)(now - h->jump_time)) {
+        h->jump_count++;
+    } else {
+        h->jump_count = 1;
+    }
+    h->jump = value;
+    h->jump_time = now;
+    return h->jump_count >= HEALTH_CONFIRM ? 2 : 0;
+}
+
+static void update(sensor_health_t *h, float value, uint32_t now)
+{
+    float d = value - h->last;
+    h->noise += HEALTH_ALPHA * (d * d - h->noise);
+    float diff = value - h->mean;
+    float incr = HEALTH_ALPHA * diff;
+    h->mean += incr;
+    h->var = (1.0f - HEALTH_ALPHA) * (h->var + diff * incr);
+    if (value != h->last) {
+        h->changed_time = now;
+    }
+    h->last = value;
+    h->last_time = now;
+    h->accepted++;
+}
+
+bool sensor_health_sample(sensor_health_t *h, float value, uint32_t now)
+{
+    const sensor_health_policy_t *p = &h->policy;
+    h->samples++;
+    if (!(value >= p->min && value <= p->max)) {
+        h->rejected++;
+        fail_streak(h);
+        return false;
+    }
+    h->fails_in_row = 0;
+    int step = h->seeded ? check_step(h, value, now) : 2;
+    if (step == 0) {
+        h->rejected++;
+        return false;
+    }
+    if (step == 2) {
+        seed(h, value, now);
+    } else {
+        update(h, value, now);
+    }
+
+    // Successive differences of white noise have twice its variance
+    if (p->stuck_s && now - h->changed_time >= p->stuck_s) {
+        h->state = SENSOR_HEALTH_STUCK;
+    } else if (p->noise_limit > 0.0f && h->accepted >= HEALTH_WARMUP &&
+               sqrtf(h->noise / 2.0f) > p->noise_limit) {
+        h->state = SENSOR_HEALTH_NOISY;
+    } else {
+        h->state = SENSOR_HEALTH_OK;
+    }
+    return h->state != SENSOR_HEALTH_STUCK;
+}
+
+void sensor_health_failure(sensor_health_t *h, bool crc)
+{
+    h->failures++;
+    if (crc) {
+        h->crc_errors++;
+    }
+    fail_streak(h);
+}
+
+const char *sensor_health_name(sensor_health_state_t state)
+{
+    return (unsigned)state < sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]) ? STATE_NAMES[state] : "unknown";
+}
@@ -0,0 +1,71 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Per-channel probe health, updated in O(1) per reading.
+ *
+ * A reading is rejected when it is outside the plausible range of the
+ * channel (which excludes the DS18B20 power-on 85 °C and -127 °C
+ * disconnected values) or jumps further from the last accepted reading
+ * than the rate limit allows.  A jump that the next readings confirm
+ * is a real change and becomes the new level.  Accepted readings feed
+ * an EWMA of the value and of its variance, and an EWMA of squared
+ * successive differences that estimates the probe noise.
+ *
+ * The channel is STUCK when its accepted reading has not changed for
+ * stuck_s, NOISY when the noise estimate is above the limit, FAILED
+ * after fail_limit read failures in a row.  Rejected readings and
+ * readings of a STUCK channel must not be stored or acted upon; NOISY
+ * readings are usable but flagged.
+ */
+
+typedef enum {
+    SENSOR_HEALTH_OK,
+    SENSOR_HEALTH_NOISY,
+    SENSOR_HEALTH_STUCK,
+    SENSOR_HEALTH_FAILED,
+} sensor_health_state_t;
+
+typedef struct {
+    float min;                  // Plausible range
+    float max;
+    float max_step;             // Change always allowed between readings
+    float max_rate;             // Further change per second (0 = unchecked)
+    float noise_limit;          // Noise standard deviation (0 = unchecked)
+    uint32_t stuck_s;           // 0 = unchecked
+    uint8_t fail_limit;
+} sensor_health_policy_t;
+
+typedef struct {
+    sensor_health_policy_t policy;
+    sensor_health_state_t state;
+    bool seeded;
+    float mean;                 // EWMA of accepted readings
+    float var;                  // and their EWMA variance
+    float noise;                // EWMA of squared successive differences
+    float last;                 // Last accepted reading
+    uint32_t last_time;
+    uint32_t changed_time;      // When last took its current value
+    float jump;                 // Rejected jump waiting for confirmation
+    uint32_t jump_time;
+    uint8_t jump_count;
+    uint8_t fails_in_row;
+    uint32_t accepted;          // Counters since boot
+    uint32_t samples;
+    uint32_t rejected;
+    uint32_t failures;
+    uint32_t crc_errors;
+} sensor_health_t;
+
+void sensor_health_init(sensor_health_t *h, const sensor_health_policy_t *policy);
+/* Feed one reading taken at now (seconds, monotonic).  Returns true
+ * when the reading may be used. */
+bool sensor_health_sample(sensor_health_t *h, float value, uint32_t now);
+/* Count a failed read; crc when it was a corrupted transfer. */
+void sensor_health_failure(sensor_health_t *h, bool crc);
+const char *sensor_health_name(sensor_health_state_t state);
+
+#endif /* SENSOR_HEALTH_H */
@@ -1,22 +1,45 @@
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include "sensor_manager.h"
+#include "sensor_scheduler.h"
 #include "app_config.h"
 #include "dht22.h"
+#include "adc_sensors.h"
 #include "ds18b20.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "http/websocket.h"
 #include "mqtt/mqtt_client.h"
 #include "mqtt/mqtt_topics.h"
+#include "storage/ts_archive.h"
+#include "utils/datetime.h"
 #include "utils/logger.h"
 
 /*
  * Sensor manager implementation.
  *
- * This module initialises supported sensors and provides a simple
- * function to read all sensors.  DHT22 readings are simulated via
- * pseudo‑random numbers; DS18B20 sensors are scanned on the
- * OneWire bus.  Readings are logged and published via MQTT.
+ * This module initialises supported sensors and registers one sampling
+ * job per sensor family with the sensor scheduler.  DHT22 sensors are
+ * captured with the RMT peripheral; DS18B20 sensors share one
+ * SKIP_ROM conversion whose 750 ms latency overlaps with the other
+ * jobs; analog probes are read from the continuous ADC.  Every reading
+ * first goes through the channel's health checks (sensor_health.h),
+ * which hold back implausible readings and take stuck or failing
+ * probes out of service.  Usable readings land in a channel table
+ * (latest value per channel) and go through the channel's
+ * report-by-exception filter: only readings that moved past the
+ * deadband, or a heartbeat, are appended to the long-term
+ * archive (once the wall clock is set) and queued for the publish job,
+ * which sends the queued channels to MQTT and the WebSocket clients
+ * and stays silent when nothing is queued.
  */
 
+// Samples stamped before this date (no SNTP yet) are not archived
+#define ARCHIVE_MIN_TIMESTAMP 1577836800u   // 2020-01-01
+
 // Maximum DS18B20 sensors supported
 #ifndef DS18B20_MAX_SENSORS
 #define DS18B20_MAX_SENSORS 8
@@ -24,6 +47,330 @@
 
 static uint8_t s_ds_addresses[DS18B20_MAX_SENSORS][8];
 static uint8_t s_ds_count = 0;
+static const int s_adc_probe_channels[] = APP_ADC_PROBE_CHANNELS;
+
+// Channel table.  Index layout is fixed at init time.
+static sensor_value_t s_values[SENSOR_MAX_CHANNELS];
+static int s_value_count = 0;
+static SemaphoreHandle_t s_values_lock = NULL;
+static ts_series_t *s_series[SENSOR_MAX_CHANNELS];
+static uint32_t s_generation = 0;     // Bumped on every channel update
+static int s_dht_channels[DHT22_MAX_SENSORS][2];    // temperature, humidity
+static int s_ds_channels[DS18B20_MAX_SENSORS];
+static int s_adc_channels[APP_ADC_PROBE_COUNT > 0 ? APP_ADC_PROBE_COUNT : 1];
+
+static const sensor_report_policy_t REPORT_POLICIES[] = {
+    [SENSOR_KIND_TEMPERATURE] = { APP_REPORT_DEADBAND_TEMPERATURE, APP_REPORT_MIN_INTERVAL_S,
+                                  APP_REPORT_HEARTBEAT_S },
+    [SENSOR_KIND_HUMIDITY] = { APP_REPORT_DEADBAND_HUMIDITY, APP_REPORT_MIN_INTERVAL_S,
+                               APP_REPORT_HEARTBEAT_S },
+    [SENSOR_KIND_VOLTAGE] = { APP_REPORT_DEADBAND_VOLTAGE, APP_REPORT_MIN_INTERVAL_S,
+                              APP_REPORT_HEARTBEAT_S },
+};
+
+/*
+ * Health checks per kind.  Temperatures outside -40..80 °C cannot come
+ * from an enclosure (the DS18B20 reports 85 °C before its first
+ * conversion and -127 °C from some failed reads); analog probes can
+ * jump and sit still legitimately (a light sensor at night), so only
+ * their range is checked.
+ */
+static const sensor_health_policy_t HEALTH_POLICIES[] = {
+    [SENSOR_KIND_TEMPERATURE] = { .min = -40.0f, .max = 80.0f, .max_step = 0.5f, .max_rate = 0.05f,
+                                  .noise_limit = 0.5f, .stuck_s = 7200, .fail_limit = 3 },
+    [SENSOR_KIND_HUMIDITY] = { .min = 0.0f, .max = 100.0f, .max_step = 3.0f, .max_rate = 0.5f,
+                               .noise_limit = 5.0f, .stuck_s = 7200, .fail_limit = 3 },
+    [SENSOR_KIND_VOLTAGE] = { .min = 0.0f, .max = 3400.0f, .fail_limit = 3 },
+};
+
+static sensor_health_t s_health[SENSOR_MAX_CHANNELS];
+
+// Report filters and the reports waiting for the publish job, under
+// s_values_lock like the channel table.
+static sensor_report_t s_report[SENSOR_MAX_CHANNELS];
+static sensor_report_out_t s_outbox[SENSOR_MAX_CHANNELS];
+static bool s_queued[SENSOR_MAX_CHANNELS];
+
+static int channel_add(const char *name, sensor_kind_t kind)
+{
+    if (s_value_count >= SENSOR_MAX_CHANNELS) {
+        log_warn("sensors", "Channel table full, %s dropped", name);
+        return -1;
+    }
+    sensor_value_t *v = &s_values[s_value_count];
+    memset(v, 0, sizeof(*v));
+    snprintf(v->name, sizeof(v->name), "%s", name);
+    v->kind = kind;
+    sensor_report_init(&s_report[s_value_count], &REPORT_POLICIES[kind]);
+    sensor_health_init(&s_health[s_value_count], &HEALTH_POLICIES[kind]);
+    // Archive resolution: DS18B20 steps are 1/16 °C, DHT22 0.1
+    s_series[s_value_count] = ts_open(name, kind == SENSOR_KIND_VOLTAGE ? 0 : 2);
+    if (!s_series[s_value_count]) {
+        log_warn("sensors", "No archive for %s", name);
+    }
+    return s_value_count++;
+}
+
+/* Queue a report; one still waiting is folded in, extremes and all. */
+static void outbox_put(int ch, const sensor_report_out_t *r)
+{
+    sensor_report_out_t *q = &s_outbox[ch];
+    if (!s_queued[ch]) {
+        *q = *r;
+        s_queued[ch] = true;
+        return;
+    }
+    if (r->min.value < q->min.value) {
+        q->min = r->min;
+    }
+    if (r->max.value > q->max.value) {
+        q->max = r->max;
+    }
+    q->value = r->value;
+    q->samples += r->samples;
+}
+
+/* The report's value, preceded by the extremes that were further than
+ * the deadband from it, in time order. */
+static void archive_report(int ch, const sensor_report_out_t *r)
+{
+    uint32_t now = datetime_now();
+    if (!s_series[ch] || now < ARCHIVE_MIN_TIMESTAMP) {
+        return;
+    }
+    float deadband = s_report[ch].policy.deadband;
+    sensor_point_t points[3];
+    int n = 0;
+    const sensor_point_t *first = r->min.time <= r->max.time ? &r->min : &r->max;
+    const sensor_point_t *second = first == &r->min ? &r->max : &r->min;
+    if (first->time != r->value.time && fabsf(first->value - r->value.value) > deadband) {
+        points[n++] = *first;
+    }
+    if (second->time != r->value.time && second->time != first->time &&
+        fabsf(second->value - r->value.value) > deadband) {
+        points[n++] = *second;
+    }
+    points[n++] = r->value;
+    for (int i = 0; i < n; i++) {
+        // Filter times are seconds since boot
+        ts_append(s_series[ch], now - (r->value.time - points[i].time), points[i].value);
+    }
+}
+
+/* Health state changes go out on the alert topic and the WebSocket. */
+static void health_alert(int ch, sensor_health_state_t from, sensor_health_state_t to)
+{
+    log_warn("sensors", "%s: %s -> %s", s_values[ch].name, sensor_health_name(from),
+             sensor_health_name(to));
+    char msg[128];
+    snprintf(msg, sizeof(msg),
+             "{\"type\":\"sensor_health\",\"channel\":\"%s\",\"state\":\"%s\",\"previous\":\"%s\"}",
+             s_values[ch].name, sensor_health_name(to), sensor_health_name(from));
+    mqtt_client_publish(MQTT_TOPIC_ALERTS_SENSOR, msg);
+    ws_broadcast(msg);
+}
+
+/* Stops serving the channel's value; s_values_lock held. */
+static void channel_drop(int ch)
+{
+    if (s_values[ch].valid) {
+        s_values[ch].valid = false;
+        s_generation++;
+        // The first reading after the failure is reported as it is
+        sensor_report_reset(&s_report[ch]);
+        s_queued[ch] = false;
+    }
+}
+
+static void channel_record(int ch, float value)
+{
+    if (ch < 0) {
+        return;
+    }
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000000);
+    sensor_report_out_t report;
+    bool reported = false;
+    xSemaphoreTake(s_values_lock, portMAX_DELAY);
+    sensor_health_t *h = &s_health[ch];
+    sensor_health_state_t before = h->state;
+    if (sensor_health_sample(h, value, now)) {
+        s_values[ch].value = value;
+        s_values[ch].timestamp = now;
+        bool became_valid = !s_values[ch].valid;
+        s_values[ch].valid = true;
+        reported = sensor_report_sample(&s_report[ch], value, now, &report);
+        if (reported) {
+            outbox_put(ch, &report);
+        }
+        if (reported || became_valid) {
+            s_generation++;
+        }
+    } else if (h->state == SENSOR_HEALTH_STUCK || h->state == SENSOR_HEALTH_FAILED) {
+        channel_drop(ch);
+    }
+    // A rejected spike leaves the last good value in place
+    sensor_health_state_t after = h->state;
+    s_values[ch].health = after;
+    if (after != before) {
+        s_generation++;
+    }
+    xSemaphoreGive(s_values_lock);
+
+    if (reported) {
+        archive_report(ch, &report);
+    }
+    if (after != before) {
+        health_alert(ch, before, after);
+    }
+}
+
+static void channel_invalidate(int ch, bool crc)
+{
+    if (ch < 0) {
+        return;
+    }
+    xSemaphoreTake(s_values_lock, portMAX_DELAY);
+    sensor_health_state_t before = s_health[ch].state;
+    sensor_health_failure(&s_health[ch], crc);
+    channel_drop(ch);
+    sensor_health_state_t after = s_health[ch].state;
+    s_values[ch].health = after;
+    if (after != before) {
+        s_generation++;
+    }
+    xSemaphoreGive(s_values_lock);
+    if (after != before) {
+        health_alert(ch, before, after);
+    }
+}
+
+static int job_dht22_collect(void *ctx)
+{
+    (void)ctx;
+    for (int i = 0; i < dht22_count(); i++) {
+        dht22_sample_t sample;
+        if (dht22_read_sensor(i, &sample) == 0) {
+            channel_record(s_dht_channels[i][0], sample.temperature);
+            channel_record(s_dht_channels[i][1], sample.humidity);
+        } else {
+            channel_invalidate(s_dht_channels[i][0], false);
+            channel_invalidate(s_dht_channels[i][1], false);
+        }
+    }
+    return 0;
+}
+
+static int job_ds18b20_start(void *ctx)
+{
+    (void)ctx;
+    return ds18b20_start_conversion(NULL) == ESP_OK ? 0 : -1;
+}
+
+static int job_ds18b20_collect(void *ctx)
+{
+    (void)ctx;
+    for (uint8_t i = 0; i < s_ds_count; i++) {
+        float t = 0.0f;
+        esp_err_t err = ds18b20_read_result(s_ds_addresses[i], &t);
+        if (err == ESP_OK) {
+            channel_record(s_ds_channels[i], t);
+        } else {
+            log_warn("sensors", "DS18B20[%d] read failed", i);
+            channel_invalidate(s_ds_channels[i], err == ESP_ERR_INVALID_CRC);
+        }
+    }
+    return 0;
+}
+
+static int job_adc_collect(void *ctx)
+{
+    (void)ctx;
+    for (int i = 0; i < APP_ADC_PROBE_COUNT; i++) {
+        adc_reading_t reading;
+        if (adc_get_latest(s_adc_probe_channels[i], &reading) == 0) {
+            channel_record(s_adc_channels[i], (float)reading.millivolts);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Sends the queued reports, or every valid channel when all is set, as
+ *   {"type":"sensors","temperature":..,"humidity":..,
+ *    "channels":{"ds0":24.50,..},"extremes":{"ds0":[24.10,25.30],..}}
+ * where extremes lists the channels whose samples since their previous
+ * report went further than the deadband from the value reported now.
+ */
+static int publish(bool all)
+{
+    sensor_value_t values[SENSOR_MAX_CHANNELS];
+    sensor_report_out_t reports[SENSOR_MAX_CHANNELS];
+    bool queued[SENSOR_MAX_CHANNELS];
+    xSemaphoreTake(s_values_lock, portMAX_DELAY);
+    int n = s_value_count;
+    memcpy(values, s_values, (size_t)n * sizeof(values[0]));
+    memcpy(reports, s_outbox, (size_t)n * sizeof(reports[0]));
+    memcpy(queued, s_queued, (size_t)n * sizeof(queued[0]));
+    memset(s_queued, 0, sizeof(s_queued));
+    xSemaphoreGive(s_values_lock);
+
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        count += (all && values[i].valid) || queued[i];
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // Keep the historical top-level keys (first DHT22) for existing
+    // subscribers, followed by the channels.
+    float temp = 0.0f, hum = 0.0f;
+    if (dht22_count() > 0 && s_dht_channels[0][1] >= 0 && s_dht_channels[0][1] < n) {
+        temp = values[s_dht_channels[0][0]].value;
+        hum = values[s_dht_channels[0][1]].value;
+    }
+    char payload[768];
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"type\":\"sensors\",\"temperature\":%.2f,\"humidity\":%.2f,\"channels\":{",
+                       temp, hum);
+    bool first = true;
+    for (int i = 0; i < n && len < (int)sizeof(payload); i++) {
+        if (!queued[i] && !(all && values[i].valid)) {
+            continue;
+        }
+        float value = queued[i] ? reports[i].value.value : values[i].value;
+        len += snprintf(payload + len, sizeof(payload) - len, "%s\"%s\":%.2f",
+                        first ? "" : ",", values[i].name, value);
+        first = false;
+    }
+    first = true;
+    for (int i = 0; i < n && len < (int)sizeof(payload); i++) {
+        const sensor_report_out_t *r = &reports[i];
+        float deadband = s_report[i].policy.deadband;
+        if (!queued[i] || (r->value.value - r->min.value <= deadband &&
+                           r->max.value - r->value.value <= deadband)) {
+            continue;
+        }
+        len += snprintf(payload + len, sizeof(payload) - len, "%s\"%s\":[%.2f,%.2f]",
+                        first ? "},\"extremes\":{" : ",", values[i].name, r->min.value,
+                        r->max.value);
+        first = false;
+    }
+    if (len >= (int)sizeof(payload) - 2) {
+        log_warn("sensors", "Sensor payload truncated");
+        return -1;
+    }
+    snprintf(payload + len, sizeof(payload) - len, "}}");
+    mqtt_client_publish(MQTT_TOPIC_SENSORS_ALL, payload);
+    ws_broadcast(payload);
+    return 0;
+}
+
+static int job_publish(void *ctx)
+{
+    (void)ctx;
+    return publish(false);
+}
 
 int sensors_init(void)
 {
@@ -31,8 +378,22 @@ int sensors_init(void)
     log_info("sensors", "Sensors disabled (APP_SENSORS_ENABLED=0)");
     return 0;
 #endif
-    // Initialise DHT22 (pseudo‑random generator)
-    dht22_init();
+    s_values_lock = xSemaphoreCreateMutex();
+    if (!s_values_lock) {
+        return -1;
+    }
+    char name[SENSOR_NAME_LEN];
+
+    // Initialise DHT22 (RMT capture on APP_DHT22_GPIO)
+    if (dht22_init() != 0) {
+        log_warn("sensors", "DHT22 init failed");
+    }
+    for (int i = 0; i < dht22_count(); i++) {
+        snprintf(name, sizeof(name), "dht%d_t", i);
+        s_dht_channels[i][0] = channel_add(name, SENSOR_KIND_TEMPERATURE);
+        snprintf(name, sizeof(name), "dht%d_h", i);
+        s_dht_channels[i][1] = channel_add(name, SENSOR_KIND_HUMIDITY);
+    }
 
     // Initialise DS18B20 driver and scan for devices
     ds18b20_init();
@@ -45,35 +406,163 @@ int sensors_init(void)
     } else {
         log_info("sensors", "Found %d DS18B20 sensors", s_ds_count);
     }
+    for (uint8_t i = 0; i < s_ds_count; i++) {
+        snprintf(name, sizeof(name), "ds%d", i);
+        s_ds_channels[i] = channel_add(name, SENSOR_KIND_TEMPERATURE);
+    }
+
+    // Start continuous sampling of the analog probes
+    if (APP_ADC_PROBE_COUNT > 0 && adc_init() == 0) {
+        for (int i = 0; i < APP_ADC_PROBE_COUNT; i++) {
+            adc_channel_cfg_t cfg = {
+                .channel = s_adc_probe_channels[i],
+                .atten = ADC_PROBE_ATTEN_12DB,
+                .oversample = APP_ADC_OVERSAMPLE,
+                .median_window = APP_ADC_MEDIAN_WINDOW,
+                .iir_shift = APP_ADC_IIR_SHIFT,
+            };
+            s_adc_channels[i] = -1;
+            if (adc_add_channel(&cfg) != 0) {
+                log_warn("sensors", "ADC channel %d rejected", cfg.channel);
+                continue;
+            }
+            snprintf(name, sizeof(name), "adc%d", cfg.channel);
+            s_adc_channels[i] = channel_add(name, SENSOR_KIND_VOLTAGE);
+        }
+        if (adc_start() != 0) {
+            log_warn("sensors", "Continuous ADC failed to start");
+        }
+    }
     return 0;
 }
 
+int sensors_start(void)
+{
+#if !APP_SENSORS_ENABLED
+    return 0;
+#endif
+    const sensor_job_cfg_t jobs[] = {
+        {
+            .name = SENSOR_JOB_DS18B20,
+            .period_ms = APP_SENSOR_PERIOD_DS18B20_MS,
+            .latency_ms = DS18B20_CONVERSION_MS,
+            .start = job_ds18b20_start,
+            .collect = job_ds18b20_collect,
+        },
+        { .name = SENSOR_JOB_DHT22, .period_ms = APP_SENSOR_PERIOD_DHT22_MS,
+          .collect = job_dht22_collect },
+        { .name = SENSOR_JOB_ADC, .period_ms = APP_SENSOR_PERIOD_ADC_MS,
+          .collect = job_adc_collect },
+        // Publish one second after the sampling jobs so the DS18B20
+        // conversion started on the same tick has been collected.
+        { .name = SENSOR_JOB_PUBLISH, .period_ms = APP_SENSOR_PERIOD_PUBLISH_MS,
+          .phase_ms = 1000, .collect = job_publish },
+    };
+    for (size_t i = 0; i < sizeof(jobs) / sizeof(jobs[0]); i++) {
+        if (jobs[i].collect == job_ds18b20_collect && s_ds_count == 0) {
+            continue;
+        }
+        if (jobs[i].collect == job_dht22_collect && dht22_count() == 0) {
+            continue;
+        }
+        if (sensor_sched_add(&jobs[i]) < 0) {
+            log_warn("sensors", "Job %s not scheduled", jobs[i].name);
+        }
+    }
+    return sensor_sched_start();
+}
+
 int sensors_read(void)
 {
 #if !APP_SENSORS_ENABLED
     return 0;
 #endif
-    // Read DHT22
-    float temp = 0.0f, hum = 0.0f;
-    if (dht22_read(&temp, &hum) == 0) {
-        log_info("sensors", "DHT22: T=%.2f°C H=%.2f%%", temp, hum);
-    } else {
-        log_warn("sensors", "Failed to read DHT22");
+    if (s_ds_count > 0 && job_ds18b20_start(NULL) == 0) {
+        vTaskDelay(pdMS_TO_TICKS(DS18B20_CONVERSION_MS));
+        job_ds18b20_collect(NULL);
     }
+    job_dht22_collect(NULL);
+    job_adc_collect(NULL);
+    return publish(true);
+}
 
-    // Read DS18B20 sensors
-    for (uint8_t i = 0; i < s_ds_count; i++) {
-        float t = 0.0f;
-        if (ds18b20_read_temp(s_ds_addresses[i], &t) == ESP_OK) {
-            log_info("sensors", "DS18B20[%d]: %.2f°C", i, t);
-        } else {
-            log_warn("sensors", "DS18B20[%d] read failed", i);
+int sensors_get_current(sensor_value_t *out, int max)
+{
+    if (!out || max <= 0 || !s_values_lock) {
+        return 0;
+    }
+    xSemaphoreTake(s_values_lock, portMAX_DELAY);
+    int n = s_value_count < max ? s_value_count : max;
+    memcpy(out, s_values, (size_t)n * sizeof(out[0]));
+    xSemaphoreGive(s_values_lock);
+    return n;
+}
+
+int sensors_set_period(const char *job, uint32_t period_ms)
+{
+    return sensor_sched_set_period(sensor_sched_find(job), period_ms);
+}
+
+int sensors_set_report_policy(const char *name, const sensor_report_policy_t *policy)
+{
+    if (!policy || !s_values_lock) {
+        return -1;
+    }
+    int found = 0;
+    xSemaphoreTake(s_values_lock, portMAX_DELAY);
+    for (int i = 0; i < s_value_count; i++) {
+        if (!name || strcmp(s_values[i].name, name) == 0) {
+            s_report[i].policy = *policy;
+            found++;
+        }
+    }
+    xSemaphoreGive(s_values_lock);
+    return found > 0 ? 0 : -1;
+}
+
+int sensors_set_health_policy(const char *name, const sensor_health_policy_t *policy)
+{
+    if (!policy || !s_values_lock) {
+        return -1;
+    }
+    int found = 0;
+    xSemaphoreTake(s_values_lock, portMAX_DELAY);
+    for (int i = 0; i < s_value_count; i++) {
+        if (!name || strcmp(s_values[i].name, name) == 0) {
+            s_health[i].policy = *policy;
+            found++;
         }
     }
+    xSemaphoreGive(s_values_lock);
+    return found > 0 ? 0 : -1;
+}
 
-    // Optionally publish aggregated sensor data via MQTT
-    char payload[128];
-    snprintf(payload, sizeof(payload), "{\"temperature\":%.2f,\"humidity\":%.2f}", temp, hum);
-    mqtt_client_publish(MQTT_TOPIC_SENSORS_ALL, payload);
-    return 0;
+int sensors_get_health(sensor_health_info_t *out, int max)
+{
+    if (!out || max <= 0 || !s_values_lock) {
+        return 0;
+    }
+    xSemaphoreTake(s_values_lock, portMAX_DELAY);
+    int n = s_value_count < max ? s_value_count : max;
+    for (int i = 0; i < n; i++) {
+        memcpy(out[i].name, s_values[i].name, sizeof(out[i].name));
+        out[i].health = s_health[i];
+    }
+    xSemaphoreGive(s_values_lock);
+    return n;
+}
+
+uint32_t sensors_generation(void)
+{
+    return s_generation;
+}
+
+ts_series_t *sensors_get_series(const char *name)
+{
+    for (int i = 0; name && i < s_value_count; i++) {
+        if (strcmp(s_values[i].name, name) == 0) {
+            return s_series[i];
+        }
+    }
+    return NULL;
 }
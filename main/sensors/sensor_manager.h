@@ -1,7 +1,61 @@
 #ifndef SENSOR_MANAGER_H
 #define SENSOR_MANAGER_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "sensor_health.h"
+#include "sensor_report.h"
+#include "storage/ts_archive.h"
+
+#define SENSOR_MAX_CHANNELS  16
+#define SENSOR_NAME_LEN      16
+
+/* Scheduler job names accepted by sensors_set_period() */
+#define SENSOR_JOB_DHT22     "dht22"
+#define SENSOR_JOB_DS18B20   "ds18b20"
+#define SENSOR_JOB_ADC       "adc"
+#define SENSOR_JOB_PUBLISH   "publish"
+
+typedef enum {
+    SENSOR_KIND_TEMPERATURE,    // °C
+    SENSOR_KIND_HUMIDITY,       // %RH
+    SENSOR_KIND_VOLTAGE,        // mV
+} sensor_kind_t;
+
+typedef struct {
+    char name[SENSOR_NAME_LEN];     // e.g. "dht0_t", "ds1", "adc5"
+    sensor_kind_t kind;
+    float value;
+    uint32_t timestamp;             // Seconds since boot of the last good read
+    bool valid;                     // false until the first read or after a failure
+    sensor_health_state_t health;   // Probe health (sensor_health.h)
+} sensor_value_t;
+
+typedef struct {
+    char name[SENSOR_NAME_LEN];
+    sensor_health_t health;
+} sensor_health_info_t;
+
 int sensors_init(void);
+/* Register the sampling jobs and start the scheduler task. */
+int sensors_start(void);
+/* Read every sensor once, synchronously, and publish every channel. */
 int sensors_read(void);
+/* Copy up to max channels into out; returns the number copied. */
+int sensors_get_current(sensor_value_t *out, int max);
+/* Health state and counters of up to max channels; returns the number copied. */
+int sensors_get_health(sensor_health_info_t *out, int max);
+/* Changes whenever a channel reports a value (sensor_report.h) or its
+ * validity changes. */
+uint32_t sensors_generation(void);
+/* Long-term archive of a channel, or NULL. */
+ts_series_t *sensors_get_series(const char *name);
+/* Change a job period at runtime (see SENSOR_JOB_*). */
+int sensors_set_period(const char *job, uint32_t period_ms);
+/* Replace the report policy of one channel, or of all with NULL.
+ * Channels start with the APP_REPORT_* defaults of their kind. */
+int sensors_set_report_policy(const char *name, const sensor_report_policy_t *policy);
+/* Same for the health checks, e.g. a wider range for a basking probe. */
+int sensors_set_health_policy(const char *name, const sensor_health_policy_t *policy);
 
-#endif /* SENSOR_MANAGER_H */
\ No newline at end of file
+#endif /* SENSOR_MANAGER_H */
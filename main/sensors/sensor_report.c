@@ -0,0 +1,59 @@
+#include <math.h>
+#include <string.h>
+#include "sensor_report.h"
+
+/*
+ * Report-by-exception filter.
+ *
+ * O(1) per sample and no allocation: the filter keeps the last
+ * reported value and time, the running extremes and a flag for a
+ * deadband crossing held back by the rate limit.
+ */
+
+void sensor_report_init(sensor_report_t *r, const sensor_report_policy_t *policy)
+{
+    memset(r, 0, sizeof(*r));
+    r->policy = *policy;
+}
+
+void sensor_report_reset(sensor_report_t *r)
+{
+    r->started = false;
+    r->due = false;
+    r->samples = 0;
+}
+
+bool sensor_report_sample(sensor_report_t *r, float value, uint32_t now, sensor_report_out_t *out)
+{
+    sensor_point_t p = { value, now };
+    if (r->samples == 0) {
+        r->min = p;
+        r->max = p;
+    } else if (value < r->min.value) {
+        r->min = p;
+    } else if (value > r->max.value) {
+        r->max = p;
+    }
+    r->samples++;
+
+    if (r->started) {
+        if (fabsf(value - r->last) > r->policy.deadband) {
+            r->due = true;
+        }
+        uint32_t silent = now - r->last_time;
+        bool heartbeat = r->policy.heartbeat_s && silent >= r->policy.heartbeat_s;
+        if ((!r->due && !heartbeat) || silent < r->policy.min_interval_s) {
+            return false;
+        }
+    }
+    out->value = p;
+    out->min = r->min;
+    out->max = r->max;
+    out->samples = r->samples;
+    r->started = true;
+    r->due = false;
+    r->last = value;
+    r->last_time = now;
+    r->samples = 0;
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef SENSOR_REPORT_H
+#define SENSOR_REPORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Report-by-exception filter, one per channel.
+ *
+ * Every sample goes through the filter; only those that should be
+ * archived and published come out.  A sample is reported when it, or
+ * any sample since the last report, is more than the deadband away
+ * from the last reported value, or when the heartbeat has gone by
+ * without a report.  Reports are at least min_interval_s apart: a
+ * change inside that interval is held and reported by the first sample
+ * after it.  The lowest and highest samples since the last report come
+ * with each report, so a spike between two reports is not lost.
+ */
+
+typedef struct {
+    float deadband;             // Change from the last report that triggers one
+    uint32_t min_interval_s;    // Shortest time between two reports
+    uint32_t heartbeat_s;       // Longest time without one (0 = no heartbeat)
+} sensor_report_policy_t;
+
+typedef struct {
+    float value;
+    uint32_t time;              // Seconds, same clock as the samples
+} sensor_point_t;
+
+typedef struct {
+    sensor_point_t value;
+    sensor_point_t min;         // Extremes of the samples since the last
+    sensor_point_t max;         // report, this one included
+    uint32_t samples;           // Samples this report stands for
+} sensor_report_out_t;
+
+typedef struct {
+    sensor_report_policy_t policy;
+    bool started;               // Something was reported since the reset
+    bool due;                   // Deadband crossed, waiting for the interval
+    float last;                 // Last reported value
+    uint32_t last_time;
+    sensor_point_t min;
+    sensor_point_t max;
+    uint32_t samples;
+} sensor_report_t;
+
+void sensor_report_init(sensor_report_t *r, const sensor_report_policy_t *policy);
+/* Forget the last report: the next sample is reported whatever its value. */
+void sensor_report_reset(sensor_report_t *r);
+/* Feed one sample taken at now (seconds, monotonic).  Returns true and
+ * fills out when it is to be reported. */
+bool sensor_report_sample(sensor_report_t *r, float value, uint32_t now, sensor_report_out_t *out);
+
+#endif /* SENSOR_REPORT_H */
@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <string.h>
+#include "sensor_scheduler.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "utils/logger.h"
+
+/*
+ * Sensor scheduler implementation.
+ *
+ * Time is counted in scheduler ticks since sensor_sched_start().  Each
+ * job owns two events (run and collect) that are linked into a hashed
+ * timer wheel slot (due tick modulo WHEEL_SLOTS).  The task sleeps until
+ * the earliest armed event, then fires every event due on that tick:
+ * run events call start() and arm the collect event latency ticks later
+ * (or call collect() directly when there is no latency), then re-arm
+ * themselves one period later on the same grid so jitter does not
+ * accumulate.  Callbacks run without the lock held.
+ */
+
+#define WHEEL_SLOTS       64
+#define SCHED_TASK_STACK  4096
+#define SCHED_TASK_PRIO   6
+
+#define MS_TO_SCHED_TICKS(ms) (((ms) + SENSOR_SCHED_TICK_MS - 1) / SENSOR_SCHED_TICK_MS)
+
+typedef enum {
+    EVENT_RUN,
+    EVENT_COLLECT,
+} sched_event_kind_t;
+
+typedef struct sched_event {
+    struct sched_event *next;
+    uint32_t due;
+    uint8_t job;
+    uint8_t kind;
+    bool armed;
+} sched_event_t;
+
+typedef struct {
+    sensor_job_cfg_t cfg;
+    uint32_t period_ticks;
+    uint32_t latency_ticks;
+    uint32_t last_run;
+    sched_event_t run;
+    sched_event_t collect;
+} sched_job_t;
+
+static const char *TAG_SCHED = "sched";
+static sched_job_t s_jobs[SENSOR_SCHED_MAX_JOBS];
+static int s_job_count = 0;
+static sched_event_t *s_wheel[WHEEL_SLOTS];
+static TickType_t s_origin = 0;
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_task = NULL;
+
+static uint32_t current_tick(void)
+{
+    return (uint32_t)((xTaskGetTickCount() - s_origin) / pdMS_TO_TICKS(SENSOR_SCHED_TICK_MS));
+}
+
+static void event_arm(sched_event_t *ev, uint32_t due)
+{
+    sched_event_t **slot = &s_wheel[due & (WHEEL_SLOTS - 1)];
+    ev->due = due;
+    ev->armed = true;
+    ev->next = *slot;
+    *slot = ev;
+}
+
+static void event_disarm(sched_event_t *ev)
+{
+    if (!ev->armed) {
+        return;
+    }
+    sched_event_t **link = &s_wheel[ev->due & (WHEEL_SLOTS - 1)];
+    while (*link) {
+        if (*link == ev) {
+            *link = ev->next;
+            break;
+        }
+        link = &(*link)->next;
+    }
+    ev->next = NULL;
+    ev->armed = false;
+}
+
+static bool next_due(uint32_t *out)
+{
+    bool found = false;
+    uint32_t best = 0;
+    for (int i = 0; i < s_job_count; i++) {
+        const sched_event_t *evs[2] = { &s_jobs[i].run, &s_jobs[i].collect };
+        for (int k = 0; k < 2; k++) {
+            if (evs[k]->armed && (!found || (int32_t)(evs[k]->due - best) < 0)) {
+                best = evs[k]->due;
+                found = true;
+            }
+        }
+    }
+    *out = best;
+    return found;
+}
+
+static void fire_tick(uint32_t tick)
+{
+    sched_event_t *fired[SENSOR_SCHED_MAX_JOBS * 2];
+    int n = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    sched_event_t **link = &s_wheel[tick & (WHEEL_SLOTS - 1)];
+    while (*link) {
+        sched_event_t *ev = *link;
+        if (ev->due == tick) {
+            *link = ev->next;
+            ev->next = NULL;
+            ev->armed = false;
+            fired[n++] = ev;
+        } else {
+            link = &ev->next;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    // Collects first so a job whose period equals its latency reads the
+    // previous conversion before starting the next one.
+    for (int pass = EVENT_COLLECT; pass >= EVENT_RUN; pass--) {
+        for (int i = 0; i < n; i++) {
+            if (fired[i]->kind != pass) {
+                continue;
+            }
+            sched_job_t *job = &s_jobs[fired[i]->job];
+            if (pass == EVENT_COLLECT) {
+                job->cfg.collect(job->cfg.ctx);
+                continue;
+            }
+            bool started = true;
+            if (job->cfg.start && job->cfg.start(job->cfg.ctx) != 0) {
+                log_warn(TAG_SCHED, "Job %s: start failed", job->cfg.name);
+                started = false;
+            }
+            bool deferred = started && job->cfg.start && job->latency_ticks > 0;
+            if (started && !deferred) {
+                job->cfg.collect(job->cfg.ctx);
+            }
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            if (deferred) {
+                event_disarm(&job->collect);
+                event_arm(&job->collect, tick + job->latency_ticks);
+            }
+            job->last_run = tick;
+            if (!job->run.armed) {
+                // Stay on the period grid; skip runs missed by an overrun
+                uint32_t due = tick + job->period_ticks;
+                uint32_t now = current_tick();
+                while ((int32_t)(due - now) <= 0) {
+                    due += job->period_ticks;
+                }
+                event_arm(&job->run, due);
+            }
+            xSemaphoreGive(s_lock);
+        }
+    }
+}
+
+static void sched_task(void *arg)
+{
+    (void)arg;
+    const TickType_t tick_len = pdMS_TO_TICKS(SENSOR_SCHED_TICK_MS);
+    for (;;) {
+        uint32_t due = 0;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        bool have = next_due(&due);
+        xSemaphoreGive(s_lock);
+        if (!have) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        TickType_t wake_at = s_origin + (TickType_t)due * tick_len;
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(wake_at - now) > 0 &&
+            ulTaskNotifyTake(pdTRUE, wake_at - now) > 0) {
+            // Job added or period changed: recompute the next wakeup
+            continue;
+        }
+        fire_tick(due);
+    }
+}
+
+static int sched_lock_init(void)
+{
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+    }
+    return s_lock ? 0 : -1;
+}
+
+int sensor_sched_add(const sensor_job_cfg_t *cfg)
+{
+    if (!cfg || !cfg->collect || cfg->period_ms == 0 || sched_lock_init() != 0) {
+        return -1;
+    }
+    if (cfg->latency_ms >= cfg->period_ms) {
+        log_warn(TAG_SCHED, "Job %s: latency must be shorter than period",
+                 cfg->name ? cfg->name : "?");
+        return -1;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_job_count >= SENSOR_SCHED_MAX_JOBS) {
+        xSemaphoreGive(s_lock);
+        return -1;
+    }
+    int id = s_job_count++;
+    sched_job_t *job = &s_jobs[id];
+    memset(job, 0, sizeof(*job));
+    job->cfg = *cfg;
+    job->period_ticks = MS_TO_SCHED_TICKS(cfg->period_ms);
+    job->latency_ticks = MS_TO_SCHED_TICKS(cfg->latency_ms);
+    job->run.job = (uint8_t)id;
+    job->run.kind = EVENT_RUN;
+    job->collect.job = (uint8_t)id;
+    job->collect.kind = EVENT_COLLECT;
+    event_arm(&job->run, current_tick() + 1 + MS_TO_SCHED_TICKS(cfg->phase_ms));
+    xSemaphoreGive(s_lock);
+    if (s_task) {
+        xTaskNotifyGive(s_task);
+    }
+    log_info(TAG_SCHED, "Job %s: period %u ms, phase %u ms, latency %u ms",
+             cfg->name ? cfg->name : "?", (unsigned)cfg->period_ms,
+             (unsigned)cfg->phase_ms, (unsigned)cfg->latency_ms);
+    return id;
+}
+
+int sensor_sched_start(void)
+{
+    if (s_task) {
+        return 0;
+    }
+    if (sched_lock_init() != 0) {
+        return -1;
+    }
+    // Jobs registered before start are timed from here
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_origin = xTaskGetTickCount();
+    for (int i = 0; i < s_job_count; i++) {
+        event_disarm(&s_jobs[i].run);
+        event_arm(&s_jobs[i].run, 1 + MS_TO_SCHED_TICKS(s_jobs[i].cfg.phase_ms));
+    }
+    xSemaphoreGive(s_lock);
+    if (xTaskCreatePinnedToCore(sched_task, "sensor_sched", SCHED_TASK_STACK, NULL,
+                                SCHED_TASK_PRIO, &s_task, 1) != pdPASS) {
+        log_error(TAG_SCHED, "Failed to create scheduler task");
+        return -1;
+    }
+    return 0;
+}
+
+int sensor_sched_find(const char *name)
+{
+    if (!name) {
+        return -1;
+    }
+    for (int i = 0; i < s_job_count; i++) {
+        if (s_jobs[i].cfg.name && strcmp(s_jobs[i].cfg.name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int sensor_sched_set_period(int job_id, uint32_t period_ms)
+{
+    if (job_id < 0 || job_id >= s_job_count || period_ms == 0) {
+        return -1;
+    }
+    sched_job_t *job = &s_jobs[job_id];
+    if (job->cfg.latency_ms >= period_ms) {
+        return -1;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    job->cfg.period_ms = period_ms;
+    job->period_ticks = MS_TO_SCHED_TICKS(period_ms);
+    if (job->run.armed) {
+        uint32_t now = current_tick();
+        uint32_t due = job->last_run + job->period_ticks;
+        if ((int32_t)(due - now) <= 0) {
+            due = now + 1;
+        }
+        event_disarm(&job->run);
+        event_arm(&job->run, due);
+    }
+    xSemaphoreGive(s_lock);
+    if (s_task) {
+        xTaskNotifyGive(s_task);
+    }
+    log_info(TAG_SCHED, "Job %s: period set to %u ms", job->cfg.name ? job->cfg.name : "?",
+             (unsigned)period_ms);
+    return 0;
+}
+
+uint32_t sensor_sched_get_period(int job_id)
+{
+    if (job_id < 0 || job_id >= s_job_count) {
+        return 0;
+    }
+    return s_jobs[job_id].cfg.period_ms;
+}
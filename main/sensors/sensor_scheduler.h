@@ -0,0 +1,42 @@
+#ifndef SENSOR_SCHEDULER_H
+#define SENSOR_SCHEDULER_H
+
+#include <stdint.h>
+
+/*
+ * Sensor sampling scheduler.
+ *
+ * A single task owns a timer wheel of sampling jobs.  Every job has a
+ * period and a phase on a common tick grid, and optionally a
+ * conversion latency: the start callback kicks off a conversion and
+ * the collect callback runs once the latency has elapsed, so long
+ * conversions on different sensors overlap.  All events falling on
+ * the same tick are handled in one wakeup, and the task sleeps until
+ * the next occupied tick.
+ */
+
+#define SENSOR_SCHED_TICK_MS   250
+#define SENSOR_SCHED_MAX_JOBS  8
+
+typedef int (*sensor_job_fn)(void *ctx);
+
+typedef struct {
+    const char *name;
+    uint32_t period_ms;         // Rounded up to a whole number of ticks
+    uint32_t phase_ms;          // Offset of the first run from start
+    uint32_t latency_ms;        // Delay between start and collect
+    sensor_job_fn start;        // Optional; NULL for one-step jobs
+    sensor_job_fn collect;
+    void *ctx;
+} sensor_job_cfg_t;
+
+/* Register a job before or after sensor_sched_start().  Returns the
+ * job id or -1. */
+int sensor_sched_add(const sensor_job_cfg_t *cfg);
+int sensor_sched_start(void);
+int sensor_sched_find(const char *name);
+/* Takes effect from the job's next run. */
+int sensor_sched_set_period(int job_id, uint32_t period_ms);
+uint32_t sensor_sched_get_period(int job_id);
+
+#endif /* SENSOR_SCHEDULER_H */
@@ -0,0 +1,122 @@
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+#include "species_index.h"
+
+/*
+ * Species regulation image reader.
+ *
+ * The partition is mapped once at boot and its CRC checked; after that
+ * the header, the displacement table, the records and the strings are
+ * all read straight from flash through the cache.  Finding a species
+ * is one FNV pass over the name, one displacement read, a second hash
+ * and a single name comparison, whatever the size of the list (see
+ * tools/species_pack.py for the layout and the hash).
+ */
+
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "utils/logger.h"
+
+#define SPECIES_PARTITION  "species"
+#define SPECIES_MAGIC      "SPR1"
+#define SPECIES_NAME_MAX   96
+#define FNV_PRIME          0x01000193u
+
+typedef struct {
+    char magic[4];
+    uint32_t count;
+    uint32_t record_size;
+    uint32_t strings_size;
+    uint32_t date;
+    uint32_t crc;
+    uint8_t reserved[8];
+} species_header_t;
+
+_Static_assert(sizeof(species_header_t) == 32, "header layout is on flash");
+_Static_assert(sizeof(species_record_t) == 36, "record layout is on flash");
+
+static struct {
+    const species_header_t *header;
+    const int32_t *displacement;
+    const species_record_t *records;
+    const char *strings;
+    esp_partition_mmap_handle_t map;
+} s_index;
+
+static uint32_t fnv(uint32_t h, const char *key)
+{
+    if (h == 0) {
+        h = FNV_PRIME;
+    }
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        h = (h * FNV_PRIME) ^ (uint32_t)tolower(*p);
+    }
+    return h;
+}
+
+int species_index_init(void)
+{
+    const esp_partition_t *part =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, SPECIES_PARTITION);
+    if (!part) {
+        log_warn("species", "No %s partition, regulation list unavailable", SPECIES_PARTITION);
+        return -1;
+    }
+    const void *ptr;
+    if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &s_index.map) != ESP_OK) {
+        log_error("species", "Cannot map the %s partition", SPECIES_PARTITION);
+        return -1;
+    }
+    const species_header_t *h = ptr;
+    uint64_t size = sizeof(*h) + (uint64_t)h->count * (sizeof(int32_t) + sizeof(species_record_t)) +
+                    h->strings_size;
+    if (memcmp(h->magic, SPECIES_MAGIC, 4) != 0 || h->count == 0 ||
+        h->record_size != sizeof(species_record_t) || size > part->size ||
+        esp_rom_crc32_le(0, (const uint8_t *)(h + 1), (uint32_t)size - sizeof(*h)) != h->crc) {
+        log_warn("species", "The %s partition holds no valid regulation list", SPECIES_PARTITION);
+        esp_partition_munmap(s_index.map);
+        return -1;
+    }
+    s_index.displacement = (const int32_t *)(h + 1);
+    s_index.records = (const species_record_t *)(s_index.displacement + h->count);
+    s_index.strings = (const char *)(s_index.records + h->count);
+    s_index.header = h;
+    log_info("species", "Regulation list: %u species", (unsigned)h->count);
+    return 0;
+}
+
+const species_record_t *species_index_find(const char *scientific_name)
+{
+    if (!s_index.header || !scientific_name || strlen(scientific_name) >= SPECIES_NAME_MAX) {
+        return NULL;
+    }
+    uint32_t n = s_index.header->count;
+    int32_t d = s_index.displacement[fnv(0, scientific_name) % n];
+    uint32_t slot = d < 0 ? (uint32_t)(-(d + 1)) : fnv((uint32_t)d, scientific_name) % n;
+    if (slot >= n) {
+        return NULL;
+    }
+    const species_record_t *r = &s_index.records[slot];
+    return strcasecmp(species_index_str(r->scientific_name), scientific_name) == 0 ? r : NULL;
+}
+
+int species_index_count(void)
+{
+    return s_index.header ? (int)s_index.header->count : 0;
+}
+
+const species_record_t *species_index_at(int i)
+{
+    return i >= 0 && i < species_index_count() ? &s_index.records[i] : NULL;
+}
+
+const char *species_index_str(uint32_t offset)
+{
+    return s_index.header && offset < s_index.header->strings_size ? s_index.strings + offset : "";
+}
+
+uint32_t species_index_date(void)
+{
+    return s_index.header ? s_index.header->date : 0;
+}
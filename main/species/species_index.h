@@ -0,0 +1,47 @@
+#ifndef SPECIES_INDEX_H
+#define SPECIES_INDEX_H
+
+#include <stdint.h>
+
+/*
+ * Read-only species regulation list in the "species" partition, built
+ * by tools/species_pack.py from species/species_regulations.csv.
+ *
+ * Records are read in place from the mapped partition: a lookup hashes
+ * the name once and compares a single record, and nothing is copied.
+ * Strings are offsets into the image; species_index_str() turns them
+ * into pointers that stay valid until reboot.
+ */
+
+#define SPECIES_DOMESTIC   0x01
+#define SPECIES_DANGEROUS  0x02
+#define SPECIES_INVASIVE   0x04
+
+typedef struct {
+    uint32_t scientific_name;
+    uint32_t common_names;      // "; " separated
+    uint32_t family;
+    uint32_t category;          // DOMESTIQUE, NON_DOMESTIQUE or PROTEGE
+    uint32_t cites_appendix;
+    uint32_t eu_annex;
+    uint32_t france_column;
+    uint32_t last_updated;      // Unix seconds
+    uint8_t flags;
+    uint8_t reserved[3];
+} species_record_t;
+
+/* Maps and checks the partition.  Returns -1 when it is missing or does
+ * not hold a valid image; lookups then find nothing. */
+int species_index_init(void);
+
+/* Record for a scientific name, case-insensitive, or NULL. */
+const species_record_t *species_index_find(const char *scientific_name);
+
+int species_index_count(void);
+const species_record_t *species_index_at(int i);
+const char *species_index_str(uint32_t offset);
+
+/* Date of the newest entry, 0 without a dataset. */
+uint32_t species_index_date(void);
+
+#endif /* SPECIES_INDEX_H */
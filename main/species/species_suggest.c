@@ -0,0 +1,372 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "species_suggest.h"
+
+/*
+ * Species name prefix index.
+ *
+ * Every name is folded once into a pool of lower-case ASCII strings;
+ * each word start in it becomes an entry pointing at that suffix, so
+ * "python royal" is found from "py" and from "ro" while its text is
+ * stored once.  Entries are sorted by their suffix: a query folds the
+ * prefix the same way, binary searches the first suffix not below it
+ * and walks forward while suffixes still start with it.
+ *
+ * Scientific names of listed species point into the mapped regulation
+ * list; their common names, split out of its "; " separated field, and
+ * the names only found in the animals table are copied into the pool
+ * next to the folded text.  Both the pool and the entries come from
+ * mem_alloc_large() and are sized by a first counting pass.
+ *
+ * Rebuilds run on a low-priority task of their own, woken by a query
+ * that finds the animals table changed: the new index is built without
+ * the lock and swapped in under it, so queries keep answering from the
+ * previous one and never wait on SQLite.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "database/db_manager.h"
+#include "database/db_schema.h"
+#include "species_index.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+
+#define SUGGEST_NAME_MAX  128       // Folded bytes kept per name
+#define SUGGEST_SCAN_MAX  512       // Entries walked per query
+#define SUGGEST_TASK_STACK 4096
+#define SUGGEST_TASK_PRIO  2
+
+typedef struct {
+    uint32_t key;                   // Word start in the folded pool
+    const char *scientific_name;
+    const char *name;               // Name the word belongs to
+} suggest_entry_t;
+
+typedef struct {
+    suggest_entry_t *entries;       // NULL while counting
+    int count;
+    int capacity;
+    char *pool;
+    size_t pool_used;
+    size_t pool_size;
+} suggest_index_t;
+
+static suggest_index_t s_index;
+static uint32_t s_animals_generation;
+static SemaphoreHandle_t s_lock;
+static TaskHandle_t s_task;
+
+/* U+00C0..U+017F without accents; " " separates words. */
+static const char FOLD_LATIN[192][3] = {
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",   // U+00C0
+    "d", "n", "o", "o", "o", "o", "o", " ", "o", "u", "u", "u", "u", "y", "th", "ss",  // U+00D0
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",   // U+00E0
+    "d", "n", "o", "o", "o", "o", "o", " ", "o", "u", "u", "u", "u", "y", "th", "y",   // U+00F0
+    "a", "a", "a", "a", "a", "a", "c", "c", "c", "c", "c", "c", "c", "c", "d", "d",    // U+0100
+    "d", "d", "e", "e", "e", "e", "e", "e", "e", "e", "e", "e", "g", "g", "g", "g",    // U+0110
+    "g", "g", "g", "g", "h", "h", "h", "h", "i", "i", "i", "i", "i", "i", "i", "i",    // U+0120
+    "i", "i", "ij", "ij", "j", "j", "k", "k", "k", "l", "l", "l", "l", "l", "l", "l",  // U+0130
+    "l", "l", "l", "n", "n", "n", "n", "n", "n", "n", "n", "n", "o", "o", "o", "o",    // U+0140
+    "o", "o", "oe", "oe", "r", "r", "r", "r", "r", "r", "s", "s", "s", "s", "s", "s",  // U+0150
+    "s", "s", "t", "t", "t", "t", "t", "t", "u", "u", "u", "u", "u", "u", "u", "u",    // U+0160
+    "u", "u", "u", "u", "w", "w", "y", "y", "y", "z", "z", "z", "z", "z", "z", "s",    // U+0170
+};
+
+/*
+ * Lower-case ASCII letters and digits, words separated by one space.
+ * Latin accents are removed, other punctuation and scripts dropped
+ * ("Boa de Duméril" -> "boa de dumeril", "Dumeril's" -> "dumerils").
+ * A trailing separator is kept for queries, so "python " stops at the
+ * end of the word.  Returns the folded length.
+ */
+static size_t fold(const char *in, char *out, size_t size, bool keep_trailing)
+{
+    size_t n = 0;
+    bool space = true;              // No leading separator
+    for (const unsigned char *p = (const unsigned char *)in; *p && n + 3 < size; ) {
+        const char *f = NULL;
+        char one[2] = { 0 };
+        if (*p < 0x80) {
+            if ((*p >= 'a' && *p <= 'z') || (*p >= '0' && *p <= '9')) {
+                one[0] = (char)*p;
+            } else if (*p >= 'A' && *p <= 'Z') {
+                one[0] = (char)(*p | 0x20);
+            } else if (*p == ' ' || *p == '-' || *p == '_' || *p == '/' || *p == ',' || *p == ';' ||
+                       *p == '.' || *p == '\t') {
+                one[0] = ' ';
+            }
+            f = one;
+            p++;
+        } else if (*p >= 0xC3 && *p <= 0xC5 && (p[1] & 0xC0) == 0x80) {
+            f = FOLD_LATIN[(((*p & 0x1F) << 6) | (p[1] & 0x3F)) - 0xC0];
+            p += 2;
+        } else {
+            // Any other sequence: skip the lead byte and its continuations
+            p++;
+            while ((*p & 0xC0) == 0x80) {
+                p++;
+            }
+            continue;
+        }
+        for (; *f; f++) {
+            if (*f == ' ') {
+                if (!space) {
+                    out[n++] = ' ';
+                }
+                space = true;
+            } else {
+                out[n++] = *f;
+                space = false;
+            }
+        }
+    }
+    if (n > 0 && space && !keep_trailing) {
+        n--;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+static const char *pool_copy(suggest_index_t *ix, const char *s)
+{
+    size_t n = strlen(s) + 1;
+    if (!ix->entries) {
+        ix->pool_used += n;
+        return s;
+    }
+    if (ix->pool_used + n > ix->pool_size) {
+        return NULL;
+    }
+    char *copy = memcpy(ix->pool + ix->pool_used, s, n);
+    ix->pool_used += n;
+    return copy;
+}
+
+/* Counts (entries == NULL) or stores the words of one name. */
+static void add_name(suggest_index_t *ix, const char *scientific_name, const char *name)
+{
+    char folded[SUGGEST_NAME_MAX];
+    size_t len = fold(name, folded, sizeof(folded), false);
+    if (len == 0) {
+        return;
+    }
+    int words = 0;
+    for (size_t i = 0; i < len; i++) {
+        words += i == 0 || folded[i - 1] == ' ';
+    }
+    if (!ix->entries) {
+        ix->count += words;
+        ix->pool_used += len + 1;
+        return;
+    }
+    // The table may have grown since it was counted
+    if (ix->count + words > ix->capacity || ix->pool_used + len + 1 > ix->pool_size) {
+        return;
+    }
+    uint32_t base = (uint32_t)ix->pool_used;
+    memcpy(ix->pool + base, folded, len + 1);
+    ix->pool_used += len + 1;
+    for (size_t i = 0; i < len; i++) {
+        if (i == 0 || folded[i - 1] == ' ') {
+            ix->entries[ix->count++] = (suggest_entry_t){ base + (uint32_t)i, scientific_name, name };
+        }
+    }
+}
+
+static void add_listed(suggest_index_t *ix)
+{
+    int n = species_index_count();
+    for (int i = 0; i < n; i++) {
+        const species_record_t *r = species_index_at(i);
+        const char *sci = species_index_str(r->scientific_name);
+        add_name(ix, sci, sci);
+        // Common names are "; " separated: each is copied out on its own
+        const char *p = species_index_str(r->common_names);
+        while (*p) {
+            while (*p == ' ' || *p == ';') {
+                p++;
+            }
+            size_t len = strcspn(p, ";");
+            while (len > 0 && p[len - 1] == ' ') {
+                len--;
+            }
+            char name[SUGGEST_NAME_MAX];
+            if (len > 0 && len < sizeof(name)) {
+                memcpy(name, p, len);
+                name[len] = '\0';
+                const char *copy = pool_copy(ix, name);
+                if (copy) {
+                    add_name(ix, sci, copy);
+                }
+            }
+            p += strcspn(p, ";");
+        }
+    }
+}
+
+/* Species in the animals table that the regulation list does not know. */
+static void add_animals(suggest_index_t *ix)
+{
+    db_stmt_t *st = db_prepare("SELECT species_name, max(common_name) FROM " DB_ANIMALS
+                               " GROUP BY species_name COLLATE NOCASE;");
+    while (st && db_step(st) == 1) {
+        const char *sci = db_column_text(st, 0);
+        const char *common = db_column_text(st, 1);
+        if (!sci[0] || species_index_find(sci)) {
+            continue;
+        }
+        const char *sci_copy = pool_copy(ix, sci);
+        const char *common_copy = common[0] ? pool_copy(ix, common) : NULL;
+        if (!sci_copy) {
+            break;
+        }
+        add_name(ix, sci_copy, sci_copy);
+        if (common_copy) {
+            add_name(ix, sci_copy, common_copy);
+        }
+    }
+    db_finalize(st);
+}
+
+static const char *s_sort_pool;       // Only the building task sorts
+
+static int compare_entries(const void *a, const void *b)
+{
+    const suggest_entry_t *x = a, *y = b;
+    return strcmp(s_sort_pool + x->key, s_sort_pool + y->key);
+}
+
+/* Builds a new index into ix; touches no shared state. */
+static int build(suggest_index_t *ix)
+{
+    memset(ix, 0, sizeof(*ix));
+    add_listed(ix);
+    add_animals(ix);
+    ix->capacity = ix->count;
+    ix->pool_size = ix->pool_used;
+    ix->count = 0;
+    ix->pool_used = 0;
+    if (ix->capacity == 0) {
+        return 0;
+    }
+    ix->entries = mem_alloc_large(ix->capacity * sizeof(suggest_entry_t));
+    ix->pool = mem_alloc_large(ix->pool_size);
+    if (!ix->entries || !ix->pool) {
+        log_error("species", "No memory for the suggestion index (%d names)", ix->capacity);
+        mem_free_large(ix->entries);
+        mem_free_large(ix->pool);
+        memset(ix, 0, sizeof(*ix));
+        return -1;
+    }
+    add_listed(ix);
+    add_animals(ix);
+    s_sort_pool = ix->pool;
+    qsort(ix->entries, ix->count, sizeof(suggest_entry_t), compare_entries);
+    log_info("species", "Suggestion index: %d words, %u bytes", ix->count,
+             (unsigned)(ix->capacity * sizeof(suggest_entry_t) + ix->pool_size));
+    return 0;
+}
+
+/* Builds a new index and swaps it in; the old one is freed after. */
+static int rebuild(void)
+{
+    uint32_t generation = db_table_generation(DB_ANIMALS);
+    suggest_index_t fresh;
+    if (build(&fresh) != 0) {
+        return -1;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    suggest_index_t old = s_index;
+    s_index = fresh;
+    s_animals_generation = generation;
+    xSemaphoreGive(s_lock);
+    mem_free_large(old.entries);
+    mem_free_large(old.pool);
+    return 0;
+}
+
+static void suggest_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (db_table_generation(DB_ANIMALS) != s_animals_generation) {
+            rebuild();
+        }
+    }
+}
+
+int species_suggest_init(void)
+{
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        if (!s_lock) {
+            return -1;
+        }
+    }
+    // Built here first; the task only starts once nobody else builds
+    int rc = rebuild();
+    if (!s_task &&
+        xTaskCreate(suggest_task, "suggest", SUGGEST_TASK_STACK, NULL, SUGGEST_TASK_PRIO, &s_task) != pdPASS) {
+        log_error("species", "Failed to create the suggestion task");
+        s_task = NULL;
+        return -1;
+    }
+    return rc;
+}
+
+int species_suggest(const char *prefix, int limit, species_suggest_fn fn, void *ctx)
+{
+    if (!s_lock || !prefix || !fn) {
+        return -1;
+    }
+    // Stale: ask for a rebuild and answer from the current index
+    if (s_task && db_table_generation(DB_ANIMALS) != s_animals_generation) {
+        xTaskNotifyGive(s_task);
+    }
+    char key[SUGGEST_NAME_MAX];
+    size_t len = fold(prefix, key, sizeof(key), true);
+    if (limit > SPECIES_SUGGEST_MAX) {
+        limit = SPECIES_SUGGEST_MAX;
+    }
+    if (len == 0 || limit <= 0) {
+        return 0;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    const suggest_index_t *ix = &s_index;
+    int lo = 0, hi = ix->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(ix->pool + ix->entries[mid].key, key) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    const char *seen[SPECIES_SUGGEST_MAX];
+    int found = 0;
+    for (int i = lo; i < ix->count && i < lo + SUGGEST_SCAN_MAX && found < limit; i++) {
+        const suggest_entry_t *e = &ix->entries[i];
+        if (strncmp(ix->pool + e->key, key, len) != 0) {
+            break;
+        }
+        // One suggestion per species, under the first name that matched
+        bool dup = false;
+        for (int j = 0; j < found && !dup; j++) {
+            dup = seen[j] == e->scientific_name;
+        }
+        if (dup) {
+            continue;
+        }
+        seen[found++] = e->scientific_name;
+        if (fn(e->scientific_name, e->name, ctx) != 0) {
+            break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return found;
+}
@@ -0,0 +1,29 @@
+#ifndef SPECIES_SUGGEST_H
+#define SPECIES_SUGGEST_H
+
+/*
+ * Species name autocompletion.
+ *
+ * A sorted array of every word start of every scientific and common
+ * name in the regulation list (species_index.h) and in the animals
+ * table, folded to lower-case ASCII without accents: "tortue d'herm"
+ * and "HERMANN" both find Testudo hermanni.  Built at boot in PSRAM
+ * when there is some.  A query that finds the animals table changed
+ * wakes a background rebuild and is answered from the previous index;
+ * queries are a binary search and never touch SQLite.
+ */
+
+#define SPECIES_SUGGEST_MAX  50
+
+/* Called once per species, in name order; non-zero stops. */
+typedef int (*species_suggest_fn)(const char *scientific_name, const char *name, void *ctx);
+
+/* Builds the index and starts its rebuild task.  Call after db_init()
+ * and species_index_init(). */
+int species_suggest_init(void);
+
+/* Up to limit species with a name or name word starting with prefix.
+ * Returns the number passed to fn, or -1 when there is no index. */
+int species_suggest(const char *prefix, int limit, species_suggest_fn fn, void *ctx);
+
+#endif /* SPECIES_SUGGEST_H */
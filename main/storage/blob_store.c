@@ -0,0 +1,174 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "blob_store.h"
+
+/*
+ * Blob store implementation.
+ *
+ * Data goes to BLOB_ROOT/t-<n> with plain write() calls (no stdio
+ * buffer) and through SHA-256 on the way.  On commit the temporary is
+ * renamed to its content address.  SPIFFS refuses to rename onto an
+ * existing name, so a failed rename with the target present means the
+ * content is already stored: the temporary is dropped and the existing
+ * blob kept.  Two concurrent uploads of the same file therefore end up
+ * with one copy and no window where either sees a partial file.
+ */
+
+#include "mbedtls/sha256.h"
+#include "utils/logger.h"
+
+#define BLOB_TMP_PREFIX  "t-"
+#define BLOB_PATH_MAX    (sizeof(BLOB_ROOT) + BLOB_ID_LEN + 2)
+
+struct blob_writer {
+    int fd;
+    char tmp[BLOB_PATH_MAX];
+    uint32_t size;
+    mbedtls_sha256_context sha;
+};
+
+static uint32_t s_tmp_seq = 0;
+
+int blob_store_init(void)
+{
+    DIR *dir = opendir(BLOB_ROOT);
+    if (!dir) {
+        return 0;       // Nothing stored yet
+    }
+    int removed = 0;
+    char path[BLOB_PATH_MAX + 16];
+    for (struct dirent *e = readdir(dir); e; e = readdir(dir)) {
+        if (strncmp(e->d_name, BLOB_TMP_PREFIX, strlen(BLOB_TMP_PREFIX)) == 0) {
+            snprintf(path, sizeof(path), BLOB_ROOT "/%s", e->d_name);
+            removed += unlink(path) == 0;
+        }
+    }
+    closedir(dir);
+    if (removed > 0) {
+        log_info("blob", "Removed %d interrupted upload(s)", removed);
+    }
+    return 0;
+}
+
+blob_writer_t *blob_begin(void)
+{
+    blob_writer_t *w = calloc(1, sizeof(*w));
+    if (!w) {
+        return NULL;
+    }
+    uint32_t seq = __atomic_fetch_add(&s_tmp_seq, 1, __ATOMIC_RELAXED);
+    snprintf(w->tmp, sizeof(w->tmp), BLOB_ROOT "/" BLOB_TMP_PREFIX "%08x", (unsigned)seq);
+    w->fd = open(w->tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
+        log_error("blob", "Cannot create %s (errno %d)", w->tmp, errno);
+        free(w);
+        return NULL;
+    }
+    mbedtls_sha256_init(&w->sha);
+    mbedtls_sha256_starts(&w->sha, 0);
+    return w;
+}
+
+int blob_write(blob_writer_t *w, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    mbedtls_sha256_update(&w->sha, p, len);
+    while (len > 0) {
+        ssize_t n = write(w->fd, p, len);
+        if (n <= 0) {
+            log_error("blob", "Write failed after %u bytes (errno %d)", (unsigned)w->size, errno);
+            return -1;      // Usually a full filesystem
+        }
+        p += n;
+        len -= (size_t)n;
+        w->size += (uint32_t)n;
+    }
+    return 0;
+}
+
+static void writer_free(blob_writer_t *w)
+{
+    mbedtls_sha256_free(&w->sha);
+    free(w);
+}
+
+int blob_commit(blob_writer_t *w, char id[BLOB_ID_LEN + 1], uint8_t sha256[32], uint32_t *size)
+{
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&w->sha, digest);
+    bool synced = fsync(w->fd) == 0;
+    if (close(w->fd) != 0 || !synced) {
+        unlink(w->tmp);
+        writer_free(w);
+        return -1;
+    }
+    for (int i = 0; i < BLOB_ID_LEN / 2; i++) {
+        snprintf(id + 2 * i, 3, "%02x", digest[i]);
+    }
+    char path[BLOB_PATH_MAX];
+    blob_path(id, path, sizeof(path));
+    struct stat st;
+    if (rename(w->tmp, path) != 0) {
+        bool stored = stat(path, &st) == 0 && (uint32_t)st.st_size == w->size;
+        unlink(w->tmp);
+        if (!stored) {
+            log_error("blob", "Cannot publish %s (errno %d)", id, errno);
+            writer_free(w);
+            return -1;
+        }
+        log_info("blob", "%s already stored, upload deduplicated", id);
+    }
+    if (sha256) {
+        memcpy(sha256, digest, sizeof(digest));
+    }
+    if (size) {
+        *size = w->size;
+    }
+    writer_free(w);
+    return 0;
+}
+
+void blob_abort(blob_writer_t *w)
+{
+    if (w) {
+        close(w->fd);
+        unlink(w->tmp);
+        writer_free(w);
+    }
+}
+
+int blob_path(const char *id, char *out, size_t len)
+{
+    if (!id || strspn(id, "0123456789abcdef") < BLOB_ID_LEN || len < BLOB_PATH_MAX) {
+        return -1;
+    }
+    snprintf(out, len, BLOB_ROOT "/%.*s", BLOB_ID_LEN, id);
+    return 0;
+}
+
+int blob_stat(const char *id, uint32_t *size)
+{
+    char path[BLOB_PATH_MAX];
+    struct stat st;
+    if (blob_path(id, path, sizeof(path)) != 0 || stat(path, &st) != 0) {
+        return -1;
+    }
+    *size = (uint32_t)st.st_size;
+    return 0;
+}
+
+int blob_remove(const char *id)
+{
+    char path[BLOB_PATH_MAX];
+    if (blob_path(id, path, sizeof(path)) != 0) {
+        return -1;
+    }
+    return unlink(path) == 0 ? 0 : -1;
+}
@@ -0,0 +1,39 @@
+#ifndef BLOB_STORE_H
+#define BLOB_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Content-addressed file store for photos and documents.
+ *
+ * A blob is written to a temporary file while its SHA-256 is computed,
+ * then renamed to BLOB_ROOT/<id>, where the id is the first
+ * BLOB_ID_LEN hex digits of the digest (SPIFFS names are limited to
+ * 32 bytes).  Storing the same content twice keeps a single copy and
+ * returns the same id.  A blob is only ever visible complete.
+ */
+
+#define BLOB_ROOT    "/spiffs/b"
+#define BLOB_ID_LEN  24
+
+typedef struct blob_writer blob_writer_t;
+
+/* Removes temporaries left by an interrupted upload. */
+int blob_store_init(void);
+
+blob_writer_t *blob_begin(void);
+int blob_write(blob_writer_t *w, const void *data, size_t len);
+/* Publishes the blob and frees the writer.  id receives BLOB_ID_LEN
+ * hex digits; sha256 and size may be NULL. */
+int blob_commit(blob_writer_t *w, char id[BLOB_ID_LEN + 1], uint8_t sha256[32], uint32_t *size);
+void blob_abort(blob_writer_t *w);
+
+/* Path of a stored blob; -1 when id is malformed.  Longer ids (the
+ * full digest) are accepted and truncated. */
+int blob_path(const char *id, char *out, size_t len);
+/* Size of a stored blob, -1 when absent. */
+int blob_stat(const char *id, uint32_t *size);
+int blob_remove(const char *id);
+
+#endif /* BLOB_STORE_H */
@@ -1,3 +1,5 @@
+#include <dirent.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include "file_manager.h"
@@ -8,22 +10,119 @@
  * Saves and loads arbitrary binary data to and from the filesystem
  * using standard C file I/O.  Returns 0 on success and -1 on
  * failure.  Note: this implementation does not create missing
- * directories.
+ * directories.  Whole-buffer only; streamed uploads go through the
+ * blob store instead.
+ *
+ * A save writes <path>.fs-tmp, moves the old file to <path>.fs-bak,
+ * moves the new one in place and only then removes the backup: SPIFFS
+ * cannot rename over an existing file, and at every step one complete
+ * copy exists under a known name.  file_recover() finishes or undoes a
+ * save cut short by a reset.  The suffixes are private to file_save so
+ * recovery never touches files others leave beside (db_backup()'s
+ * .bak, for one).
  */
 
+#define FILE_PATH_MAX    64
+#define FILE_TMP_SUFFIX  ".fs-tmp"
+#define FILE_BAK_SUFFIX  ".fs-bak"
+#define RECOVER_BATCH    8      // Leftovers handled per directory scan
+
+/* Copy name without suffix into out; false when it does not end with it. */
+static bool strip_suffix(const char *name, const char *suffix, char *out, size_t size)
+{
+    size_t len = strlen(name), n = strlen(suffix);
+    if (len <= n || strcmp(name + len - n, suffix) != 0 || len - n >= size) {
+        return false;
+    }
+    memcpy(out, name, len - n);
+    out[len - n] = '\0';
+    return true;
+}
+
 int file_save(const char *path, const void *data, size_t size)
 {
     if (!path || !data || size == 0) {
         return -1;
     }
-    FILE *f = fopen(path, "wb");
+    // Write beside the target so a short write never clobbers it
+    char tmp[FILE_PATH_MAX], bak[FILE_PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s" FILE_TMP_SUFFIX, path) >= (int)sizeof(tmp) ||
+        snprintf(bak, sizeof(bak), "%s" FILE_BAK_SUFFIX, path) >= (int)sizeof(bak)) {
+        return -1;
+    }
+    FILE *f = fopen(tmp, "wb");
     if (!f) {
         perror("file_save fopen");
         return -1;
     }
     size_t written = fwrite(data, 1, size, f);
-    fclose(f);
-    return (written == size) ? 0 : -1;
+    if (fclose(f) != 0 || written != size) {
+        remove(tmp);
+        return -1;
+    }
+    // SPIFFS cannot rename over an existing file: keep the old one as
+    // the backup until the new one is in place
+    remove(bak);
+    bool had_old = rename(path, bak) == 0;
+    if (rename(tmp, path) != 0) {
+        if (had_old) {
+            rename(bak, path);
+        }
+        remove(tmp);
+        return -1;
+    }
+    remove(bak);
+    return 0;
+}
+
+/* Finish or undo one interrupted save from its leftover path. */
+static int recover_one(const char *path)
+{
+    char target[FILE_PATH_MAX];
+    if (strip_suffix(path, FILE_BAK_SUFFIX, target, sizeof(target))) {
+        // Saved before the reset: drop the backup; otherwise restore it
+        FILE *f = fopen(target, "rb");
+        if (f) {
+            fclose(f);
+            return remove(path) == 0 ? 0 : -1;
+        }
+        return rename(path, target) == 0 ? 0 : -1;
+    }
+    // Never moved in place: the target or its backup is intact
+    return remove(path) == 0 ? 0 : -1;
+}
+
+int file_recover(const char *dir)
+{
+    // Collect names first and change the directory only once readdir is
+    // done with it; rescan while a batch comes back full and every
+    // leftover in it was cleared (so a stuck file cannot loop forever)
+    char found[RECOVER_BATCH][FILE_PATH_MAX];
+    int fixed = 0, count, failed;
+    do {
+        DIR *d = opendir(dir);
+        if (!d) {
+            return fixed ? fixed : -1;
+        }
+        count = 0;
+        for (struct dirent *e = readdir(d); e && count < RECOVER_BATCH; e = readdir(d)) {
+            char *path = found[count], target[FILE_PATH_MAX];
+            if (snprintf(path, FILE_PATH_MAX, "%s/%s", dir, e->d_name) >= FILE_PATH_MAX) {
+                continue;
+            }
+            if (strip_suffix(path, FILE_BAK_SUFFIX, target, sizeof(target)) ||
+                strip_suffix(path, FILE_TMP_SUFFIX, target, sizeof(target))) {
+                count++;
+            }
+        }
+        closedir(d);
+        failed = 0;
+        for (int i = 0; i < count; i++) {
+            failed |= recover_one(found[i]);
+        }
+        fixed += count;
+    } while (count == RECOVER_BATCH && !failed);
+    return fixed;
 }
 
 int file_load(const char *path, void *buffer, size_t max_size)
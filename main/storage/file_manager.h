@@ -3,5 +3,8 @@
 
 int file_save(const char *path, const void *data, size_t size);
 int file_load(const char *path, void *buffer, size_t max_size);
+/* Complete or roll back saves interrupted by a reset; call after mount.
+ * Returns the number of leftover files handled, or -1. */
+int file_recover(const char *dir);
 
 #endif /* FILE_MANAGER_H */
\ No newline at end of file
@@ -18,6 +18,7 @@
 
 static const char *TAG_NVS = "nvs";
 static nvs_handle_t s_nvs_handle = 0;
+static uint32_t s_generation = 0;     // Bumped on every committed write
 
 int nvs_init(void)
 {
@@ -72,5 +73,11 @@ int nvsman_set_str(const char *key, const char *value)
         ESP_LOGE(TAG_NVS, "nvs_commit failed: %s", esp_err_to_name(err));
         return -1;
     }
+    s_generation++;
     return 0;
 }
+
+uint32_t nvsman_generation(void)
+{
+    return s_generation;
+}
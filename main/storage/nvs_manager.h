@@ -1,8 +1,13 @@
 #ifndef NVS_MANAGER_H
 #define NVS_MANAGER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 int nvs_init(void);
 int nvsman_get_str(const char *key, char *value, size_t max_len);
 int nvsman_set_str(const char *key, const char *value);
+/* Changes whenever a value is written; used as a cache validator. */
+uint32_t nvsman_generation(void);
 
 #endif /* NVS_MANAGER_H */
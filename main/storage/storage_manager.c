@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "storage_manager.h"
+#include "file_manager.h"
 
 /*
  * Storage manager implementation for SPIFFS.
@@ -7,7 +8,8 @@
  * Mounts and unmounts the SPIFFS filesystem using the ESP‑IDF
  * VFS API.  On mount the filesystem will be formatted if it has
  * never been initialised.  Paths below "/spiffs" will be available
- * via standard C file I/O after a successful mount.
+ * via standard C file I/O after a successful mount, once saves cut
+ * short by a reset have been completed or rolled back.
  */
 
 #include "esp_spiffs.h"
@@ -31,6 +33,10 @@ int storage_mount(void)
     size_t total = 0, used = 0;
     esp_spiffs_info(conf.partition_label, &total, &used);
     ESP_LOGI(TAG_STORAGE, "SPIFFS mounted, total=%d bytes, used=%d bytes", (int)total, (int)used);
+    int recovered = file_recover(conf.base_path);
+    if (recovered > 0) {
+        ESP_LOGW(TAG_STORAGE, "Recovered %d interrupted file save(s)", recovered);
+    }
     return 0;
 }
 
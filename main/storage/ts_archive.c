@@ -0,0 +1,715 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ts_archive.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "utils/logger.h"
+#include "utils/mem_arena.h"
+
+/*
+ * Time-series archive implementation.
+ *
+ * Block layout: a 48-byte header followed by a bitstream.  The first
+ * sample of a block is stored in the header (t_first, v_first); every
+ * following sample is two variable-length codes:
+ *
+ *   timestamp: delta-of-delta, zigzagged
+ *       '0'                     dod == 0
+ *       '10'   + 7 bits         '110'  + 9 bits
+ *       '1110' + 12 bits        '1111' + 32 bits
+ *   value: delta of the quantised value, zigzagged
+ *       '0'                     unchanged
+ *       '10'   + 4 bits         '110'  + 8 bits
+ *       '1110' + 16 bits        '1111' + 32 bits
+ *
+ * The active (newest) block lives in RAM and is written back every
+ * TS_FLUSH_EVERY appends: data bytes first, then the header, so a
+ * power cut never leaves a header counting samples that are not on
+ * flash.  A sealed block is written in full so the next block starts
+ * on a TS_BLOCK_SIZE boundary.  Once the file holds
+ * CONFIG_APP_TS_ARCHIVE_MAX_BLOCKS blocks the oldest one is reused;
+ * block headers carry a sequence number to find the newest on open.
+ */
+
+#ifndef TS_ARCHIVE_DIR
+#define TS_ARCHIVE_DIR "/spiffs/ts"
+#endif
+
+#define TS_MAGIC            0x31415354u     // "TSA1"
+#define TS_MAX_SAMPLE_BITS  72              // Two worst-case codes
+#define TS_NO_DIRTY         UINT32_MAX
+
+typedef struct {
+    uint32_t magic;
+    uint16_t count;
+    uint8_t decimals;
+    uint8_t version;
+    uint32_t seq;
+    uint32_t t_first;
+    uint32_t t_last;
+    int32_t v_first;
+    int32_t v_min;
+    int32_t v_max;
+    uint32_t bit_len;
+    uint32_t reserved;
+    int64_t v_sum;
+} ts_block_header_t;
+
+typedef struct {
+    ts_block_header_t hdr;
+    uint8_t data[TS_BLOCK_SIZE - sizeof(ts_block_header_t)];
+} ts_block_t;
+
+_Static_assert(sizeof(ts_block_header_t) == 48, "block header layout is on flash");
+_Static_assert(sizeof(ts_block_t) == TS_BLOCK_SIZE, "block size");
+
+#define TS_DATA_BITS ((uint32_t)sizeof(((ts_block_t *)0)->data) * 8)
+
+struct ts_series {
+    char path[48];
+    uint8_t decimals;
+    float scale;
+    uint32_t max_blocks;
+    uint32_t block_count;       // Blocks in the file, head included
+    uint32_t head;              // Ring index of the active block
+    uint32_t seq;
+    ts_block_t *active;
+    uint32_t prev_delta;
+    int32_t prev_value;
+    uint32_t dirty_from;        // First data byte not yet on flash
+    bool header_dirty;
+    uint32_t unflushed;
+    uint32_t t_newest;          // Last appended timestamp, 0 = none
+    uint32_t appends;           // Since open, for cache validators
+    SemaphoreHandle_t lock;
+};
+
+static const uint8_t DOD_BITS[4] = { 7, 9, 12, 32 };
+static const uint8_t VAL_BITS[4] = { 4, 8, 16, 32 };
+static const float SCALES[5] = { 1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f };
+
+static void put_bits(uint8_t *buf, uint32_t *pos, uint32_t value, unsigned n)
+{
+    while (n > 0) {
+        unsigned room = 8 - (*pos & 7);
+        unsigned take = n < room ? n : room;
+        uint8_t chunk = (uint8_t)((value >> (n - take)) & ((1u << take) - 1));
+        buf[*pos >> 3] |= (uint8_t)(chunk << (room - take));
+        *pos += take;
+        n -= take;
+    }
+}
+
+static uint32_t get_bits(const uint8_t *buf, uint32_t *pos, unsigned n)
+{
+    uint32_t value = 0;
+    while (n > 0) {
+        unsigned room = 8 - (*pos & 7);
+        unsigned take = n < room ? n : room;
+        uint8_t chunk = (uint8_t)((buf[*pos >> 3] >> (room - take)) & ((1u << take) - 1));
+        value = (value << take) | chunk;
+        *pos += take;
+        n -= take;
+    }
+    return value;
+}
+
+static void put_code(uint8_t *buf, uint32_t *pos, uint32_t zz, const uint8_t widths[4])
+{
+    if (zz == 0) {
+        put_bits(buf, pos, 0, 1);
+        return;
+    }
+    for (unsigned i = 0; i < 4; i++) {
+        if (i == 3) {
+            put_bits(buf, pos, 0xF, 4);
+        } else if (zz < (1u << widths[i])) {
+            put_bits(buf, pos, ((1u << (i + 1)) - 1) << 1, i + 2);
+        } else {
+            continue;
+        }
+        put_bits(buf, pos, zz, widths[i]);
+        return;
+    }
+}
+
+static uint32_t get_code(const uint8_t *buf, uint32_t *pos, const uint8_t widths[4])
+{
+    unsigned ones = 0;
+    while (ones < 4 && get_bits(buf, pos, 1)) {
+        ones++;
+    }
+    return ones ? get_bits(buf, pos, widths[ones - 1]) : 0;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t z)
+{
+    return (int32_t)((z >> 1) ^ (0u - (z & 1)));
+}
+
+/* Advance a decoder by one sample.  Returns false at the end of the
+ * encoded bits (or on a corrupted header). */
+static bool decode_next(const ts_block_t *b, uint32_t *bitpos, uint32_t *t,
+                        uint32_t *delta, int32_t *v)
+{
+    // Appends keep one worst-case sample of room, so a valid sample
+    // never starts closer than that to the end of the block.
+    if (*bitpos >= b->hdr.bit_len || *bitpos + TS_MAX_SAMPLE_BITS > TS_DATA_BITS) {
+        return false;
+    }
+    int32_t dod = unzigzag(get_code(b->data, bitpos, DOD_BITS));
+    *delta = (uint32_t)((int32_t)*delta + dod);
+    *t += *delta;
+    *v += unzigzag(get_code(b->data, bitpos, VAL_BITS));
+    return *bitpos <= b->hdr.bit_len;
+}
+
+static void block_reset(ts_series_t *s)
+{
+    memset(s->active, 0, sizeof(*s->active));
+    s->active->hdr.magic = TS_MAGIC;
+    s->active->hdr.version = 1;
+    s->active->hdr.decimals = s->decimals;
+    s->active->hdr.seq = s->seq;
+    s->prev_delta = 0;
+    s->prev_value = 0;
+    s->dirty_from = 0;
+    s->header_dirty = true;
+    s->unflushed = 0;
+}
+
+/* Write the dirty part of the active block.  full: up to the block end. */
+static int flush_locked(ts_series_t *s, bool full)
+{
+    ts_block_t *b = s->active;
+    uint32_t used = (b->hdr.bit_len + 7) / 8;
+    uint32_t end = full ? sizeof(b->data) : used;
+    if (!s->header_dirty && s->dirty_from == TS_NO_DIRTY && !full) {
+        return 0;
+    }
+    FILE *f = fopen(s->path, "r+b");
+    if (!f) {
+        log_error("ts", "Cannot open %s", s->path);
+        return -1;
+    }
+    long base = (long)s->head * TS_BLOCK_SIZE;
+    int ret = 0;
+    // Everything below 'used' is on flash unless marked dirty
+    uint32_t from = (s->dirty_from != TS_NO_DIRTY) ? s->dirty_from : (full ? used : end);
+    if (end > from) {
+        if (fseek(f, base + (long)sizeof(b->hdr) + (long)from, SEEK_SET) != 0 ||
+            fwrite(b->data + from, 1, end - from, f) != end - from) {
+            ret = -1;
+        }
+    }
+    if (ret == 0 && (fseek(f, base, SEEK_SET) != 0 ||
+                     fwrite(&b->hdr, sizeof(b->hdr), 1, f) != 1)) {
+        ret = -1;
+    }
+    fclose(f);
+    if (ret != 0) {
+        log_error("ts", "Write to %s failed", s->path);
+        return -1;
+    }
+    s->dirty_from = TS_NO_DIRTY;
+    s->header_dirty = false;
+    s->unflushed = 0;
+    return 0;
+}
+
+/* Close the active block and start the next one in the ring. */
+static int seal_locked(ts_series_t *s)
+{
+    if (flush_locked(s, true) != 0) {
+        return -1;
+    }
+    if (s->block_count < s->max_blocks) {
+        s->head = s->block_count++;
+    } else {
+        s->head = (s->head + 1) % s->max_blocks;
+    }
+    s->seq++;
+    block_reset(s);
+    // Replace the recycled block's header before any of its data, so
+    // the old count never describes new bits.
+    s->dirty_from = TS_NO_DIRTY;
+    return flush_locked(s, false);
+}
+
+static bool quantize(const ts_series_t *s, float value, int32_t *out)
+{
+    float q = value * s->scale;
+    if (!(q > -1e9f && q < 1e9f)) {
+        return false;       // Out of range or NaN
+    }
+    *out = (int32_t)lroundf(q);
+    return true;
+}
+
+int ts_append(ts_series_t *s, uint32_t timestamp, float value)
+{
+    int32_t q;
+    if (!s || !quantize(s, value, &q)) {
+        return -1;
+    }
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    ts_block_header_t *h = &s->active->hdr;
+    // Against the whole series: a fresh active block has no t_last yet,
+    // and iteration relies on blocks not overlapping in time
+    if (s->t_newest != 0 && timestamp < s->t_newest) {
+        xSemaphoreGive(s->lock);
+        return -1;
+    }
+    if (h->count > 0) {
+        uint32_t delta = timestamp - h->t_last;
+        if (delta > INT32_MAX || h->count == UINT16_MAX ||
+            h->bit_len + TS_MAX_SAMPLE_BITS > TS_DATA_BITS) {
+            if (seal_locked(s) != 0) {
+                xSemaphoreGive(s->lock);
+                return -1;
+            }
+        }
+    }
+    if (h->count == 0) {
+        h->t_first = timestamp;
+        h->v_first = q;
+        h->v_min = q;
+        h->v_max = q;
+        h->v_sum = 0;
+    } else {
+        uint32_t delta = timestamp - h->t_last;
+        int32_t dod = (int32_t)((int64_t)delta - (int64_t)s->prev_delta);
+        uint32_t pos = h->bit_len;
+        if (s->dirty_from == TS_NO_DIRTY || pos / 8 < s->dirty_from) {
+            s->dirty_from = pos / 8;
+        }
+        put_code(s->active->data, &pos, zigzag(dod), DOD_BITS);
+        put_code(s->active->data, &pos, zigzag(q - s->prev_value), VAL_BITS);
+        h->bit_len = pos;
+        s->prev_delta = delta;
+        if (q < h->v_min) {
+            h->v_min = q;
+        }
+        if (q > h->v_max) {
+            h->v_max = q;
+        }
+    }
+    h->t_last = timestamp;
+    h->v_sum += q;
+    h->count++;
+    s->t_newest = timestamp;
+    s->appends++;
+    s->prev_value = q;
+    s->header_dirty = true;
+    int ret = 0;
+    if (++s->unflushed >= TS_FLUSH_EVERY) {
+        ret = flush_locked(s, false);
+    }
+    xSemaphoreGive(s->lock);
+    return ret;
+}
+
+int ts_flush(ts_series_t *s)
+{
+    if (!s) {
+        return -1;
+    }
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    int ret = flush_locked(s, false);
+    xSemaphoreGive(s->lock);
+    return ret;
+}
+
+/* Rebuild the encoder state from the head block read back from flash. */
+static void replay_head(ts_series_t *s)
+{
+    ts_block_header_t *h = &s->active->hdr;
+    uint32_t bitpos = 0, t = h->t_first, delta = 0;
+    int32_t v = h->v_first;
+    uint16_t n = h->count ? 1 : 0;
+    while (n < h->count && decode_next(s->active, &bitpos, &t, &delta, &v)) {
+        n++;
+    }
+    if (n != h->count) {
+        log_warn("ts", "%s: head block truncated to %u samples", s->path, (unsigned)n);
+        h->count = n;
+        h->t_last = t;
+        s->header_dirty = true;
+    }
+    h->bit_len = bitpos;
+    // A recycled block still holds older bits past the end; appends OR
+    // into the buffer, so clear them.
+    uint32_t used = (bitpos + 7) / 8;
+    if (bitpos & 7) {
+        s->active->data[bitpos / 8] &= (uint8_t)(0xFF << (8 - (bitpos & 7)));
+    }
+    memset(s->active->data + used, 0, sizeof(s->active->data) - used);
+    s->prev_delta = delta;
+    s->prev_value = v;
+}
+
+ts_series_t *ts_open(const char *name, uint8_t decimals)
+{
+    if (!name || strlen(name) >= TS_NAME_MAX || decimals >= sizeof(SCALES) / sizeof(SCALES[0])) {
+        return NULL;
+    }
+    ts_series_t *s = calloc(1, sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    snprintf(s->path, sizeof(s->path), "%s/%s.tsa", TS_ARCHIVE_DIR, name);
+    s->decimals = decimals;
+    s->scale = SCALES[decimals];
+    s->max_blocks = CONFIG_APP_TS_ARCHIVE_MAX_BLOCKS;
+    s->lock = xSemaphoreCreateMutex();
+    s->active = mem_alloc_large(sizeof(ts_block_t));
+    if (!s->lock || !s->active) {
+        ts_close(s);
+        return NULL;
+    }
+
+    // Find the newest block by sequence number
+    bool found = false;
+    FILE *f = fopen(s->path, "rb");
+    if (f) {
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        uint32_t blocks = (uint32_t)((size + TS_BLOCK_SIZE - 1) / TS_BLOCK_SIZE);
+        if (blocks > s->max_blocks) {
+            log_warn("ts", "%s: %u blocks, only %u kept", s->path, (unsigned)blocks,
+                     (unsigned)s->max_blocks);
+            blocks = s->max_blocks;
+        }
+        ts_block_header_t hdr;
+        for (uint32_t i = 0; i < blocks; i++) {
+            if (fseek(f, (long)i * TS_BLOCK_SIZE, SEEK_SET) != 0 ||
+                fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != TS_MAGIC) {
+                continue;
+            }
+            if (hdr.count > 0 && hdr.t_last > s->t_newest) {
+                s->t_newest = hdr.t_last;
+            }
+            if (!found || (int32_t)(hdr.seq - s->seq) > 0) {
+                s->seq = hdr.seq;
+                s->head = i;
+                found = true;
+            }
+        }
+        if (found) {
+            memset(s->active, 0, sizeof(*s->active));
+            fseek(f, (long)s->head * TS_BLOCK_SIZE, SEEK_SET);
+            fread(s->active, 1, sizeof(*s->active), f);
+            s->block_count = blocks;
+        }
+        fclose(f);
+    }
+
+    if (!found) {
+        f = fopen(s->path, "wb");
+        if (!f) {
+            log_error("ts", "Cannot create %s", s->path);
+            ts_close(s);
+            return NULL;
+        }
+        fclose(f);
+        s->block_count = 1;
+        s->head = 0;
+        s->seq = 0;
+        block_reset(s);
+        s->dirty_from = TS_NO_DIRTY;
+        if (flush_locked(s, false) != 0) {
+            ts_close(s);
+            return NULL;
+        }
+        return s;
+    }
+
+    s->dirty_from = TS_NO_DIRTY;
+    s->header_dirty = false;
+    replay_head(s);
+    if (s->active->hdr.count > 0 && s->active->hdr.decimals != decimals) {
+        // Blocks carry their own quantisation; start a fresh one
+        seal_locked(s);
+    }
+    s->active->hdr.decimals = decimals;
+    return s;
+}
+
+void ts_close(ts_series_t *s)
+{
+    if (!s) {
+        return;
+    }
+    if (s->lock && s->active) {
+        ts_flush(s);
+    }
+    if (s->lock) {
+        vSemaphoreDelete(s->lock);
+    }
+    mem_free_large(s->active);
+    free(s);
+}
+
+/* Load block k (ring order) into the iterator: header only, or all of it. */
+static int iter_load(ts_iter_t *it, uint32_t k, bool with_data)
+{
+    ts_series_t *s = it->series;
+    ts_block_t *b = it->block;
+    size_t len = with_data ? sizeof(*b) : sizeof(b->hdr);
+    uint32_t idx = (it->oldest + k) % it->block_total;
+    int ret = 0;
+
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    if (idx == s->head) {
+        memcpy(b, s->active, len);
+    } else {
+        memset(b, 0, len);
+        if (fseek(it->file, (long)idx * TS_BLOCK_SIZE, SEEK_SET) != 0 ||
+            fread(b, 1, len, it->file) < sizeof(b->hdr)) {
+            ret = -1;
+        }
+    }
+    xSemaphoreGive(s->lock);
+    if (ret == 0 && (b->hdr.magic != TS_MAGIC || b->hdr.decimals >= sizeof(SCALES) / sizeof(SCALES[0]))) {
+        ret = -1;
+    }
+    return ret;
+}
+
+int ts_iter_begin(ts_series_t *s, uint32_t from, uint32_t to, ts_iter_t *it)
+{
+    if (!s || !it || from > to) {
+        return -1;
+    }
+    memset(it, 0, sizeof(*it));
+    it->series = s;
+    it->from = from;
+    it->to = to;
+    it->block = mem_alloc_large(sizeof(ts_block_t));
+    it->file = fopen(s->path, "rb");
+    if (!it->block || !it->file) {
+        ts_iter_end(it);
+        return -1;
+    }
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    it->block_total = s->block_count;
+    it->oldest = (s->block_count < s->max_blocks) ? 0 : (s->head + 1) % s->max_blocks;
+    xSemaphoreGive(s->lock);
+    return 0;
+}
+
+void ts_iter_end(ts_iter_t *it)
+{
+    if (!it) {
+        return;
+    }
+    if (it->file) {
+        fclose(it->file);
+        it->file = NULL;
+    }
+    mem_free_large(it->block);
+    it->block = NULL;
+}
+
+/* Load the next block overlapping the range.  Returns 1, or 0 at the end. */
+static int iter_next_block(ts_iter_t *it, bool with_data)
+{
+    const ts_block_t *b = it->block;
+    while (it->next_block < it->block_total) {
+        uint32_t k = it->next_block++;
+        if (iter_load(it, k, false) != 0 || b->hdr.count == 0 || b->hdr.t_last < it->from) {
+            continue;
+        }
+        if (b->hdr.t_first > it->to) {
+            break;
+        }
+        if (with_data && iter_load(it, k, true) != 0) {
+            continue;
+        }
+        it->remaining = b->hdr.count;
+        it->scale = SCALES[b->hdr.decimals];
+        return 1;
+    }
+    it->done = true;
+    return 0;
+}
+
+/* Decode the next in-range sample of the loaded block.  Returns 1, or
+ * 0 once the block is exhausted (it->done is set past the range). */
+static int iter_decode(ts_iter_t *it, ts_sample_t *out)
+{
+    const ts_block_t *b = it->block;
+    while (it->remaining > 0) {
+        if (it->remaining == b->hdr.count) {
+            it->bitpos = 0;
+            it->t = b->hdr.t_first;
+            it->delta = 0;
+            it->v = b->hdr.v_first;
+        } else if (!decode_next(b, &it->bitpos, &it->t, &it->delta, &it->v)) {
+            break;
+        }
+        it->remaining--;
+        if (it->t < it->from || it->t < it->last_t) {
+            continue;       // Before the range, or a block recycled under us
+        }
+        if (it->t > it->to) {
+            it->done = true;
+            break;
+        }
+        it->last_t = it->t;
+        out->timestamp = it->t;
+        out->value = (float)it->v / it->scale;
+        return 1;
+    }
+    it->remaining = 0;
+    return 0;
+}
+
+int ts_iter_next(ts_iter_t *it, ts_sample_t *out)
+{
+    if (!it || !it->block || !out) {
+        return -1;
+    }
+    while (!it->done) {
+        if (iter_decode(it, out) == 1) {
+            return 1;
+        }
+        if (!it->done) {
+            iter_next_block(it, true);
+        }
+    }
+    return 0;
+}
+
+typedef struct {
+    ts_bucket_t bucket;
+    double sum;
+    bool open;
+} rollup_acc_t;
+
+static int rollup_merge(rollup_acc_t *acc, uint32_t start, uint32_t count, float min,
+                        float max, double sum, ts_bucket_cb cb, void *ctx)
+{
+    int ret = 0;
+    if (acc->open && acc->bucket.t_start != start) {
+        acc->bucket.mean = (float)(acc->sum / acc->bucket.count);
+        ret = cb(&acc->bucket, ctx);
+        acc->open = false;
+    }
+    if (!acc->open) {
+        acc->bucket.t_start = start;
+        acc->bucket.count = 0;
+        acc->bucket.min = min;
+        acc->bucket.max = max;
+        acc->sum = 0.0;
+        acc->open = true;
+    }
+    acc->bucket.count += count;
+    acc->bucket.min = fminf(acc->bucket.min, min);
+    acc->bucket.max = fmaxf(acc->bucket.max, max);
+    acc->sum += sum;
+    return ret;
+}
+
+int ts_rollup(ts_series_t *s, uint32_t from, uint32_t to, uint32_t step,
+              ts_bucket_cb cb, void *ctx)
+{
+    if (!cb || step == 0) {
+        return -1;
+    }
+    ts_iter_t it;
+    if (ts_iter_begin(s, from, to, &it) != 0) {
+        return -1;
+    }
+    const ts_block_t *b = it.block;
+    rollup_acc_t acc = { 0 };
+    int stop = 0;
+    while (!stop && iter_next_block(&it, false) == 1) {
+        const ts_block_header_t *h = &b->hdr;
+        uint32_t first = (h->t_first - from) / step;
+        if (h->t_first >= from && h->t_last <= to && first == (h->t_last - from) / step) {
+            // Whole block inside one bucket: the header has the answer
+            stop = rollup_merge(&acc, from + first * step, h->count, h->v_min / it.scale,
+                                h->v_max / it.scale, (double)h->v_sum / it.scale, cb, ctx);
+            it.remaining = 0;
+            continue;
+        }
+        if (iter_load(&it, it.next_block - 1, true) != 0) {
+            continue;
+        }
+        ts_sample_t sample;
+        while (!stop && iter_decode(&it, &sample) == 1) {
+            uint32_t start = from + (sample.timestamp - from) / step * step;
+            stop = rollup_merge(&acc, start, 1, sample.value, sample.value, sample.value,
+                                cb, ctx);
+        }
+        if (it.done) {
+            break;
+        }
+    }
+    if (!stop && acc.open) {
+        acc.bucket.mean = (float)(acc.sum / acc.bucket.count);
+        cb(&acc.bucket, ctx);
+    }
+    ts_iter_end(&it);
+    return 0;
+}
+
+int ts_span(ts_series_t *s, uint32_t *oldest, uint32_t *newest, uint32_t *version)
+{
+    if (!s || !oldest || !newest || !version) {
+        return -1;
+    }
+    int ret = 0;
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    *newest = s->t_newest;
+    *version = s->appends;
+    uint32_t idx = (s->block_count < s->max_blocks) ? 0 : (s->head + 1) % s->max_blocks;
+    if (idx == s->head) {
+        *oldest = s->active->hdr.count ? s->active->hdr.t_first : 0;
+    } else {
+        ts_block_header_t hdr;
+        FILE *f = fopen(s->path, "rb");
+        if (!f || fseek(f, (long)idx * TS_BLOCK_SIZE, SEEK_SET) != 0 ||
+            fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != TS_MAGIC) {
+            ret = -1;
+        } else {
+            *oldest = hdr.count ? hdr.t_first : 0;
+        }
+        if (f) {
+            fclose(f);
+        }
+    }
+    xSemaphoreGive(s->lock);
+    return ret;
+}
+
+int ts_stats(ts_series_t *s, uint32_t *bytes, uint32_t *samples)
+{
+    if (!s || !bytes || !samples) {
+        return -1;
+    }
+    ts_iter_t it;
+    if (ts_iter_begin(s, 0, UINT32_MAX, &it) != 0) {
+        return -1;
+    }
+    const ts_block_t *b = it.block;
+    *bytes = 0;
+    *samples = 0;
+    for (uint32_t k = 0; k < it.block_total; k++) {
+        if (iter_load(&it, k, false) == 0) {
+            *bytes += sizeof(b->hdr) + (b->hdr.bit_len + 7) / 8;
+            *samples += b->hdr.count;
+        }
+    }
+    ts_iter_end(&it);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#ifndef TS_ARCHIVE_H
+#define TS_ARCHIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Append-only time-series archive.
+ *
+ * Each series is one file on SPIFFS made of fixed 4 KB blocks used as
+ * a ring (CONFIG_APP_TS_ARCHIVE_MAX_BLOCKS per series).  A block header
+ * holds the sample count, first/last timestamp and min/max/sum of the
+ * block; the payload is a bitstream of delta-of-delta timestamps and
+ * deltas of values quantised to a fixed number of decimals.  A sensor
+ * sampled at a steady period with slowly moving values costs 2 to 8
+ * bits per sample.
+ *
+ * Readers stream: an iterator decodes one block at a time and skips
+ * blocks whose header falls outside the queried range, and rollups use
+ * the header aggregates directly for blocks that fit in one bucket.
+ */
+
+#define TS_BLOCK_SIZE     4096
+#define TS_NAME_MAX       16
+#define TS_FLUSH_EVERY    10     // Appends kept in RAM before a flash write
+
+typedef struct ts_series ts_series_t;
+
+typedef struct {
+    uint32_t timestamp;     // Unix seconds
+    float value;
+} ts_sample_t;
+
+typedef struct {
+    uint32_t t_start;       // Bucket start (from + k * step)
+    uint32_t count;
+    float min;
+    float max;
+    float mean;
+} ts_bucket_t;
+
+/* Streaming cursor; fill with ts_iter_begin(), release with ts_iter_end(). */
+typedef struct {
+    ts_series_t *series;
+    uint32_t from;
+    uint32_t to;
+    uint32_t next_block;    // Position in ring order (0 = oldest)
+    uint32_t block_total;
+    uint32_t oldest;        // Ring index of the oldest block
+    void *file;
+    void *block;            // One loaded block (TS_BLOCK_SIZE bytes)
+    uint32_t remaining;     // Samples left in the loaded block
+    uint32_t bitpos;        // Decoder state
+    uint32_t t;
+    uint32_t delta;
+    int32_t v;
+    float scale;
+    uint32_t last_t;
+    bool done;
+} ts_iter_t;
+
+typedef int (*ts_bucket_cb)(const ts_bucket_t *bucket, void *ctx);
+
+/* Open or create /spiffs/ts/<name>.  decimals: quantisation (0..4). */
+ts_series_t *ts_open(const char *name, uint8_t decimals);
+void ts_close(ts_series_t *s);
+
+/* Timestamps must not go backwards, across blocks and reopens too;
+ * returns -1 when they do. */
+int ts_append(ts_series_t *s, uint32_t timestamp, float value);
+int ts_flush(ts_series_t *s);
+
+int ts_iter_begin(ts_series_t *s, uint32_t from, uint32_t to, ts_iter_t *it);
+/* Returns 1 with a sample, 0 at the end of the range, -1 on error. */
+int ts_iter_next(ts_iter_t *it, ts_sample_t *out);
+void ts_iter_end(ts_iter_t *it);
+
+/* Aggregate [from, to] into step-second buckets; empty buckets are
+ * not reported.  Stops early when cb returns non-zero. */
+int ts_rollup(ts_series_t *s, uint32_t from, uint32_t to, uint32_t step,
+              ts_bucket_cb cb, void *ctx);
+
+/*
+ * Oldest timestamp still held (the ring drops whole blocks), newest
+ * appended timestamp, and a counter bumped by every append since the
+ * series was opened.  Appends never go below newest, so a range ending
+ * before it only changes when its start is dropped.
+ */
+int ts_span(ts_series_t *s, uint32_t *oldest, uint32_t *newest, uint32_t *version);
+
+/* Encoded size of the series in bytes and its sample count. */
+int ts_stats(ts_series_t *s, uint32_t *bytes, uint32_t *samples);
+
+#endif /* TS_ARCHIVE_H */
@@ -0,0 +1,290 @@
+#include <stdbool.h>
+#include <string.h>
+#include "gzip_stream.h"
+#include "esp_rom_crc.h"
+#include "utils/mem_arena.h"
+
+/*
+ * gzip encoder.
+ *
+ * win[] holds two windows: the history matches may refer to and the
+ * input not yet encoded.  When it fills up the upper half is moved
+ * down and every hash chain entry is rebased, so positions always fit
+ * in 16 bits.  Matching is greedy over hash chains of 3-byte prefixes,
+ * at most GZ_MAX_CHAIN candidates deep; on small JSON rows lazy
+ * matching gains little and costs a second search per byte.
+ *
+ * The output is one final fixed-Huffman block (RFC 1951 3.2.6), which
+ * needs no tables and can be as long as the stream.
+ */
+
+#define GZ_MIN_MATCH   3
+#define GZ_MAX_MATCH   258
+#define GZ_MAX_CHAIN   24
+#define GZ_WINDOW_MASK (GZ_WINDOW_SIZE - 1)
+
+struct gz_stream {
+    gz_sink_fn sink;
+    void *ctx;
+    uint8_t win[2 * GZ_WINDOW_SIZE];
+    uint16_t head[1u << GZ_HASH_BITS];  // Newest position + 1 per hash, 0 = none
+    uint16_t prev[GZ_WINDOW_SIZE];      // Older position + 1 with the same hash
+    uint32_t fill;                      // Bytes in win[]
+    uint32_t pos;                       // Next byte to encode
+    uint32_t crc;
+    uint32_t total_in;
+    uint32_t total_out;
+    uint32_t bits;                      // Pending output bits, LSB first
+    uint32_t nbits;
+    uint8_t out[GZ_OUT_SIZE];
+    size_t out_len;
+    int err;
+};
+
+static const uint16_t LEN_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LEN_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static void flush_out(gz_stream_t *z)
+{
+    if (z->out_len > 0 && z->err == 0) {
+        if (z->sink(z->ctx, z->out, z->out_len) != 0) {
+            z->err = -1;
+        }
+        z->total_out += z->out_len;
+    }
+    z->out_len = 0;
+}
+
+static void put_byte(gz_stream_t *z, uint8_t b)
+{
+    z->out[z->out_len++] = b;
+    if (z->out_len == sizeof(z->out)) {
+        flush_out(z);
+    }
+}
+
+static void put_bits(gz_stream_t *z, uint32_t value, unsigned n)
+{
+    z->bits |= value << z->nbits;
+    z->nbits += n;
+    while (z->nbits >= 8) {
+        put_byte(z, (uint8_t)z->bits);
+        z->bits >>= 8;
+        z->nbits -= 8;
+    }
+}
+
+/* Huffman codes are defined MSB first but packed LSB first. */
+static void put_code(gz_stream_t *z, uint32_t code, unsigned n)
+{
+    uint32_t rev = 0;
+    for (unsigned i = 0; i < n; i++) {
+        rev = (rev << 1) | ((code >> i) & 1);
+    }
+    put_bits(z, rev, n);
+}
+
+static void put_symbol(gz_stream_t *z, unsigned sym)
+{
+    if (sym < 144) {
+        put_code(z, 0x30 + sym, 8);
+    } else if (sym < 256) {
+        put_code(z, 0x190 + sym - 144, 9);
+    } else if (sym < 280) {
+        put_code(z, sym - 256, 7);
+    } else {
+        put_code(z, 0xC0 + sym - 280, 8);
+    }
+}
+
+static void put_match(gz_stream_t *z, unsigned len, unsigned dist)
+{
+    unsigned i = 28;
+    while (LEN_BASE[i] > len) {
+        i--;
+    }
+    put_symbol(z, 257 + i);
+    put_bits(z, len - LEN_BASE[i], LEN_EXTRA[i]);
+
+    unsigned d = 29;
+    while (DIST_BASE[d] > dist) {
+        d--;
+    }
+    put_code(z, d, 5);
+    put_bits(z, dist - DIST_BASE[d], DIST_EXTRA[d]);
+}
+
+static uint32_t hash3(const uint8_t *p)
+{
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - GZ_HASH_BITS);
+}
+
+static void insert(gz_stream_t *z, uint32_t pos)
+{
+    uint32_t h = hash3(z->win + pos);
+    z->prev[pos & GZ_WINDOW_MASK] = z->head[h];
+    z->head[h] = (uint16_t)(pos + 1);
+}
+
+static unsigned longest_match(gz_stream_t *z, uint32_t pos, uint32_t avail, unsigned *dist)
+{
+    const uint8_t *cur = z->win + pos;
+    unsigned max = avail < GZ_MAX_MATCH ? avail : GZ_MAX_MATCH;
+    unsigned best = 0;
+    unsigned chain = GZ_MAX_CHAIN;
+    uint32_t cand = z->head[hash3(cur)];
+
+    while (cand != 0 && chain-- > 0) {
+        uint32_t c = cand - 1;
+        // prev[] slots are reused a window later, so stop before that
+        if (c >= pos || pos - c >= GZ_WINDOW_SIZE) {
+            break;
+        }
+        const uint8_t *m = z->win + c;
+        if (m[best] == cur[best] && m[0] == cur[0]) {
+            unsigned len = 0;
+            while (len < max && m[len] == cur[len]) {
+                len++;
+            }
+            if (len > best) {
+                best = len;
+                *dist = pos - c;
+                if (len == max) {
+                    break;
+                }
+            }
+        }
+        uint32_t next = z->prev[c & GZ_WINDOW_MASK];
+        if (next >= cand) {
+            break;
+        }
+        cand = next;
+    }
+    return best;
+}
+
+/* Encodes win[pos..fill), keeping a full match of lookahead unless final. */
+static void deflate_pending(gz_stream_t *z, bool final)
+{
+    for (;;) {
+        uint32_t avail = z->fill - z->pos;
+        if (avail == 0 || (!final && avail < GZ_MAX_MATCH)) {
+            return;
+        }
+        unsigned dist = 0;
+        unsigned len = avail >= GZ_MIN_MATCH ? longest_match(z, z->pos, avail, &dist) : 0;
+        if (len >= GZ_MIN_MATCH) {
+            put_match(z, len, dist);
+            for (unsigned k = 0; k < len; k++, z->pos++) {
+                if (z->pos + GZ_MIN_MATCH <= z->fill) {
+                    insert(z, z->pos);
+                }
+            }
+        } else {
+            if (avail >= GZ_MIN_MATCH) {
+                insert(z, z->pos);
+            }
+            put_symbol(z, z->win[z->pos++]);
+        }
+    }
+}
+
+static void slide(gz_stream_t *z)
+{
+    memmove(z->win, z->win + GZ_WINDOW_SIZE, z->fill - GZ_WINDOW_SIZE);
+    z->fill -= GZ_WINDOW_SIZE;
+    z->pos -= GZ_WINDOW_SIZE;
+    for (size_t i = 0; i < (1u << GZ_HASH_BITS); i++) {
+        z->head[i] = z->head[i] > GZ_WINDOW_SIZE ? z->head[i] - GZ_WINDOW_SIZE : 0;
+    }
+    for (size_t i = 0; i < GZ_WINDOW_SIZE; i++) {
+        z->prev[i] = z->prev[i] > GZ_WINDOW_SIZE ? z->prev[i] - GZ_WINDOW_SIZE : 0;
+    }
+}
+
+gz_stream_t *gz_open(gz_sink_fn sink, void *ctx)
+{
+    // ~21 KB per stream: keep it out of internal DRAM when PSRAM is there
+    gz_stream_t *z = mem_alloc_large(sizeof(*z));
+    if (!z) {
+        return NULL;
+    }
+    memset(z, 0, sizeof(*z));
+    z->sink = sink;
+    z->ctx = ctx;
+    // ID1 ID2 CM=deflate FLG=0 MTIME=0 XFL=0 OS=unknown
+    static const uint8_t header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+    for (size_t i = 0; i < sizeof(header); i++) {
+        put_byte(z, header[i]);
+    }
+    put_bits(z, 1, 1);      // BFINAL
+    put_bits(z, 1, 2);      // BTYPE = fixed Huffman
+    return z;
+}
+
+int gz_write(gz_stream_t *z, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0 && z->err == 0) {
+        size_t n = sizeof(z->win) - z->fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(z->win + z->fill, p, n);
+        z->crc = esp_rom_crc32_le(z->crc, p, (uint32_t)n);
+        z->fill += (uint32_t)n;
+        z->total_in += (uint32_t)n;
+        p += n;
+        len -= n;
+        deflate_pending(z, false);
+        if (z->fill == sizeof(z->win)) {
+            slide(z);
+        }
+    }
+    return z->err;
+}
+
+int gz_finish(gz_stream_t *z)
+{
+    deflate_pending(z, true);
+    put_symbol(z, 256);                     // End of block
+    put_bits(z, 0, (8 - z->nbits) & 7);     // Byte align
+    for (int i = 0; i < 4; i++) {
+        put_byte(z, (uint8_t)(z->crc >> (8 * i)));
+    }
+    for (int i = 0; i < 4; i++) {
+        put_byte(z, (uint8_t)(z->total_in >> (8 * i)));
+    }
+    flush_out(z);
+    return z->err;
+}
+
+void gz_close(gz_stream_t *z)
+{
+    mem_free_large(z);
+}
+
+void gz_totals(const gz_stream_t *z, uint32_t *in, uint32_t *out)
+{
+    if (in) {
+        *in = z->total_in;
+    }
+    if (out) {
+        *out = z->total_out + (uint32_t)z->out_len;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Streaming gzip encoder with a fixed memory budget.
+ *
+ * Input is compressed as it arrives with LZ77 over a 4 KB window and
+ * the fixed Huffman code of DEFLATE (one block, no dynamic tables), and
+ * the gzip stream is handed to a sink in GZ_OUT_SIZE pieces.  The whole
+ * state is one allocation of about 21 KB regardless of the payload, so
+ * a response of any length can be compressed while it is generated.
+ * JSON typically shrinks 3 to 5 times, about what gzip -1 achieves;
+ * dynamic Huffman tables would gain another quarter but need a block
+ * of symbols buffered per stream.
+ */
+
+#define GZ_WINDOW_BITS  12
+#define GZ_WINDOW_SIZE  (1u << GZ_WINDOW_BITS)
+#define GZ_HASH_BITS    11
+#define GZ_OUT_SIZE     512
+
+/* Receives compressed bytes; return non-zero to abort the stream. */
+typedef int (*gz_sink_fn)(void *ctx, const uint8_t *data, size_t len);
+
+typedef struct gz_stream gz_stream_t;
+
+gz_stream_t *gz_open(gz_sink_fn sink, void *ctx);
+
+/* Returns -1 once the sink has failed; later writes are ignored. */
+int gz_write(gz_stream_t *z, const void *data, size_t len);
+
+/* Emits the remaining input and the gzip trailer. */
+int gz_finish(gz_stream_t *z);
+
+void gz_close(gz_stream_t *z);
+
+/* Compressed bytes produced so far and input bytes consumed. */
+void gz_totals(const gz_stream_t *z, uint32_t *in, uint32_t *out);
+
+#endif /* GZIP_STREAM_H */
@@ -0,0 +1,518 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_fields.h"
+
+/*
+ * JSON field parser.
+ *
+ * Recursive descent over the body with the dotted path of the current
+ * member kept alongside; a value whose path is in the schema is
+ * converted straight into its target, any other value is only checked
+ * for syntax.  Members of arrays never match.  Strings are decoded as
+ * they are read, so a target array that is too short is caught without
+ * a second pass; in-place decoding is safe because the decoded text is
+ * never longer than its escaped form.
+ *
+ * Recursion is bounded by JSON_FIELDS_MAX_DEPTH, about 100 bytes of
+ * stack per level.
+ */
+
+typedef struct {
+    char *p;
+    char *end;
+    char *start;
+    const json_field_t *fields;
+    int count;
+    uint8_t *target;
+    uint32_t present;
+    char *err;
+    size_t err_size;
+    char path[JSON_FIELDS_PATH_MAX];
+    size_t path_len;
+    bool path_ok;           // False inside arrays and below over-long paths
+} parser_t;
+
+static int syntax_error(parser_t *j)
+{
+    snprintf(j->err, j->err_size, "Invalid JSON at byte %u", (unsigned)(j->p - j->start));
+    return -1;
+}
+
+static int field_error(parser_t *j, const char *problem)
+{
+    snprintf(j->err, j->err_size, "%s: %s", j->path, problem);
+    return -1;
+}
+
+static void skip_ws(parser_t *j)
+{
+    while (j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\n' || *j->p == '\r')) {
+        j->p++;
+    }
+}
+
+static int hex4(parser_t *j, uint32_t *out)
+{
+    if (j->end - j->p < 4) {
+        return -1;
+    }
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = *j->p++;
+        v <<= 4;
+        if (c >= '0' && c <= '9') {
+            v |= (uint32_t)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            v |= (uint32_t)(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            v |= (uint32_t)(c - 'A' + 10);
+        } else {
+            return -1;
+        }
+    }
+    *out = v;
+    return 0;
+}
+
+static size_t utf8_encode(uint32_t cp, char *out)
+{
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/*
+ * Reads the string at j->p.  The decoded text goes to dst while it fits
+ * in cap - 1 bytes and is NUL-terminated; *len is its full length.
+ */
+static int read_string(parser_t *j, char *dst, size_t cap, size_t *len)
+{
+    size_t n = 0;
+    j->p++;     // Opening quote
+    for (;;) {
+        if (j->p >= j->end) {
+            return syntax_error(j);
+        }
+        char c = *j->p++;
+        char buf[4];
+        size_t w = 1;
+        buf[0] = c;
+        if (c == '"') {
+            break;
+        }
+        if ((unsigned char)c < 0x20) {
+            j->p--;
+            return syntax_error(j);
+        }
+        if (c == '\\') {
+            if (j->p >= j->end) {
+                return syntax_error(j);
+            }
+            c = *j->p++;
+            switch (c) {
+            case '"': case '\\': case '/': buf[0] = c; break;
+            case 'b': buf[0] = '\b'; break;
+            case 'f': buf[0] = '\f'; break;
+            case 'n': buf[0] = '\n'; break;
+            case 'r': buf[0] = '\r'; break;
+            case 't': buf[0] = '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (hex4(j, &cp) != 0 || (cp >= 0xDC00 && cp <= 0xDFFF)) {
+                    return syntax_error(j);
+                }
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t low;
+                    if (j->end - j->p < 2 || j->p[0] != '\\' || j->p[1] != 'u') {
+                        return syntax_error(j);
+                    }
+                    j->p += 2;
+                    if (hex4(j, &low) != 0 || low < 0xDC00 || low > 0xDFFF) {
+                        return syntax_error(j);
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                w = utf8_encode(cp, buf);
+                break;
+            }
+            default:
+                j->p--;
+                return syntax_error(j);
+            }
+        }
+        if (dst && n + w < cap) {
+            memcpy(dst + n, buf, w);
+        }
+        n += w;
+    }
+    if (dst && cap > 0) {
+        dst[n < cap ? n : cap - 1] = '\0';
+    }
+    *len = n;
+    return 0;
+}
+
+/* Integer part of a number, or *integral = false for fractions,
+ * exponents and values beyond int64_t. */
+static int read_number(parser_t *j, int64_t *value, bool *integral)
+{
+    bool negative = false;
+    uint64_t v = 0;
+    *integral = true;
+    if (j->p < j->end && *j->p == '-') {
+        negative = true;
+        j->p++;
+    }
+    if (j->p >= j->end || *j->p < '0' || *j->p > '9') {
+        return syntax_error(j);
+    }
+    if (*j->p == '0') {
+        j->p++;
+    } else {
+        while (j->p < j->end && *j->p >= '0' && *j->p <= '9') {
+            unsigned d = (unsigned)(*j->p++ - '0');
+            if (v > (UINT64_MAX - d) / 10) {
+                *integral = false;
+            }
+            v = v * 10 + d;
+        }
+    }
+    if (j->p < j->end && *j->p == '.') {
+        j->p++;
+        *integral = false;
+        if (j->p >= j->end || *j->p < '0' || *j->p > '9') {
+            return syntax_error(j);
+        }
+        while (j->p < j->end && *j->p >= '0' && *j->p <= '9') {
+            j->p++;
+        }
+    }
+    if (j->p < j->end && (*j->p == 'e' || *j->p == 'E')) {
+        j->p++;
+        *integral = false;
+        if (j->p < j->end && (*j->p == '+' || *j->p == '-')) {
+            j->p++;
+        }
+        if (j->p >= j->end || *j->p < '0' || *j->p > '9') {
+            return syntax_error(j);
+        }
+        while (j->p < j->end && *j->p >= '0' && *j->p <= '9') {
+            j->p++;
+        }
+    }
+    if (v > (negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX)) {
+        *integral = false;
+    }
+    *value = negative ? (int64_t)(0 - v) : (int64_t)v;
+    return 0;
+}
+
+static int read_literal(parser_t *j, const char *word)
+{
+    size_t n = strlen(word);
+    if ((size_t)(j->end - j->p) < n || memcmp(j->p, word, n) != 0) {
+        return syntax_error(j);
+    }
+    j->p += n;
+    return 0;
+}
+
+static const json_field_t *find_field(parser_t *j)
+{
+    if (!j->path_ok) {
+        return NULL;
+    }
+    for (int i = 0; i < j->count; i++) {
+        if (strcmp(j->fields[i].path, j->path) == 0) {
+            return &j->fields[i];
+        }
+    }
+    return NULL;
+}
+
+static int store_int(parser_t *j, const json_field_t *f, int64_t v, bool integral)
+{
+    if (!integral || v < f->min || v > f->max) {
+        char problem[64];
+        snprintf(problem, sizeof(problem), "must be an integer from %lld to %lld",
+                 (long long)f->min, (long long)f->max);
+        return field_error(j, problem);
+    }
+    memcpy(j->target + f->offset, &v, sizeof(v));
+    return 0;
+}
+
+static int read_field_string(parser_t *j, const json_field_t *f)
+{
+    size_t len;
+    uint8_t *slot = j->target + f->offset;
+    switch (f->type) {
+    case JSON_FIELD_STR:
+        if (read_string(j, (char *)slot, f->size, &len) != 0) {
+            return -1;
+        }
+        return len < f->size ? 0 : field_error(j, "too long");
+    case JSON_FIELD_STR_REF: {
+        char *text = j->p + 1;
+        if (read_string(j, text, SIZE_MAX, &len) != 0) {
+            return -1;
+        }
+        memcpy(slot, &text, sizeof(text));
+        return len < f->size ? 0 : field_error(j, "too long");
+    }
+    case JSON_FIELD_INT: {
+        char digits[24];
+        if (read_string(j, digits, sizeof(digits), &len) != 0) {
+            return -1;
+        }
+        if (len == 0) {
+            return 1;   // Missing
+        }
+        char *end;
+        errno = 0;
+        long long v = strtoll(digits, &end, 10);
+        if (len >= sizeof(digits) || *end != '\0' ||
+            (digits[0] != '-' && (digits[0] < '0' || digits[0] > '9'))) {
+            return field_error(j, "not an integer");
+        }
+        return store_int(j, f, v, errno == 0);
+    }
+    default:
+        return field_error(j, "wrong type");
+    }
+}
+
+static int parse_value(parser_t *j, int depth);
+
+/* A RAW field: the value is validated like an unlisted one, with
+ * nothing below it matching, and only its extent recorded. */
+static int read_raw(parser_t *j, const json_field_t *f, int depth)
+{
+    json_raw_t raw = { .text = j->p, .string = *j->p == '"' };
+    if (raw.string) {
+        raw.text = j->p + 1;
+        if (read_string(j, raw.text, SIZE_MAX, &raw.len) != 0) {
+            return -1;
+        }
+    } else {
+        bool outer_ok = j->path_ok;
+        j->path_ok = false;
+        int rc = parse_value(j, depth);
+        j->path_ok = outer_ok;
+        if (rc != 0) {
+            return -1;
+        }
+        raw.len = (size_t)(j->p - raw.text);
+    }
+    memcpy(j->target + f->offset, &raw, sizeof(raw));
+    return 0;
+}
+
+static int parse_object(parser_t *j, int depth)
+{
+    if (depth > JSON_FIELDS_MAX_DEPTH) {
+        return syntax_error(j);
+    }
+    j->p++;
+    skip_ws(j);
+    if (j->p < j->end && *j->p == '}') {
+        j->p++;
+        return 0;
+    }
+    size_t outer_len = j->path_len;
+    bool outer_ok = j->path_ok;
+    for (;;) {
+        skip_ws(j);
+        if (j->p >= j->end || *j->p != '"') {
+            return syntax_error(j);
+        }
+        char key[JSON_FIELDS_PATH_MAX];
+        size_t key_len;
+        if (read_string(j, key, sizeof(key), &key_len) != 0) {
+            return -1;
+        }
+        size_t sep = outer_len ? 1 : 0;
+        j->path_ok = outer_ok && outer_len + sep + key_len < sizeof(j->path);
+        if (j->path_ok) {
+            j->path[outer_len] = '.';
+            memcpy(j->path + outer_len + sep, key, key_len + 1);
+            j->path_len = outer_len + sep + key_len;
+        }
+        skip_ws(j);
+        if (j->p >= j->end || *j->p != ':') {
+            return syntax_error(j);
+        }
+        j->p++;
+        if (parse_value(j, depth) != 0) {
+            return -1;
+        }
+        j->path_len = outer_len;
+        j->path[outer_len] = '\0';
+        j->path_ok = outer_ok;
+        skip_ws(j);
+        if (j->p < j->end && *j->p == ',') {
+            j->p++;
+            continue;
+        }
+        if (j->p < j->end && *j->p == '}') {
+            j->p++;
+            return 0;
+        }
+        return syntax_error(j);
+    }
+}
+
+static int parse_array(parser_t *j, int depth)
+{
+    if (depth > JSON_FIELDS_MAX_DEPTH) {
+        return syntax_error(j);
+    }
+    j->p++;
+    skip_ws(j);
+    if (j->p < j->end && *j->p == ']') {
+        j->p++;
+        return 0;
+    }
+    bool outer_ok = j->path_ok;
+    j->path_ok = false;
+    for (;;) {
+        if (parse_value(j, depth) != 0) {
+            return -1;
+        }
+        skip_ws(j);
+        if (j->p < j->end && *j->p == ',') {
+            j->p++;
+            continue;
+        }
+        if (j->p < j->end && *j->p == ']') {
+            j->p++;
+            j->path_ok = outer_ok;
+            return 0;
+        }
+        return syntax_error(j);
+    }
+}
+
+static int parse_value(parser_t *j, int depth)
+{
+    skip_ws(j);
+    if (j->p >= j->end) {
+        return syntax_error(j);
+    }
+    const json_field_t *f = find_field(j);
+    if (f && f->type == JSON_FIELD_RAW && *j->p != 'n') {
+        if (read_raw(j, f, depth) != 0) {
+            return -1;
+        }
+        j->present |= JSON_FIELD_BIT(f - j->fields);
+        return 0;
+    }
+    int rc;
+    switch (*j->p) {
+    case '{':
+        return f ? field_error(j, "wrong type") : parse_object(j, depth + 1);
+    case '[':
+        return f ? field_error(j, "wrong type") : parse_array(j, depth + 1);
+    case '"':
+        if (!f) {
+            size_t len;
+            return read_string(j, NULL, 0, &len);
+        }
+        rc = read_field_string(j, f);
+        break;
+    case 't':
+    case 'f': {
+        bool v = *j->p == 't';
+        if (read_literal(j, v ? "true" : "false") != 0) {
+            return -1;
+        }
+        if (!f) {
+            return 0;
+        }
+        if (f->type != JSON_FIELD_BOOL) {
+            return field_error(j, "wrong type");
+        }
+        memcpy(j->target + f->offset, &v, sizeof(v));
+        rc = 0;
+        break;
+    }
+    case 'n':
+        return read_literal(j, "null");
+    default: {
+        int64_t v;
+        bool integral;
+        if (read_number(j, &v, &integral) != 0) {
+            return -1;
+        }
+        if (!f) {
+            return 0;
+        }
+        if (f->type != JSON_FIELD_INT) {
+            return field_error(j, "wrong type");
+        }
+        rc = store_int(j, f, v, integral);
+        break;
+    }
+    }
+    if (rc < 0) {
+        return -1;
+    }
+    if (rc == 0) {
+        j->present |= JSON_FIELD_BIT(f - j->fields);
+    }
+    return 0;
+}
+
+int json_fields_parse(char *json, size_t len, const json_field_t *fields, int count,
+                      void *target, uint32_t *present, char *err, size_t err_size)
+{
+    parser_t j = {
+        .p = json,
+        .end = json + len,
+        .start = json,
+        .fields = fields,
+        .count = count,
+        .target = target,
+        .err = err,
+        .err_size = err_size,
+        .path_ok = true,
+    };
+    *present = 0;
+    if (count > JSON_FIELDS_MAX) {
+        snprintf(err, err_size, "Too many fields");
+        return -1;
+    }
+    skip_ws(&j);
+    if (j.p >= j.end || *j.p != '{') {
+        snprintf(err, err_size, "Expected a JSON object");
+        return -1;
+    }
+    if (parse_object(&j, 1) != 0) {
+        return -1;
+    }
+    skip_ws(&j);
+    if (j.p != j.end) {
+        return syntax_error(&j);
+    }
+    *present = j.present;
+    return 0;
+}
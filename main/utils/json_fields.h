@@ -0,0 +1,78 @@
+#ifndef JSON_FIELDS_H
+#define JSON_FIELDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Schema-driven JSON object parser for request bodies.
+ *
+ * An endpoint lists the fields it accepts, each with a dotted path
+ * ("server.port"), a type and where it goes in the endpoint's own
+ * struct.  One pass over the body validates the syntax, checks each
+ * listed value's type, length and range, and stores it; everything
+ * else is skipped.  Nothing is allocated: strings are copied into char
+ * arrays or decoded in place in the body, and no tree is built.
+ *
+ * A field that is missing or null is left untouched and its bit in
+ * *present stays clear.  An empty string counts as missing for
+ * integers, so forms may send "" for an unset port.
+ */
+
+#define JSON_FIELDS_MAX        32   // Bits in the presence mask
+#define JSON_FIELDS_MAX_DEPTH  8    // Nesting accepted, skipped values included
+#define JSON_FIELDS_PATH_MAX   64
+
+typedef enum {
+    JSON_FIELD_STR,         // char[size], NUL included; longer is an error
+    JSON_FIELD_STR_REF,     // const char *, decoded in place, at most size - 1 bytes
+    JSON_FIELD_INT,         // int64_t from a number or a string of digits, min..max
+    JSON_FIELD_BOOL,        // bool from true or false
+    JSON_FIELD_RAW,         // json_raw_t: any value, see below
+} json_field_type_t;
+
+/*
+ * A RAW field takes a value of any type.  A string is decoded in place
+ * and NUL-terminated; anything else (number, true/false, object or
+ * array) is left as written and is len bytes at text.  The byte after
+ * it belongs to the body, so the caller may terminate it there once
+ * json_fields_parse() has returned.
+ */
+typedef struct {
+    char *text;
+    size_t len;
+    bool string;
+} json_raw_t;
+
+typedef struct {
+    const char *path;
+    json_field_type_t type;
+    uint16_t offset;
+    uint16_t size;
+    int64_t min;
+    int64_t max;
+} json_field_t;
+
+#define JSON_STR(path, type, member) \
+    { path, JSON_FIELD_STR, offsetof(type, member), sizeof(((type *)0)->member), 0, 0 }
+#define JSON_STR_REF(path, type, member, max_len) \
+    { path, JSON_FIELD_STR_REF, offsetof(type, member), (max_len) + 1, 0, 0 }
+#define JSON_INT(path, type, member, lo, hi) \
+    { path, JSON_FIELD_INT, offsetof(type, member), sizeof(int64_t), lo, hi }
+#define JSON_BOOL(path, type, member) \
+    { path, JSON_FIELD_BOOL, offsetof(type, member), sizeof(bool), 0, 0 }
+#define JSON_RAW(path, type, member) \
+    { path, JSON_FIELD_RAW, offsetof(type, member), sizeof(json_raw_t), 0, 0 }
+
+#define JSON_FIELD_BIT(i)  (1u << (i))
+
+/*
+ * Parses the object in json[0..len) into target.  STR_REF fields point
+ * into json, which is modified.  Returns 0 with bit i of *present set
+ * for each fields[i] given, or -1 with a message for the client in err.
+ */
+int json_fields_parse(char *json, size_t len, const json_field_t *fields, int count,
+                      void *target, uint32_t *present, char *err, size_t err_size);
+
+#endif /* JSON_FIELDS_H */
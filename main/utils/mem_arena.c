@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "mem_arena.h"
+
+/*
+ * Request-scoped arena implementation.
+ *
+ * An arena is a chain of blocks.  The first block is allocated when
+ * a task opens its first scope and is kept for the lifetime of the
+ * task, so steady-state request handling performs no heap calls at
+ * all.  If a scope outgrows the first block an overflow block is
+ * chained in front of it (in PSRAM when it is large enough) and
+ * released when the scope closes.  Frees inside the arena are no-ops;
+ * anything else is forwarded to free().
+ */
+
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "cJSON.h"
+#include "utils/logger.h"
+
+#ifndef CONFIG_APP_MEM_ARENA_SIZE
+#define CONFIG_APP_MEM_ARENA_SIZE 8192
+#endif
+#ifndef CONFIG_APP_MEM_LARGE_THRESHOLD
+#define CONFIG_APP_MEM_LARGE_THRESHOLD 16384
+#endif
+#ifndef CONFIG_APP_MEM_ARENA_TLS_INDEX
+#define CONFIG_APP_MEM_ARENA_TLS_INDEX 1
+#endif
+
+#define ARENA_ALIGN 8
+#define ARENA_ROUND(n) (((n) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct mem_arena_block {
+    struct mem_arena_block *next;
+    size_t size;
+    size_t used;
+    uint8_t data[] __attribute__((aligned(ARENA_ALIGN)));
+} mem_arena_block_t;
+
+struct mem_arena {
+    mem_arena_block_t *head;    // Block currently bumped
+    mem_arena_block_t *base;    // Persistent first block
+    uint32_t depth;             // Open scope count
+    size_t in_use;              // Bytes handed out in this scope
+};
+
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static mem_arena_stats_t s_stats;
+
+static mem_arena_block_t *block_new(size_t size)
+{
+    mem_arena_block_t *block = mem_alloc_large(sizeof(*block) + size);
+    if (!block) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+#if CONFIG_FREERTOS_TLSP_DELETION_CALLBACKS
+static void arena_task_deleted(int index, void *ptr)
+{
+    (void)index;
+    mem_arena_t *arena = ptr;
+    if (!arena) {
+        return;
+    }
+    mem_arena_block_t *block = arena->head;
+    while (block) {
+        mem_arena_block_t *next = block->next;
+        mem_free_large(block);
+        block = next;
+    }
+    free(arena);
+}
+#endif
+
+static mem_arena_t *arena_current(void)
+{
+    return pvTaskGetThreadLocalStoragePointer(NULL, CONFIG_APP_MEM_ARENA_TLS_INDEX);
+}
+
+static mem_arena_t *arena_get_or_create(void)
+{
+    mem_arena_t *arena = arena_current();
+    if (arena) {
+        return arena;
+    }
+    arena = calloc(1, sizeof(*arena));
+    if (!arena) {
+        return NULL;
+    }
+    // The persistent block lives in internal RAM: it is small, hot and
+    // allocated once per task, so it cannot fragment the heap.
+    arena->base = malloc(sizeof(mem_arena_block_t) + CONFIG_APP_MEM_ARENA_SIZE);
+    if (!arena->base) {
+        free(arena);
+        return NULL;
+    }
+    arena->base->next = NULL;
+    arena->base->size = CONFIG_APP_MEM_ARENA_SIZE;
+    arena->base->used = 0;
+    arena->head = arena->base;
+#if CONFIG_FREERTOS_TLSP_DELETION_CALLBACKS
+    vTaskSetThreadLocalStoragePointerAndDelCallback(NULL, CONFIG_APP_MEM_ARENA_TLS_INDEX,
+                                                    arena, arena_task_deleted);
+#else
+    vTaskSetThreadLocalStoragePointer(NULL, CONFIG_APP_MEM_ARENA_TLS_INDEX, arena);
+#endif
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.capacity += CONFIG_APP_MEM_ARENA_SIZE;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return arena;
+}
+
+static bool arena_owns(const mem_arena_t *arena, const void *ptr)
+{
+    const uint8_t *p = ptr;
+    for (const mem_arena_block_t *block = arena->head; block; block = block->next) {
+        if (p >= block->data && p < block->data + block->size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void arena_rewind(mem_arena_t *arena)
+{
+    bool overflowed = false;
+    while (arena->head != arena->base) {
+        mem_arena_block_t *next = arena->head->next;
+        mem_free_large(arena->head);
+        arena->head = next;
+        overflowed = true;
+    }
+    arena->base->used = 0;
+    portENTER_CRITICAL(&s_stats_lock);
+    if (arena->in_use > s_stats.peak) {
+        s_stats.peak = arena->in_use;
+    }
+    if (overflowed) {
+        s_stats.overflows++;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    arena->in_use = 0;
+}
+
+int mem_init(void)
+{
+    cJSON_Hooks hooks = {
+        .malloc_fn = mem_arena_malloc,
+        .free_fn = mem_arena_free,
+    };
+    cJSON_InitHooks(&hooks);
+    return 0;
+}
+
+int mem_arena_scope_begin(void)
+{
+    mem_arena_t *arena = arena_get_or_create();
+    if (!arena) {
+        log_warn("mem", "Arena unavailable, falling back to heap");
+        return -1;
+    }
+    arena->depth++;
+    return 0;
+}
+
+void mem_arena_scope_end(void)
+{
+    mem_arena_t *arena = arena_current();
+    if (!arena || arena->depth == 0) {
+        return;
+    }
+    if (--arena->depth == 0) {
+        arena_rewind(arena);
+    }
+}
+
+void *mem_arena_malloc(size_t size)
+{
+    mem_arena_t *arena = arena_current();
+    if (!arena || arena->depth == 0) {
+        return malloc(size);
+    }
+    size_t need = ARENA_ROUND(size ? size : 1);
+    mem_arena_block_t *block = arena->head;
+    if (block->size - block->used < need) {
+        size_t chunk = need > CONFIG_APP_MEM_ARENA_SIZE ? need : CONFIG_APP_MEM_ARENA_SIZE;
+        block = block_new(chunk);
+        if (!block) {
+            return NULL;
+        }
+        block->next = arena->head;
+        arena->head = block;
+    }
+    void *ptr = block->data + block->used;
+    block->used += need;
+    arena->in_use += need;
+    return ptr;
+}
+
+void mem_arena_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    mem_arena_t *arena = arena_current();
+    if (arena && arena_owns(arena, ptr)) {
+        return;
+    }
+    free(ptr);
+}
+
+void *mem_alloc_large(size_t size)
+{
+#if CONFIG_SPIRAM
+    if (size >= CONFIG_APP_MEM_LARGE_THRESHOLD) {
+        // Prefer PSRAM, but boards booted with SPIRAM_IGNORE_NOTFOUND
+        // still get a buffer from internal RAM.
+        return heap_caps_malloc_prefer(size, 2,
+                                       MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT,
+                                       MALLOC_CAP_DEFAULT);
+    }
+#endif
+    return malloc(size);
+}
+
+void mem_free_large(void *ptr)
+{
+    heap_caps_free(ptr);
+}
+
+void mem_get_heap_stats(mem_heap_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    const uint32_t internal = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    memset(out, 0, sizeof(*out));
+    out->internal_free = heap_caps_get_free_size(internal);
+    out->internal_largest = heap_caps_get_largest_free_block(internal);
+    out->internal_min_free = heap_caps_get_minimum_free_size(internal);
+    if (out->internal_free > 0) {
+        out->internal_frag_pct =
+            (uint8_t)(100 - (out->internal_largest * 100) / out->internal_free);
+    }
+#if CONFIG_SPIRAM
+    out->psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    out->psram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+#endif
+}
+
+void mem_get_arena_stats(mem_arena_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
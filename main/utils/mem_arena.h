@@ -0,0 +1,60 @@
+#ifndef MEM_ARENA_H
+#define MEM_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Request-scoped bump allocator and heap placement helpers.
+ *
+ * Each task that opens a scope gets its own arena (stored in a
+ * FreeRTOS thread local storage slot).  Allocations made through
+ * mem_arena_malloc() while a scope is open are served by bumping a
+ * pointer in a block that is allocated once and reused; closing the
+ * outermost scope rewinds the arena in O(1).  cJSON is routed through
+ * the same hooks by mem_init(), so DOMs built inside an HTTP handler
+ * never touch the general purpose heap.  Outside of a scope the hooks
+ * fall back to malloc()/free().
+ *
+ * Pointers obtained from a scope must not outlive it.
+ */
+
+typedef struct mem_arena mem_arena_t;
+
+typedef struct {
+    size_t internal_free;       // Free internal DRAM (bytes)
+    size_t internal_largest;    // Largest contiguous internal block
+    size_t internal_min_free;   // Low-water mark since boot
+    uint8_t internal_frag_pct;  // 100 - largest * 100 / free
+    size_t psram_free;          // 0 when PSRAM is absent
+    size_t psram_largest;
+} mem_heap_stats_t;
+
+typedef struct {
+    size_t capacity;            // Size of the persistent first block
+    size_t peak;                // Highest usage seen in one scope
+    uint32_t overflows;         // Scopes that needed an extra block
+} mem_arena_stats_t;
+
+/* Install the cJSON hooks.  Call once, before any cJSON use. */
+int mem_init(void);
+
+/* Open/close an allocation scope on the calling task.  Scopes nest;
+ * the arena is rewound when the outermost scope closes. */
+int mem_arena_scope_begin(void);
+void mem_arena_scope_end(void);
+
+/* Allocator pair used by cJSON and request code. */
+void *mem_arena_malloc(size_t size);
+void mem_arena_free(void *ptr);
+
+/* Large buffers go to PSRAM when available, internal heap otherwise. */
+void *mem_alloc_large(size_t size);
+void mem_free_large(void *ptr);
+
+void mem_get_heap_stats(mem_heap_stats_t *out);
+/* Aggregated over every task arena created so far. */
+void mem_get_arena_stats(mem_arena_stats_t *out);
+
+#endif /* MEM_ARENA_H */
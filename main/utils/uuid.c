@@ -1,43 +1,121 @@
-#include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 #include "uuid.h"
 
 /*
- * UUID v4 generator.
+ * UUID generation and conversion.
  *
- * Generates a random UUID version 4 string using esp_random().
- * The format is xxxxxxxx-xxxx-4xxx-yxxx-xxxxxxxxxxxx where x is
- * random hex and y is one of 8, 9, A or B.  Returns 0 on success.
+ * UUIDv7 layout: 48-bit Unix milliseconds, version 7, a 12-bit
+ * counter, variant 10, 62 random bits.  The counter starts at a random
+ * value below 0x800 each millisecond and counts up inside it (RFC 9562
+ * method 1), so ids stay ordered when several are made in the same
+ * millisecond; if it runs out, or the clock steps back after an SNTP
+ * correction, the next millisecond is borrowed instead.
+ *
+ * Text conversion is table driven: one nibble lookup per hex digit out
+ * and one byte lookup per digit in, with no snprintf.
  */
 
+#include "freertos/FreeRTOS.h"
 #include "esp_random.h"
+#include "mbedtls/sha256.h"
+
+static const char HEX[] = "0123456789abcdef";
+
+// Digit value + 1; 0 marks a character that is not a hex digit
+static const uint8_t UNHEX[256] = {
+    ['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,
+    ['5'] = 6,  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t s_last_ms;
+static uint16_t s_counter;
+
+void uuid_v7(uint8_t out[UUID_BIN_LEN])
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t ms = (uint64_t)tv.tv_sec * 1000 + (uint64_t)tv.tv_usec / 1000;
+    uint32_t r0 = esp_random();
+    uint32_t r1 = esp_random();
+    uint32_t r2 = esp_random();
+
+    portENTER_CRITICAL(&s_lock);
+    if (ms > s_last_ms) {
+        s_last_ms = ms;
+        s_counter = r0 & 0x7FF;
+    } else if (++s_counter > 0xFFF) {
+        s_last_ms++;
+        s_counter = r0 & 0x7FF;
+    }
+    ms = s_last_ms;
+    uint16_t counter = s_counter;
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < 6; i++) {
+        out[i] = (uint8_t)(ms >> (40 - 8 * i));
+    }
+    out[6] = 0x70 | (uint8_t)(counter >> 8);
+    out[7] = (uint8_t)counter;
+    out[8] = 0x80 | (uint8_t)(r1 & 0x3F);
+    out[9] = (uint8_t)(r1 >> 8);
+    out[10] = (uint8_t)(r1 >> 16);
+    out[11] = (uint8_t)(r1 >> 24);
+    memcpy(out + 12, &r2, 4);
+}
+
+void uuid_from_name(const char *name, uint8_t out[UUID_BIN_LEN])
+{
+    uint8_t digest[32];
+    mbedtls_sha256((const unsigned char *)name, strlen(name), digest, 0);
+    memcpy(out, digest, UUID_BIN_LEN);
+    out[6] = 0x80 | (out[6] & 0x0F);
+    out[8] = 0x80 | (out[8] & 0x3F);
+}
+
+void uuid_format(const uint8_t in[UUID_BIN_LEN], char out[UUID_STR_LEN])
+{
+    char *p = out;
+    for (int i = 0; i < UUID_BIN_LEN; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            *p++ = '-';
+        }
+        *p++ = HEX[in[i] >> 4];
+        *p++ = HEX[in[i] & 0x0F];
+    }
+    *p = '\0';
+}
+
+int uuid_parse(const char *text, uint8_t out[UUID_BIN_LEN])
+{
+    const uint8_t *p = (const uint8_t *)text;
+    for (int i = 0; i < UUID_BIN_LEN; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            if (*p++ != '-') {
+                return -1;
+            }
+        }
+        uint8_t hi = UNHEX[p[0]];
+        uint8_t lo = hi ? UNHEX[p[1]] : 0;
+        if (!lo) {
+            return -1;
+        }
+        out[i] = (uint8_t)((hi - 1) << 4 | (lo - 1));
+        p += 2;
+    }
+    return *p == '\0' ? 0 : -1;
+}
 
 int uuid_generate(char *out, size_t max_len)
 {
-    if (!out || max_len < 37) {
+    if (!out || max_len < UUID_STR_LEN) {
         return -1;
     }
-    uint8_t bytes[16];
-    for (int i = 0; i < 16; i += 4) {
-        uint32_t r = esp_random();
-        bytes[i]     = (r >> 0) & 0xFF;
-        bytes[i + 1] = (r >> 8) & 0xFF;
-        bytes[i + 2] = (r >> 16) & 0xFF;
-        bytes[i + 3] = (r >> 24) & 0xFF;
-    }
-    // Set version (4) and variant (10xx)
-    bytes[6] = (bytes[6] & 0x0F) | 0x40;
-    bytes[8] = (bytes[8] & 0x3F) | 0x80;
-    snprintf(out, max_len,
-             "%02x%02x%02x%02x-"
-             "%02x%02x-"
-             "%02x%02x-"
-             "%02x%02x-"
-             "%02x%02x%02x%02x%02x%02x",
-             bytes[0], bytes[1], bytes[2], bytes[3],
-             bytes[4], bytes[5],
-             bytes[6], bytes[7],
-             bytes[8], bytes[9],
-             bytes[10], bytes[11], bytes[12], bytes[13], bytes[14], bytes[15]);
+    uint8_t id[UUID_BIN_LEN];
+    uuid_v7(id);
+    uuid_format(id, out);
     return 0;
 }
@@ -2,7 +2,27 @@
 #define UUID_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+/*
+ * Record identifiers are UUIDv7 (RFC 9562): a 48-bit millisecond
+ * timestamp leads, so ids made one after the other sort in creation
+ * order.  The database keeps the 16 bytes; the 36-character text form
+ * only exists at the API boundary.
+ */
+
+#define UUID_BIN_LEN 16
+#define UUID_STR_LEN 37         // Text form and its terminating NUL
+
+/* Text form of a new UUIDv7.  Returns 0 on success. */
 int uuid_generate(char *out, size_t max_len);
+/* New UUIDv7; strictly increasing within one boot. */
+void uuid_v7(uint8_t out[UUID_BIN_LEN]);
+/* Stable UUIDv8 named after any other key (SHA-256 of the text), for
+ * ids that predate UUIDs: the same key always maps to the same id. */
+void uuid_from_name(const char *name, uint8_t out[UUID_BIN_LEN]);
+void uuid_format(const uint8_t in[UUID_BIN_LEN], char out[UUID_STR_LEN]);
+/* 8-4-4-4-12 hex digits, either case.  Returns 0 on success. */
+int uuid_parse(const char *text, uint8_t out[UUID_BIN_LEN]);
 
-#endif /* UUID_H */
\ No newline at end of file
+#endif /* UUID_H */
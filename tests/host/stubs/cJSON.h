@@ -0,0 +1,14 @@
+#ifndef cJSON__h
+#define cJSON__h
+
+#include <stddef.h>
+
+/* Host stub: only the allocator hooks mem_arena.c installs. */
+typedef struct cJSON_Hooks {
+    void *(*malloc_fn)(size_t sz);
+    void (*free_fn)(void *ptr);
+} cJSON_Hooks;
+
+void cJSON_InitHooks(cJSON_Hooks *hooks);
+
+#endif /* cJSON__h */
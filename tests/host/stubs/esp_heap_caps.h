@@ -0,0 +1,17 @@
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H
+
+#include <stdlib.h>
+
+/* Host stub: one heap, no statistics. */
+#define MALLOC_CAP_INTERNAL 0x1
+#define MALLOC_CAP_8BIT     0x2
+#define MALLOC_CAP_SPIRAM   0x4
+#define MALLOC_CAP_DEFAULT  0x8
+
+static inline void heap_caps_free(void *ptr) { free(ptr); }
+static inline size_t heap_caps_get_free_size(unsigned caps) { (void)caps; return 0; }
+static inline size_t heap_caps_get_largest_free_block(unsigned caps) { (void)caps; return 0; }
+static inline size_t heap_caps_get_minimum_free_size(unsigned caps) { (void)caps; return 0; }
+
+#endif /* ESP_HEAP_CAPS_H */
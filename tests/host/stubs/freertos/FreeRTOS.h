@@ -0,0 +1,10 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+/* Host stub: one task, no preemption. */
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux)  ((void)(mux))
+
+#endif /* FREERTOS_H */
@@ -0,0 +1,23 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <stddef.h>
+
+/* Host stub: the calling thread is the only task. */
+typedef void *TaskHandle_t;
+
+static void *s_host_tls[8];
+
+static inline void *pvTaskGetThreadLocalStoragePointer(TaskHandle_t task, int index)
+{
+    (void)task;
+    return s_host_tls[index];
+}
+
+static inline void vTaskSetThreadLocalStoragePointer(TaskHandle_t task, int index, void *value)
+{
+    (void)task;
+    s_host_tls[index] = value;
+}
+
+#endif /* TASK_H */
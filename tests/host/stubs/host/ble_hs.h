@@ -0,0 +1,81 @@
+#ifndef H_BLE_HS_
+#define H_BLE_HS_
+
+#include <stdint.h>
+
+/*
+ * Minimal NimBLE host stub for the host tests: the types, constants
+ * and calls ble_services.c uses.  The test provides the functions and
+ * records what the service sends.
+ */
+
+#define BLE_HS_ENOMEM                       6
+#define BLE_HS_EBUSY                        15
+#define BLE_HS_ENOTCONN                     7
+
+#define BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN  0x0d
+#define BLE_ATT_ERR_UNLIKELY                0x0e
+#define BLE_ATT_ERR_INSUFFICIENT_RES        0x11
+
+#define BLE_GATT_ACCESS_OP_READ_CHR         0
+#define BLE_GATT_ACCESS_OP_WRITE_CHR        1
+#define BLE_GATT_SVC_TYPE_PRIMARY           1
+#define BLE_GATT_CHR_F_READ                 0x0002
+#define BLE_GATT_CHR_F_WRITE                0x0008
+#define BLE_GATT_CHR_F_NOTIFY               0x0010
+
+typedef struct {
+    uint8_t type;
+} ble_uuid_t;
+
+typedef struct {
+    ble_uuid_t u;
+    uint16_t value;
+} ble_uuid16_t;
+
+typedef struct {
+    ble_uuid_t u;
+    uint8_t value[16];
+} ble_uuid128_t;
+
+#define BLE_UUID128_INIT(...) { .u = { .type = 128 }, .value = { __VA_ARGS__ } }
+#define BLE_UUID16_DECLARE(v) (&((const ble_uuid16_t){ .u = { .type = 16 }, .value = (v) }).u)
+
+struct os_mbuf {
+    uint16_t len;
+    uint8_t data[600];
+};
+
+#define OS_MBUF_PKTLEN(om) ((om)->len)
+
+struct ble_gatt_access_ctxt {
+    uint8_t op;
+    struct os_mbuf *om;
+};
+
+typedef int ble_gatt_access_fn(uint16_t conn_handle, uint16_t attr_handle,
+                               struct ble_gatt_access_ctxt *ctxt, void *arg);
+
+struct ble_gatt_chr_def {
+    const ble_uuid_t *uuid;
+    ble_gatt_access_fn *access_cb;
+    uint16_t flags;
+    uint16_t *val_handle;
+};
+
+struct ble_gatt_svc_def {
+    uint8_t type;
+    const ble_uuid_t *uuid;
+    const struct ble_gatt_chr_def *characteristics;
+};
+
+uint16_t ble_att_mtu(uint16_t conn_handle);
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len);
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len);
+int ble_hs_mbuf_to_flat(const struct os_mbuf *om, void *flat, uint16_t max_len, uint16_t *out_len);
+int ble_gatts_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om);
+void ble_gatts_chr_updated(uint16_t chr_val_handle);
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs);
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *svcs);
+
+#endif /* H_BLE_HS_ */
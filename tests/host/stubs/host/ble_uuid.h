@@ -0,0 +1,7 @@
+#ifndef H_BLE_UUID_
+#define H_BLE_UUID_
+
+/* The UUID types live in the ble_hs.h stub. */
+#include "host/ble_hs.h"
+
+#endif /* H_BLE_UUID_ */
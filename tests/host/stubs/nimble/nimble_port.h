@@ -0,0 +1,32 @@
+#ifndef _NIMBLE_PORT_H
+#define _NIMBLE_PORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* NimBLE porting layer stub: a callout only records that it is armed. */
+
+struct ble_npl_event {
+    int unused;
+};
+
+struct ble_npl_eventq {
+    int unused;
+};
+
+typedef void ble_npl_event_fn(struct ble_npl_event *ev);
+
+struct ble_npl_callout {
+    ble_npl_event_fn *fn;
+    bool armed;
+    uint32_t ticks;
+};
+
+struct ble_npl_eventq *nimble_port_get_dflt_eventq(void);
+void ble_npl_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq,
+                          ble_npl_event_fn *ev_cb, void *ev_arg);
+int ble_npl_callout_reset(struct ble_npl_callout *co, uint32_t ticks);
+void ble_npl_callout_stop(struct ble_npl_callout *co);
+uint32_t ble_npl_time_ms_to_ticks32(uint32_t ms);
+
+#endif /* _NIMBLE_PORT_H */
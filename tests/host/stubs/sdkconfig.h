@@ -0,0 +1,9 @@
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+/* Host test configuration: only what the sources under test read. */
+#define CONFIG_BT_NIMBLE_ENABLED 1
+#define CONFIG_APP_IMPORT_BATCH_BYTES 32768
+#define CONFIG_APP_MEM_ARENA_SIZE 8192
+
+#endif /* SDKCONFIG_H */
@@ -0,0 +1,383 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Host test of the BLE history stream against the NimBLE stub in
+ * stubs/: page packing (MTU-based capacity, u16 step overflow, empty
+ * final page) and the pump's handling of full host buffers.  The
+ * service file is included so its static functions can be driven
+ * directly; the archive iterator and the sensor table are faked.
+ */
+
+#include "ble/ble_services.c"
+
+#define MAX_SAMPLES  1000
+#define MAX_PAGES    64
+
+static int s_failed;
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+            s_failed++;                                                       \
+        }                                                                     \
+    } while (0)
+
+/* --- Fakes ------------------------------------------------------------ */
+
+static ts_sample_t s_samples[MAX_SAMPLES];
+static size_t s_sample_count;
+static int s_iter_ended;
+static int s_series_dummy;
+
+static uint16_t s_mtu;
+static int s_notify_rc[16];         // Scripted results, then 0
+static int s_notify_rc_count;
+static int s_notify_calls;
+static int s_mbuf_fail;             // ble_hs_mbuf_from_flat() failures to come
+static uint8_t s_pages[MAX_PAGES][HISTORY_PAGE_MAX];
+static uint16_t s_page_len[MAX_PAGES];
+static int s_page_count;
+static struct os_mbuf s_mbuf;
+
+void log_info(const char *tag, const char *fmt, ...) { (void)tag; (void)fmt; }
+void log_warn(const char *tag, const char *fmt, ...) { (void)tag; (void)fmt; }
+void log_error(const char *tag, const char *fmt, ...) { (void)tag; (void)fmt; }
+
+int ts_iter_begin(ts_series_t *s, uint32_t from, uint32_t to, ts_iter_t *it)
+{
+    memset(it, 0, sizeof(*it));
+    it->series = s;
+    it->from = from;
+    it->to = to;
+    return 0;
+}
+
+int ts_iter_next(ts_iter_t *it, ts_sample_t *out)
+{
+    while (it->next_block < s_sample_count) {
+        ts_sample_t s = s_samples[it->next_block++];
+        if (s.timestamp > it->to) {
+            return 0;
+        }
+        if (s.timestamp >= it->from) {
+            *out = s;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void ts_iter_end(ts_iter_t *it)
+{
+    it->done = true;
+    s_iter_ended++;
+}
+
+int sensors_get_current(sensor_value_t *out, int max)
+{
+    if (max < 1) {
+        return 0;
+    }
+    memset(out, 0, sizeof(*out));
+    snprintf(out->name, sizeof(out->name), "ds0");
+    out->kind = SENSOR_KIND_TEMPERATURE;
+    out->valid = true;
+    return 1;
+}
+
+ts_series_t *sensors_get_series(const char *name)
+{
+    return strcmp(name, "ds0") == 0 ? (ts_series_t *)&s_series_dummy : NULL;
+}
+
+int sensor_sched_add(const sensor_job_cfg_t *cfg) { (void)cfg; return 0; }
+int sensor_sched_start(void) { return 0; }
+
+uint16_t ble_att_mtu(uint16_t conn_handle) { (void)conn_handle; return s_mtu; }
+
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len)
+{
+    if (om->len + len > sizeof(om->data)) {
+        return BLE_HS_ENOMEM;
+    }
+    memcpy(om->data + om->len, data, len);
+    om->len += len;
+    return 0;
+}
+
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len)
+{
+    if (s_mbuf_fail > 0) {
+        s_mbuf_fail--;
+        return NULL;
+    }
+    s_mbuf.len = 0;
+    os_mbuf_append(&s_mbuf, buf, len);
+    return &s_mbuf;
+}
+
+int ble_hs_mbuf_to_flat(const struct os_mbuf *om, void *flat, uint16_t max_len, uint16_t *out_len)
+{
+    uint16_t n = om->len < max_len ? om->len : max_len;
+    memcpy(flat, om->data, n);
+    *out_len = n;
+    return n == om->len ? 0 : BLE_HS_ENOMEM;
+}
+
+int ble_gatts_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om)
+{
+    (void)conn_handle;
+    (void)att_handle;
+    int rc = s_notify_calls < s_notify_rc_count ? s_notify_rc[s_notify_calls] : 0;
+    s_notify_calls++;
+    if (rc == 0 && s_page_count < MAX_PAGES) {
+        memcpy(s_pages[s_page_count], om->data, om->len);
+        s_page_len[s_page_count++] = om->len;
+    }
+    return rc;
+}
+
+void ble_gatts_chr_updated(uint16_t chr_val_handle) { (void)chr_val_handle; }
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs) { (void)defs; return 0; }
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *svcs) { (void)svcs; return 0; }
+
+static struct ble_npl_eventq s_eventq;
+
+struct ble_npl_eventq *nimble_port_get_dflt_eventq(void) { return &s_eventq; }
+
+void ble_npl_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq,
+                          ble_npl_event_fn *ev_cb, void *ev_arg)
+{
+    (void)evq;
+    (void)ev_arg;
+    memset(co, 0, sizeof(*co));
+    co->fn = ev_cb;
+}
+
+int ble_npl_callout_reset(struct ble_npl_callout *co, uint32_t ticks)
+{
+    co->armed = true;
+    co->ticks = ticks;
+    return 0;
+}
+
+void ble_npl_callout_stop(struct ble_npl_callout *co) { co->armed = false; }
+uint32_t ble_npl_time_ms_to_ticks32(uint32_t ms) { return ms; }
+
+/* --- Helpers ----------------------------------------------------------- */
+
+static void reset(uint16_t mtu)
+{
+    history_stop(&s_stream);
+    memset(&s_stream, 0, sizeof(s_stream));
+    s_sample_count = 0;
+    s_iter_ended = 0;
+    s_mtu = mtu;
+    s_notify_rc_count = 0;
+    s_notify_calls = 0;
+    s_mbuf_fail = 0;
+    s_page_count = 0;
+    ble_services_init();
+}
+
+static void add_sample(uint32_t t, float v)
+{
+    s_samples[s_sample_count++] = (ts_sample_t){ t, v };
+}
+
+static int request(uint32_t from, uint32_t to)
+{
+    uint8_t req[HISTORY_REQ_LEN] = { 0 };
+    put_le32(req + 1, from);
+    put_le32(req + 5, to);
+    struct os_mbuf om = { 0 };
+    os_mbuf_append(&om, req, sizeof(req));
+    struct ble_gatt_access_ctxt ctxt = { BLE_GATT_ACCESS_OP_WRITE_CHR, &om };
+    return history_access(1, s_history_handle, &ctxt, NULL);
+}
+
+/* Run the armed callout until the stream ends; returns the number of runs. */
+static int drain(void)
+{
+    int runs = 0;
+    while (s_pump_callout.armed && runs < 1000) {
+        s_pump_callout.armed = false;
+        s_pump_callout.fn(NULL);
+        runs++;
+    }
+    return runs;
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* Decode every received page back into samples; checks the sequence. */
+static size_t decode_pages(ts_sample_t *out, size_t max)
+{
+    size_t n = 0;
+    for (int i = 0; i < s_page_count; i++) {
+        const uint8_t *p = s_pages[i];
+        CHECK(p[0] == (uint8_t)i);
+        CHECK(s_page_len[i] == HISTORY_HDR_LEN + p[1] * HISTORY_SAMPLE_LEN);
+        uint32_t t = get_le32(p + 3);
+        for (int k = 0; k < p[1] && n < max; k++) {
+            t += get_le16(p + HISTORY_HDR_LEN + k * HISTORY_SAMPLE_LEN);
+            int16_t q = (int16_t)get_le16(p + HISTORY_HDR_LEN + k * HISTORY_SAMPLE_LEN + 2);
+            out[n++] = (ts_sample_t){ t, q / 100.0f };
+        }
+    }
+    return n;
+}
+
+static void check_round_trip(void)
+{
+    static ts_sample_t got[MAX_SAMPLES];
+    size_t n = decode_pages(got, MAX_SAMPLES);
+    CHECK(n == s_sample_count);
+    for (size_t i = 0; i < n && i < s_sample_count; i++) {
+        CHECK(got[i].timestamp == s_samples[i].timestamp);
+        CHECK(fabsf(got[i].value - s_samples[i].value) < 0.006f);
+    }
+    // Exactly one empty page, the last one
+    CHECK(s_page_count > 0 && s_pages[s_page_count - 1][1] == 0);
+    for (int i = 0; i + 1 < s_page_count; i++) {
+        CHECK(s_pages[i][1] > 0);
+    }
+    CHECK(!s_stream.active && s_iter_ended == 1);
+}
+
+/* --- Tests ------------------------------------------------------------- */
+
+static void test_capacity(void)
+{
+    // Default MTU: 20-byte payload, 3 samples a page
+    reset(23);
+    for (int i = 0; i < 10; i++) {
+        add_sample(1000 + 60 * i, 24.0f + 0.25f * i);
+    }
+    CHECK(request(0, 0) == 0);
+    drain();
+    CHECK(s_page_count == 5);
+    CHECK(s_pages[0][1] == 3 && s_pages[3][1] == 1);
+    check_round_trip();
+
+    // Largest MTU: 126 samples a page
+    reset(517);
+    for (int i = 0; i < 300; i++) {
+        add_sample(1000 + 60 * i, -5.0f + 0.01f * i);
+    }
+    CHECK(request(0, 0) == 0);
+    drain();
+    CHECK(s_page_count == 4);
+    CHECK(s_pages[0][1] == 126 && s_pages[1][1] == 126 && s_pages[2][1] == 48);
+    check_round_trip();
+
+    // No MTU known: falls back to the default payload
+    reset(0);
+    add_sample(1000, 20.0f);
+    CHECK(request(0, 0) == 0);
+    drain();
+    CHECK(s_page_count == 2 && s_pages[0][1] == 1);
+}
+
+static void test_step_overflow(void)
+{
+    reset(517);
+    add_sample(1000, 25.0f);
+    add_sample(1060, 25.5f);
+    add_sample(1060 + 70000, 26.0f);    // More than a u16 step after the previous
+    add_sample(1120 + 70000, 26.5f);
+    CHECK(request(0, 0) == 0);
+    drain();
+    CHECK(s_page_count == 3);
+    CHECK(s_pages[0][1] == 2 && get_le32(s_pages[0] + 3) == 1000);
+    CHECK(s_pages[1][1] == 2 && get_le32(s_pages[1] + 3) == 1060 + 70000);
+    check_round_trip();
+}
+
+static void test_empty_range(void)
+{
+    reset(517);
+    add_sample(1000, 25.0f);
+    CHECK(request(2000, 3000) == 0);
+    drain();
+    CHECK(s_page_count == 1 && s_pages[0][1] == 0);
+    CHECK(!s_stream.active && s_iter_ended == 1);
+}
+
+static void test_buffers_full(void)
+{
+    reset(23);
+    for (int i = 0; i < 40; i++) {
+        add_sample(1000 + 60 * i, 30.0f - 0.5f * i);
+    }
+    // Out of buffers, then busy, then no mbuf: each keeps the page
+    s_notify_rc[0] = 0;
+    s_notify_rc[1] = BLE_HS_ENOMEM;
+    s_notify_rc[2] = BLE_HS_EBUSY;
+    s_notify_rc_count = 3;
+    s_mbuf_fail = 0;
+    CHECK(request(0, 0) == 0);
+    s_pump_callout.armed = false;
+    s_pump_callout.fn(NULL);
+    CHECK(s_page_count == 1);               // Stopped at the first refusal
+    CHECK(s_stream.active && s_stream.page_len > 0);
+    CHECK(s_pump_callout.armed && s_pump_callout.ticks == HISTORY_RETRY_MS);
+    s_mbuf_fail = 1;
+    drain();
+    check_round_trip();                     // No page lost or sent twice
+}
+
+static void test_burst_and_tx(void)
+{
+    reset(23);
+    for (int i = 0; i < 100; i++) {
+        add_sample(1000 + 60 * i, 22.0f);
+    }
+    CHECK(request(0, 0) == 0);
+    s_pump_callout.armed = false;
+    s_pump_callout.fn(NULL);
+    CHECK(s_page_count == HISTORY_BURST);   // Yields to the host task
+    CHECK(s_pump_callout.armed);
+    // A completed notification pumps the next burst straight away
+    ble_services_on_notify_tx(1, 0);
+    CHECK(s_page_count == 2 * HISTORY_BURST);
+    drain();
+    check_round_trip();
+}
+
+static void test_abort_and_busy(void)
+{
+    reset(23);
+    for (int i = 0; i < 10; i++) {
+        add_sample(1000 + 60 * i, 22.0f);
+    }
+    CHECK(request(0, 0) == 0);
+    CHECK(request(0, 0) == HISTORY_ERR_BUSY);
+    s_notify_rc[0] = BLE_HS_ENOTCONN;
+    s_notify_rc_count = 1;
+    drain();
+    CHECK(!s_stream.active && s_iter_ended == 1 && !s_pump_callout.armed);
+    CHECK(s_page_count == 0);
+    // A new request is accepted once the stream is gone
+    CHECK(request(0, 0) == 0);
+    ble_services_on_disconnect(1);
+    CHECK(!s_stream.active && s_iter_ended == 2);
+}
+
+int main(void)
+{
+    test_capacity();
+    test_step_overflow();
+    test_empty_range();
+    test_buffers_full();
+    test_burst_and_tx();
+    test_abort_and_busy();
+    printf("test_ble_history: %s\n", s_failed ? "FAILED" : "ok");
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+#include <math.h>
+#include <stdio.h>
+#include "dht22_frame.h"
+
+/*
+ * Host test of the DHT22 frame decoder: logic-analyser traces of a
+ * response, as (level, µs) pairs starting at the host's release of the
+ * line, go through the same path as the driver's RMT symbols.
+ */
+
+typedef struct {
+    int level;
+    uint16_t us;
+} edge_t;
+
+// 65.2 %RH, 35.1 °C
+static const edge_t TRACE_WARM[] = {
+    { 1, 30 }, { 0, 79 }, { 1, 81 }, { 0, 48 }, { 1, 23 }, { 0, 49 }, { 1, 25 }, { 0, 48 },
+    { 1, 27 }, { 0, 51 }, { 1, 23 }, { 0, 49 }, { 1, 26 }, { 0, 54 }, { 1, 23 }, { 0, 51 },
+    { 1, 68 }, { 0, 54 }, { 1, 23 }, { 0, 49 }, { 1, 69 }, { 0, 48 }, { 1, 27 }, { 0, 54 },
+    { 1, 23 }, { 0, 51 }, { 1, 23 }, { 0, 50 }, { 1, 70 }, { 0, 54 }, { 1, 69 }, { 0, 49 },
+    { 1, 27 }, { 0, 52 }, { 1, 27 }, { 0, 50 }, { 1, 23 }, { 0, 51 }, { 1, 25 }, { 0, 49 },
+    { 1, 27 }, { 0, 49 }, { 1, 27 }, { 0, 48 }, { 1, 27 }, { 0, 51 }, { 1, 26 }, { 0, 54 },
+    { 1, 29 }, { 0, 53 }, { 1, 71 }, { 0, 55 }, { 1, 25 }, { 0, 52 }, { 1, 69 }, { 0, 50 },
+    { 1, 28 }, { 0, 51 }, { 1, 68 }, { 0, 52 }, { 1, 72 }, { 0, 55 }, { 1, 70 }, { 0, 55 },
+    { 1, 70 }, { 0, 49 }, { 1, 68 }, { 0, 54 }, { 1, 69 }, { 0, 53 }, { 1, 69 }, { 0, 55 },
+    { 1, 71 }, { 0, 48 }, { 1, 28 }, { 0, 49 }, { 1, 74 }, { 0, 53 }, { 1, 70 }, { 0, 53 },
+    { 1, 72 }, { 0, 55 }, { 1, 27 }, { 0, 55 },
+};
+
+// 43.5 %RH, -10.1 °C
+static const edge_t TRACE_FREEZING[] = {
+    { 1, 22 }, { 0, 84 }, { 1, 78 }, { 0, 52 }, { 1, 26 }, { 0, 49 }, { 1, 23 }, { 0, 52 },
+    { 1, 28 }, { 0, 55 }, { 1, 25 }, { 0, 54 }, { 1, 28 }, { 0, 53 }, { 1, 23 }, { 0, 55 },
+    { 1, 25 }, { 0, 50 }, { 1, 72 }, { 0, 49 }, { 1, 71 }, { 0, 48 }, { 1, 24 }, { 0, 52 },
+    { 1, 69 }, { 0, 51 }, { 1, 71 }, { 0, 54 }, { 1, 29 }, { 0, 55 }, { 1, 23 }, { 0, 50 },
+    { 1, 71 }, { 0, 54 }, { 1, 72 }, { 0, 52 }, { 1, 69 }, { 0, 54 }, { 1, 29 }, { 0, 52 },
+    { 1, 28 }, { 0, 54 }, { 1, 25 }, { 0, 54 }, { 1, 24 }, { 0, 50 }, { 1, 23 }, { 0, 50 },
+    { 1, 24 }, { 0, 51 }, { 1, 28 }, { 0, 51 }, { 1, 23 }, { 0, 55 }, { 1, 74 }, { 0, 50 },
+    { 1, 70 }, { 0, 52 }, { 1, 23 }, { 0, 50 }, { 1, 26 }, { 0, 53 }, { 1, 72 }, { 0, 53 },
+    { 1, 24 }, { 0, 48 }, { 1, 71 }, { 0, 54 }, { 1, 71 }, { 0, 54 }, { 1, 26 }, { 0, 49 },
+    { 1, 26 }, { 0, 54 }, { 1, 68 }, { 0, 51 }, { 1, 68 }, { 0, 51 }, { 1, 26 }, { 0, 50 },
+    { 1, 23 }, { 0, 53 }, { 1, 72 }, { 0, 48 },
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static int s_failed;
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+            s_failed++;                                                       \
+        }                                                                     \
+    } while (0)
+
+/* Feed count edges (a capture that timed out has fewer) and decode. */
+static int decode_trace(const edge_t *edges, size_t count, float *t, float *h)
+{
+    uint16_t highs[DHT22_FRAME_BITS + 2];
+    dht22_pulses_t p;
+    dht22_pulses_init(&p, highs, COUNT(highs));
+    for (size_t i = 0; i < count; i++) {
+        dht22_pulses_add(&p, edges[i].level, edges[i].us);
+    }
+    return dht22_decode(highs, p.count, t, h);
+}
+
+static void test_decode(void)
+{
+    float t = 0, h = 0;
+    CHECK(decode_trace(TRACE_WARM, COUNT(TRACE_WARM), &t, &h) == 0);
+    CHECK(fabsf(t - 35.1f) < 0.01f && fabsf(h - 65.2f) < 0.01f);
+    CHECK(decode_trace(TRACE_FREEZING, COUNT(TRACE_FREEZING), &t, &h) == 0);
+    CHECK(fabsf(t + 10.1f) < 0.01f && fabsf(h - 43.5f) < 0.01f);
+}
+
+static void test_checksum(void)
+{
+    // One humidity bit read as a 1 instead of a 0
+    edge_t bad[COUNT(TRACE_WARM)];
+    for (size_t i = 0; i < COUNT(bad); i++) {
+        bad[i] = TRACE_WARM[i];
+    }
+    bad[4].us = 70;
+    float t = -99, h = -99;
+    CHECK(decode_trace(bad, COUNT(bad), &t, &h) == -1);
+    CHECK(t == -99 && h == -99);
+}
+
+static void test_timeout(void)
+{
+    float t, h;
+    // The receive timed out half way through, or before any answer
+    CHECK(decode_trace(TRACE_WARM, 40, &t, &h) == -1);
+    CHECK(decode_trace(TRACE_WARM, 0, &t, &h) == -1);
+    // RMT end-of-buffer markers are ignored
+    uint16_t highs[4];
+    dht22_pulses_t p;
+    dht22_pulses_init(&p, highs, COUNT(highs));
+    dht22_pulses_add(&p, 0, 50);
+    dht22_pulses_add(&p, 1, 0);
+    CHECK(p.count == 0);
+    // Failed reads back off exponentially up to the cap
+    CHECK(dht22_backoff_ms(1) == DHT22_MIN_INTERVAL_MS);
+    CHECK(dht22_backoff_ms(2) == 2 * DHT22_MIN_INTERVAL_MS);
+    CHECK(dht22_backoff_ms(5) == DHT22_MAX_BACKOFF_MS);
+    CHECK(dht22_backoff_ms(100) == DHT22_MAX_BACKOFF_MS);
+}
+
+int main(void)
+{
+    test_decode();
+    test_checksum();
+    test_timeout();
+    printf("test_dht22: %s\n", s_failed ? "FAILED" : "ok");
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Host test of file_save() and file_recover() on a scratch directory:
+ * leftovers of an interrupted save are finished or undone, and files
+ * that merely end in .bak or .tmp (db_backup()'s copy) are left alone.
+ */
+
+#include "storage/file_manager.h"
+
+static int s_failed;
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+            s_failed++;                                                       \
+        }                                                                     \
+    } while (0)
+
+static char s_dir[32];
+
+/* --- Helpers ---------------------------------------------------------- */
+
+static void put(const char *name, const char *text)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", s_dir, name);
+    FILE *f = fopen(path, "wb");
+    fputs(text, f);
+    fclose(f);
+}
+
+/* Contents of name, or "" when it does not exist. */
+static const char *get(const char *name)
+{
+    static char text[32];
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", s_dir, name);
+    int n = file_load(path, text, sizeof(text) - 1);
+    text[n > 0 ? n : 0] = '\0';
+    return text;
+}
+
+/* --- Tests ------------------------------------------------------------ */
+
+static void test_save(void)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s/config.json", s_dir);
+    CHECK(file_save(path, "one", 3) == 0);
+    CHECK(file_save(path, "two", 3) == 0);
+    CHECK(strcmp(get("config.json"), "two") == 0);
+    CHECK(file_recover(s_dir) == 0);
+}
+
+static void test_recover(void)
+{
+    put("reptiles.db", "live");
+    put("reptiles.db.bak", "backup");           // db_backup(), not ours
+    put("notes.tmp", "foreign");
+    put("saved.json", "new");
+    put("saved.json.fs-bak", "old");            // Reset before the cleanup
+    put("moved.json.fs-bak", "old");            // Reset between the renames
+    put("moved.json.fs-tmp", "new");
+    for (int i = 0; i < 10; i++) {              // More than one batch
+        char name[32];
+        snprintf(name, sizeof(name), "torn%d.json.fs-tmp", i);
+        put(name, "partial");
+    }
+    CHECK(file_recover(s_dir) == 13);
+    CHECK(strcmp(get("reptiles.db.bak"), "backup") == 0);
+    CHECK(strcmp(get("reptiles.db"), "live") == 0);
+    CHECK(strcmp(get("notes.tmp"), "foreign") == 0);
+    CHECK(strcmp(get("saved.json"), "new") == 0);
+    CHECK(strcmp(get("saved.json.fs-bak"), "") == 0);
+    CHECK(strcmp(get("moved.json"), "old") == 0);
+    CHECK(strcmp(get("moved.json.fs-tmp"), "") == 0);
+    CHECK(strcmp(get("torn9.json.fs-tmp"), "") == 0);
+    CHECK(file_recover(s_dir) == 0);
+}
+
+int main(void)
+{
+    snprintf(s_dir, sizeof(s_dir), "/tmp/recoverXXXXXX");
+    CHECK(mkdtemp(s_dir) != NULL);
+    test_save();
+    test_recover();
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "rm -r %s", s_dir);
+    CHECK(system(cmd) == 0);
+    if (s_failed) {
+        printf("%d check(s) failed\n", s_failed);
+        return 1;
+    }
+    printf("file recover: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+Pack a built web UI for the /ui/ static file handler.
+
+Every file of the source directory (the output of the UI bundler) is
+stored in the output directory under the first 16 hex digits of its
+SHA-256, with a gzipped copy next to it when that saves at least 10 %.
+A manifest maps URL paths to these names, so the device never scans a
+directory and the ETag of a file is its content hash.
+
+Files whose names already carry a bundler hash (app.3f9c21d0.js,
+index-B8k2fQ1x.css) are flagged immutable and cached by browsers for a
+year; everything else revalidates.
+
+The output directory holds the contents of /spiffs/www.  Add it to the
+SPIFFS image with spiffsgen.py, or upload it next to the existing data.
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+
+HASHED_NAME = r"[.-](?=[0-9A-Za-z_]*\d)[0-9A-Za-z_]{8,}\.\w+$"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack a web UI for /spiffs/www")
+    parser.add_argument("source", help="Directory with the built UI (index.html at its root)")
+    parser.add_argument("output", help="Directory to write hashed files and the manifest to")
+    parser.add_argument("--immutable", default=HASHED_NAME,
+                        help="Regex matching file names that embed a content hash")
+    args = parser.parse_args()
+
+    immutable = re.compile(args.immutable)
+    os.makedirs(args.output, exist_ok=True)
+    entries = []
+    for root, _, files in os.walk(args.source):
+        for name in sorted(files):
+            full = os.path.join(root, name)
+            url = "/" + os.path.relpath(full, args.source).replace(os.sep, "/")
+            if " " in url:
+                raise SystemExit(f"{url}: spaces are not supported in UI paths")
+            with open(full, "rb") as f:
+                data = f.read()
+            digest = hashlib.sha256(data).hexdigest()[:16]
+            with open(os.path.join(args.output, digest), "wb") as f:
+                f.write(data)
+            packed = gzip.compress(data, compresslevel=9, mtime=0)
+            gz_size = 0
+            if len(packed) * 10 <= len(data) * 9:
+                gz_size = len(packed)
+                with open(os.path.join(args.output, digest + ".gz"), "wb") as f:
+                    f.write(packed)
+            flags = "i" if immutable.search(name) and name != "index.html" else "-"
+            entries.append((url, digest, len(data), gz_size, flags))
+
+    lines = ["# hash size gz_size flags path"]
+    for url, digest, size, gz_size, flags in sorted(entries):
+        lines.append(f"{digest} {size} {gz_size} {flags} {url}")
+    with open(os.path.join(args.output, "manifest"), "w") as f:
+        f.write("\n".join(lines) + "\n")
+    total = sum(e[2] for e in entries)
+    sent = sum(e[3] or e[2] for e in entries)
+    print(f"{len(entries)} files, {total} bytes ({sent} bytes as served compressed)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,29 @@
+#!/usr/bin/env python3
+"""
+Gzip a web asset for embedding in the firmware.
+
+The output is reproducible (no file name, zero mtime) so rebuilding an
+unchanged page produces an identical image, and is compressed at the
+highest level since the cost is paid once on the build machine.
+"""
+
+import argparse
+import gzip
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Gzip a web asset")
+    parser.add_argument("source", help="File to compress")
+    parser.add_argument("output", help="Path of the .gz file to write")
+    args = parser.parse_args()
+
+    with open(args.source, "rb") as f:
+        data = f.read()
+    packed = gzip.compress(data, compresslevel=9, mtime=0)
+    with open(args.output, "wb") as f:
+        f.write(packed)
+    print(f"{args.source}: {len(data)} -> {len(packed)} bytes")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+Build a delta OTA patch between two firmware images.
+
+The patch turns the image running on a device (old) into a new build
+and is applied on the device by ota/ota_delta.c while it streams in.
+The format follows bsdiff: a sequence of records
+
+    u32 diff_len, u32 extra_len, i32 seek, diff bytes, extra bytes
+
+where the diff bytes are added (mod 256) to the old image at the
+current position, the extra bytes are copied as they are, and seek
+moves the old position.  Code that only moved by a few bytes produces
+diff runs that are nearly all zeros, which compress extremely well.
+The records are compressed as raw DEFLATE with a 4 KB window so the
+device can inflate with a 4 KB ring buffer.
+
+Header (little endian, 80 bytes, uncompressed):
+    "TDP1", u32 old_size, u32 new_size, u32 flags (0),
+    sha256(old image), sha256(new image)
+"""
+
+import argparse
+import hashlib
+import struct
+import zlib
+
+MAGIC = b"TDP1"
+KEY = 16            # Bytes hashed to find candidate matches
+STRIDE = 4          # Old image positions indexed
+GIVE_UP = 64        # Stop extending a match after this many bytes without gain
+
+
+def index_old(old):
+    table = {}
+    for j in range(0, len(old) - KEY + 1, STRIDE):
+        table.setdefault(old[j:j + KEY], j)
+    return table
+
+
+def extend(old, new, i, j):
+    """Approximate match length from new[i] / old[j], bsdiff scoring."""
+    limit = min(len(new) - i, len(old) - j)
+    score = best_score = best_len = 0
+    k = 0
+    while k < limit and k - best_len <= GIVE_UP:
+        if old[j + k] == new[i + k]:
+            score += 1
+        k += 1
+        if score * 2 - k > best_score * 2 - best_len:
+            best_score, best_len = score, k
+    return best_len
+
+
+def diff(old, new):
+    table = index_old(old)
+    records = []
+    d_new = d_old = d_len = 0       # Current diff region
+    i = 0
+    while i + KEY <= len(new):
+        expected = d_old + d_len + (i - d_new - d_len)
+        key = new[i:i + KEY]
+        if 0 <= expected <= len(old) - KEY and old[expected:expected + KEY] == key:
+            j = expected
+        else:
+            j = table.get(key)
+            if j is None:
+                i += 1
+                continue
+        # Recover bytes the sampling skipped, without eating the last region
+        while i > d_new + d_len and j > 0 and new[i - 1] == old[j - 1]:
+            i -= 1
+            j -= 1
+        length = extend(old, new, i, j)
+        if length < KEY:
+            i += 1
+            continue
+        records.append((d_new, d_old, d_len, i - d_new - d_len, j - (d_old + d_len)))
+        d_new, d_old, d_len = i, j, length
+        i += length
+    records.append((d_new, d_old, d_len, len(new) - d_new - d_len, 0))
+    return records
+
+
+def encode(old, new, records):
+    out = bytearray()
+    for d_new, d_old, d_len, extra_len, seek in records:
+        out += struct.pack("<IIi", d_len, extra_len, seek)
+        out += bytes((new[d_new + k] - old[d_old + k]) & 0xFF for k in range(d_len))
+        out += new[d_new + d_len:d_new + d_len + extra_len]
+    return bytes(out)
+
+
+def apply(old, body):
+    new = bytearray()
+    pos = old_pos = 0
+    while pos < len(body):
+        d_len, extra_len, seek = struct.unpack_from("<IIi", body, pos)
+        pos += 12
+        new += bytes((body[pos + k] + old[old_pos + k]) & 0xFF for k in range(d_len))
+        pos += d_len
+        old_pos += d_len
+        new += body[pos:pos + extra_len]
+        pos += extra_len
+        old_pos += seek
+    return bytes(new)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Create a delta OTA patch")
+    parser.add_argument("old", help="Firmware image running on the devices")
+    parser.add_argument("new", help="Firmware image to install")
+    parser.add_argument("patch", help="Patch file to write")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    body = encode(old, new, diff(old, new))
+    if apply(old, body) != new:
+        raise SystemExit("internal error: patch does not reproduce the new image")
+    packer = zlib.compressobj(9, zlib.DEFLATED, -12, 9)
+    packed = packer.compress(body) + packer.flush()
+
+    header = MAGIC + struct.pack("<III", len(old), len(new), 0)
+    header += hashlib.sha256(old).digest() + hashlib.sha256(new).digest()
+    with open(args.patch, "wb") as f:
+        f.write(header + packed)
+    size = len(header) + len(packed)
+    print(f"{args.patch}: {size} bytes, {len(new) / size:.1f}x smaller than the image")
+
+
+if __name__ == "__main__":
+    main()
@@ -2,13 +2,18 @@
 """
 Upload a firmware binary to an ESP32 device using the OTA HTTP API.
 
-This script is a placeholder that demonstrates how you might send
-the contents of a firmware file via HTTP POST to the `/api/v1/ota/update`
-endpoint on the device.  The real implementation would handle
-authentication, error checking and response parsing.
+The firmware file is POSTed as multipart/form-data to the
+`/api/v1/ota/update` endpoint together with its SHA-256, which the
+device checks before switching to the new image.  The device writes
+the image to flash as it arrives; progress is also pushed to WebSocket
+clients on /api/v1/ws.
+
+With --delta the file is a patch from make_delta.py; the digest sent is
+the one of the image the patch rebuilds, read from the patch header.
 """
 
 import argparse
+import hashlib
 import requests
 
 
@@ -17,10 +22,28 @@ def main():
     parser.add_argument("device_url", help="Base URL of the device, e.g. http://192.168.1.100")
     parser.add_argument("firmware", help="Path to firmware binary")
     parser.add_argument("token", help="Bearer token for authentication")
+    parser.add_argument("--delta", action="store_true", help="The file is a delta patch")
     args = parser.parse_args()
 
+    digest = hashlib.sha256()
+    with open(args.firmware, "rb") as f:
+        if args.delta:
+            header = f.read(80)
+            if header[:4] != b"TDP1":
+                raise SystemExit(f"{args.firmware} is not a delta patch")
+            sha256 = header[48:80].hex()
+        else:
+            for block in iter(lambda: f.read(65536), b""):
+                digest.update(block)
+            sha256 = digest.hexdigest()
+
     with open(args.firmware, "rb") as f:
-        files = {"firmware": ("firmware.bin", f, "application/octet-stream")}
+        # The digest goes first so the device knows it before the image ends
+        part = "delta" if args.delta else "firmware"
+        files = {
+            "sha256": (None, sha256),
+            part: (part + ".bin", f, "application/octet-stream"),
+        }
         headers = {"Authorization": f"Bearer {args.token}"}
         url = args.device_url.rstrip("/") + "/api/v1/ota/update"
         print(f"Uploading {args.firmware} to {url}...")
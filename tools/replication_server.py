@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Stand-in replication server for testing the device's upstream replication.
+
+Accepts the gzipped NDJSON batches POSTed by the replicator, appends
+their lines to an output file, and acknowledges each one with
+"X-Ack: <X-Batch>".  Batches can arrive again after a failure, so a real
+server should upsert mutations by (table, key) and readings by
+(channel, t); this one only records what it was sent.
+
+It speaks plain HTTP: build the device with CONFIG_APP_REPL_TLS=n and
+no server user, or put it behind a TLS proxy the device's certificate
+bundle trusts.
+
+--fail-every N refuses every Nth batch with a 503 to exercise resumption.
+"""
+
+import argparse
+import gzip
+import http.server
+import sys
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"     # Keep-alive, so batches can be pipelined
+    batches = 0
+
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        batch = self.headers.get("X-Batch", "")
+        cls = type(self)
+        cls.batches += 1
+        if self.server.fail_every and cls.batches % self.server.fail_every == 0:
+            self.reply(503, None)
+            return
+        try:
+            if self.headers.get("Content-Encoding") == "gzip":
+                body = gzip.decompress(body)
+            lines = body.decode("utf-8").splitlines()
+        except (OSError, UnicodeDecodeError):
+            self.reply(400, None)
+            return
+        with open(self.server.out, "a", encoding="utf-8") as out:
+            for line in lines:
+                out.write(line + "\n")
+        sys.stderr.write("batch %s from %s (%s): %d records, %d bytes\n"
+                         % (batch, self.headers.get("X-Device"), self.headers.get("X-Database"),
+                            len(lines), len(body)))
+        self.reply(204, batch)
+
+    def reply(self, status, ack):
+        self.send_response(status)
+        if ack is not None:
+            self.send_header("X-Ack", ack)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def log_message(self, fmt, *args):
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Receive replication batches from the device")
+    parser.add_argument("--port", type=int, default=8080, help="Port to listen on")
+    parser.add_argument("--out", default="replicated.ndjson", help="File the records are appended to")
+    parser.add_argument("--fail-every", type=int, default=0, metavar="N",
+                        help="Refuse every Nth batch with a 503")
+    args = parser.parse_args()
+
+    server = http.server.ThreadingHTTPServer(("", args.port), Handler)
+    server.out = args.out
+    server.fail_every = args.fail_every
+    print("Listening on port %d, writing to %s" % (args.port, args.out))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+Compile the species regulation list into the flash image read by
+species/species_index.c.
+
+The source is a CSV with the columns of the species_regulations table
+(main/species/species_regulations.csv).  The image is written to the
+"species" partition and read in place through a memory mapping, so a
+lookup costs a few flash reads and no RAM.  Rebuilding only the list
+and flashing the partition updates the dataset without a new firmware:
+
+    parttool.py write_partition --partition-name species --input species.bin
+
+Layout (little endian):
+    header, 32 bytes:
+        "SPR1", u32 count, u32 record_size, u32 strings_size,
+        u32 dataset date (newest last_updated), u32 crc32 of the rest,
+        8 reserved bytes
+    i32 displacement[count]     minimal perfect hash, see below
+    record[count]               in hash order
+    strings                     NUL terminated, offset 0 is ""
+
+A record is seven u32 string offsets (scientific_name, common_names,
+family, category, cites_appendix, eu_annex, france_column), a u32
+last_updated and a u8 of flags (domestic, dangerous, invasive) padded
+to 36 bytes.
+
+The hash is hash-and-displace over the lower-cased scientific name
+with a seeded FNV: key k goes to bucket h(0, k) % count; a bucket with
+displacement d > 0 places its keys at h(d, k) % count, one with d < 0
+at slot -d - 1.  The device hashes the same way and compares the name
+stored in the slot, since any string maps to some slot.
+"""
+
+import argparse
+import csv
+import datetime
+import struct
+import zlib
+
+MAGIC = b"SPR1"
+HEADER = struct.Struct("<4sIIIII8x")
+RECORD = struct.Struct("<8IB3x")
+STRINGS = ("scientific_name", "common_names", "family", "category",
+           "cites_appendix", "eu_annex", "france_column")
+FLAGS = ("domestic", "dangerous", "invasive")
+FNV_PRIME = 0x01000193
+
+
+def fnv(d, key):
+    h = d or FNV_PRIME
+    for c in key:
+        h = ((h * FNV_PRIME) ^ c) & 0xFFFFFFFF
+    return h
+
+
+def perfect_hash(keys):
+    """Displacement table placing each key in its own slot."""
+    n = len(keys)
+    buckets = [[] for _ in range(n)]
+    for i, key in enumerate(keys):
+        buckets[fnv(0, key) % n].append(i)
+    displacement = [0] * n
+    slot_of = [None] * n
+    taken = [False] * n
+    order = sorted(range(n), key=lambda b: -len(buckets[b]))
+    for b in order:
+        items = buckets[b]
+        if len(items) <= 1:
+            break
+        d = 1
+        while True:
+            slots = [fnv(d, keys[i]) % n for i in items]
+            if len(set(slots)) == len(slots) and not any(taken[s] for s in slots):
+                break
+            d += 1
+        displacement[b] = d
+        for i, s in zip(items, slots):
+            taken[s] = True
+            slot_of[i] = s
+    free = [s for s in range(n) if not taken[s]]
+    for b in order:
+        if len(buckets[b]) == 1:
+            s = free.pop()
+            displacement[b] = -s - 1
+            slot_of[buckets[b][0]] = s
+    return displacement, slot_of
+
+
+def flag(value):
+    return value.strip().lower() in ("1", "true", "yes", "y")
+
+
+def date(value):
+    if not value.strip():
+        return 0
+    day = datetime.date.fromisoformat(value.strip())
+    return int(datetime.datetime(day.year, day.month, day.day,
+                                 tzinfo=datetime.timezone.utc).timestamp())
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build the species regulation image")
+    parser.add_argument("source", help="CSV with the species_regulations columns")
+    parser.add_argument("output", help="Partition image to write")
+    parser.add_argument("--size", type=lambda s: int(s, 0), default=0,
+                        help="Partition size the image must fit in")
+    args = parser.parse_args()
+
+    with open(args.source, newline="", encoding="utf-8") as f:
+        rows = [r for r in csv.DictReader(line for line in f if not line.startswith("#"))]
+    names = set()
+    for r in rows:
+        r["scientific_name"] = " ".join(r["scientific_name"].split())
+        key = r["scientific_name"].lower()
+        if not key or not key.isascii():
+            raise SystemExit(f"{args.source}: invalid scientific name {r['scientific_name']!r}")
+        if key in names:
+            raise SystemExit(f"{args.source}: duplicate species {r['scientific_name']}")
+        names.add(key)
+    if not rows:
+        raise SystemExit(f"{args.source}: no species")
+
+    keys = [r["scientific_name"].lower().encode() for r in rows]
+    displacement, slot_of = perfect_hash(keys)
+
+    strings = bytearray(b"\0")
+    offsets = {"": 0}
+
+    def intern(s):
+        s = s.strip()
+        if s not in offsets:
+            offsets[s] = len(strings)
+            strings.extend(s.encode("utf-8") + b"\0")
+        return offsets[s]
+
+    records = [b""] * len(rows)
+    for r, slot in zip(rows, slot_of):
+        flags = sum(1 << i for i, name in enumerate(FLAGS) if flag(r.get(name, "")))
+        records[slot] = RECORD.pack(*(intern(r.get(name, "")) for name in STRINGS),
+                                    date(r.get("last_updated", "")), flags)
+    while len(strings) % 4:
+        strings.append(0)
+
+    body = struct.pack(f"<{len(rows)}i", *displacement) + b"".join(records) + bytes(strings)
+    dataset = max(date(r.get("last_updated", "")) for r in rows)
+    header = HEADER.pack(MAGIC, len(rows), RECORD.size, len(strings), dataset, zlib.crc32(body))
+    image = header + body
+    if args.size and len(image) > args.size:
+        raise SystemExit(f"{args.output}: {len(image)} bytes do not fit the {args.size} byte partition")
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print(f"{args.output}: {len(rows)} species, {len(image)} bytes")
+
+
+if __name__ == "__main__":
+    main()